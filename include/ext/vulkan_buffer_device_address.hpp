@@ -0,0 +1,19 @@
+#pragma once
+#include "vulkan_extension_management.hpp"
+
+// Lets buffers created with VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT hand out GPU addresses through VulkanBuffer::getDeviceAddress
+// The memory allocator picks this up and allocates with VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT
+class VulkanBufferDeviceAddressExtension final : public VulkanDeviceExtension
+{
+public:
+    static VulkanBufferDeviceAddressExtension* get(const VulkanDevice& p_Device);
+    static VulkanBufferDeviceAddressExtension* get(ResourceID p_DeviceID);
+
+    explicit VulkanBufferDeviceAddressExtension(ResourceID p_DeviceID);
+
+    [[nodiscard]] VkBaseInStructure* getExtensionStruct() const override;
+    [[nodiscard]] VkStructureType getExtensionStructType() const override { return VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES_KHR; }
+
+    void free() override {}
+    std::string getMainExtensionName() override { return VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME; }
+};
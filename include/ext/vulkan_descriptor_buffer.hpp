@@ -0,0 +1,31 @@
+#pragma once
+#include <vector>
+
+#include "vulkan_extension_management.hpp"
+
+// Lets descriptors live in plain buffers instead of pools and sets, see VulkanDescriptorBuffer
+// The buffers need device addresses, so VulkanBufferDeviceAddressExtension has to be enabled as well
+class VulkanDescriptorBufferExtension final : public VulkanDeviceExtension
+{
+public:
+    static VulkanDescriptorBufferExtension* get(const VulkanDevice& p_Device);
+    static VulkanDescriptorBufferExtension* get(ResourceID p_DeviceID);
+
+    explicit VulkanDescriptorBufferExtension(ResourceID p_DeviceID);
+
+    [[nodiscard]] VkBaseInStructure* getExtensionStruct() const override;
+    [[nodiscard]] VkStructureType getExtensionStructType() const override { return VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT; }
+
+    // Descriptor sizes and buffer alignments, queried on first use
+    [[nodiscard]] const VkPhysicalDeviceDescriptorBufferPropertiesEXT& getProperties() const;
+    // Bytes vkGetDescriptorEXT writes for one descriptor of p_Type, which is also the stride between array elements
+    [[nodiscard]] size_t getDescriptorSize(VkDescriptorType p_Type) const;
+
+    void free() override {}
+    std::string getMainExtensionName() override { return VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME; }
+    std::vector<std::string> getExtraExtensionNames() override { return {VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME}; }
+
+private:
+    mutable VkPhysicalDeviceDescriptorBufferPropertiesEXT m_Properties{};
+    mutable bool m_PropertiesQueried = false;
+};
@@ -0,0 +1,29 @@
+#pragma once
+#include <vector>
+
+#include "vulkan_extension_management.hpp"
+
+// Enables update after bind, partially bound and non uniformly indexed descriptor arrays of sampled images, storage images
+// and storage buffers, which is everything a bindless heap needs
+class VulkanDescriptorIndexingExtension final : public VulkanDeviceExtension
+{
+public:
+    static VulkanDescriptorIndexingExtension* get(const VulkanDevice& p_Device);
+    static VulkanDescriptorIndexingExtension* get(ResourceID p_DeviceID);
+
+    explicit VulkanDescriptorIndexingExtension(ResourceID p_DeviceID);
+
+    [[nodiscard]] VkBaseInStructure* getExtensionStruct() const override;
+    [[nodiscard]] VkStructureType getExtensionStructType() const override { return VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT; }
+
+    // Update after bind limits, queried on first use
+    [[nodiscard]] const VkPhysicalDeviceDescriptorIndexingPropertiesEXT& getProperties() const;
+
+    void free() override {}
+    std::string getMainExtensionName() override { return VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME; }
+    std::vector<std::string> getExtraExtensionNames() override { return {VK_KHR_MAINTENANCE_3_EXTENSION_NAME}; }
+
+private:
+    mutable VkPhysicalDeviceDescriptorIndexingPropertiesEXT m_Properties{};
+    mutable bool m_PropertiesQueried = false;
+};
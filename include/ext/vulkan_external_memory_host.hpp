@@ -0,0 +1,38 @@
+#pragma once
+#include <map>
+
+#include "vulkan_extension_management.hpp"
+#include "vulkan_memory.hpp"
+
+class VulkanExternalMemoryHostExtension final : public VulkanDeviceExtension
+{
+public:
+    struct HostImport
+    {
+        ResourceID buffer = UINT32_MAX;
+        // Where the imported pointer starts inside the buffer, since the import itself has to be aligned down
+        VkDeviceSize offset = 0;
+    };
+
+    static VulkanExternalMemoryHostExtension* get(const VulkanDevice& p_Device);
+    static VulkanExternalMemoryHostExtension* get(ResourceID p_DeviceID);
+
+    explicit VulkanExternalMemoryHostExtension(ResourceID p_DeviceID);
+
+    [[nodiscard]] VkBaseInStructure* getExtensionStruct() const override { return nullptr; }
+    [[nodiscard]] VkStructureType getExtensionStructType() const override { return VK_STRUCTURE_TYPE_MAX_ENUM; }
+
+    // Wraps host memory in a buffer without copying it. The memory must outlive the buffer. Returns a buffer of UINT32_MAX if the driver can't import it
+    [[nodiscard]] HostImport importHostPointer(const void* p_Pointer, VkDeviceSize p_Size, VkBufferUsageFlags p_Usage);
+    void freeImportedBuffer(ResourceID p_Buffer);
+
+    [[nodiscard]] VkDeviceSize getMinImportedHostPointerAlignment() const;
+
+    void free() override;
+
+    std::string getMainExtensionName() override { return VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME; }
+
+private:
+    std::map<ResourceID, VkDeviceMemory> m_ImportedMemory;
+    mutable VkDeviceSize m_MinAlignment = 0;
+};
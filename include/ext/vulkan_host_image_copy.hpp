@@ -0,0 +1,30 @@
+#pragma once
+#include <vector>
+
+#include "vulkan_extension_management.hpp"
+
+class VulkanHostImageCopyExtension final : public VulkanDeviceExtension
+{
+public:
+    static VulkanHostImageCopyExtension* get(const VulkanDevice& p_Device);
+    static VulkanHostImageCopyExtension* get(ResourceID p_DeviceID);
+
+    explicit VulkanHostImageCopyExtension(ResourceID p_DeviceID);
+
+    [[nodiscard]] VkBaseInStructure* getExtensionStruct() const override;
+    [[nodiscard]] VkStructureType getExtensionStructType() const override { return VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT; }
+
+    // Layouts vkCopyMemoryToImageEXT can write to on this device
+    [[nodiscard]] bool isCopyDstLayout(VkImageLayout p_Layout) const;
+    [[nodiscard]] bool isFormatSupported(VkFormat p_Format, VkImageTiling p_Tiling) const;
+
+    void free() override {}
+    std::string getMainExtensionName() override { return VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME; }
+    std::vector<std::string> getExtraExtensionNames() override { return {VK_KHR_COPY_COMMANDS_2_EXTENSION_NAME, VK_KHR_FORMAT_FEATURE_FLAGS_2_EXTENSION_NAME}; }
+
+private:
+    void queryLayouts() const;
+
+    mutable std::vector<VkImageLayout> m_CopyDstLayouts;
+    mutable bool m_LayoutsQueried = false;
+};
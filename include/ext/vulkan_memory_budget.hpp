@@ -0,0 +1,17 @@
+#pragma once
+#include "vulkan_extension_management.hpp"
+
+class VulkanMemoryBudgetExtension final : public VulkanDeviceExtension
+{
+public:
+    static VulkanMemoryBudgetExtension* get(const VulkanDevice& p_Device);
+    static VulkanMemoryBudgetExtension* get(ResourceID p_DeviceID);
+
+    explicit VulkanMemoryBudgetExtension(ResourceID p_DeviceID);
+
+    [[nodiscard]] VkBaseInStructure* getExtensionStruct() const override { return nullptr; }
+    [[nodiscard]] VkStructureType getExtensionStructType() const override { return VK_STRUCTURE_TYPE_MAX_ENUM; }
+
+    void free() override {}
+    std::string getMainExtensionName() override { return VK_EXT_MEMORY_BUDGET_EXTENSION_NAME; }
+};
@@ -0,0 +1,18 @@
+#pragma once
+#include "vulkan_extension_management.hpp"
+
+// Enables the memoryPriority feature, the memory allocator only passes priorities to VMA when this extension is loaded
+class VulkanMemoryPriorityExtension final : public VulkanDeviceExtension
+{
+public:
+    static VulkanMemoryPriorityExtension* get(const VulkanDevice& p_Device);
+    static VulkanMemoryPriorityExtension* get(ResourceID p_DeviceID);
+
+    explicit VulkanMemoryPriorityExtension(ResourceID p_DeviceID);
+
+    [[nodiscard]] VkBaseInStructure* getExtensionStruct() const override;
+    [[nodiscard]] VkStructureType getExtensionStructType() const override { return VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PRIORITY_FEATURES_EXT; }
+
+    void free() override {}
+    std::string getMainExtensionName() override { return VK_EXT_MEMORY_PRIORITY_EXTENSION_NAME; }
+};
@@ -0,0 +1,94 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class ThreadPool;
+
+// Non-blocking file reads into caller owned memory. Uses io_uring when built with ASYNC_FILE_READER_USE_IO_URING, and a small thread pool doing blocking reads otherwise
+// Completions are only ever delivered from poll() and wait(), so the caller decides which thread handles them
+class AsyncFileReader
+{
+public:
+    using FileHandle = uint32_t;
+    using RequestID = uint64_t;
+
+    struct Completion
+    {
+        RequestID request;
+        size_t bytesRead;
+        bool success;
+    };
+
+    explicit AsyncFileReader(uint32_t p_QueueDepth = 64, uint32_t p_FallbackThreadCount = 2);
+    ~AsyncFileReader();
+
+    AsyncFileReader(const AsyncFileReader&) = delete;
+    AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+
+    [[nodiscard]] FileHandle openFile(std::string_view p_Path);
+    // Reads still in flight for the file must have completed
+    void closeFile(FileHandle p_File);
+    [[nodiscard]] size_t getFileSize(FileHandle p_File) const;
+
+    // p_Destination must stay valid until the request's completion is returned
+    RequestID read(FileHandle p_File, size_t p_Offset, size_t p_Size, void* p_Destination);
+
+    // Appends the finished reads to p_Completions, returns how many were appended
+    size_t poll(std::vector<Completion>& p_Completions);
+    // Same as poll(), but blocks until at least one read finishes if any are in flight
+    size_t wait(std::vector<Completion>& p_Completions);
+
+    [[nodiscard]] size_t getInFlightCount() const { return m_InFlight; }
+    [[nodiscard]] bool isUsingIoUring() const { return m_IoUring != nullptr; }
+
+private:
+#ifdef _WIN32
+    using NativeFile = void*;
+#else
+    using NativeFile = int;
+#endif
+
+    struct File
+    {
+        NativeFile handle;
+        size_t size;
+    };
+
+    struct Request
+    {
+        NativeFile file;
+        size_t offset;
+        size_t size;
+        uint8_t* destination;
+        size_t done;
+    };
+
+    struct IoUring;
+
+    static bool readBlocking(NativeFile p_File, size_t p_Offset, size_t p_Size, uint8_t* p_Destination, size_t& p_BytesRead);
+
+    bool submitIoUring(RequestID p_Request);
+    size_t drainIoUring(std::vector<Completion>& p_Completions);
+    size_t drainFallback(std::vector<Completion>& p_Completions);
+
+    IoUring* m_IoUring = nullptr;
+    uint32_t m_QueueDepth;
+    std::unordered_map<RequestID, Request> m_Requests;
+    std::deque<RequestID> m_Backlog;
+
+    ThreadPool* m_Pool = nullptr;
+    std::mutex m_CompletedMutex;
+    std::condition_variable m_CompletedCondition;
+    std::vector<Completion> m_Completed;
+
+    std::unordered_map<FileHandle, File> m_Files;
+    FileHandle m_NextFile = 0;
+    RequestID m_NextRequest = 0;
+    size_t m_InFlight = 0;
+};
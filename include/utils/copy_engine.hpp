@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+class ThreadPool;
+
+// Bulk host copies into write-combined (staging) memory, split across worker threads and using streaming stores when available
+class CopyEngine
+{
+public:
+    enum class Path : uint8_t
+    {
+        SCALAR,
+        AVX2_STREAM,
+        AVX512_STREAM
+    };
+
+    struct Stats
+    {
+        size_t bytes = 0;
+        double seconds = 0.0;
+        double gigabytesPerSecond = 0.0;
+        uint32_t threads = 1;
+        Path path = Path::SCALAR;
+    };
+
+    struct BenchmarkResult
+    {
+        Stats baseline;
+        Stats engine;
+    };
+
+    // p_ThreadCount == 0 uses one worker per hardware thread, minus the caller
+    static void init(uint32_t p_ThreadCount = 0);
+    static void free();
+
+    static Stats copy(void* p_Dst, const void* p_Src, size_t p_Size);
+
+    static void setPath(Path p_Path);
+    static void setParallelThreshold(size_t p_Bytes) { s_ParallelThreshold = p_Bytes; }
+
+    [[nodiscard]] static Path getPath() { return s_Path; }
+    [[nodiscard]] static Path getBestSupportedPath();
+    [[nodiscard]] static std::string_view getPathName(Path p_Path);
+    [[nodiscard]] static uint32_t getThreadCount();
+
+    // Compares plain memcpy with the engine on regular host memory. Streaming stores bypass the cache, so host-to-host numbers underestimate gains on write-combined memory
+    static BenchmarkResult benchmark(size_t p_Size, uint32_t p_Iterations);
+
+private:
+    static void copyRange(uint8_t* p_Dst, const uint8_t* p_Src, size_t p_Size, Path p_Path);
+
+    inline static ThreadPool* s_Pool = nullptr;
+    inline static Path s_Path = Path::SCALAR;
+    inline static bool s_PathDetected = false;
+    inline static size_t s_ParallelThreshold = 4ULL * 1024 * 1024;
+
+    CopyEngine() = default;
+};
@@ -0,0 +1,64 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// Keeps up to N elements inside the object and only moves them to the heap past that. Meant for short lists of handles
+// that are searched linearly, order is not preserved on erase
+template<typename T, uint32_t N>
+class InlineVector
+{
+    static_assert(std::is_trivially_copyable_v<T>, "InlineVector only holds trivially copyable types");
+
+public:
+    void push_back(const T& p_Value)
+    {
+        if (m_Size == N && m_Heap.empty())
+        {
+            m_Heap.reserve(N * 2);
+            m_Heap.assign(m_Inline.begin(), m_Inline.end());
+        }
+
+        if (m_Heap.empty())
+            m_Inline[m_Size] = p_Value;
+        else
+            m_Heap.push_back(p_Value);
+        m_Size++;
+    }
+
+    // Swaps the last element into p_Index
+    void eraseUnordered(const uint32_t p_Index)
+    {
+        data()[p_Index] = data()[m_Size - 1];
+        if (!m_Heap.empty())
+            m_Heap.pop_back();
+        m_Size--;
+    }
+
+    void clear()
+    {
+        m_Heap.clear();
+        m_Size = 0;
+    }
+
+    [[nodiscard]] T* data() { return m_Heap.empty() ? m_Inline.data() : m_Heap.data(); }
+    [[nodiscard]] const T* data() const { return m_Heap.empty() ? m_Inline.data() : m_Heap.data(); }
+
+    [[nodiscard]] T* begin() { return data(); }
+    [[nodiscard]] T* end() { return data() + m_Size; }
+    [[nodiscard]] const T* begin() const { return data(); }
+    [[nodiscard]] const T* end() const { return data() + m_Size; }
+
+    [[nodiscard]] T& operator[](const uint32_t p_Index) { return data()[p_Index]; }
+    [[nodiscard]] const T& operator[](const uint32_t p_Index) const { return data()[p_Index]; }
+
+    [[nodiscard]] uint32_t size() const { return m_Size; }
+    [[nodiscard]] bool empty() const { return m_Size == 0; }
+    [[nodiscard]] bool isInline() const { return m_Heap.empty(); }
+
+private:
+    std::array<T, N> m_Inline{};
+    std::vector<T> m_Heap;
+    uint32_t m_Size = 0;
+};
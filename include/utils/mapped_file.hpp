@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    explicit MappedFile(std::string_view p_Path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& p_Other) noexcept;
+    MappedFile& operator=(MappedFile&& p_Other) noexcept;
+
+    void open(std::string_view p_Path);
+    void close();
+
+    // Hints the OS that the mapping is read front to back, so it can read ahead aggressively and drop pages behind us
+    void adviseSequential() const;
+    // Asks the OS to start paging in the range asynchronously
+    void prefetch(size_t p_Offset, size_t p_Size) const;
+
+    [[nodiscard]] bool isOpen() const { return m_Data != nullptr; }
+    [[nodiscard]] const uint8_t* getData() const { return m_Data; }
+    [[nodiscard]] size_t getSize() const { return m_Size; }
+
+    [[nodiscard]] static size_t getPageSize();
+
+private:
+    uint8_t* m_Data = nullptr;
+    size_t m_Size = 0;
+
+#ifdef _WIN32
+    void* m_FileHandle = nullptr;
+    void* m_MappingHandle = nullptr;
+#else
+    int m_FileDescriptor = -1;
+#endif
+};
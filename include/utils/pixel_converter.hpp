@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Converts tightly packed pixels between common source layouts and GPU friendly formats, meant to write straight into
+// staging memory so conversion and upload copy are a single pass over the data
+class PixelConverter
+{
+public:
+    enum class Path : uint8_t
+    {
+        SCALAR,
+        SSE41,
+        // Also requires F16C
+        AVX2
+    };
+
+    enum class Conversion : uint8_t
+    {
+        RGB8_TO_RGBA8,
+        BGR8_TO_RGBA8,
+        BGRA8_TO_RGBA8,
+        // 16 bit unorm to 8 bit unorm, rounded to nearest
+        RGBA16_TO_RGBA8,
+        // Linear float to sRGB encoded 8 bit, alpha stays linear
+        RGBA32F_TO_RGBA8_SRGB,
+        RGB32F_TO_RGBA16F,
+        RGBA32F_TO_RGBA16F,
+        COUNT
+    };
+
+    struct Stats
+    {
+        size_t pixels = 0;
+        double seconds = 0.0;
+        double megapixelsPerSecond = 0.0;
+        Path path = Path::SCALAR;
+    };
+
+    struct BenchmarkResult
+    {
+        Conversion conversion;
+        Stats scalar;
+        Stats converter;
+    };
+
+    // Missing channels are filled with opaque alpha. p_Dst and p_Src must not overlap
+    static Stats convert(Conversion p_Conversion, void* p_Dst, const void* p_Src, size_t p_PixelCount);
+
+    static void setPath(Path p_Path);
+
+    [[nodiscard]] static Path getPath() { return s_Path; }
+    [[nodiscard]] static Path getBestSupportedPath();
+    [[nodiscard]] static std::string_view getPathName(Path p_Path);
+    [[nodiscard]] static std::string_view getConversionName(Conversion p_Conversion);
+    [[nodiscard]] static uint32_t getSrcPixelSize(Conversion p_Conversion);
+    [[nodiscard]] static uint32_t getDstPixelSize(Conversion p_Conversion);
+
+    // Compares the scalar kernel with the selected path on regular host memory and checks both produce the same output
+    static BenchmarkResult benchmark(Conversion p_Conversion, size_t p_PixelCount, uint32_t p_Iterations);
+    static std::vector<BenchmarkResult> benchmarkAll(size_t p_PixelCount, uint32_t p_Iterations);
+
+private:
+    static void convertRange(Conversion p_Conversion, uint8_t* p_Dst, const uint8_t* p_Src, size_t p_PixelCount, Path p_Path);
+
+    inline static Path s_Path = Path::SCALAR;
+    inline static bool s_PathDetected = false;
+
+    PixelConverter() = default;
+};
@@ -104,6 +104,10 @@ struct ShaderReflectionData
     VkShaderStageFlags stageFlags = 0;
 
     [[nodiscard]] VkPushConstantRange getPushConstantRange() const;
+    // One binding per descriptor the program declares in p_Set, sorted by binding and visible to every stage of the program
+    [[nodiscard]] std::vector<VkDescriptorSetLayoutBinding> getDescriptorSetLayoutBindings(uint32_t p_Set) const;
+    // Constant buffers map to uniform buffers and read only images to sampled images, VK_DESCRIPTOR_TYPE_MAX_ENUM if there is no match
+    [[nodiscard]] static VkDescriptorType getDescriptorType(const FieldPtr& p_Field);
     void populateBindings(std::span<VertexBindingRef> p_Bindings, uint32_t p_StartingField = 0) const;
 
     void invalidate() { m_Valid = false; }
@@ -223,6 +227,65 @@ inline VkPushConstantRange ShaderReflectionData::getPushConstantRange() const
     return l_PushConstantRange;
 }
 
+inline std::vector<VkDescriptorSetLayoutBinding> ShaderReflectionData::getDescriptorSetLayoutBindings(const uint32_t p_Set) const
+{
+    std::vector<VkDescriptorSetLayoutBinding> l_Bindings;
+    for (const DescriptorBinding& l_DescriptorBinding : descriptorBindings)
+    {
+        if (l_DescriptorBinding.set != p_Set)
+        {
+            continue;
+        }
+
+        const VkDescriptorType l_Type = getDescriptorType(l_DescriptorBinding.field);
+        if (l_Type == VK_DESCRIPTOR_TYPE_MAX_ENUM)
+        {
+            LOG_WARN("Descriptor ", l_DescriptorBinding.field->name, " (binding ", l_DescriptorBinding.binding, ") has no matching descriptor type, skipping it");
+            continue;
+        }
+
+        VkDescriptorSetLayoutBinding l_Binding{};
+        l_Binding.binding = l_DescriptorBinding.binding;
+        l_Binding.descriptorType = l_Type;
+        l_Binding.descriptorCount = 1;
+        l_Binding.stageFlags = stageFlags;
+        l_Bindings.push_back(l_Binding);
+    }
+
+    std::ranges::sort(l_Bindings, {}, &VkDescriptorSetLayoutBinding::binding);
+    return l_Bindings;
+}
+
+inline VkDescriptorType ShaderReflectionData::getDescriptorType(const FieldPtr& p_Field)
+{
+    if (std::dynamic_pointer_cast<Struct>(p_Field))
+    {
+        return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    }
+
+    const ResourcePtr l_Resource = std::dynamic_pointer_cast<Resource>(p_Field);
+    if (!l_Resource)
+    {
+        return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+    }
+
+    switch (l_Resource->type)
+    {
+    case IMAGE1D:
+    case IMAGE2D:
+    case IMAGE3D:
+        return l_Resource->readOnly ? VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    case BUFFER:
+        return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    case SAMPLER:
+        return VK_DESCRIPTOR_TYPE_SAMPLER;
+    case SUBPASS_INPUT:
+        return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+    default:
+        return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+    }
+}
+
 inline void ShaderReflectionData::populateBindings(std::span<VertexBindingRef> p_Bindings, const uint32_t p_StartingField) const
 {
     const std::vector<VertexBindingRef::Field> l_FlatVertexInputs = getFlatVertexInputs(p_StartingField);
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+#include <Volk/volk.h>
+
+#include "utils/mapped_file.hpp"
+
+// Memory mapped KTX2 or DDS texture. Parsing only reads the headers, subresource data stays in the mapping
+class TextureContainer
+{
+public:
+    struct Subresource
+    {
+        uint32_t mipLevel;
+        uint32_t arrayLayer;
+        size_t offset;
+        size_t size;
+    };
+
+    struct BlockInfo
+    {
+        uint32_t width = 1;
+        uint32_t height = 1;
+        // 0 for formats the loader doesn't know
+        uint32_t bytes = 0;
+    };
+
+    TextureContainer() = default;
+    explicit TextureContainer(std::string_view p_Path);
+
+    // Picks the parser from the file's magic number, throws if the file is malformed or uses a feature the loader doesn't handle
+    void open(std::string_view p_Path);
+    void close();
+
+    [[nodiscard]] bool isOpen() const { return m_File.isOpen(); }
+    [[nodiscard]] VkFormat getFormat() const { return m_Format; }
+    [[nodiscard]] VkImageType getImageType() const { return m_ImageType; }
+    [[nodiscard]] VkExtent3D getExtent() const { return m_Extent; }
+    [[nodiscard]] uint32_t getMipLevels() const { return m_MipLevels; }
+    // Cube faces count as layers, six per cube
+    [[nodiscard]] uint32_t getArrayLayers() const { return m_ArrayLayers; }
+    [[nodiscard]] bool isCube() const { return m_Cube; }
+
+    // Every mip level of every layer, in file order
+    [[nodiscard]] std::span<const Subresource> getSubresources() const { return m_Subresources; }
+    [[nodiscard]] std::span<const uint8_t> getData(const Subresource& p_Subresource) const;
+
+    [[nodiscard]] static BlockInfo getBlockInfo(VkFormat p_Format);
+    [[nodiscard]] static bool isBlockCompressed(VkFormat p_Format);
+    [[nodiscard]] static VkExtent3D getMipExtent(VkExtent3D p_Extent, uint32_t p_MipLevel);
+    // Bytes taken by one layer of one mip level, whole blocks included
+    [[nodiscard]] static size_t getSubresourceSize(VkFormat p_Format, VkExtent3D p_Extent);
+
+    // Formats transcode() can decode, UNDEFINED for the rest. Decoded data is always 4 bytes per texel RGBA
+    [[nodiscard]] static VkFormat getTranscodeFormat(VkFormat p_Format);
+    // p_Dst must hold p_Extent.width * p_Extent.height * p_Extent.depth * 4 bytes
+    static void transcode(VkFormat p_Format, VkExtent3D p_Extent, std::span<const uint8_t> p_Src, uint8_t* p_Dst);
+
+private:
+    void parseKTX2();
+    void parseDDS();
+
+    MappedFile m_File;
+
+    VkFormat m_Format = VK_FORMAT_UNDEFINED;
+    VkImageType m_ImageType = VK_IMAGE_TYPE_2D;
+    VkExtent3D m_Extent{};
+    uint32_t m_MipLevels = 0;
+    uint32_t m_ArrayLayers = 0;
+    bool m_Cube = false;
+
+    std::vector<Subresource> m_Subresources;
+};
@@ -0,0 +1,118 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <Volk/volk.h>
+
+#include "utils/identifiable.hpp"
+
+// One descriptor set holding large update after bind arrays of sampled images, storage images, storage buffers and samplers
+// Resources are registered once and addressed in shaders by the returned index, so a frame binds this set a single time
+// instead of a set per draw. Requires VulkanDescriptorIndexingExtension
+class VulkanBindlessHeap
+{
+public:
+    enum class Type : uint8_t
+    {
+        SAMPLED_IMAGE,
+        STORAGE_IMAGE,
+        STORAGE_BUFFER,
+        SAMPLER,
+        COUNT
+    };
+
+    // Counts are clamped to the device's update after bind limits
+    struct Config
+    {
+        uint32_t sampledImages = 65536;
+        uint32_t storageImages = 8192;
+        uint32_t storageBuffers = 65536;
+        uint32_t samplers = 1024;
+        VkShaderStageFlags stages = VK_SHADER_STAGE_ALL;
+    };
+
+    static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+    explicit VulkanBindlessHeap(ResourceID p_Device, const Config& p_Config = {});
+
+    VulkanBindlessHeap(const VulkanBindlessHeap&) = delete;
+    VulkanBindlessHeap& operator=(const VulkanBindlessHeap&) = delete;
+
+    // Safe to call from any thread. Slots come from a lock free free list and the descriptor write is queued until flush
+    // Returns INVALID_INDEX when the array is full
+    uint32_t registerSampledImage(ResourceID p_Image, ResourceID p_ImageView, VkImageLayout p_Layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    uint32_t registerStorageImage(ResourceID p_Image, ResourceID p_ImageView);
+    uint32_t registerStorageBuffer(ResourceID p_Buffer, VkDeviceSize p_Offset = 0, VkDeviceSize p_Range = VK_WHOLE_SIZE);
+    // Takes a sampler from VulkanDevice::acquireSampler, the heap doesn't hold a reference to it
+    uint32_t registerSampler(ResourceID p_Sampler);
+
+    // The slot is handed out again once p_Fence signals, pass the fence of the last submission that may read it
+    // Without a fence the slot is reused right away
+    void unregister(Type p_Type, uint32_t p_Index, ResourceID p_Fence = UINT32_MAX);
+
+    // Writes every queued descriptor in one vkUpdateDescriptorSets call, merging consecutive slots into a single write
+    // Call once per frame before submitting work that reads the new slots
+    void flush();
+
+    void free();
+
+    [[nodiscard]] ResourceID getLayout() const { return m_Layout; }
+    [[nodiscard]] ResourceID getSet() const { return m_Set; }
+    [[nodiscard]] uint32_t getCapacity(Type p_Type) const { return m_Slots[static_cast<uint32_t>(p_Type)].capacity; }
+    [[nodiscard]] uint32_t getUsedCount(Type p_Type) const { return m_Slots[static_cast<uint32_t>(p_Type)].used.load(std::memory_order_relaxed); }
+    [[nodiscard]] size_t getPendingWriteCount() const;
+
+    // Binding each array lives at, matching the order of Type
+    [[nodiscard]] static uint32_t getBinding(Type p_Type) { return static_cast<uint32_t>(p_Type); }
+    [[nodiscard]] static VkDescriptorType getDescriptorType(Type p_Type);
+
+private:
+    // Treiber stack over slot indices. The head packs the top index in the low half and a counter bumped on every change
+    // in the high half, so a pop racing with a pop and push of the same slot fails its exchange instead of corrupting the list
+    struct SlotList
+    {
+        std::unique_ptr<std::atomic<uint32_t>[]> next;
+        std::atomic<uint64_t> head{INVALID_INDEX};
+        // Slots past this one have never been handed out
+        std::atomic<uint32_t> untouched{0};
+        std::atomic<uint32_t> used{0};
+        uint32_t capacity = 0;
+    };
+
+    struct PendingWrite
+    {
+        Type type;
+        uint32_t index;
+        VkDescriptorImageInfo image;
+        VkDescriptorBufferInfo buffer;
+    };
+
+    struct RetiredSlot
+    {
+        ResourceID fence;
+        Type type;
+        uint32_t index;
+    };
+
+    [[nodiscard]] uint32_t allocateSlot(Type p_Type);
+    void releaseSlot(Type p_Type, uint32_t p_Index);
+    void queueWrite(const PendingWrite& p_Write);
+    // Expects m_Mutex to be held
+    void reclaim();
+
+    ResourceID m_Device;
+    Config m_Config;
+
+    ResourceID m_Layout = UINT32_MAX;
+    ResourceID m_Pool = UINT32_MAX;
+    ResourceID m_Set = UINT32_MAX;
+
+    std::array<SlotList, static_cast<size_t>(Type::COUNT)> m_Slots;
+
+    mutable std::mutex m_Mutex;
+    std::vector<PendingWrite> m_PendingWrites;
+    std::vector<RetiredSlot> m_Retired;
+};
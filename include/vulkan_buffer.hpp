@@ -22,18 +22,25 @@ public:
     void* map(VkDeviceSize p_Size, VkDeviceSize p_Offset);
     void unmap();
 
+    void markDirty(VkDeviceSize p_Offset, VkDeviceSize p_Size) const;
+    void flush(VkDeviceSize p_Offset = 0, VkDeviceSize p_Size = VK_WHOLE_SIZE) const;
+    void invalidate(VkDeviceSize p_Offset = 0, VkDeviceSize p_Size = VK_WHOLE_SIZE) const;
+
     [[nodiscard]] bool isMemoryMapped() const;
+    [[nodiscard]] bool isPersistentlyMapped() const;
     [[nodiscard]] void* getMappedData() const;
 
 protected:
     explicit VulkanMemArray(const ResourceID p_ID) : VulkanDeviceSubresource(p_ID) {}
 
     virtual void setBoundMemory(VmaAllocation p_Allocation) = 0;
+    void updateMappingState();
     
     VmaAllocation m_Allocation = VK_NULL_HANDLE;
 
     uint32_t m_QueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     void* m_MappedData = nullptr;
+    bool m_PersistentlyMapped = false;
 
     friend class VulkanExternalMemoryExtension;
 };
@@ -46,6 +53,7 @@ public:
         VkDeviceSize size;
         VkBufferUsageFlags usage;
         uint32_t ownerQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        VkBufferCreateFlags flags = 0;
     };
 
     using MemoryPreferences = VulkanMemoryAllocator::MemoryPreferences;
@@ -55,6 +63,7 @@ public:
     void allocate(MemoryPreferences p_Preferences) override;
 
     [[nodiscard]] VkDeviceSize getSize() const;
+    [[nodiscard]] VkBufferUsageFlags getUsage() const;
     [[nodiscard]] uint32_t getQueue() const;
 
     VkBuffer operator*() const;
@@ -66,15 +75,23 @@ public:
 private:
     void free() override;
 
-    VulkanBuffer(ResourceID p_Device, VkBuffer p_VkHandle, VkDeviceSize p_Size);
+    VulkanBuffer(ResourceID p_Device, VkBuffer p_VkHandle, VkDeviceSize p_Size, VkBufferUsageFlags p_Usage = 0);
     
     void setBoundMemory(VmaAllocation p_Allocation) override;
+    // Exchanges handle and memory with another buffer of the same size, so a copy can take over this buffer's ID once the GPU is done filling it
+    void swapBacking(VulkanBuffer& p_Other);
+    // Same, but only the handle moves, for when VMA already moved the allocation itself
+    void swapHandle(VulkanBuffer& p_Other);
 
     VkBuffer m_VkHandle = VK_NULL_HANDLE;
 
     VkDeviceSize m_Size = 0;
+    VkBufferUsageFlags m_Usage = 0;
 
     friend class VulkanDevice;
     friend class VulkanCommandBuffer;
     friend class VulkanMemoryBarrierBuilder;
+    friend class VulkanExternalMemoryHostExtension;
+    friend class VulkanResidencyManager;
+    friend class VulkanDefragmenter;
 };
@@ -0,0 +1,53 @@
+#pragma once
+#include <Volk/volk.h>
+
+#include "vulkan_memory.hpp"
+#include "utils/identifiable.hpp"
+
+struct VulkanBufferSlice
+{
+    ResourceID buffer = UINT32_MAX;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+
+    VmaVirtualAllocation allocation = VK_NULL_HANDLE;
+
+    [[nodiscard]] bool isValid() const { return allocation != VK_NULL_HANDLE; }
+};
+
+// One large buffer handing out aligned slices through a VMA virtual block, so many small meshes or uniform blocks share a single VkBuffer and binding
+class VulkanBufferArena
+{
+public:
+    using MemoryPreferences = VulkanMemoryAllocator::MemoryPreferences;
+
+    // Uniform and storage usages automatically respect the device's minimum offset alignments
+    VulkanBufferArena(ResourceID p_Device, VkDeviceSize p_Size, VkBufferUsageFlags p_Usage, const MemoryPreferences& p_Preferences = {}, uint32_t p_QueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED);
+
+    // Returns an invalid slice if the arena has no free range big enough. Alignments that are not powers of two are honoured by padding the slice
+    [[nodiscard]] VulkanBufferSlice allocate(VkDeviceSize p_Size, VkDeviceSize p_Alignment = 1);
+    // Offset is a multiple of p_Stride, so it can be turned into a first vertex or first index, even for non power of two strides
+    [[nodiscard]] VulkanBufferSlice allocateElements(uint32_t p_Count, uint32_t p_Stride);
+    void freeSlice(VulkanBufferSlice& p_Slice);
+
+    // Drops every slice at once, only call once the GPU is done with all of them
+    void clear();
+    void free();
+
+    [[nodiscard]] VkDescriptorBufferInfo getDescriptorInfo(const VulkanBufferSlice& p_Slice) const;
+
+    [[nodiscard]] ResourceID getBuffer() const { return m_Buffer; }
+    [[nodiscard]] VkDeviceSize getSize() const { return m_Size; }
+    [[nodiscard]] VkDeviceSize getUsedBytes() const;
+    [[nodiscard]] uint32_t getSliceCount() const { return m_SliceCount; }
+
+private:
+    ResourceID m_Device;
+
+    ResourceID m_Buffer = UINT32_MAX;
+    VmaVirtualBlock m_Block = VK_NULL_HANDLE;
+    VkDeviceSize m_Size = 0;
+    VkDeviceSize m_MinAlignment = 1;
+
+    uint32_t m_SliceCount = 0;
+};
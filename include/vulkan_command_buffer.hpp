@@ -6,6 +6,7 @@
 
 #include "vulkan_context.hpp"
 #include "utils/identifiable.hpp"
+#include "utils/pixel_converter.hpp"
 
 
 class VulkanImage;
@@ -15,6 +16,8 @@ class VulkanFence;
 class VulkanRenderPass;
 class VulkanDevice;
 class VulkanDevice;
+class VulkanBufferUpdateBatcher;
+struct VulkanBufferSlice;
 
 class VulkanMemoryBarrierBuilder
 {
@@ -27,6 +30,8 @@ public:
     void addBufferMemoryBarrier(ResourceID p_Buffer, VkDeviceSize p_Offset, VkDeviceSize p_Size, VkAccessFlags p_SrcAccessMask, VkAccessFlags p_DstAccessMask, uint32_t p_DstQueueFamily = VK_QUEUE_FAMILY_IGNORED);
     void addImageMemoryBarrier(ResourceID p_Image, VkImageLayout p_NewLayout, uint32_t p_DstQueueFamily = VK_QUEUE_FAMILY_IGNORED, VkAccessFlags p_SrcAccessMask = VK_ACCESS_FLAG_BITS_MAX_ENUM, VkAccessFlags p_DstAccessMask = VK_ACCESS_FLAG_BITS_MAX_ENUM);
     void addImageMemoryBarrier(const VulkanImage& p_Image, VkImageLayout p_NewLayout, uint32_t p_DstQueueFamily = VK_QUEUE_FAMILY_IGNORED, VkAccessFlags p_SrcAccessMask = VK_ACCESS_FLAG_BITS_MAX_ENUM, VkAccessFlags p_DstAccessMask = VK_ACCESS_FLAG_BITS_MAX_ENUM);
+    // Transitions only p_Range. The image keeps a single tracked layout, so the caller provides the range's current layout
+    void addImageMemoryBarrier(const VulkanImage& p_Image, const VkImageSubresourceRange& p_Range, VkImageLayout p_OldLayout, VkImageLayout p_NewLayout, VkAccessFlags p_SrcAccessMask = VK_ACCESS_FLAG_BITS_MAX_ENUM, VkAccessFlags p_DstAccessMask = VK_ACCESS_FLAG_BITS_MAX_ENUM);
 
 private:
     ResourceID m_Device;
@@ -72,9 +77,15 @@ public:
 	void cmdBindVertexBuffer(ResourceID p_Buffer, VkDeviceSize p_Offset) const;
 	void cmdBindVertexBuffers(std::span<const ResourceID> p_BufferIDs, std::span<const VkDeviceSize> p_Offsets) const;
 	void cmdBindIndexBuffer(ResourceID p_BufferID, VkDeviceSize p_Offset, VkIndexType p_IndexType) const;
+    // Binds the slice's whole arena buffer at offset 0, the slice draw overloads below apply the slice offset
+    void cmdBindVertexBuffer(const VulkanBufferSlice& p_Slice) const;
+    void cmdBindIndexBuffer(const VulkanBufferSlice& p_Slice, VkIndexType p_IndexType) const;
 
 	void cmdCopyBuffer(ResourceID p_Source, ResourceID p_Destination, std::span<const VkBufferCopy> p_CopyRegions) const;
+	void cmdUpdateBuffer(ResourceID p_Buffer, VkDeviceSize p_Offset, VkDeviceSize p_Size, const void* p_Data) const;
     void cmdCopyBufferToImage(ResourceID p_Buffer, ResourceID p_Image, VkImageLayout p_ImageLayout, std::span<const VkBufferImageCopy> p_CopyRegions) const;
+    void cmdCopyImageToBuffer(ResourceID p_Image, VkImageLayout p_ImageLayout, ResourceID p_Buffer, std::span<const VkBufferImageCopy> p_CopyRegions) const;
+    void cmdCopyImage(ResourceID p_Source, ResourceID p_Destination, std::span<const VkImageCopy> p_Regions) const;
 	void cmdBlitImage(ResourceID p_Source, ResourceID p_Destination, std::span<const VkImageBlit> p_Regions, VkFilter p_Filter) const;
     void cmdBlitImage(const VulkanImage& p_Source, const VulkanImage& p_Destination, std::span<const VkImageBlit> p_Regions, VkFilter p_Filter) const;
     void cmdSimpleBlitImage(ResourceID p_Source, ResourceID p_Destination, VkFilter p_Filter) const;
@@ -83,16 +94,35 @@ public:
 	void ecmdDumpStagingBuffer(ResourceID p_Buffer, std::span<const VkBufferCopy> p_Regions) const;
     void ecmdDumpStagingBufferToImage(ResourceID p_Image, VkExtent3D p_Size, VkOffset3D p_Offset, bool p_KeepLayout = false) const;
     void ecmdDumpDataIntoBuffer(ResourceID p_DestBuffer, const uint8_t* p_Data, VkDeviceSize p_Size) const;
+    // Always recorded, so the copy stays ordered with the rest of the queue. See ecmdUploadDataIntoImage for the host path
     void ecmdDumpDataIntoImage(ResourceID p_DestImage, const uint8_t* p_Data, VkExtent3D p_Extent, uint32_t p_BytesPerPixel, bool p_KeepLayout) const;
+    // Writes the data from the host right away when the image allows host copies and p_ImageIdle promises no queued or running
+    // work touches it, and records ecmdDumpDataIntoImage otherwise. Returns true if nothing was recorded
+    bool ecmdUploadDataIntoImage(ResourceID p_DestImage, const uint8_t* p_Data, VkExtent3D p_Extent, uint32_t p_BytesPerPixel, bool p_KeepLayout, bool p_ImageIdle) const;
+    // Same as ecmdDumpDataIntoImage, but pixels are converted while being written into the staging buffer
+    void ecmdConvertDataIntoImage(ResourceID p_DestImage, const void* p_Data, VkExtent3D p_Extent, PixelConverter::Conversion p_Conversion, bool p_KeepLayout) const;
+    void ecmdFlushBufferUpdates(VulkanBufferUpdateBatcher& p_Batcher) const;
+    // Fills every mip level from level 0 with one blit per level, leaving the whole image in p_FinalLayout
+    // Level 0 must be in the image's tracked layout, the other levels are overwritten
+    void ecmdGenerateMipmaps(ResourceID p_Image, VkImageLayout p_FinalLayout, VkFilter p_Filter = VK_FILTER_LINEAR) const;
 
 	void cmdPushConstant(ResourceID p_Layout, VkShaderStageFlags p_StageFlags, uint32_t p_Offset, uint32_t p_Size, const void* p_Values) const;
     void cmdBindDescriptorSet(VkPipelineBindPoint p_BindPoint, ResourceID p_Layout, ResourceID p_DescriptorSet) const;
+    // For sets that never get a device object, like the per frame ones from VulkanDescriptorAllocator
+    void cmdBindDescriptorSets(VkPipelineBindPoint p_BindPoint, ResourceID p_Layout, uint32_t p_FirstSet, std::span<const VkDescriptorSet> p_DescriptorSets, std::span<const uint32_t> p_DynamicOffsets = {}) const;
+    // Descriptor buffers from VulkanDescriptorBuffer::getBindingInfo. Binding new buffers drops the offsets set before
+    void cmdBindDescriptorBuffers(std::span<const VkDescriptorBufferBindingInfoEXT> p_Buffers) const;
+    // Points sets p_FirstSet onwards at p_Offsets inside the bound buffers p_BufferIndices picks, one entry of each per set
+    void cmdSetDescriptorBufferOffsets(VkPipelineBindPoint p_BindPoint, ResourceID p_Layout, uint32_t p_FirstSet, std::span<const uint32_t> p_BufferIndices, std::span<const VkDeviceSize> p_Offsets) const;
 
 	void cmdSetViewport(const VkViewport& p_Viewport) const;
 	void cmdSetScissor(VkRect2D p_Scissor) const;
 
 	void cmdDraw(uint32_t p_VertexCount, uint32_t p_FirstVertex, uint32_t p_InstanceCount = 1, uint32_t p_FirstInstance = 0) const;
 	void cmdDrawIndexed(uint32_t p_IndexCount, uint32_t p_FirstIndex, int32_t p_VertexOffset, uint32_t p_InstanceCount = 1, uint32_t p_FirstInstance = 0) const;
+    // Arena draws, the arena buffers must be bound at offset 0 so slice offsets can be turned into first vertex/index
+    void cmdDraw(const VulkanBufferSlice& p_Vertices, uint32_t p_VertexStride, uint32_t p_InstanceCount = 1, uint32_t p_FirstInstance = 0) const;
+    void cmdDrawIndexed(const VulkanBufferSlice& p_Indices, VkIndexType p_IndexType, const VulkanBufferSlice& p_Vertices, uint32_t p_VertexStride, uint32_t p_InstanceCount = 1, uint32_t p_FirstInstance = 0) const;
     void cmdDispatch(uint32_t p_GroupCountX, uint32_t p_GroupCountY, uint32_t p_GroupCountZ) const;
 
 	VkCommandBuffer operator*() const;
@@ -0,0 +1,99 @@
+#pragma once
+#include <functional>
+#include <unordered_set>
+#include <vector>
+
+#include <Volk/volk.h>
+
+#include "vulkan_memory.hpp"
+#include "utils/identifiable.hpp"
+
+class VulkanCommandBuffer;
+
+// Incremental VMA defragmentation spread over several frames. Moved buffers and images are recreated at their new place,
+// filled with a GPU copy and then swapped in behind their existing ResourceIDs, so only descriptor sets need attention
+// Descriptor sets written with the old handles are flagged through VulkanDescriptorSet::needsRewrite
+class VulkanDefragmenter
+{
+public:
+    using Callback = std::function<void(ResourceID)>;
+
+    struct Config
+    {
+        VmaDefragmentationFlags flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_BALANCED_BIT;
+        // Bounds the copy work recorded in a single frame
+        VkDeviceSize maxBytesPerPass = 64ULL * 1024 * 1024;
+        uint32_t maxMovesPerPass = 64;
+        uint32_t framesInFlight = 2;
+        // UINT32_MAX defragments the default pools
+        uint32_t pool = UINT32_MAX;
+    };
+
+    struct Stats
+    {
+        VkDeviceSize bytesMoved = 0;
+        VkDeviceSize bytesFreed = 0;
+        uint32_t allocationsMoved = 0;
+        uint32_t blocksFreed = 0;
+        uint32_t passes = 0;
+    };
+
+    explicit VulkanDefragmenter(ResourceID p_Device, const Config& p_Config = {});
+
+    // Resources must not be freed while a run is in progress
+    void begin();
+    // Call once per frame while running, returns false once the run is over. Copies are recorded into p_CommandBuffer, which must be submitted with p_Fence
+    // Resources the GPU writes to every frame should be excluded, writes landing between the copy and the swap would be lost
+    bool update(uint32_t p_FrameIndex, const VulkanCommandBuffer& p_CommandBuffer, ResourceID p_Fence);
+    // Waits for the device to go idle and ends the current run, keeping whatever was already moved
+    void cancel();
+
+    void exclude(ResourceID p_Resource) { m_Excluded.insert(p_Resource); }
+    void include(ResourceID p_Resource) { m_Excluded.erase(p_Resource); }
+
+    // Called for every resource once its new handle is in place
+    void setRelocationCallback(Callback p_Callback) { m_RelocationCallback = std::move(p_Callback); }
+
+    [[nodiscard]] bool isRunning() const { return m_Context != VK_NULL_HANDLE; }
+    [[nodiscard]] const Stats& getStats() const { return m_Stats; }
+
+private:
+    enum class State
+    {
+        IDLE,
+        READY,
+        COPYING,
+        DRAINING
+    };
+
+    struct Move
+    {
+        ResourceID resource;
+        // Bound to the new memory until the swap, then holds the old handle until the pass ends
+        ResourceID copy;
+        bool image;
+    };
+
+    void beginPass(const VulkanCommandBuffer& p_CommandBuffer, ResourceID p_Fence);
+    bool recordBufferMove(const VmaDefragmentationMove& p_Move, ResourceID p_Buffer, const VulkanCommandBuffer& p_CommandBuffer);
+    bool recordImageMove(const VmaDefragmentationMove& p_Move, ResourceID p_Image, const VulkanCommandBuffer& p_CommandBuffer);
+    void swapMoved();
+    void endPass();
+    void finish();
+
+    ResourceID m_Device;
+    Config m_Config;
+
+    VmaDefragmentationContext m_Context = VK_NULL_HANDLE;
+    VmaDefragmentationPassMoveInfo m_Pass{};
+    State m_State = State::IDLE;
+
+    std::vector<Move> m_Moves;
+    ResourceID m_Fence = UINT32_MAX;
+    uint32_t m_Frame = 0;
+    uint32_t m_SwapFrame = 0;
+
+    std::unordered_set<ResourceID> m_Excluded;
+    Stats m_Stats{};
+    Callback m_RelocationCallback;
+};
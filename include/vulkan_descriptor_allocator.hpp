@@ -0,0 +1,88 @@
+#pragma once
+#include <deque>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include <Volk/volk.h>
+
+#include "utils/identifiable.hpp"
+
+// Hands out descriptor sets that live for a single frame, with pool sizes derived from the layouts themselves
+// Layouts needing the same descriptors per set share a class, and every class keeps its own list of pools. A pool that runs
+// out is swapped for a fresh one, and once a frame's fence signals all of its pools are reset in one call each and reused
+class VulkanDescriptorAllocator
+{
+public:
+    struct Config
+    {
+        // Sets in the first pool of a class, every new pool doubles it up to maxSetsPerPool
+        uint32_t initialSetsPerPool = 64;
+        uint32_t maxSetsPerPool = 4096;
+        uint32_t framesInFlight = 2;
+    };
+
+    explicit VulkanDescriptorAllocator(ResourceID p_Device, const Config& p_Config = {});
+
+    // Starts a new frame. Sets allocated until the next call are returned to their pools once p_Fence signals
+    // Blocks on the oldest frame if more than framesInFlight frames are still pending
+    void beginFrame(ResourceID p_Fence);
+
+    // p_Sets receives one set per layout, in order. Sets of the same class are allocated with a single call
+    void allocate(std::span<const ResourceID> p_Layouts, VkDescriptorSet* p_Sets);
+    [[nodiscard]] VkDescriptorSet allocate(ResourceID p_Layout);
+
+    // Waits for every pending frame and destroys every pool
+    void free();
+
+    [[nodiscard]] uint32_t getClassCount() const { return static_cast<uint32_t>(m_Classes.size()); }
+    [[nodiscard]] uint32_t getPoolCount() const { return m_PoolCount; }
+    [[nodiscard]] uint32_t getFrameSetCount() const { return m_FrameSetCount; }
+
+private:
+    struct Pool
+    {
+        ResourceID pool = UINT32_MAX;
+        uint32_t maxSets = 0;
+        uint32_t setsLeft = 0;
+    };
+
+    struct LayoutClass
+    {
+        std::vector<VkDescriptorPoolSize> perSet;
+        VkDescriptorPoolCreateFlags poolFlags;
+        uint32_t nextPoolSets;
+        Pool current{};
+        std::vector<Pool> freePools;
+    };
+
+    struct UsedPool
+    {
+        uint32_t layoutClass;
+        Pool pool;
+    };
+
+    struct Frame
+    {
+        ResourceID fence;
+        std::vector<UsedPool> pools;
+    };
+
+    [[nodiscard]] uint32_t getLayoutClass(ResourceID p_Layout);
+    // Retires the class's current pool into the frame being recorded and replaces it with a free or new one
+    void nextPool(uint32_t p_Class);
+    void releaseFrame(Frame& p_Frame);
+    void reclaim();
+
+    ResourceID m_Device;
+    Config m_Config;
+
+    std::vector<LayoutClass> m_Classes;
+    std::unordered_map<ResourceID, uint32_t> m_LayoutClasses;
+
+    Frame m_Current{UINT32_MAX, {}};
+    std::deque<Frame> m_Pending;
+
+    uint32_t m_PoolCount = 0;
+    uint32_t m_FrameSetCount = 0;
+};
@@ -0,0 +1,63 @@
+#pragma once
+#include <Volk/volk.h>
+
+#include "utils/identifiable.hpp"
+
+// Descriptors written straight into a host visible buffer with vkGetDescriptorEXT and bound by offset, without pools or set
+// objects. Sets are carved out of the buffer linearly and all given back at once by reset, so keep one per frame in flight
+// Layouts must be created with VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT and pipelines using them with
+// VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT. Requires VulkanDescriptorBufferExtension and VulkanBufferDeviceAddressExtension
+class VulkanDescriptorBuffer
+{
+public:
+    struct Config
+    {
+        VkDeviceSize size = 1 << 20;
+        // Sampler and combined image sampler descriptors need a buffer of their own, created with this set
+        bool samplers = false;
+    };
+
+    static constexpr VkDeviceSize INVALID_OFFSET = UINT64_MAX;
+
+    explicit VulkanDescriptorBuffer(ResourceID p_Device, const Config& p_Config = {});
+
+    VulkanDescriptorBuffer(const VulkanDescriptorBuffer&) = delete;
+    VulkanDescriptorBuffer& operator=(const VulkanDescriptorBuffer&) = delete;
+
+    // Reserves one set of p_Layout and returns its offset in the buffer, INVALID_OFFSET when the buffer is full
+    // The offset is what cmdSetDescriptorBufferOffsets takes
+    [[nodiscard]] VkDeviceSize allocateSet(ResourceID p_Layout);
+    // Hands every set back, only once the GPU is done reading them
+    void reset();
+
+    // Writes go directly to mapped memory, there is nothing to flush or batch
+    void writeImage(VkDeviceSize p_Set, ResourceID p_Layout, uint32_t p_Binding, VkDescriptorType p_Type, const VkDescriptorImageInfo& p_Info, uint32_t p_ArrayElement = 0) const;
+    void writeBuffer(VkDeviceSize p_Set, ResourceID p_Layout, uint32_t p_Binding, VkDescriptorType p_Type, ResourceID p_Buffer, VkDeviceSize p_Offset = 0, VkDeviceSize p_Range = VK_WHOLE_SIZE, uint32_t p_ArrayElement = 0) const;
+    void writeTexelBuffer(VkDeviceSize p_Set, ResourceID p_Layout, uint32_t p_Binding, VkDescriptorType p_Type, ResourceID p_Buffer, VkFormat p_Format,
+                          VkDeviceSize p_Offset = 0, VkDeviceSize p_Range = VK_WHOLE_SIZE, uint32_t p_ArrayElement = 0) const;
+
+    // For VulkanCommandBuffer::cmdBindDescriptorBuffers
+    [[nodiscard]] VkDescriptorBufferBindingInfoEXT getBindingInfo() const;
+
+    void free();
+
+    [[nodiscard]] ResourceID getBuffer() const { return m_Buffer; }
+    [[nodiscard]] VkDeviceSize getSize() const { return m_Config.size; }
+    [[nodiscard]] VkDeviceSize getUsedSize() const { return m_Used; }
+
+private:
+    void write(VkDeviceSize p_Set, ResourceID p_Layout, uint32_t p_Binding, uint32_t p_ArrayElement, const VkDescriptorGetInfoEXT& p_Info) const;
+    void writeAddress(VkDeviceSize p_Set, ResourceID p_Layout, uint32_t p_Binding, VkDescriptorType p_Type, ResourceID p_Buffer, VkFormat p_Format,
+                      VkDeviceSize p_Offset, VkDeviceSize p_Range, uint32_t p_ArrayElement) const;
+
+    ResourceID m_Device;
+    Config m_Config;
+
+    ResourceID m_Buffer = UINT32_MAX;
+    uint8_t* m_Mapped = nullptr;
+    VkDeviceAddress m_Address = 0;
+    VkBufferUsageFlags m_Usage = 0;
+
+    VkDeviceSize m_Alignment = 1;
+    VkDeviceSize m_Used = 0;
+};
@@ -1,4 +1,8 @@
 #pragma once
+#include <span>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <Volk/volk.h>
 
 #include "utils/identifiable.hpp"
@@ -11,6 +15,9 @@ class VulkanDescriptorPool final : public VulkanDeviceSubresource
 public:
     [[nodiscard]] VkDescriptorPool operator*() const;
 
+    // Returns every set allocated from the pool at once. Set objects created from it through the device become invalid
+    void reset() const;
+
 private:
     void free() override;
 
@@ -29,6 +36,22 @@ class VulkanDescriptorSetLayout final : public VulkanDeviceSubresource
 public:
     [[nodiscard]] VkDescriptorSetLayout operator*() const;
 
+    // Descriptors a single set of this layout takes from a pool, one entry per type sorted by type
+    [[nodiscard]] const std::vector<VkDescriptorPoolSize>& getPoolSizes() const { return m_PoolSizes; }
+    [[nodiscard]] VkDescriptorSetLayoutCreateFlags getFlags() const { return m_Flags; }
+    // Sorted by binding, immutable sampler pointers are not kept
+    [[nodiscard]] const std::vector<VkDescriptorSetLayoutBinding>& getBindings() const { return m_Bindings; }
+    // getBindings drops the sampler pointers, this keeps whether p_Binding was created with immutable samplers
+    [[nodiscard]] bool hasImmutableSamplers(uint32_t p_Binding) const;
+    // Number of createDescriptorSetLayout calls and pipeline layouts sharing this layout
+    [[nodiscard]] uint32_t getReferenceCount() const { return m_References; }
+
+    // Only for layouts created with VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT, queried once and kept
+    // Bytes one set of this layout takes in a descriptor buffer
+    [[nodiscard]] VkDeviceSize getDescriptorBufferSize() const;
+    // Where p_Binding starts inside such a set
+    [[nodiscard]] VkDeviceSize getDescriptorBufferOffset(uint32_t p_Binding) const;
+
 private:
     void free() override;
 
@@ -36,6 +59,26 @@ private:
 
     VkDescriptorSetLayout m_VkHandle = VK_NULL_HANDLE;
 
+    std::vector<VkDescriptorPoolSize> m_PoolSizes;
+    std::vector<VkDescriptorSetLayoutBinding> m_Bindings;
+    // Parallel to m_Bindings
+    std::vector<bool> m_HasImmutableSamplers;
+    // Parallel to m_Bindings, empty when the layout was created without binding flags
+    std::vector<VkDescriptorBindingFlags> m_BindingFlags;
+    // Every immutable sampler in binding order, part of the cache key
+    std::vector<VkSampler> m_ImmutableSamplerHandles;
+    VkDescriptorSetLayoutCreateFlags m_Flags = 0;
+
+    size_t m_Hash = 0;
+    uint32_t m_References = 1;
+
+    // Parallel to m_Bindings, filled together with the size on first use
+    mutable std::vector<VkDeviceSize> m_DescriptorBufferOffsets;
+    mutable VkDeviceSize m_DescriptorBufferSize = UINT64_MAX;
+
+    // References to cached samplers baked into the layout, released when it is freed
+    std::vector<ResourceID> m_ImmutableSamplers;
+
     friend class VulkanDevice;
 };
 
@@ -46,17 +89,133 @@ public:
 
     void updateDescriptorSet(const VkWriteDescriptorSet& p_WriteDescriptorSet) const;
 
+    // True while a buffer or image view written through updateDescriptorSet was moved to a new handle. Rewriting the stale slots clears it
+    [[nodiscard]] bool needsRewrite() const { return !m_StaleSlots.empty(); }
+
 private:
     void free() override;
 
     VulkanDescriptorSet(ResourceID p_Device, ResourceID p_Pool, VkDescriptorSet p_DescriptorSet);
 
+    void recordWrite(const VkWriteDescriptorSet& p_WriteDescriptorSet) const;
+    bool markHandleMoved(uint64_t p_Handle);
+
     VkDescriptorSet m_VkHandle = VK_NULL_HANDLE;
 
     ResourceID m_Pool = UINT32_MAX;
     bool m_CanBeFreed = false;
 
+    // Keyed by binding in the high half and array element in the low half
+    mutable std::unordered_map<uint64_t, uint64_t> m_SlotHandles;
+    mutable std::unordered_set<uint64_t> m_StaleSlots;
+
     friend class VulkanDevice;
     friend class VulkanDescriptorPool;
     friend class VulkanDescriptorSetLayout;
+    friend class VulkanDescriptorUpdateTemplate;
+};
+
+// Writes every descriptor it covers with one vkUpdateDescriptorSetWithTemplate call, reading them from a single packed block
+// Descriptors sit in the block in binding order, each taking the size of its info struct or handle
+class VulkanDescriptorUpdateTemplate final : public VulkanDeviceSubresource
+{
+public:
+    struct Entry
+    {
+        uint32_t binding;
+        uint32_t count;
+        VkDescriptorType type;
+        uint32_t offset;
+        uint32_t stride;
+    };
+
+    [[nodiscard]] VkDescriptorUpdateTemplate operator*() const;
+
+    [[nodiscard]] ResourceID getLayout() const { return m_Layout; }
+    [[nodiscard]] const std::vector<Entry>& getEntries() const { return m_Entries; }
+    // Size of the block update reads
+    [[nodiscard]] uint32_t getDataSize() const { return m_DataSize; }
+    // Byte offset of one descriptor in the block, UINT32_MAX if the template does not write it
+    [[nodiscard]] uint32_t getOffset(uint32_t p_Binding, uint32_t p_ArrayElement = 0) const;
+
+    // Place one descriptor in a block of getDataSize bytes
+    void setImage(void* p_Data, uint32_t p_Binding, const VkDescriptorImageInfo& p_Info, uint32_t p_ArrayElement = 0) const;
+    void setBuffer(void* p_Data, uint32_t p_Binding, const VkDescriptorBufferInfo& p_Info, uint32_t p_ArrayElement = 0) const;
+    void setTexelBuffer(void* p_Data, uint32_t p_Binding, VkBufferView p_View, uint32_t p_ArrayElement = 0) const;
+
+    void update(VkDescriptorSet p_Set, const void* p_Data) const;
+    // Also keeps the handle tracking of the set current, like VulkanDescriptorSet::updateDescriptorSet
+    void update(ResourceID p_Set, const void* p_Data) const;
+
+    // Bytes one descriptor of p_Type takes in the block, 1 for inline uniform blocks whose count is in bytes
+    [[nodiscard]] static uint32_t getDescriptorStride(VkDescriptorType p_Type);
+
+private:
+    void free() override;
+
+    VulkanDescriptorUpdateTemplate(ResourceID p_Device, VkDescriptorUpdateTemplate p_Template, ResourceID p_Layout, std::vector<Entry>&& p_Entries, uint32_t p_DataSize);
+
+    void setDescriptor(void* p_Data, uint32_t p_Binding, uint32_t p_ArrayElement, const void* p_Descriptor, uint32_t p_Size) const;
+
+    VkDescriptorUpdateTemplate m_VkHandle = VK_NULL_HANDLE;
+
+    ResourceID m_Layout = UINT32_MAX;
+    std::vector<Entry> m_Entries;
+    uint32_t m_DataSize = 0;
+
+    friend class VulkanDevice;
+};
+
+// Collects descriptor writes for any number of sets and issues them in one vkUpdateDescriptorSets call on flush
+// Writes continuing the previous one in the same binding are merged into it. Not synchronized, keep one per recording thread
+class VulkanDescriptorWriteBatcher
+{
+public:
+    explicit VulkanDescriptorWriteBatcher(ResourceID p_Device);
+
+    void writeImages(VkDescriptorSet p_Set, uint32_t p_Binding, VkDescriptorType p_Type, std::span<const VkDescriptorImageInfo> p_Infos, uint32_t p_ArrayElement = 0);
+    void writeBuffers(VkDescriptorSet p_Set, uint32_t p_Binding, VkDescriptorType p_Type, std::span<const VkDescriptorBufferInfo> p_Infos, uint32_t p_ArrayElement = 0);
+    void writeTexelBuffers(VkDescriptorSet p_Set, uint32_t p_Binding, VkDescriptorType p_Type, std::span<const VkBufferView> p_Views, uint32_t p_ArrayElement = 0);
+
+    // Looks the handle up from the device. Device owned sets get their handle tracking updated on flush either way
+    void writeImages(ResourceID p_Set, uint32_t p_Binding, VkDescriptorType p_Type, std::span<const VkDescriptorImageInfo> p_Infos, uint32_t p_ArrayElement = 0);
+    void writeBuffers(ResourceID p_Set, uint32_t p_Binding, VkDescriptorType p_Type, std::span<const VkDescriptorBufferInfo> p_Infos, uint32_t p_ArrayElement = 0);
+
+    void flush();
+    // Drops every queued write without issuing it
+    void clear();
+
+    [[nodiscard]] uint32_t getPendingWriteCount() const { return static_cast<uint32_t>(m_Writes.size()); }
+    [[nodiscard]] uint32_t getPendingDescriptorCount() const { return m_DescriptorCount; }
+
+private:
+    enum class InfoKind : uint8_t
+    {
+        IMAGE,
+        BUFFER,
+        TEXEL_BUFFER
+    };
+
+    struct PendingWrite
+    {
+        VkDescriptorSet set;
+        uint32_t binding;
+        uint32_t arrayElement;
+        uint32_t count;
+        VkDescriptorType type;
+        InfoKind kind;
+        // Index of the first descriptor in the info array matching kind, pointers are only resolved on flush
+        uint32_t firstInfo;
+    };
+
+    void queue(VkDescriptorSet p_Set, uint32_t p_Binding, VkDescriptorType p_Type, InfoKind p_Kind, uint32_t p_FirstInfo, uint32_t p_Count, uint32_t p_ArrayElement);
+
+    ResourceID m_Device;
+
+    std::vector<PendingWrite> m_Writes;
+    std::vector<VkDescriptorImageInfo> m_ImageInfos;
+    std::vector<VkDescriptorBufferInfo> m_BufferInfos;
+    std::vector<VkBufferView> m_TexelViews;
+    std::vector<VkWriteDescriptorSet> m_VkWrites;
+    uint32_t m_DescriptorCount = 0;
 };
@@ -20,6 +20,7 @@
 #include "utils/allocators.hpp"
 
 class VulkanDeviceExtensionManager;
+struct ShaderReflectionData;
 
 class VulkanDevice final : public Identifiable
 {
@@ -62,6 +63,8 @@ public:
     bool freeFramebuffer(const VulkanFramebuffer& p_Framebuffer) { return freeSubresource<VulkanFramebuffer>(p_Framebuffer.getID()); }
 
     ResourceID createAndAllocateBuffer(const VulkanMemoryAllocator::MemoryPreferences& p_MemoryPreferences, const VulkanBuffer::Config& p_Config);
+    // Buffers with the same memory requirements are allocated together, IDs are returned in the order of p_Configs
+    std::vector<ResourceID> createAndAllocateBuffers(const VulkanMemoryAllocator::MemoryPreferences& p_MemoryPreferences, std::span<const VulkanBuffer::Config> p_Configs);
 	ResourceID createBuffer(const VulkanBuffer::Config& p_Config);
     VulkanBuffer& getBuffer(const ResourceID p_ID) { return *getSubresource<VulkanBuffer>(p_ID); }
     [[nodiscard]] const VulkanBuffer& getBuffer(const ResourceID p_ID) const { return *getSubresource<VulkanBuffer>(p_ID); }
@@ -69,7 +72,14 @@ public:
     bool freeBuffer(const VulkanBuffer& p_Buffer) { return freeSubresource<VulkanBuffer>(p_Buffer.getID()); }
 
     ResourceID createAndAllocateImage(const VulkanMemoryAllocator::MemoryPreferences& p_MemoryPreferences, const VulkanImage::Config& p_Config);
+    std::vector<ResourceID> createAndAllocateImages(const VulkanMemoryAllocator::MemoryPreferences& p_MemoryPreferences, std::span<const VulkanImage::Config> p_Configs);
     ResourceID createImage(const VulkanImage::Config& p_Config);
+    // Partially resident resources without any memory, pages are bound through a VulkanSparseBinder
+    ResourceID createSparseBuffer(const VulkanBuffer::Config& p_Config);
+    ResourceID createSparseImage(const VulkanImage::Config& p_Config);
+    // Attachments whose contents never outlive a render pass. Backed by lazily allocated memory when the device has it,
+    // so on tilers they can stay in tile memory and never get physical pages
+    ResourceID createTransientAttachment(const VulkanImage::Config& p_Config);
     VulkanImage& getImage(const ResourceID p_ID) { return *getSubresource<VulkanImage>(p_ID); }
     [[nodiscard]] const VulkanImage& getImage(const ResourceID p_ID) const { return *getSubresource<VulkanImage>(p_ID); }
     bool freeImage(const ResourceID p_ID) { return freeSubresource<VulkanImage>(p_ID); }
@@ -81,11 +91,13 @@ public:
     bool freeRenderPass(const ResourceID p_ID) { return freeSubresource<VulkanRenderPass>(p_ID); }
     bool freeRenderPass(const VulkanRenderPass& p_RenderPass) { return freeSubresource<VulkanRenderPass>(p_RenderPass.getID()); }
 
+    // Layouts built from the same set layouts and push constant ranges are shared. Every create holds a reference that
+    // freePipelineLayout gives back, the layout is destroyed with the last one
 	ResourceID createPipelineLayout(std::span<const ResourceID> p_DescriptorSetLayouts, std::span<const VkPushConstantRange> p_PushConstantRanges);
     VulkanPipelineLayout& getPipelineLayout(const ResourceID p_ID) { return *getSubresource<VulkanPipelineLayout>(p_ID); }
     [[nodiscard]] const VulkanPipelineLayout& getPipelineLayout(const ResourceID p_ID) const { return *getSubresource<VulkanPipelineLayout>(p_ID); }
-    bool freePipelineLayout(const ResourceID p_ID) { return freeSubresource<VulkanPipelineLayout>(p_ID); }
-    bool freePipelineLayout(const VulkanPipelineLayout& p_Layout) { return freeSubresource<VulkanPipelineLayout>(p_Layout.getID()); }
+    bool freePipelineLayout(ResourceID p_ID);
+    bool freePipelineLayout(const VulkanPipelineLayout& p_Layout) { return freePipelineLayout(p_Layout.getID()); }
 
 	ResourceID createShaderModule(VulkanShader& p_ShaderCode, VkShaderStageFlagBits p_Stage);
     ResourceID createShaderModule(std::span<const uint32_t> p_SpirvCode, VkShaderStageFlagBits p_Stage);
@@ -113,20 +125,47 @@ public:
     bool freeDescriptorPool(const ResourceID p_ID) { return freeSubresource<VulkanDescriptorPool>(p_ID); }
     bool freeDescriptorPool(const VulkanDescriptorPool& p_DescriptorPool) { return freeSubresource<VulkanDescriptorPool>(p_DescriptorPool.getID()); }
 
-	ResourceID createDescriptorSetLayout(std::span<const VkDescriptorSetLayoutBinding> p_Bindings, VkDescriptorSetLayoutCreateFlags p_Flags);
+    // Immutable samplers that came from acquireSampler are kept alive by the layout until it is freed
+    // p_BindingFlags is either empty or holds one entry per binding
+    // Layouts with the same bindings in any order, binding flags, immutable samplers and create flags are shared. Every create
+    // holds a reference that freeDescriptorSetLayout gives back, the layout is destroyed with the last one
+	ResourceID createDescriptorSetLayout(std::span<const VkDescriptorSetLayoutBinding> p_Bindings, VkDescriptorSetLayoutCreateFlags p_Flags, std::span<const VkDescriptorBindingFlags> p_BindingFlags = {});
     VulkanDescriptorSetLayout& getDescriptorSetLayout(const ResourceID p_ID) { return *getSubresource<VulkanDescriptorSetLayout>(p_ID); }
     [[nodiscard]] const VulkanDescriptorSetLayout& getDescriptorSetLayout(const ResourceID p_ID) const { return *getSubresource<VulkanDescriptorSetLayout>(p_ID); }
-    bool freeDescriptorSetLayout(const ResourceID p_ID) { return freeSubresource<VulkanDescriptorSetLayout>(p_ID); }
-    bool freeDescriptorSetLayout(const VulkanDescriptorSetLayout& p_Layout) { return freeSubresource<VulkanDescriptorSetLayout>(p_Layout.getID()); }
+    bool freeDescriptorSetLayout(ResourceID p_ID);
+    bool freeDescriptorSetLayout(const VulkanDescriptorSetLayout& p_Layout) { return freeDescriptorSetLayout(p_Layout.getID()); }
     
 	ResourceID createDescriptorSet(ResourceID p_Pool, ResourceID p_Layout);
     void createDescriptorSets(ResourceID p_Pool, ResourceID p_Layout, uint32_t p_Count, ResourceID p_Container[]);
+    // One set per entry of p_Layouts, allocated with a single call
+    void createDescriptorSets(ResourceID p_Pool, std::span<const ResourceID> p_Layouts, ResourceID p_Container[]);
     VulkanDescriptorSet& getDescriptorSet(const ResourceID p_ID) { return *getSubresource<VulkanDescriptorSet>(p_ID); }
     [[nodiscard]] const VulkanDescriptorSet& getDescriptorSet(const ResourceID p_ID) const { return *getSubresource<VulkanDescriptorSet>(p_ID); }
     bool freeDescriptorSet(const ResourceID p_ID) { return freeSubresource<VulkanDescriptorSet>(p_ID); }
     bool freeDescriptorSet(const VulkanDescriptorSet& p_DescriptorSet) { return freeSubresource<VulkanDescriptorSet>(p_DescriptorSet.getID()); }
+    // Writes into sets created through the device are recorded for flagDescriptorSetsReferencing, like updateDescriptorSet
     void updateDescriptorSets(std::span<const VkWriteDescriptorSet> p_DescriptorWrites) const;
 
+    // One entry per binding of the layout, see VulkanDescriptorUpdateTemplate for the data block it reads
+	ResourceID createDescriptorUpdateTemplate(ResourceID p_Layout);
+    // Only covers the descriptors p_Reflection declares in p_Set, each of which has to be a binding of p_Layout
+    ResourceID createDescriptorUpdateTemplate(ResourceID p_Layout, const ShaderReflectionData& p_Reflection, uint32_t p_Set);
+    VulkanDescriptorUpdateTemplate& getDescriptorUpdateTemplate(const ResourceID p_ID) { return *getSubresource<VulkanDescriptorUpdateTemplate>(p_ID); }
+    [[nodiscard]] const VulkanDescriptorUpdateTemplate& getDescriptorUpdateTemplate(const ResourceID p_ID) const { return *getSubresource<VulkanDescriptorUpdateTemplate>(p_ID); }
+    bool freeDescriptorUpdateTemplate(const ResourceID p_ID) { return freeSubresource<VulkanDescriptorUpdateTemplate>(p_ID); }
+    bool freeDescriptorUpdateTemplate(const VulkanDescriptorUpdateTemplate& p_Template) { return freeSubresource<VulkanDescriptorUpdateTemplate>(p_Template.getID()); }
+    // Marks every descriptor set holding one of the old handles as needing a rewrite, returns the sets that were marked
+    std::vector<ResourceID> flagDescriptorSetsReferencing(std::span<const uint64_t> p_MovedHandles);
+
+    // Create infos with the same sampler state share one sampler. Every acquire holds a reference that has to be given back
+    // with releaseSampler, freeing the sampler directly would pull it out from under the other holders
+    ResourceID acquireSampler(const VkSamplerCreateInfo& p_CreateInfo);
+    VulkanImageSampler& getSampler(const ResourceID p_ID) { return *getSubresource<VulkanImageSampler>(p_ID); }
+    [[nodiscard]] const VulkanImageSampler& getSampler(const ResourceID p_ID) const { return *getSubresource<VulkanImageSampler>(p_ID); }
+    // Destroys the sampler with its last reference, false if p_ID is not a sampler
+    bool releaseSampler(ResourceID p_ID);
+    [[nodiscard]] uint32_t getSamplerCount() const { return static_cast<uint32_t>(m_SamplersByHandle.size()); }
+
 	ResourceID createSemaphore();
     VulkanSemaphore& getSemaphore(const ResourceID p_ID) { return *getSubresource<VulkanSemaphore>(p_ID); }
     [[nodiscard]] const VulkanSemaphore& getSemaphore(const ResourceID p_ID) const { return *getSubresource<VulkanSemaphore>(p_ID); }
@@ -190,6 +229,12 @@ private:
     ARENA_UMAP(m_ThreadCommandInfos, ThreadID, ThreadCommandInfo);
     ARENA_UMAP(m_CommandBuffers, ThreadID, ThreadCmdBuffers);
     ARENA_UMAP(m_Subresources, ResourceID, VulkanDeviceSubresource*);
+    std::unordered_map<VulkanImageSampler::Key, ResourceID, VulkanImageSampler::KeyHash> m_SamplerCache;
+    ARENA_UMAP(m_SamplersByHandle, VkSampler, ResourceID);
+    ARENA_UMAP(m_DescriptorSetsByHandle, VkDescriptorSet, ResourceID);
+    // Content hash to every live layout with that hash, candidates are compared in full on lookup
+    std::unordered_multimap<size_t, ResourceID> m_DescriptorSetLayoutCache;
+    std::unordered_multimap<size_t, ResourceID> m_PipelineLayoutCache;
     VulkanMemoryAllocator m_MemoryAllocator{};
 
 	QueueSelection m_OneTimeQueue{UINT32_MAX, UINT32_MAX};
@@ -218,14 +263,18 @@ private:
 	friend class VulkanDescriptorPool;
 	friend class VulkanDescriptorSetLayout;
 	friend class VulkanDescriptorSet;
+	friend class VulkanDescriptorUpdateTemplate;
 	friend class VulkanSwapchain;
 
     friend class VulkanDeviceExtensionManager;
 
 private:
     void insertImage(VulkanImage* p_Image);
+    void insertBuffer(VulkanBuffer* p_Buffer);
+    ResourceID createDescriptorUpdateTemplate(ResourceID p_Layout, std::span<const VkDescriptorSetLayoutBinding> p_Bindings);
 
     friend class VulkanExternalMemoryExtension;
+    friend class VulkanExternalMemoryHostExtension;
 };
 
 
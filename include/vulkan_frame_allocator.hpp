@@ -0,0 +1,96 @@
+#pragma once
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include <Volk/volk.h>
+
+#include "vulkan_memory.hpp"
+#include "utils/identifiable.hpp"
+
+struct VulkanFrameAllocation
+{
+    ResourceID buffer = UINT32_MAX;
+    VkDeviceSize offset = 0;
+    void* data = nullptr;
+
+    [[nodiscard]] bool isValid() const { return data != nullptr; }
+};
+
+// Bump allocator for data rewritten every frame, like uniforms, instance data and indirect arguments
+// A ring of persistently mapped segments is created up front in a single block VMA linear pool, one per frame in flight plus the frame being recorded.
+// Each frame takes a segment and hands it back once its fence signals, so steady state frames create no buffers
+class VulkanFrameAllocator
+{
+public:
+    struct Config
+    {
+        // Bytes a single frame is expected to use. Frames going over it spill into regular allocations
+        VkDeviceSize segmentSize = 4ULL * 1024 * 1024;
+        uint32_t framesInFlight = 2;
+        VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    };
+
+    explicit VulkanFrameAllocator(ResourceID p_Device, const Config& p_Config = {});
+
+    // Starts a new frame. Everything allocated until the next call is released once p_Fence signals
+    // Blocks on the oldest frame if more than framesInFlight frames are still pending
+    void beginFrame(ResourceID p_Fence);
+
+    // Offsets respect the device's dynamic uniform and storage offset alignment, on top of p_Alignment
+    [[nodiscard]] VulkanFrameAllocation allocate(VkDeviceSize p_Size, VkDeviceSize p_Alignment = 1);
+    template <typename T>
+    [[nodiscard]] VulkanFrameAllocation push(const T& p_Value);
+
+    // Waits for every pending frame
+    void free();
+
+    [[nodiscard]] uint32_t getPool() const { return m_Pool; }
+    [[nodiscard]] VkDeviceSize getMinAlignment() const { return m_MinAlignment; }
+    [[nodiscard]] VkDeviceSize getFrameUsage() const { return m_FrameUsage; }
+
+private:
+    struct Segment
+    {
+        ResourceID buffer;
+        uint8_t* data;
+        VkDeviceSize size;
+        // Index into m_Ring, UINT32_MAX for overflow segments that are freed with their frame
+        uint32_t ringIndex;
+    };
+
+    struct Frame
+    {
+        ResourceID fence;
+        std::vector<Segment> segments;
+    };
+
+    [[nodiscard]] Segment createSegment(VkDeviceSize p_Size, uint32_t p_RingIndex);
+    [[nodiscard]] Segment acquireSegment();
+    void releaseFrame(Frame& p_Frame);
+    void reclaim();
+
+    ResourceID m_Device;
+    Config m_Config;
+
+    uint32_t m_Pool = UINT32_MAX;
+    VkDeviceSize m_MinAlignment = 1;
+    bool m_Coherent = true;
+
+    std::vector<Segment> m_Ring;
+    std::vector<uint32_t> m_FreeRing;
+
+    Frame m_Current{UINT32_MAX, {}};
+    VkDeviceSize m_Cursor = 0;
+    VkDeviceSize m_FrameUsage = 0;
+    std::deque<Frame> m_Pending;
+};
+
+template <typename T>
+VulkanFrameAllocation VulkanFrameAllocator::push(const T& p_Value)
+{
+    const VulkanFrameAllocation l_Allocation = allocate(sizeof(T), alignof(T));
+    if (l_Allocation.isValid())
+        std::memcpy(l_Allocation.data, &p_Value, sizeof(T));
+    return l_Allocation;
+}
@@ -4,6 +4,7 @@
 #include "vulkan_buffer.hpp"
 #include "vulkan_context.hpp"
 #include "utils/identifiable.hpp"
+#include "utils/inline_vector.hpp"
 
 class VulkanDevice;
 class VulkanMemoryBarrierBuilder;
@@ -11,14 +12,27 @@ class VulkanMemoryBarrierBuilder;
 class VulkanImageView final : public VulkanDeviceSubresource
 {
 public:
+    [[nodiscard]] VkFormat getFormat() const { return m_Format; }
+    [[nodiscard]] VkImageViewType getViewType() const { return m_ViewType; }
+    [[nodiscard]] const VkImageSubresourceRange& getRange() const { return m_Range; }
+    [[nodiscard]] const VkComponentMapping& getComponents() const { return m_Components; }
+    [[nodiscard]] uint32_t getReferenceCount() const { return m_References; }
+
     [[nodiscard]] VkImageView operator*() const { return m_VkHandle; }
 
 private:
     void free() override;
 
-    VulkanImageView(ResourceID p_Device, VkImageView p_VkHandle);
+    VulkanImageView(ResourceID p_Device, VkImageView p_VkHandle, VkFormat p_Format, VkImageViewType p_ViewType, const VkImageSubresourceRange& p_Range, const VkComponentMapping& p_Components);
+
+    [[nodiscard]] bool matches(VkFormat p_Format, VkImageViewType p_ViewType, const VkImageSubresourceRange& p_Range, const VkComponentMapping& p_Components) const;
 
     VkImageView m_VkHandle = VK_NULL_HANDLE;
+    VkFormat m_Format = VK_FORMAT_UNDEFINED;
+    VkImageViewType m_ViewType = VK_IMAGE_VIEW_TYPE_2D;
+    VkImageSubresourceRange m_Range{};
+    VkComponentMapping m_Components{};
+    uint32_t m_References = 1;
 
     friend class VulkanImage;
     friend class VulkanDevice;
@@ -27,8 +41,46 @@ private:
 class VulkanImageSampler final : public VulkanDeviceSubresource
 {
 public:
+    // Every piece of state that changes how the sampler behaves. Floats are kept as bit patterns and state the create info
+    // leaves unused is zeroed, so equivalent create infos produce equal keys
+    struct Key
+    {
+        VkSamplerCreateFlags flags = 0;
+        VkFilter magFilter = VK_FILTER_NEAREST;
+        VkFilter minFilter = VK_FILTER_NEAREST;
+        VkSamplerMipmapMode mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        VkSamplerAddressMode addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        VkSamplerAddressMode addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        VkSamplerAddressMode addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        uint32_t mipLodBias = 0;
+        uint32_t maxAnisotropy = 0;
+        VkCompareOp compareOp = VK_COMPARE_OP_NEVER;
+        uint32_t minLod = 0;
+        uint32_t maxLod = 0;
+        VkBorderColor borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+        VkBool32 anisotropyEnable = VK_FALSE;
+        VkBool32 compareEnable = VK_FALSE;
+        VkBool32 unnormalizedCoordinates = VK_FALSE;
+        VkSamplerReductionMode reductionMode = VK_SAMPLER_REDUCTION_MODE_WEIGHTED_AVERAGE;
+        uint32_t customBorderColor[4]{};
+        VkFormat customBorderFormat = VK_FORMAT_UNDEFINED;
+
+        bool operator==(const Key& p_Other) const = default;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& p_Key) const;
+    };
+
     [[nodiscard]] VkSampler operator*() const { return m_VkHandle; }
 
+    // False when p_CreateInfo chains a structure the key can't describe, such as a YCbCr conversion
+    [[nodiscard]] static bool makeKey(const VkSamplerCreateInfo& p_CreateInfo, Key& p_Key);
+
+    [[nodiscard]] uint32_t getReferenceCount() const { return m_References; }
+    [[nodiscard]] bool isShared() const { return m_Shared; }
+
 private:
     void free() override;
 
@@ -36,6 +88,10 @@ private:
 
     VkSampler m_VkHandle = VK_NULL_HANDLE;
 
+    Key m_Key{};
+    uint32_t m_References = 0;
+    bool m_Shared = false;
+
     friend class VulkanImage;
     friend class VulkanDevice;
 };
@@ -51,6 +107,9 @@ public:
         VkImageUsageFlags usage;
         VkImageCreateFlags flags = 0;
         VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL;
+        uint32_t mipLevels = 1;
+        uint32_t arrayLayers = 1;
+        VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
     };
 
     using MemoryPreferences = VulkanMemoryAllocator::MemoryPreferences;
@@ -59,12 +118,22 @@ public:
 
     void allocate(MemoryPreferences p_Preferences) override;
 
+    // Views are cached per image, asking again for the same format, type, range and swizzle returns the existing view with
+    // one more reference, and freeImageView only destroys it once every reference is gone
+    // Covers every mip level and array layer, with the view type picked from the image type and layer count
     ResourceID createImageView(VkFormat p_Format, VkImageAspectFlags p_AspectFlags);
+    ResourceID createImageView(VkFormat p_Format, VkImageViewType p_ViewType, const VkImageSubresourceRange& p_Range, const VkComponentMapping& p_Components = {});
+    // A single mip level over every layer. Cube images are viewed as 2D arrays so the level can be bound as a storage image
+    ResourceID createMipView(uint32_t p_MipLevel);
+    // A single mip level of a single layer
+    ResourceID createLayerView(uint32_t p_ArrayLayer, uint32_t p_MipLevel = 0);
+    [[nodiscard]] uint32_t getImageViewCount() const { return m_ImageViews.size(); }
     VulkanImageView& getImageView(ResourceID p_ImageView);
     [[nodiscard]] const VulkanImageView& getImageView(ResourceID p_ImageView) const;
     void freeImageView(ResourceID p_ImageView);
     void freeImageView(const VulkanImageView& p_ImageView);
 
+    // Comes from the device sampler cache, so images asking for the same state share one sampler. The image holds a reference until freeSampler or free
     ResourceID createSampler(VkFilter p_Filter, VkSamplerAddressMode p_SamplerAddressMode);
     VulkanImageSampler& getSampler(ResourceID p_Sampler);
     [[nodiscard]] const VulkanImageSampler& getSampler(ResourceID p_Sampler) const;
@@ -74,14 +143,34 @@ public:
     [[nodiscard]] VkExtent3D getSize() const;
     [[nodiscard]] uint32_t getFlatSize() const;
     [[nodiscard]] VkImageType getType() const;
+    [[nodiscard]] VkFormat getFormat() const;
+    [[nodiscard]] uint32_t getMipLevels() const { return m_MipLevels; }
+    [[nodiscard]] uint32_t getArrayLayers() const { return m_ArrayLayers; }
+    [[nodiscard]] VkSampleCountFlagBits getSamples() const { return m_Samples; }
+    [[nodiscard]] VkImageAspectFlags getAspectFlags() const { return getAspectFlags(m_Format); }
+    // Every mip level and array layer of the image
+    [[nodiscard]] VkImageSubresourceRange getFullRange() const;
+    // Only complete for images created through the device, swapchain images don't know their usage
+    [[nodiscard]] Config getConfig() const;
     [[nodiscard]] VkImageLayout getLayout() const;
     [[nodiscard]] uint32_t getQueue() const;
 
     void setLayout(VkImageLayout p_Layout);
     void setQueue(uint32_t p_QueueFamilyIndex);
 
+    // True when VK_EXT_host_image_copy is enabled, the image was created with VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT, its format
+    // supports host transfers with its tiling and the device can copy into p_Layout
+    [[nodiscard]] bool canCopyFromHost(VkImageLayout p_Layout) const;
+    // Writes tightly packed texels from host memory without going through a queue, moving the whole image to p_Layout on the host first
+    // Runs immediately, so the GPU must not be accessing the image
+    void copyFromHost(const void* p_Data, const VkImageSubresourceLayers& p_Subresource, VkOffset3D p_Offset, VkExtent3D p_Extent, VkImageLayout p_Layout);
+
     VkImage operator*() const;
 
+    [[nodiscard]] static VkImageAspectFlags getAspectFlags(VkFormat p_Format);
+    // Levels in a full mip chain down to 1x1x1
+    [[nodiscard]] static uint32_t getFullMipCount(VkExtent3D p_Extent);
+
 private:
     [[nodiscard]] VulkanImageView* getImageViewPtr(ResourceID p_ImageView) const;
     [[nodiscard]] VulkanImageSampler* getSamplerPtr(ResourceID p_Sampler) const;
@@ -89,16 +178,29 @@ private:
     void free() override;
 
     VulkanImage(ResourceID p_Device, VkImage p_VkHandle, VkExtent3D p_Size, VkImageType p_Type, VkImageLayout p_Layout);
+    VulkanImage(ResourceID p_Device, VkImage p_VkHandle, const Config& p_Config, VkImageLayout p_Layout);
 
     void setBoundMemory(VmaAllocation p_Allocation) override;
+    [[nodiscard]] VkImageViewType getDefaultViewType() const;
+    [[nodiscard]] VkImageView createViewHandle(VkFormat p_Format, VkImageViewType p_ViewType, const VkImageSubresourceRange& p_Range, const VkComponentMapping& p_Components) const;
+    // Takes over p_Other's image handle and rebuilds every view on it, keeping their IDs. Memory is left untouched
+    void swapHandle(VulkanImage& p_Other);
 
     VkExtent3D m_Size{};
     VkImageType m_Type;
     VkImageLayout m_Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkFormat m_Format = VK_FORMAT_UNDEFINED;
+    VkImageUsageFlags m_Usage = 0;
+    VkImageCreateFlags m_Flags = 0;
+    VkImageTiling m_Tiling = VK_IMAGE_TILING_OPTIMAL;
+    uint32_t m_MipLevels = 1;
+    uint32_t m_ArrayLayers = 1;
+    VkSampleCountFlagBits m_Samples = VK_SAMPLE_COUNT_1_BIT;
 
     VkImage m_VkHandle = VK_NULL_HANDLE;
 
-    ARENA_UMAP(m_ImageViews, ResourceID, VulkanImageView*);
+    // Images rarely have more than a handful of views, so a linear search beats hashing
+    InlineVector<VulkanImageView*, 8> m_ImageViews;
     ARENA_UMAP(m_Samplers, ResourceID, VulkanImageSampler*);
 
     friend class VulkanDevice;
@@ -106,4 +208,5 @@ private:
     friend class VulkanSwapchain;
     friend class VulkanMemoryBarrierBuilder;
     friend class VulkanExternalMemoryExtension;
+    friend class VulkanDefragmenter;
 };
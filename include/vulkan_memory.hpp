@@ -1,6 +1,8 @@
 #pragma once
 #include <optional>
+#include <span>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "vulkan_gpu.hpp"
@@ -55,6 +57,16 @@ public:
         VmaAllocationInfo info{};
     };
 
+    struct HeapBudget
+    {
+        // Usage and budget come from VK_EXT_memory_budget when enabled, otherwise VMA estimates them from its own allocations
+        VkDeviceSize usage = 0;
+        VkDeviceSize budget = 0;
+        VkDeviceSize allocationBytes = 0;
+        VkDeviceSize blockBytes = 0;
+        bool deviceLocal = false;
+    };
+
     struct MemoryPreferences
     {
         VmaMemoryUsage usage = VMA_MEMORY_USAGE_AUTO;
@@ -90,6 +102,11 @@ public:
         bool operator==(const PoolPreferences& p_Other) const;
     };
 
+    struct PoolPreferencesHash
+    {
+        size_t operator()(const PoolPreferences& p_Prefs) const;
+    };
+
     [[nodiscard]] uint32_t findMemoryType(const MemoryPreferences& p_Preferences) const;
     [[nodiscard]] uint32_t findMemoryType(const VkMemoryRequirements& p_Reqs, const MemoryPreferences& p_Preferences) const;
     [[nodiscard]] uint32_t findMemoryType(const MemoryPreferences& p_Preferences, uint32_t p_StartingFilter) const;
@@ -100,13 +117,34 @@ public:
 
     uint32_t getOrCreatePool(const PoolPreferences& p_Prefs);
     uint32_t createPool(const PoolPreferences& p_Prefs);
+    // Every allocation made from the pool must have been freed
+    void destroyPool(uint32_t p_Id);
 
     void* map(VmaAllocation p_Alloc) const;
     void unmap(VmaAllocation p_Alloc) const;
-    void deallocate(VmaAllocation p_Alloc) const;
+    void deallocate(VmaAllocation p_Alloc);
+
+    void flush(VmaAllocation p_Alloc, VkDeviceSize p_Offset, VkDeviceSize p_Size) const;
+    void invalidate(VmaAllocation p_Alloc, VkDeviceSize p_Offset, VkDeviceSize p_Size) const;
+    [[nodiscard]] bool isHostCoherent(VmaAllocation p_Alloc) const;
+
+    // Host writes to non-coherent memory are recorded here and flushed together with a single vmaFlushAllocations call
+    void markDirty(VmaAllocation p_Alloc, VkDeviceSize p_Offset, VkDeviceSize p_Size);
+    void flushDirtyRanges();
+    [[nodiscard]] bool hasDirtyRanges() const;
 
     [[nodiscard]] const MemoryStructure& getMemoryStructure() const;
     [[nodiscard]] VmaAllocationInfo getAllocationInfo(VmaAllocation p_Allocation) const;
+    [[nodiscard]] uint32_t getAllocationHeap(VmaAllocation p_Allocation) const;
+    // Lets code that only sees VMA allocations, like defragmentation moves, find the resource they are bound to
+    void setAllocationOwner(VmaAllocation p_Allocation, ResourceID p_Owner) const;
+    [[nodiscard]] ResourceID getAllocationOwner(VmaAllocation p_Allocation) const;
+
+    // VMA only refreshes the driver reported budget when the frame index changes, so call this once per frame
+    void setCurrentFrameIndex(uint32_t p_FrameIndex) const;
+    [[nodiscard]] std::vector<HeapBudget> getHeapBudgets() const;
+    [[nodiscard]] HeapBudget getHeapBudget(uint32_t p_Heap) const;
+    [[nodiscard]] bool isBudgetTracked() const { return m_BudgetTracked; }
 
     VmaAllocator operator*() const { return m_Allocator; }
 
@@ -124,6 +162,12 @@ private:
         T as() const { return reinterpret_cast<T>(vkObj); }
     };
 
+    struct DirtyRange
+    {
+        VkDeviceSize begin;
+        VkDeviceSize end;
+    };
+
     struct PoolData
     {
         uint32_t id;
@@ -132,11 +176,38 @@ private:
         PoolPreferences prefs;
     };
 
+    // Everything vmaFindMemoryTypeIndex looks at, priority and forced indices don't change which type it picks
+    struct MemoryTypeKey
+    {
+        uint32_t typeBits;
+        VmaMemoryUsage usage;
+        VmaAllocationCreateFlags flags;
+        uint32_t pool;
+        VkMemoryPropertyFlags desiredProperties;
+        VkMemoryPropertyFlags preferredProperties;
+
+        bool operator==(const MemoryTypeKey& p_Other) const = default;
+    };
+
+    struct MemoryTypeKeyHash
+    {
+        size_t operator()(const MemoryTypeKey& p_Key) const;
+    };
+
     VulkanMemoryAllocator() = default;
     explicit VulkanMemoryAllocator(const VulkanDevice& p_Device);
 
     [[nodiscard]] AllocationReturn createBuffer(const VkBufferCreateInfo& p_Info, const MemoryPreferences& p_Preferences) const;
     [[nodiscard]] AllocationReturn createImage(const VkImageCreateInfo& p_Info, const MemoryPreferences& p_Preferences) const;
+    // Handles with identical memory requirements share a single vmaAllocateMemoryPages call
+    // Resources that prefer or require dedicated memory go through createBuffer/createImage instead. A failed batch destroys everything it created
+    void createBuffers(std::span<const VkBufferCreateInfo> p_Infos, const MemoryPreferences& p_Preferences, std::span<AllocationReturn> p_Results) const;
+    void createImages(std::span<const VkImageCreateInfo> p_Infos, const MemoryPreferences& p_Preferences, std::span<AllocationReturn> p_Results) const;
+    // Resolves the type VMA would pick for the resource, UINT32_MAX if none fits
+    [[nodiscard]] uint32_t findMemoryType(const VkBufferCreateInfo& p_Info, const VkMemoryRequirements& p_Reqs, const MemoryPreferences& p_Preferences) const;
+    [[nodiscard]] uint32_t findMemoryType(const VkImageCreateInfo& p_Info, const VkMemoryRequirements& p_Reqs, const MemoryPreferences& p_Preferences) const;
+    // p_MemoryTypes is parallel to p_Requirements, every run is allocated from its resolved type
+    void allocatePages(std::span<const VkMemoryRequirements> p_Requirements, std::span<const uint32_t> p_MemoryTypes, const MemoryPreferences& p_Preferences, std::span<AllocationReturn> p_Results) const;
 
     [[nodiscard]] VmaAllocationCreateInfo toVmaAllocCI(const MemoryPreferences& p_Preferences, uint32_t p_MemoryTypeBits) const;
 
@@ -145,9 +216,18 @@ private:
     VmaAllocator m_Allocator = VK_NULL_HANDLE;
     MemoryStructure m_MemoryStructure{};
 
-    std::vector<PoolData> m_Pools{};
+    std::unordered_map<uint32_t, PoolData> m_Pools{};
+    std::unordered_map<PoolPreferences, uint32_t, PoolPreferencesHash> m_PoolsByPrefs{};
+    uint32_t m_NextPoolID = 0;
+
+    mutable std::unordered_map<MemoryTypeKey, uint32_t, MemoryTypeKeyHash> m_MemoryTypeCache{};
+    std::unordered_map<VmaAllocation, std::vector<DirtyRange>> m_DirtyRanges{};
 
     ResourceID m_Device;
+    // Resolved once at creation, so allocations don't look extensions up by name
+    bool m_BudgetTracked = false;
+    bool m_PriorityEnabled = false;
 
     friend class VulkanDevice;
+    friend class VulkanDefragmenter;
 };
\ No newline at end of file
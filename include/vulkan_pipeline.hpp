@@ -127,6 +127,11 @@ class VulkanPipelineLayout final : public VulkanDeviceSubresource
 public:
     VkPipelineLayout operator*() const;
 
+    [[nodiscard]] const std::vector<ResourceID>& getSetLayouts() const { return m_SetLayouts; }
+    [[nodiscard]] const std::vector<VkPushConstantRange>& getPushConstantRanges() const { return m_PushConstantRanges; }
+    // Number of createPipelineLayout calls sharing this layout
+    [[nodiscard]] uint32_t getReferenceCount() const { return m_References; }
+
 private:
     void free() override;
 
@@ -134,7 +139,12 @@ private:
 
     VkPipelineLayout m_VkHandle = VK_NULL_HANDLE;
 
+    // Each holds a reference to its set layout, so their handles can't be reused while this layout is cached under them
+    std::vector<ResourceID> m_SetLayouts;
+    std::vector<VkPushConstantRange> m_PushConstantRanges;
+
     size_t m_Hash = 0;
+    uint32_t m_References = 1;
 
     friend class VulkanDevice;
     friend class VulkanCommandBuffer;
@@ -16,6 +16,18 @@ enum AttachmentType
     PRESERVE_ATTACHMENT
 };
 
+// What happens to an attachment's contents once the render pass ends
+enum class AttachmentStore
+{
+    // Keeps the store ops given in the description
+    KEEP,
+    // Forces DONT_CARE stores, for attachments nothing reads after the pass
+    DISCARD,
+    // Discards depth attachments and resolved multisampled color attachments that end the pass in an attachment-only layout
+    // Attachments a later pass loads from must use KEEP instead
+    AUTO
+};
+
 class VulkanRenderPassBuilder
 {
 public:
@@ -56,13 +68,16 @@ public:
         }
     };
 
-    VulkanRenderPassBuilder& addAttachment(const VkAttachmentDescription& p_Attachment);
+    VulkanRenderPassBuilder& addAttachment(const VkAttachmentDescription& p_Attachment, AttachmentStore p_Store = AttachmentStore::KEEP);
     VulkanRenderPassBuilder& addSubpass(std::span<const AttachmentReference> p_Attachments, VkSubpassDescriptionFlags p_Flags);
     VulkanRenderPassBuilder& addDependency(const VkSubpassDependency& p_Dependency);
 
     static VkAttachmentDescription createAttachment(VkFormat p_Format, VkAttachmentLoadOp p_LoadOp, VkAttachmentStoreOp p_StoreOp, VkImageLayout p_InitialLayout, VkImageLayout p_FinalLayout);
 
 private:
+    // Attachment descriptions with the store ops AttachmentStore asked for
+    [[nodiscard]] std::vector<VkAttachmentDescription> resolveAttachments() const;
+
     struct SubpassInfo
     {
         VkSubpassDescriptionFlags flags;
@@ -75,6 +90,7 @@ private:
     };
 
     std::vector<VkAttachmentDescription> m_Attachments;
+    std::vector<AttachmentStore> m_AttachmentStores;
     std::vector<SubpassInfo> m_Subpasses;
     std::vector<VkSubpassDependency> m_Dependencies;
 
@@ -0,0 +1,105 @@
+#pragma once
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <Volk/volk.h>
+
+#include "vulkan_memory.hpp"
+#include "utils/identifiable.hpp"
+
+class VulkanCommandBuffer;
+
+// Watches the device local heaps against the budget reported by VK_EXT_memory_budget and, when a heap gets close to it,
+// moves low priority streamable buffers to host memory before the driver starts paging on its own
+// Buffers keep their ResourceID when moved, descriptors pointing at them have to be rewritten from the relocation callback
+class VulkanResidencyManager
+{
+public:
+    using Callback = std::function<void(ResourceID)>;
+
+    struct Config
+    {
+        // Fractions of the heap budget. Eviction starts above the threshold and stops once usage is back under the target
+        float evictionThreshold = 0.9f;
+        float targetUsage = 0.8f;
+        // Resources used more recently than this are never evicted
+        uint32_t minIdleFrames = 3;
+        uint32_t framesInFlight = 2;
+        bool promoteWhenIdle = true;
+    };
+
+    explicit VulkanResidencyManager(ResourceID p_Device, const Config& p_Config = {});
+
+    // Higher priority stays resident longer. Only streamable resources are ever evicted or demoted
+    void track(ResourceID p_Resource, float p_Priority, bool p_Streamable);
+    void untrack(ResourceID p_Resource);
+    void setPriority(ResourceID p_Resource, float p_Priority);
+    void markUsed(ResourceID p_Resource);
+
+    // Images and buffers that can't be copied are handed here instead of being demoted. The owner is expected to free them and reload on demand
+    void setEvictionCallback(Callback p_Callback) { m_EvictionCallback = std::move(p_Callback); }
+    // Called once a buffer's handle changed after a demotion or promotion
+    void setRelocationCallback(Callback p_Callback) { m_RelocationCallback = std::move(p_Callback); }
+
+    // Call once per frame. Migration copies are recorded into p_CommandBuffer, which must be submitted with p_Fence
+    // A buffer must not be written by the GPU between being picked for migration and p_Fence signaling
+    void update(uint32_t p_FrameIndex, const VulkanCommandBuffer& p_CommandBuffer, ResourceID p_Fence);
+
+    // Waits for pending migrations and releases every retired allocation
+    void free();
+
+    [[nodiscard]] bool isTracked(ResourceID p_Resource) const { return m_Entries.contains(p_Resource); }
+    [[nodiscard]] bool isDemoted(ResourceID p_Resource) const;
+    [[nodiscard]] size_t getTrackedCount() const { return m_Entries.size(); }
+    [[nodiscard]] size_t getPendingMigrationCount() const { return m_Migrations.size(); }
+
+private:
+    struct Entry
+    {
+        float priority;
+        uint32_t lastUsedFrame;
+        bool streamable;
+        bool demoted;
+        bool migrating;
+    };
+
+    struct Migration
+    {
+        ResourceID resource;
+        // Fresh buffer receiving the copy, after the swap it holds the old handle and memory
+        ResourceID copy;
+        ResourceID fence;
+        uint32_t releasedHeap;
+        VkDeviceSize size;
+        bool demote;
+    };
+
+    struct Retired
+    {
+        ResourceID buffer;
+        uint32_t frame;
+        uint32_t heap;
+        VkDeviceSize size;
+    };
+
+    void completeMigrations();
+    void releaseRetired(bool p_Force);
+
+    void evict(uint32_t p_Heap, VkDeviceSize p_Bytes, const VulkanCommandBuffer& p_CommandBuffer, ResourceID p_Fence);
+    void promote(const std::vector<VulkanMemoryAllocator::HeapBudget>& p_Budgets, const VulkanCommandBuffer& p_CommandBuffer, ResourceID p_Fence);
+    bool migrate(ResourceID p_Buffer, bool p_Demote, const VulkanCommandBuffer& p_CommandBuffer, ResourceID p_Fence);
+
+    ResourceID m_Device;
+    Config m_Config;
+
+    uint32_t m_Frame = 0;
+    std::unordered_map<ResourceID, Entry> m_Entries;
+    std::vector<Migration> m_Migrations;
+    std::vector<Retired> m_Retired;
+    // Device local bytes already on their way out, so the same overshoot isn't answered twice while copies are in flight
+    std::vector<VkDeviceSize> m_PendingRelease;
+
+    Callback m_EvictionCallback;
+    Callback m_RelocationCallback;
+};
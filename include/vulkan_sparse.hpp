@@ -0,0 +1,132 @@
+#pragma once
+#include <deque>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include <Volk/volk.h>
+
+#include "vulkan_memory.hpp"
+#include "utils/identifiable.hpp"
+
+class VulkanQueue;
+
+// Identifies one sparse page. Buffers only use tile.x as the page index, images use tiles of the format's sparse granularity
+struct VulkanSparsePage
+{
+    ResourceID resource = UINT32_MAX;
+    uint32_t mipLevel = 0;
+    uint32_t arrayLayer = 0;
+    VkOffset3D tile{};
+
+    bool operator==(const VulkanSparsePage& p_Other) const;
+};
+
+struct VulkanSparsePageHash
+{
+    size_t operator()(const VulkanSparsePage& p_Page) const;
+};
+
+// Page granular residency for sparse buffers and images created with the sparse binding and residency flags
+// Pages come out of a shared pool of fixed size allocations and every commit or eviction requested between two flushes
+// is bound with a single vkQueueBindSparse call on a queue supporting sparse binding
+class VulkanSparseBinder
+{
+public:
+    struct Config
+    {
+        // Upper bound of pages held at once. Commits past it fail until idle pages are evicted
+        uint32_t maxPages = 4096;
+        // Pages allocated from VMA at a time when the pool runs dry
+        uint32_t pagesPerAllocation = 16;
+        // Frames without a request after which evictIdle releases a page
+        uint32_t minIdleFrames = 8;
+    };
+
+    explicit VulkanSparseBinder(ResourceID p_Device, const Config& p_Config = {});
+
+    // Images get their mip tail committed on the next flush, it can't be made partially resident
+    void registerBuffer(ResourceID p_Buffer);
+    void registerImage(ResourceID p_Image);
+    // Evicts every page of the resource. Must happen before the resource is freed
+    void unregister(ResourceID p_Resource);
+
+    // Returns false when the pool is exhausted, the page is then retried on the next request
+    bool commit(const VulkanSparsePage& p_Page);
+    void evict(const VulkanSparsePage& p_Page);
+
+    // Feeds the pages the GPU reported as needed this frame, missing ones are committed and least recently requested
+    // pages are evicted to make room once the pool is full
+    void request(std::span<const VulkanSparsePage> p_Pages);
+    // Evicts every page not requested within minIdleFrames
+    void evictIdle();
+
+    // Submits every pending bind in one call, p_Queue must support sparse binding. Evicted pages go back to the pool once
+    // the binder's own fence for this flush signals. GPU work still reading evicted pages must be covered by p_WaitSemaphores
+    void flush(const VulkanQueue& p_Queue, std::span<const ResourceID> p_WaitSemaphores, std::span<const ResourceID> p_SignalSemaphores);
+
+    // Waits for pending binds and releases all page memory. Registered resources must not be used afterwards
+    void free();
+
+    [[nodiscard]] bool isResident(const VulkanSparsePage& p_Page) const { return m_Resident.contains(p_Page); }
+    [[nodiscard]] VkDeviceSize getPageSize(ResourceID p_Resource) const;
+    [[nodiscard]] VkExtent3D getTileExtent(ResourceID p_Image) const;
+    [[nodiscard]] size_t getResidentPageCount() const { return m_Resident.size(); }
+    [[nodiscard]] uint32_t getAllocatedPageCount() const { return m_AllocatedPages; }
+
+private:
+    struct Resource
+    {
+        VkMemoryRequirements requirements;
+        bool image;
+
+        VkSparseImageMemoryRequirements sparse;
+        VmaAllocation mipTail;
+        // One tail per array layer unless the format uses a single mip tail
+        uint32_t mipTailCount;
+    };
+
+    struct Resident
+    {
+        VmaAllocation page;
+        uint32_t lastRequestFrame;
+    };
+
+    struct FreedPage
+    {
+        VmaAllocation page;
+        uint64_t poolKey;
+    };
+
+    struct Retired
+    {
+        ResourceID fence;
+        std::vector<FreedPage> pages;
+    };
+
+    [[nodiscard]] static uint64_t getPoolKey(const VkMemoryRequirements& p_Requirements);
+    [[nodiscard]] VmaAllocation acquirePage(const VkMemoryRequirements& p_Requirements);
+    void queueBind(const VulkanSparsePage& p_Page, VmaAllocation p_Memory);
+    void queueMipTailBind(ResourceID p_Image, const Resource& p_Resource, VmaAllocation p_Memory);
+    void reclaim();
+
+    [[nodiscard]] const Resource& getResource(ResourceID p_Resource) const;
+
+    ResourceID m_Device;
+    Config m_Config;
+
+    uint32_t m_Frame = 0;
+    uint32_t m_AllocatedPages = 0;
+
+    std::unordered_map<ResourceID, Resource> m_Resources;
+    std::unordered_map<VulkanSparsePage, Resident, VulkanSparsePageHash> m_Resident;
+    // Free pages, by page size and the memory type bits they were allocated for
+    std::unordered_map<uint64_t, std::vector<VmaAllocation>> m_FreePages;
+    std::deque<Retired> m_Retired;
+    // Evictions waiting for the flush that unbinds them
+    std::vector<FreedPage> m_Evicted;
+
+    std::unordered_map<ResourceID, std::vector<VkSparseMemoryBind>> m_BufferBinds;
+    std::unordered_map<ResourceID, std::vector<VkSparseMemoryBind>> m_OpaqueImageBinds;
+    std::unordered_map<ResourceID, std::vector<VkSparseImageMemoryBind>> m_ImageBinds;
+};
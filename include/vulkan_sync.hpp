@@ -11,8 +11,12 @@ public:
 
 	void reset();
 	void wait();
+	bool poll();
 
 	[[nodiscard]] bool isSignaled() const;
+	// Bumped by every VulkanCommandBuffer::submit signaling this fence. Work recorded against the fence is only covered by
+	// a signal once the count moved past the value seen at record time, before that the fence may still be signaled from its last use
+	[[nodiscard]] uint64_t getSubmitCount() const { return m_SubmitCount; }
 
 	VkFence operator*() const;
 
@@ -24,6 +28,7 @@ private:
 	VkFence m_VkHandle = VK_NULL_HANDLE;
 
 	bool m_IsSignaled = false;
+	uint64_t m_SubmitCount = 0;
 
 	friend class VulkanDevice;
 	friend class SDLWindow;
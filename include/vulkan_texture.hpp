@@ -0,0 +1,59 @@
+#pragma once
+#include <string_view>
+#include <vector>
+
+#include <Volk/volk.h>
+
+#include "utils/identifiable.hpp"
+#include "utils/texture_container.hpp"
+
+class VulkanCommandBuffer;
+
+// Uploads KTX2 and DDS textures, block compressed ones included, with every mip level and layer going through a single
+// buffer to image copy. Formats the device can't sample are decoded to RGBA8 on the CPU when the container format allows it
+class VulkanTextureLoader
+{
+public:
+    struct Config
+    {
+        VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT;
+        VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        bool allowTranscoding = true;
+    };
+
+    struct Texture
+    {
+        ResourceID image = UINT32_MAX;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        bool transcoded = false;
+    };
+
+    explicit VulkanTextureLoader(ResourceID p_Device, const Config& p_Config = {});
+
+    // Creates the image and records its upload into p_CommandBuffer, which must be submitted with p_Fence
+    Texture load(const VulkanCommandBuffer& p_CommandBuffer, ResourceID p_Fence, std::string_view p_Path);
+    Texture load(const VulkanCommandBuffer& p_CommandBuffer, ResourceID p_Fence, const TextureContainer& p_Container);
+
+    // Frees the staging buffers of uploads that were submitted and whose fence has signaled since. Call it after submitting,
+    // load() doesn't, since the fence may still be signaled from its previous use while the command buffer is being recorded
+    void reclaim();
+    // Waits for every submitted upload, uploads that were never submitted only get their staging buffer freed
+    void free();
+
+    [[nodiscard]] bool isFormatSupported(VkFormat p_Format) const;
+    [[nodiscard]] size_t getPendingCount() const { return m_Pending.size(); }
+
+private:
+    struct PendingUpload
+    {
+        ResourceID fence;
+        ResourceID staging;
+        // Fence submit count when the upload was recorded
+        uint64_t submitCount;
+    };
+
+    ResourceID m_Device;
+    Config m_Config;
+
+    std::vector<PendingUpload> m_Pending;
+};
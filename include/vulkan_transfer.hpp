@@ -0,0 +1,272 @@
+#pragma once
+#include <array>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <span>
+#include <string_view>
+#include <vector>
+#include <Volk/volk.h>
+
+#include "vulkan_context.hpp"
+#include "vulkan_queues.hpp"
+#include "utils/async_file_reader.hpp"
+#include "utils/identifiable.hpp"
+#include "utils/mapped_file.hpp"
+
+class VulkanCommandBuffer;
+
+class VulkanBufferUpdateBatcher
+{
+public:
+    // vkCmdUpdateBuffer hard limit
+    static constexpr VkDeviceSize MAX_INLINE_UPDATE_SIZE = 65536;
+
+    VulkanBufferUpdateBatcher(ResourceID p_Device, VkDeviceSize p_StagingSize, uint32_t p_QueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED);
+
+    // Returns false if the update does not fit in the remaining staging space. Record the batch, wait for it and reset() before retrying
+    bool addUpdate(ResourceID p_Buffer, VkDeviceSize p_Offset, const void* p_Data, VkDeviceSize p_Size);
+
+    void setInlineThreshold(VkDeviceSize p_Threshold);
+
+    // Only call once the GPU has finished consuming every recorded batch
+    void reset();
+    void free();
+
+    [[nodiscard]] bool hasPendingUpdates() const { return !m_Updates.empty(); }
+    [[nodiscard]] size_t getPendingUpdateCount() const { return m_Updates.size(); }
+    [[nodiscard]] VkDeviceSize getStagingSize() const { return m_StagingSize; }
+    [[nodiscard]] VkDeviceSize getStagingUsage() const { return m_StagingCursor; }
+    [[nodiscard]] ResourceID getStagingBuffer() const { return m_StagingBuffer; }
+
+private:
+    struct Update
+    {
+        ResourceID buffer;
+        VkDeviceSize dstOffset;
+        VkDeviceSize size;
+        VkDeviceSize srcOffset;
+        bool isInline;
+    };
+
+    [[nodiscard]] bool isInlineCandidate(VkDeviceSize p_Offset, VkDeviceSize p_Size) const;
+    [[nodiscard]] bool reserveStaging(VkDeviceSize p_Size, VkDeviceSize& p_Offset);
+
+    ResourceID m_Device;
+
+    ResourceID m_StagingBuffer = UINT32_MAX;
+    uint8_t* m_StagingData = nullptr;
+    VkDeviceSize m_StagingSize = 0;
+    VkDeviceSize m_StagingCursor = 0;
+
+    VkDeviceSize m_InlineThreshold = MAX_INLINE_UPDATE_SIZE;
+
+    ARENA_VECTOR(m_Updates, Update);
+    ARENA_VECTOR(m_InlineData, uint8_t);
+
+    friend class VulkanCommandBuffer;
+};
+
+class VulkanReadbackManager
+{
+public:
+    // The span is only valid for the duration of the callback
+    using Callback = std::function<void(std::span<const uint8_t>)>;
+
+    explicit VulkanReadbackManager(ResourceID p_Device);
+
+    // p_Fence must be the fence the command buffer is submitted with
+    void readBuffer(const VulkanCommandBuffer& p_CommandBuffer, ResourceID p_Fence, ResourceID p_Buffer, VkDeviceSize p_Offset, VkDeviceSize p_Size, Callback p_Callback);
+    [[nodiscard]] std::future<std::vector<uint8_t>> readBuffer(const VulkanCommandBuffer& p_CommandBuffer, ResourceID p_Fence, ResourceID p_Buffer, VkDeviceSize p_Offset, VkDeviceSize p_Size);
+
+    void readImage(const VulkanCommandBuffer& p_CommandBuffer, ResourceID p_Fence, ResourceID p_Image, uint32_t p_BytesPerPixel, Callback p_Callback);
+    [[nodiscard]] std::future<std::vector<uint8_t>> readImage(const VulkanCommandBuffer& p_CommandBuffer, ResourceID p_Fence, ResourceID p_Image, uint32_t p_BytesPerPixel);
+
+    // Resolves every readback whose command buffer was submitted and whose fence has signaled since, returns how many were resolved
+    // A fence still signaled from its previous use doesn't count, so polling between recording and submitting is safe
+    uint32_t poll();
+    // Waits for every submitted readback and resolves it, readbacks that were never submitted stay pending
+    void waitAll();
+
+    void free();
+
+    [[nodiscard]] size_t getPendingCount() const { return m_Pending.size(); }
+    [[nodiscard]] size_t getPooledBufferCount() const { return m_Pool.size(); }
+
+private:
+    struct PooledBuffer
+    {
+        ResourceID buffer;
+        VkDeviceSize size;
+        bool inUse;
+    };
+
+    struct PendingReadback
+    {
+        ResourceID fence;
+        // Fence submit count when the copy was recorded
+        uint64_t submitCount;
+        uint32_t poolIndex;
+        VkDeviceSize size;
+        Callback callback;
+    };
+
+    [[nodiscard]] uint32_t acquireBuffer(VkDeviceSize p_Size);
+    void resolve(const PendingReadback& p_Readback);
+
+    static Callback toPromise(const std::shared_ptr<std::promise<std::vector<uint8_t>>>& p_Promise);
+
+    ResourceID m_Device;
+
+    ARENA_VECTOR(m_Pool, PooledBuffer);
+    std::vector<PendingReadback> m_Pending;
+};
+
+// Persistently mapped staging buffer handed out front to back. Ranges are recycled once the submission serial they were retired with completes
+class VulkanStagingRing
+{
+public:
+    struct Range
+    {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        uint8_t* data;
+    };
+
+    VulkanStagingRing(ResourceID p_Device, VkDeviceSize p_Size, uint32_t p_QueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED);
+
+    // Returns false if there is no contiguous free space left, complete() a retired serial before retrying
+    [[nodiscard]] bool allocate(VkDeviceSize p_Size, VkDeviceSize p_Alignment, Range& p_Range);
+    // Ties every range allocated since the last retire to p_Serial, a number the caller gives each submission
+    void retire(uint64_t p_Serial);
+    // Ties a single range to p_Serial, for ranges that are filled and consumed out of allocation order
+    void retire(VkDeviceSize p_Offset, uint64_t p_Serial);
+    // Marks the ranges retired with p_Serial as done once the GPU finished that submission, returns how many bytes were freed
+    // Done ranges behind a range still in use are only freed together with it, space is handed out in allocation order
+    VkDeviceSize complete(uint64_t p_Serial);
+
+    void free();
+
+    [[nodiscard]] ResourceID getBuffer() const { return m_Buffer; }
+    [[nodiscard]] VkDeviceSize getSize() const { return m_Size; }
+    [[nodiscard]] bool isEmpty() const { return m_Allocations.empty(); }
+    [[nodiscard]] bool hasUnretiredRanges() const { return !m_Allocations.empty() && m_Allocations.back().serial == UINT64_MAX; }
+
+private:
+    struct Allocation
+    {
+        VkDeviceSize begin;
+        VkDeviceSize end;
+        uint64_t serial;
+        bool done;
+    };
+
+    ResourceID m_Device;
+
+    ResourceID m_Buffer = UINT32_MAX;
+    uint8_t* m_Data = nullptr;
+    VkDeviceSize m_Size = 0;
+    VkDeviceSize m_Head = 0;
+
+    std::deque<Allocation> m_Allocations;
+};
+
+// Streams file contents into buffers through a staging ring, or imports the file mapping directly when VK_EXT_external_memory_host allows it
+class VulkanFileStreamer
+{
+public:
+    static constexpr uint32_t MAX_BATCHES_IN_FLIGHT = 3;
+
+    VulkanFileStreamer(ResourceID p_Device, QueueSelection p_Queue, ThreadID p_ThreadID, VkDeviceSize p_RingSize);
+
+    // p_Size == VK_WHOLE_SIZE streams up to the end of the file. Copies are recorded and submitted in batches, call waitIdle() before using the buffer
+    void uploadFile(std::string_view p_Path, VkDeviceSize p_FileOffset, VkDeviceSize p_Size, ResourceID p_Buffer, VkDeviceSize p_BufferOffset);
+    // Same as uploadFile, but the file is read asynchronously straight into ring ranges. Call pump() regularly to keep reads going and submit finished chunks
+    void uploadFileAsync(std::string_view p_Path, VkDeviceSize p_FileOffset, VkDeviceSize p_Size, ResourceID p_Buffer, VkDeviceSize p_BufferOffset);
+
+    // Issues reads as ring space frees up, and records and submits copies for the chunks that finished reading
+    // Returns true while async uploads are still in progress. p_Block waits for at least one read or batch to make progress
+    bool pump(bool p_Block = false);
+
+    // Submits the copies recorded so far without waiting for them
+    void submit();
+    void waitIdle();
+
+    void setImportEnabled(bool p_Enabled) { m_ImportEnabled = p_Enabled; }
+    void setChunkSize(VkDeviceSize p_Size);
+
+    void free();
+
+    [[nodiscard]] const VulkanStagingRing& getRing() const { return m_Ring; }
+    [[nodiscard]] bool hasPendingAsyncUploads() const { return !m_AsyncUploads.empty(); }
+
+private:
+    struct Batch
+    {
+        ResourceID commandBuffer = UINT32_MAX;
+        ResourceID fence = UINT32_MAX;
+        bool recording = false;
+        bool submitted = false;
+        // Ring ranges are retired with this instead of the fence, which is reset when the batch is reused
+        uint64_t serial = 0;
+
+        // Kept alive until the fence signals, the GPU reads straight from them
+        std::vector<MappedFile> files;
+        std::vector<ResourceID> importedBuffers;
+
+        std::vector<VkDeviceSize> ringRanges;
+        VkDeviceSize recordedBytes = 0;
+    };
+
+    struct AsyncUpload
+    {
+        AsyncFileReader::FileHandle file;
+        VkDeviceSize fileOffset;
+        VkDeviceSize size;
+        VkDeviceSize issued;
+        ResourceID buffer;
+        VkDeviceSize bufferOffset;
+        uint32_t readsInFlight;
+    };
+
+    struct ChunkRead
+    {
+        uint32_t upload;
+        VkDeviceSize ringOffset;
+        VkDeviceSize uploadOffset;
+        VkDeviceSize size;
+    };
+
+    [[nodiscard]] VulkanCommandBuffer& getRecordingCommandBuffer();
+    void recycleBatch(Batch& p_Batch);
+    // Recycles every submitted batch whose fence has signaled, without waiting
+    void recycleFinishedBatches();
+    bool waitOldestBatch();
+
+    [[nodiscard]] bool tryImport(MappedFile& p_File, VkDeviceSize p_FileOffset, VkDeviceSize p_Size, ResourceID p_Buffer, VkDeviceSize p_BufferOffset);
+    void copyThroughRing(const MappedFile& p_File, VkDeviceSize p_FileOffset, VkDeviceSize p_Size, ResourceID p_Buffer, VkDeviceSize p_BufferOffset);
+    void recordRingCopy(VkDeviceSize p_RingOffset, ResourceID p_Buffer, VkDeviceSize p_BufferOffset, VkDeviceSize p_Size);
+
+    // Returns false if the ring ran out of space before every queued read could be issued
+    bool issueReads();
+    void completeRead(const AsyncFileReader::Completion& p_Completion);
+
+    ResourceID m_Device;
+    QueueSelection m_Queue;
+    ThreadID m_ThreadID;
+
+    VulkanStagingRing m_Ring;
+    VkDeviceSize m_ChunkSize;
+
+    std::array<Batch, MAX_BATCHES_IN_FLIGHT> m_Batches{};
+    uint32_t m_CurrentBatch = 0;
+    uint64_t m_NextSerial = 1;
+
+    bool m_ImportEnabled = true;
+
+    AsyncFileReader* m_Reader = nullptr;
+    std::map<uint32_t, AsyncUpload> m_AsyncUploads;
+    std::unordered_map<AsyncFileReader::RequestID, ChunkRead> m_ChunkReads;
+    uint32_t m_NextUpload = 0;
+};
@@ -0,0 +1,330 @@
+#include "utils/async_file_reader.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <Windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+// Opt-in, the build defines ASYNC_FILE_READER_USE_IO_URING only when it also links liburing
+#if defined(ASYNC_FILE_READER_USE_IO_URING) && defined(__linux__) && __has_include(<liburing.h>)
+    #define ASYNC_FILE_READER_IO_URING
+    #include <liburing.h>
+#endif
+
+#include "utils/logger.hpp"
+#include "utils/thread_pool.hpp"
+
+struct AsyncFileReader::IoUring
+{
+#ifdef ASYNC_FILE_READER_IO_URING
+    io_uring ring;
+#endif
+    uint32_t inKernel = 0;
+};
+
+AsyncFileReader::AsyncFileReader(const uint32_t p_QueueDepth, const uint32_t p_FallbackThreadCount)
+    : m_QueueDepth(std::max(p_QueueDepth, 1U))
+{
+#ifdef ASYNC_FILE_READER_IO_URING
+    m_IoUring = new IoUring{};
+    const int l_Result = io_uring_queue_init(m_QueueDepth, &m_IoUring->ring, 0);
+    if (l_Result == 0)
+    {
+        LOG_DEBUG("Async file reader using io_uring with queue depth ", m_QueueDepth);
+        return;
+    }
+
+    // Kernels without io_uring, or sandboxes blocking it, get the thread pool instead
+    LOG_DEBUG("io_uring unavailable (error ", -l_Result, "), async file reader falling back to a thread pool");
+    delete m_IoUring;
+    m_IoUring = nullptr;
+#endif
+
+    m_Pool = new ThreadPool(std::max(p_FallbackThreadCount, 1U));
+}
+
+AsyncFileReader::~AsyncFileReader()
+{
+    // Reads write into caller memory, none can be left running
+    std::vector<Completion> l_Discarded;
+    while (m_InFlight > 0)
+    {
+        wait(l_Discarded);
+        l_Discarded.clear();
+    }
+
+#ifdef ASYNC_FILE_READER_IO_URING
+    if (m_IoUring)
+        io_uring_queue_exit(&m_IoUring->ring);
+#endif
+    delete m_IoUring;
+    delete m_Pool;
+
+    while (!m_Files.empty())
+    {
+        closeFile(m_Files.begin()->first);
+    }
+}
+
+AsyncFileReader::FileHandle AsyncFileReader::openFile(const std::string_view p_Path)
+{
+    const std::string l_Path{p_Path};
+    File l_File{};
+
+#ifdef _WIN32
+    l_File.handle = CreateFileA(l_Path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (l_File.handle == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error("Failed to open file " + l_Path + " for async reading");
+    }
+
+    LARGE_INTEGER l_Size;
+    if (!GetFileSizeEx(l_File.handle, &l_Size))
+    {
+        CloseHandle(l_File.handle);
+        throw std::runtime_error("Failed to read size of file " + l_Path);
+    }
+    l_File.size = static_cast<size_t>(l_Size.QuadPart);
+#else
+    l_File.handle = ::open(l_Path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (l_File.handle < 0)
+    {
+        throw std::runtime_error("Failed to open file " + l_Path + " for async reading");
+    }
+
+    struct stat l_Stat{};
+    if (fstat(l_File.handle, &l_Stat) != 0)
+    {
+        ::close(l_File.handle);
+        throw std::runtime_error("Failed to read size of file " + l_Path);
+    }
+    l_File.size = static_cast<size_t>(l_Stat.st_size);
+
+    #ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(l_File.handle, 0, 0, POSIX_FADV_SEQUENTIAL);
+    #endif
+#endif
+
+    const FileHandle l_Handle = m_NextFile++;
+    m_Files[l_Handle] = l_File;
+    return l_Handle;
+}
+
+void AsyncFileReader::closeFile(const FileHandle p_File)
+{
+    const auto l_It = m_Files.find(p_File);
+    if (l_It == m_Files.end())
+        return;
+
+#ifdef _WIN32
+    CloseHandle(l_It->second.handle);
+#else
+    ::close(l_It->second.handle);
+#endif
+    m_Files.erase(l_It);
+}
+
+size_t AsyncFileReader::getFileSize(const FileHandle p_File) const
+{
+    return m_Files.at(p_File).size;
+}
+
+AsyncFileReader::RequestID AsyncFileReader::read(const FileHandle p_File, const size_t p_Offset, const size_t p_Size, void* p_Destination)
+{
+    const auto l_File = m_Files.find(p_File);
+    if (l_File == m_Files.end())
+    {
+        throw std::runtime_error("Tried to read from unknown async file handle " + std::to_string(p_File));
+    }
+
+    const RequestID l_ID = m_NextRequest++;
+    const NativeFile l_Native = l_File->second.handle;
+    uint8_t* l_Destination = static_cast<uint8_t*>(p_Destination);
+    m_InFlight++;
+
+    if (m_IoUring)
+    {
+        m_Requests[l_ID] = {l_Native, p_Offset, p_Size, l_Destination, 0};
+        // SQEs are only handed to the kernel on the next poll or wait, so a burst of reads costs one syscall
+        if (m_IoUring->inKernel < m_QueueDepth)
+            submitIoUring(l_ID);
+        else
+            m_Backlog.push_back(l_ID);
+        return l_ID;
+    }
+
+    m_Pool->enqueue([this, l_ID, l_Native, p_Offset, p_Size, l_Destination]
+    {
+        size_t l_BytesRead = 0;
+        const bool l_Success = readBlocking(l_Native, p_Offset, p_Size, l_Destination, l_BytesRead);
+        {
+            std::scoped_lock l_Lock{m_CompletedMutex};
+            m_Completed.push_back({l_ID, l_BytesRead, l_Success});
+        }
+        m_CompletedCondition.notify_one();
+    });
+    return l_ID;
+}
+
+size_t AsyncFileReader::poll(std::vector<Completion>& p_Completions)
+{
+    if (m_InFlight == 0)
+        return 0;
+    return m_IoUring ? drainIoUring(p_Completions) : drainFallback(p_Completions);
+}
+
+size_t AsyncFileReader::wait(std::vector<Completion>& p_Completions)
+{
+    if (m_InFlight == 0)
+        return 0;
+
+    const size_t l_Ready = poll(p_Completions);
+    if (l_Ready > 0)
+        return l_Ready;
+
+#ifdef ASYNC_FILE_READER_IO_URING
+    if (m_IoUring)
+    {
+        io_uring_submit_and_wait(&m_IoUring->ring, 1);
+        return drainIoUring(p_Completions);
+    }
+#endif
+
+    {
+        std::unique_lock l_Lock{m_CompletedMutex};
+        m_CompletedCondition.wait(l_Lock, [this] { return !m_Completed.empty(); });
+    }
+    return drainFallback(p_Completions);
+}
+
+bool AsyncFileReader::readBlocking(const NativeFile p_File, const size_t p_Offset, const size_t p_Size, uint8_t* p_Destination, size_t& p_BytesRead)
+{
+    p_BytesRead = 0;
+    while (p_BytesRead < p_Size)
+    {
+#ifdef _WIN32
+        OVERLAPPED l_Overlapped{};
+        const uint64_t l_Offset = p_Offset + p_BytesRead;
+        l_Overlapped.Offset = static_cast<DWORD>(l_Offset);
+        l_Overlapped.OffsetHigh = static_cast<DWORD>(l_Offset >> 32);
+
+        DWORD l_Read = 0;
+        const DWORD l_ToRead = static_cast<DWORD>(std::min<size_t>(p_Size - p_BytesRead, 1U << 30));
+        if (!ReadFile(p_File, p_Destination + p_BytesRead, l_ToRead, &l_Read, &l_Overlapped))
+            return false;
+#else
+        const ssize_t l_Read = pread(p_File, p_Destination + p_BytesRead, p_Size - p_BytesRead, static_cast<off_t>(p_Offset + p_BytesRead));
+        if (l_Read < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+#endif
+        // Hitting the end of the file early is reported as a failed read
+        if (l_Read == 0)
+            return false;
+        p_BytesRead += static_cast<size_t>(l_Read);
+    }
+    return true;
+}
+
+bool AsyncFileReader::submitIoUring(const RequestID p_Request)
+{
+#ifdef ASYNC_FILE_READER_IO_URING
+    io_uring_sqe* l_Sqe = io_uring_get_sqe(&m_IoUring->ring);
+    if (!l_Sqe)
+    {
+        // Submission queue full of unsubmitted entries, flush it and retry once
+        io_uring_submit(&m_IoUring->ring);
+        l_Sqe = io_uring_get_sqe(&m_IoUring->ring);
+    }
+    if (!l_Sqe)
+    {
+        m_Backlog.push_front(p_Request);
+        return false;
+    }
+
+    const Request& l_Request = m_Requests[p_Request];
+    const size_t l_Remaining = std::min<size_t>(l_Request.size - l_Request.done, UINT32_MAX);
+    io_uring_prep_read(l_Sqe, l_Request.file, l_Request.destination + l_Request.done, static_cast<unsigned>(l_Remaining), l_Request.offset + l_Request.done);
+    io_uring_sqe_set_data64(l_Sqe, p_Request);
+    m_IoUring->inKernel++;
+    return true;
+#else
+    (void)p_Request;
+    return false;
+#endif
+}
+
+size_t AsyncFileReader::drainIoUring(std::vector<Completion>& p_Completions)
+{
+    size_t l_Count = 0;
+#ifdef ASYNC_FILE_READER_IO_URING
+    io_uring_submit(&m_IoUring->ring);
+
+    io_uring_cqe* l_Cqe;
+    while (io_uring_peek_cqe(&m_IoUring->ring, &l_Cqe) == 0)
+    {
+        const RequestID l_ID = io_uring_cqe_get_data64(l_Cqe);
+        const int l_Result = l_Cqe->res;
+        io_uring_cqe_seen(&m_IoUring->ring, l_Cqe);
+        m_IoUring->inKernel--;
+
+        Request& l_Request = m_Requests[l_ID];
+        if (l_Result == -EAGAIN || l_Result == -EINTR)
+        {
+            submitIoUring(l_ID);
+            continue;
+        }
+
+        if (l_Result > 0)
+        {
+            l_Request.done += static_cast<size_t>(l_Result);
+            // Short reads are legal, queue the rest
+            if (l_Request.done < l_Request.size)
+            {
+                submitIoUring(l_ID);
+                continue;
+            }
+        }
+
+        p_Completions.push_back({l_ID, l_Request.done, l_Result > 0});
+        m_Requests.erase(l_ID);
+        m_InFlight--;
+        l_Count++;
+    }
+
+    while (!m_Backlog.empty() && m_IoUring->inKernel < m_QueueDepth)
+    {
+        const RequestID l_ID = m_Backlog.front();
+        m_Backlog.pop_front();
+        if (!submitIoUring(l_ID))
+            break;
+    }
+    io_uring_submit(&m_IoUring->ring);
+#else
+    (void)p_Completions;
+#endif
+    return l_Count;
+}
+
+size_t AsyncFileReader::drainFallback(std::vector<Completion>& p_Completions)
+{
+    std::scoped_lock l_Lock{m_CompletedMutex};
+    const size_t l_Count = m_Completed.size();
+    p_Completions.insert(p_Completions.end(), m_Completed.begin(), m_Completed.end());
+    m_Completed.clear();
+    m_InFlight -= l_Count;
+    return l_Count;
+}
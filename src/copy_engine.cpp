@@ -0,0 +1,300 @@
+#include "utils/copy_engine.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <latch>
+#include <memory>
+#include <thread>
+
+#include "utils/logger.hpp"
+#include "utils/thread_pool.hpp"
+
+#if defined(_M_X64) || defined(__x86_64__)
+    #define COPY_ENGINE_X86
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #endif
+#endif
+
+#if defined(COPY_ENGINE_X86) && (defined(__GNUC__) || defined(__clang__))
+    #define TARGET_AVX2 __attribute__((target("avx2")))
+    #define TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+    #define TARGET_AVX2
+    #define TARGET_AVX512
+#endif
+
+static constexpr size_t MIN_CHUNK_SIZE = 1024 * 1024;
+
+#ifdef COPY_ENGINE_X86
+TARGET_AVX2 static void streamCopyAVX2(uint8_t* p_Dst, const uint8_t* p_Src, size_t p_Size)
+{
+    const size_t l_Head = (32 - (reinterpret_cast<uintptr_t>(p_Dst) & 31)) & 31;
+    if (p_Size < l_Head + 128)
+    {
+        memcpy(p_Dst, p_Src, p_Size);
+        return;
+    }
+    memcpy(p_Dst, p_Src, l_Head);
+    p_Dst += l_Head;
+    p_Src += l_Head;
+    p_Size -= l_Head;
+
+    const size_t l_Blocks = p_Size / 128;
+    for (size_t i = 0; i < l_Blocks; i++)
+    {
+        _mm_prefetch(reinterpret_cast<const char*>(p_Src + 512), _MM_HINT_NTA);
+        const __m256i l_A = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p_Src));
+        const __m256i l_B = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p_Src + 32));
+        const __m256i l_C = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p_Src + 64));
+        const __m256i l_D = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p_Src + 96));
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(p_Dst), l_A);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(p_Dst + 32), l_B);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(p_Dst + 64), l_C);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(p_Dst + 96), l_D);
+        p_Src += 128;
+        p_Dst += 128;
+    }
+    _mm_sfence();
+    memcpy(p_Dst, p_Src, p_Size % 128);
+}
+
+TARGET_AVX512 static void streamCopyAVX512(uint8_t* p_Dst, const uint8_t* p_Src, size_t p_Size)
+{
+    const size_t l_Head = (64 - (reinterpret_cast<uintptr_t>(p_Dst) & 63)) & 63;
+    if (p_Size < l_Head + 256)
+    {
+        memcpy(p_Dst, p_Src, p_Size);
+        return;
+    }
+    memcpy(p_Dst, p_Src, l_Head);
+    p_Dst += l_Head;
+    p_Src += l_Head;
+    p_Size -= l_Head;
+
+    const size_t l_Blocks = p_Size / 256;
+    for (size_t i = 0; i < l_Blocks; i++)
+    {
+        _mm_prefetch(reinterpret_cast<const char*>(p_Src + 1024), _MM_HINT_NTA);
+        const __m512i l_A = _mm512_loadu_si512(p_Src);
+        const __m512i l_B = _mm512_loadu_si512(p_Src + 64);
+        const __m512i l_C = _mm512_loadu_si512(p_Src + 128);
+        const __m512i l_D = _mm512_loadu_si512(p_Src + 192);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(p_Dst), l_A);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(p_Dst + 64), l_B);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(p_Dst + 128), l_C);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(p_Dst + 192), l_D);
+        p_Src += 256;
+        p_Dst += 256;
+    }
+    _mm_sfence();
+    memcpy(p_Dst, p_Src, p_Size % 256);
+}
+#endif
+
+void CopyEngine::init(uint32_t p_ThreadCount)
+{
+    free();
+
+    if (p_ThreadCount == 0)
+    {
+        const uint32_t l_HardwareThreads = std::thread::hardware_concurrency();
+        p_ThreadCount = l_HardwareThreads > 1 ? l_HardwareThreads - 1 : 0;
+    }
+    if (p_ThreadCount > 0)
+        s_Pool = new ThreadPool(p_ThreadCount);
+
+    setPath(getBestSupportedPath());
+    LOG_DEBUG("Initialized copy engine with ", getThreadCount(), " thread(s) using path ", getPathName(s_Path));
+}
+
+void CopyEngine::free()
+{
+    delete s_Pool;
+    s_Pool = nullptr;
+}
+
+CopyEngine::Stats CopyEngine::copy(void* p_Dst, const void* p_Src, const size_t p_Size)
+{
+    if (!s_PathDetected)
+        setPath(getBestSupportedPath());
+
+    const Path l_Path = s_Path;
+    uint8_t* l_Dst = static_cast<uint8_t*>(p_Dst);
+    const uint8_t* l_Src = static_cast<const uint8_t*>(p_Src);
+
+    const auto l_Start = std::chrono::steady_clock::now();
+
+    uint32_t l_Parts = 1;
+    if (s_Pool != nullptr && p_Size >= s_ParallelThreshold)
+        l_Parts = static_cast<uint32_t>(std::min<size_t>(s_Pool->getThreadCount() + 1, p_Size / MIN_CHUNK_SIZE));
+
+    if (l_Parts <= 1)
+    {
+        copyRange(l_Dst, l_Src, p_Size, l_Path);
+        l_Parts = 1;
+    }
+    else
+    {
+        // Page aligned chunks keep every worker on its own set of write-combining buffers
+        const size_t l_Chunk = (p_Size / l_Parts + 4095) & ~static_cast<size_t>(4095);
+
+        std::latch l_Done{static_cast<ptrdiff_t>(l_Parts - 1)};
+        for (uint32_t i = 1; i < l_Parts; i++)
+        {
+            const size_t l_Begin = i * l_Chunk;
+            if (l_Begin >= p_Size)
+            {
+                l_Done.count_down();
+                continue;
+            }
+            const size_t l_Size = std::min(l_Chunk, p_Size - l_Begin);
+            s_Pool->enqueue([l_Dst, l_Src, l_Begin, l_Size, l_Path, &l_Done]
+            {
+                copyRange(l_Dst + l_Begin, l_Src + l_Begin, l_Size, l_Path);
+                l_Done.count_down();
+            });
+        }
+        copyRange(l_Dst, l_Src, std::min(l_Chunk, p_Size), l_Path);
+        l_Done.wait();
+    }
+
+    const double l_Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - l_Start).count();
+
+    Stats l_Stats{};
+    l_Stats.bytes = p_Size;
+    l_Stats.seconds = l_Seconds;
+    l_Stats.gigabytesPerSecond = l_Seconds > 0.0 ? static_cast<double>(p_Size) / l_Seconds / 1e9 : 0.0;
+    l_Stats.threads = l_Parts;
+    l_Stats.path = l_Path;
+    return l_Stats;
+}
+
+void CopyEngine::setPath(const Path p_Path)
+{
+    const Path l_Best = getBestSupportedPath();
+    if (static_cast<uint8_t>(p_Path) > static_cast<uint8_t>(l_Best))
+    {
+        LOG_WARN("Copy path ", getPathName(p_Path), " is not supported by this CPU, falling back to ", getPathName(l_Best));
+        s_Path = l_Best;
+    }
+    else
+    {
+        s_Path = p_Path;
+    }
+    s_PathDetected = true;
+}
+
+CopyEngine::Path CopyEngine::getBestSupportedPath()
+{
+#ifdef COPY_ENGINE_X86
+    #ifdef _MSC_VER
+        int l_Info[4];
+        __cpuid(l_Info, 0);
+        const int l_MaxLeaf = l_Info[0];
+
+        __cpuid(l_Info, 1);
+        const bool l_OSXSave = (l_Info[2] & (1 << 27)) != 0;
+        const bool l_AVX = (l_Info[2] & (1 << 28)) != 0;
+        if (!l_OSXSave || !l_AVX || l_MaxLeaf < 7)
+            return Path::SCALAR;
+
+        // The OS must save the YMM (and ZMM) register state for the wider paths to be usable
+        const unsigned long long l_XCR0 = _xgetbv(0);
+        if ((l_XCR0 & 0x6) != 0x6)
+            return Path::SCALAR;
+
+        __cpuidex(l_Info, 7, 0);
+        if ((l_Info[1] & (1 << 16)) != 0 && (l_XCR0 & 0xE6) == 0xE6)
+            return Path::AVX512_STREAM;
+        if ((l_Info[1] & (1 << 5)) != 0)
+            return Path::AVX2_STREAM;
+    #else
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+            return Path::AVX512_STREAM;
+        if (__builtin_cpu_supports("avx2"))
+            return Path::AVX2_STREAM;
+    #endif
+#endif
+    return Path::SCALAR;
+}
+
+std::string_view CopyEngine::getPathName(const Path p_Path)
+{
+    switch (p_Path)
+    {
+    case Path::SCALAR: return "scalar";
+    case Path::AVX2_STREAM: return "AVX2 streaming";
+    case Path::AVX512_STREAM: return "AVX-512 streaming";
+    }
+    return "unknown";
+}
+
+uint32_t CopyEngine::getThreadCount()
+{
+    return s_Pool != nullptr ? s_Pool->getThreadCount() + 1 : 1;
+}
+
+CopyEngine::BenchmarkResult CopyEngine::benchmark(const size_t p_Size, const uint32_t p_Iterations)
+{
+    const std::unique_ptr<uint8_t[]> l_Src = std::make_unique<uint8_t[]>(p_Size);
+    const std::unique_ptr<uint8_t[]> l_Dst = std::make_unique<uint8_t[]>(p_Size);
+    for (size_t i = 0; i < p_Size; i++)
+    {
+        l_Src[i] = static_cast<uint8_t>(i * 31);
+    }
+
+    // Warm up so page faults are not part of either measurement
+    memcpy(l_Dst.get(), l_Src.get(), p_Size);
+
+    BenchmarkResult l_Result{};
+    l_Result.baseline.bytes = p_Size * p_Iterations;
+    l_Result.engine.bytes = p_Size * p_Iterations;
+
+    const auto l_MemcpyStart = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < p_Iterations; i++)
+    {
+        memcpy(l_Dst.get(), l_Src.get(), p_Size);
+    }
+    l_Result.baseline.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - l_MemcpyStart).count();
+
+    for (uint32_t i = 0; i < p_Iterations; i++)
+    {
+        const Stats l_Stats = copy(l_Dst.get(), l_Src.get(), p_Size);
+        l_Result.engine.seconds += l_Stats.seconds;
+        l_Result.engine.threads = l_Stats.threads;
+        l_Result.engine.path = l_Stats.path;
+    }
+
+    if (memcmp(l_Dst.get(), l_Src.get(), p_Size) != 0)
+        LOG_ERR("Copy engine benchmark produced mismatching data");
+
+    for (Stats* l_Stats : {&l_Result.baseline, &l_Result.engine})
+    {
+        l_Stats->gigabytesPerSecond = l_Stats->seconds > 0.0 ? static_cast<double>(l_Stats->bytes) / l_Stats->seconds / 1e9 : 0.0;
+    }
+
+    LOG_INFO("Copy benchmark (", p_Size, " bytes x ", p_Iterations, "): memcpy ", l_Result.baseline.gigabytesPerSecond, " GB/s, ",
+        getPathName(l_Result.engine.path), " on ", l_Result.engine.threads, " thread(s) ", l_Result.engine.gigabytesPerSecond, " GB/s");
+    return l_Result;
+}
+
+void CopyEngine::copyRange(uint8_t* p_Dst, const uint8_t* p_Src, const size_t p_Size, const Path p_Path)
+{
+    switch (p_Path)
+    {
+#ifdef COPY_ENGINE_X86
+    case Path::AVX512_STREAM:
+        streamCopyAVX512(p_Dst, p_Src, p_Size);
+        return;
+    case Path::AVX2_STREAM:
+        streamCopyAVX2(p_Dst, p_Src, p_Size);
+        return;
+#endif
+    default:
+        memcpy(p_Dst, p_Src, p_Size);
+    }
+}
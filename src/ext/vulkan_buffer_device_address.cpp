@@ -0,0 +1,25 @@
+#include "ext/vulkan_buffer_device_address.hpp"
+
+#include "vulkan_device.hpp"
+
+VulkanBufferDeviceAddressExtension* VulkanBufferDeviceAddressExtension::get(const VulkanDevice& p_Device)
+{
+    return p_Device.getExtensionManager()->getExtension<VulkanBufferDeviceAddressExtension>(VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME);
+}
+
+VulkanBufferDeviceAddressExtension* VulkanBufferDeviceAddressExtension::get(const ResourceID p_DeviceID)
+{
+    return VulkanContext::getDevice(p_DeviceID).getExtensionManager()->getExtension<VulkanBufferDeviceAddressExtension>(VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME);
+}
+
+VulkanBufferDeviceAddressExtension::VulkanBufferDeviceAddressExtension(const ResourceID p_DeviceID)
+    : VulkanDeviceExtension(p_DeviceID) {}
+
+VkBaseInStructure* VulkanBufferDeviceAddressExtension::getExtensionStruct() const
+{
+    VkPhysicalDeviceBufferDeviceAddressFeaturesKHR* l_Struct = TRANS_ALLOC(VkPhysicalDeviceBufferDeviceAddressFeaturesKHR){};
+    l_Struct->sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES_KHR;
+    l_Struct->pNext = nullptr;
+    l_Struct->bufferDeviceAddress = VK_TRUE;
+    return reinterpret_cast<VkBaseInStructure*>(l_Struct);
+}
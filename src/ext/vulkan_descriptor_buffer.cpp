@@ -0,0 +1,74 @@
+#include "ext/vulkan_descriptor_buffer.hpp"
+
+#include <stdexcept>
+#include <vulkan/vk_enum_string_helper.h>
+
+#include "vulkan_device.hpp"
+
+VulkanDescriptorBufferExtension* VulkanDescriptorBufferExtension::get(const VulkanDevice& p_Device)
+{
+    return p_Device.getExtensionManager()->getExtension<VulkanDescriptorBufferExtension>(VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME);
+}
+
+VulkanDescriptorBufferExtension* VulkanDescriptorBufferExtension::get(const ResourceID p_DeviceID)
+{
+    return VulkanContext::getDevice(p_DeviceID).getExtensionManager()->getExtension<VulkanDescriptorBufferExtension>(VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME);
+}
+
+VulkanDescriptorBufferExtension::VulkanDescriptorBufferExtension(const ResourceID p_DeviceID)
+    : VulkanDeviceExtension(p_DeviceID) {}
+
+VkBaseInStructure* VulkanDescriptorBufferExtension::getExtensionStruct() const
+{
+    VkPhysicalDeviceDescriptorBufferFeaturesEXT* l_Struct = TRANS_ALLOC(VkPhysicalDeviceDescriptorBufferFeaturesEXT){};
+    l_Struct->sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT;
+    l_Struct->pNext = nullptr;
+    l_Struct->descriptorBuffer = VK_TRUE;
+    return reinterpret_cast<VkBaseInStructure*>(l_Struct);
+}
+
+const VkPhysicalDeviceDescriptorBufferPropertiesEXT& VulkanDescriptorBufferExtension::getProperties() const
+{
+    if (!m_PropertiesQueried)
+    {
+        m_Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_PROPERTIES_EXT;
+
+        VkPhysicalDeviceProperties2 l_Properties{};
+        l_Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        l_Properties.pNext = &m_Properties;
+        vkGetPhysicalDeviceProperties2(*VulkanContext::getDevice(getDeviceID()).getGPU(), &l_Properties);
+        m_Properties.pNext = nullptr;
+        m_PropertiesQueried = true;
+    }
+    return m_Properties;
+}
+
+size_t VulkanDescriptorBufferExtension::getDescriptorSize(const VkDescriptorType p_Type) const
+{
+    const VkPhysicalDeviceDescriptorBufferPropertiesEXT& l_Properties = getProperties();
+    switch (p_Type)
+    {
+    case VK_DESCRIPTOR_TYPE_SAMPLER:
+        return l_Properties.samplerDescriptorSize;
+    case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+        return l_Properties.combinedImageSamplerDescriptorSize;
+    case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+        return l_Properties.sampledImageDescriptorSize;
+    case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+        return l_Properties.storageImageDescriptorSize;
+    case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+        return l_Properties.uniformTexelBufferDescriptorSize;
+    case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+        return l_Properties.storageTexelBufferDescriptorSize;
+    case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+        return l_Properties.uniformBufferDescriptorSize;
+    case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+        return l_Properties.storageBufferDescriptorSize;
+    case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+        return l_Properties.inputAttachmentDescriptorSize;
+    case VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR:
+        return l_Properties.accelerationStructureDescriptorSize;
+    default:
+        throw std::runtime_error(std::string("Descriptor type ") + string_VkDescriptorType(p_Type) + " can't be placed in a descriptor buffer");
+    }
+}
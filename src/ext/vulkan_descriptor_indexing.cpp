@@ -0,0 +1,49 @@
+#include "ext/vulkan_descriptor_indexing.hpp"
+
+#include "vulkan_device.hpp"
+
+VulkanDescriptorIndexingExtension* VulkanDescriptorIndexingExtension::get(const VulkanDevice& p_Device)
+{
+    return p_Device.getExtensionManager()->getExtension<VulkanDescriptorIndexingExtension>(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+}
+
+VulkanDescriptorIndexingExtension* VulkanDescriptorIndexingExtension::get(const ResourceID p_DeviceID)
+{
+    return VulkanContext::getDevice(p_DeviceID).getExtensionManager()->getExtension<VulkanDescriptorIndexingExtension>(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+}
+
+VulkanDescriptorIndexingExtension::VulkanDescriptorIndexingExtension(const ResourceID p_DeviceID)
+    : VulkanDeviceExtension(p_DeviceID) {}
+
+VkBaseInStructure* VulkanDescriptorIndexingExtension::getExtensionStruct() const
+{
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT* l_Struct = TRANS_ALLOC(VkPhysicalDeviceDescriptorIndexingFeaturesEXT){};
+    l_Struct->sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    l_Struct->pNext = nullptr;
+    l_Struct->shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    l_Struct->shaderStorageImageArrayNonUniformIndexing = VK_TRUE;
+    l_Struct->shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+    l_Struct->descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    l_Struct->descriptorBindingStorageImageUpdateAfterBind = VK_TRUE;
+    l_Struct->descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    l_Struct->descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    l_Struct->descriptorBindingPartiallyBound = VK_TRUE;
+    l_Struct->runtimeDescriptorArray = VK_TRUE;
+    return reinterpret_cast<VkBaseInStructure*>(l_Struct);
+}
+
+const VkPhysicalDeviceDescriptorIndexingPropertiesEXT& VulkanDescriptorIndexingExtension::getProperties() const
+{
+    if (!m_PropertiesQueried)
+    {
+        m_Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+
+        VkPhysicalDeviceProperties2 l_Properties{};
+        l_Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        l_Properties.pNext = &m_Properties;
+        vkGetPhysicalDeviceProperties2(*VulkanContext::getDevice(getDeviceID()).getGPU(), &l_Properties);
+        m_Properties.pNext = nullptr;
+        m_PropertiesQueried = true;
+    }
+    return m_Properties;
+}
@@ -0,0 +1,135 @@
+#include "ext/vulkan_external_memory_host.hpp"
+
+#include <bit>
+
+#include "vulkan_device.hpp"
+#include "utils/logger.hpp"
+#include "../vulkan_base.hpp"
+
+VulkanExternalMemoryHostExtension* VulkanExternalMemoryHostExtension::get(const VulkanDevice& p_Device)
+{
+    return p_Device.getExtensionManager()->getExtension<VulkanExternalMemoryHostExtension>(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+}
+
+VulkanExternalMemoryHostExtension* VulkanExternalMemoryHostExtension::get(const ResourceID p_DeviceID)
+{
+    return VulkanContext::getDevice(p_DeviceID).getExtensionManager()->getExtension<VulkanExternalMemoryHostExtension>(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+}
+
+VulkanExternalMemoryHostExtension::VulkanExternalMemoryHostExtension(const ResourceID p_DeviceID)
+    : VulkanDeviceExtension(p_DeviceID)
+{
+}
+
+VulkanExternalMemoryHostExtension::HostImport VulkanExternalMemoryHostExtension::importHostPointer(const void* p_Pointer, const VkDeviceSize p_Size, const VkBufferUsageFlags p_Usage)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
+
+    const VkDeviceSize l_Alignment = getMinImportedHostPointerAlignment();
+    const uintptr_t l_Begin = reinterpret_cast<uintptr_t>(p_Pointer) & ~(l_Alignment - 1);
+    const uintptr_t l_End = alignUp(reinterpret_cast<uintptr_t>(p_Pointer) + p_Size, l_Alignment);
+    const VkDeviceSize l_ImportSize = l_End - l_Begin;
+    void* l_ImportPointer = reinterpret_cast<void*>(l_Begin);
+
+    constexpr VkExternalMemoryHandleTypeFlagBits HANDLE_TYPE = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+
+    VkMemoryHostPointerPropertiesEXT l_PointerProperties{};
+    l_PointerProperties.sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT;
+    if (l_Device.getTable().vkGetMemoryHostPointerPropertiesEXT(*l_Device, HANDLE_TYPE, l_ImportPointer, &l_PointerProperties) != VK_SUCCESS || l_PointerProperties.memoryTypeBits == 0)
+    {
+        LOG_DEBUG("Host pointer ", l_ImportPointer, " can't be imported, no compatible memory type");
+        return {};
+    }
+
+    VkExternalMemoryBufferCreateInfo l_ExternInfo{};
+    l_ExternInfo.sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO;
+    l_ExternInfo.handleTypes = HANDLE_TYPE;
+
+    VkBufferCreateInfo l_BufferInfo{};
+    l_BufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    l_BufferInfo.pNext = &l_ExternInfo;
+    l_BufferInfo.size = l_ImportSize;
+    l_BufferInfo.usage = p_Usage;
+    l_BufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkBuffer l_Buffer;
+    VULKAN_TRY(l_Device.getTable().vkCreateBuffer(*l_Device, &l_BufferInfo, nullptr, &l_Buffer));
+
+    VkMemoryRequirements l_Requirements;
+    l_Device.getTable().vkGetBufferMemoryRequirements(*l_Device, l_Buffer, &l_Requirements);
+
+    const uint32_t l_TypeBits = l_Requirements.memoryTypeBits & l_PointerProperties.memoryTypeBits;
+    if (l_TypeBits == 0 || l_Begin % l_Requirements.alignment != 0)
+    {
+        LOG_DEBUG("Host pointer ", l_ImportPointer, " can't back a buffer with usage ", p_Usage);
+        l_Device.getTable().vkDestroyBuffer(*l_Device, l_Buffer, nullptr);
+        return {};
+    }
+
+    VkImportMemoryHostPointerInfoEXT l_ImportInfo{};
+    l_ImportInfo.sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT;
+    l_ImportInfo.handleType = HANDLE_TYPE;
+    l_ImportInfo.pHostPointer = l_ImportPointer;
+
+    VkMemoryAllocateInfo l_AllocInfo{};
+    l_AllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    l_AllocInfo.pNext = &l_ImportInfo;
+    l_AllocInfo.allocationSize = l_ImportSize;
+    l_AllocInfo.memoryTypeIndex = static_cast<uint32_t>(std::countr_zero(l_TypeBits));
+
+    VkDeviceMemory l_Memory;
+    if (l_Device.getTable().vkAllocateMemory(*l_Device, &l_AllocInfo, nullptr, &l_Memory) != VK_SUCCESS)
+    {
+        LOG_DEBUG("Failed to import host pointer ", l_ImportPointer);
+        l_Device.getTable().vkDestroyBuffer(*l_Device, l_Buffer, nullptr);
+        return {};
+    }
+    VULKAN_TRY(l_Device.getTable().vkBindBufferMemory(*l_Device, l_Buffer, l_Memory, 0));
+
+    VulkanBuffer* l_NewRes = ARENA_ALLOC(VulkanBuffer){getDeviceID(), l_Buffer, l_ImportSize, p_Usage};
+    l_Device.insertBuffer(l_NewRes);
+    m_ImportedMemory[l_NewRes->getID()] = l_Memory;
+    LOG_DEBUG("Imported ", VulkanMemoryAllocator::compactBytes(l_ImportSize), " of host memory as buffer (ID:", l_NewRes->getID(), ")");
+
+    return {l_NewRes->getID(), reinterpret_cast<uintptr_t>(p_Pointer) - l_Begin};
+}
+
+void VulkanExternalMemoryHostExtension::freeImportedBuffer(const ResourceID p_Buffer)
+{
+    const auto l_It = m_ImportedMemory.find(p_Buffer);
+    if (l_It == m_ImportedMemory.end())
+    {
+        LOG_WARN("Tried to free buffer (ID:", p_Buffer, ") as an imported host buffer, but it wasn't imported");
+        return;
+    }
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
+    l_Device.freeBuffer(p_Buffer);
+    l_Device.getTable().vkFreeMemory(*l_Device, l_It->second, nullptr);
+    m_ImportedMemory.erase(l_It);
+}
+
+VkDeviceSize VulkanExternalMemoryHostExtension::getMinImportedHostPointerAlignment() const
+{
+    if (m_MinAlignment == 0)
+    {
+        VkPhysicalDeviceExternalMemoryHostPropertiesEXT l_HostProperties{};
+        l_HostProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT;
+
+        VkPhysicalDeviceProperties2 l_Properties{};
+        l_Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        l_Properties.pNext = &l_HostProperties;
+        vkGetPhysicalDeviceProperties2(*VulkanContext::getDevice(getDeviceID()).getGPU(), &l_Properties);
+
+        m_MinAlignment = l_HostProperties.minImportedHostPointerAlignment;
+    }
+    return m_MinAlignment;
+}
+
+void VulkanExternalMemoryHostExtension::free()
+{
+    while (!m_ImportedMemory.empty())
+    {
+        freeImportedBuffer(m_ImportedMemory.begin()->first);
+    }
+}
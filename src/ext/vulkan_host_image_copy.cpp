@@ -0,0 +1,68 @@
+#include "ext/vulkan_host_image_copy.hpp"
+
+#include <algorithm>
+
+#include "vulkan_device.hpp"
+
+VulkanHostImageCopyExtension* VulkanHostImageCopyExtension::get(const VulkanDevice& p_Device)
+{
+    return p_Device.getExtensionManager()->getExtension<VulkanHostImageCopyExtension>(VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME);
+}
+
+VulkanHostImageCopyExtension* VulkanHostImageCopyExtension::get(const ResourceID p_DeviceID)
+{
+    return VulkanContext::getDevice(p_DeviceID).getExtensionManager()->getExtension<VulkanHostImageCopyExtension>(VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME);
+}
+
+VulkanHostImageCopyExtension::VulkanHostImageCopyExtension(const ResourceID p_DeviceID)
+    : VulkanDeviceExtension(p_DeviceID) {}
+
+VkBaseInStructure* VulkanHostImageCopyExtension::getExtensionStruct() const
+{
+    VkPhysicalDeviceHostImageCopyFeaturesEXT* l_Struct = TRANS_ALLOC(VkPhysicalDeviceHostImageCopyFeaturesEXT){};
+    l_Struct->sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT;
+    l_Struct->pNext = nullptr;
+    l_Struct->hostImageCopy = VK_TRUE;
+    return reinterpret_cast<VkBaseInStructure*>(l_Struct);
+}
+
+bool VulkanHostImageCopyExtension::isCopyDstLayout(const VkImageLayout p_Layout) const
+{
+    if (!m_LayoutsQueried)
+        queryLayouts();
+    return std::ranges::find(m_CopyDstLayouts, p_Layout) != m_CopyDstLayouts.end();
+}
+
+bool VulkanHostImageCopyExtension::isFormatSupported(const VkFormat p_Format, const VkImageTiling p_Tiling) const
+{
+    VkFormatProperties3 l_Properties3{};
+    l_Properties3.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_3;
+
+    VkFormatProperties2 l_Properties{};
+    l_Properties.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2;
+    l_Properties.pNext = &l_Properties3;
+    vkGetPhysicalDeviceFormatProperties2(*VulkanContext::getDevice(getDeviceID()).getGPU(), p_Format, &l_Properties);
+
+    const VkFormatFeatureFlags2 l_Features = p_Tiling == VK_IMAGE_TILING_LINEAR ? l_Properties3.linearTilingFeatures : l_Properties3.optimalTilingFeatures;
+    return (l_Features & VK_FORMAT_FEATURE_2_HOST_IMAGE_TRANSFER_BIT_EXT) != 0;
+}
+
+void VulkanHostImageCopyExtension::queryLayouts() const
+{
+    const VkPhysicalDevice l_GPU = *VulkanContext::getDevice(getDeviceID()).getGPU();
+
+    // First call gets the counts, second one the layouts
+    VkPhysicalDeviceHostImageCopyPropertiesEXT l_HostCopyProperties{};
+    l_HostCopyProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_PROPERTIES_EXT;
+
+    VkPhysicalDeviceProperties2 l_Properties{};
+    l_Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    l_Properties.pNext = &l_HostCopyProperties;
+    vkGetPhysicalDeviceProperties2(l_GPU, &l_Properties);
+
+    m_CopyDstLayouts.resize(l_HostCopyProperties.copyDstLayoutCount);
+    l_HostCopyProperties.pCopyDstLayouts = m_CopyDstLayouts.data();
+    vkGetPhysicalDeviceProperties2(l_GPU, &l_Properties);
+
+    m_LayoutsQueried = true;
+}
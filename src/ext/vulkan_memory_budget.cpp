@@ -0,0 +1,16 @@
+#include "ext/vulkan_memory_budget.hpp"
+
+#include "vulkan_device.hpp"
+
+VulkanMemoryBudgetExtension* VulkanMemoryBudgetExtension::get(const VulkanDevice& p_Device)
+{
+    return p_Device.getExtensionManager()->getExtension<VulkanMemoryBudgetExtension>(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+}
+
+VulkanMemoryBudgetExtension* VulkanMemoryBudgetExtension::get(const ResourceID p_DeviceID)
+{
+    return VulkanContext::getDevice(p_DeviceID).getExtensionManager()->getExtension<VulkanMemoryBudgetExtension>(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+}
+
+VulkanMemoryBudgetExtension::VulkanMemoryBudgetExtension(const ResourceID p_DeviceID)
+    : VulkanDeviceExtension(p_DeviceID) {}
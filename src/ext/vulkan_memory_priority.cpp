@@ -0,0 +1,25 @@
+#include "ext/vulkan_memory_priority.hpp"
+
+#include "vulkan_device.hpp"
+
+VulkanMemoryPriorityExtension* VulkanMemoryPriorityExtension::get(const VulkanDevice& p_Device)
+{
+    return p_Device.getExtensionManager()->getExtension<VulkanMemoryPriorityExtension>(VK_EXT_MEMORY_PRIORITY_EXTENSION_NAME);
+}
+
+VulkanMemoryPriorityExtension* VulkanMemoryPriorityExtension::get(const ResourceID p_DeviceID)
+{
+    return VulkanContext::getDevice(p_DeviceID).getExtensionManager()->getExtension<VulkanMemoryPriorityExtension>(VK_EXT_MEMORY_PRIORITY_EXTENSION_NAME);
+}
+
+VulkanMemoryPriorityExtension::VulkanMemoryPriorityExtension(const ResourceID p_DeviceID)
+    : VulkanDeviceExtension(p_DeviceID) {}
+
+VkBaseInStructure* VulkanMemoryPriorityExtension::getExtensionStruct() const
+{
+    VkPhysicalDeviceMemoryPriorityFeaturesEXT* l_Struct = TRANS_ALLOC(VkPhysicalDeviceMemoryPriorityFeaturesEXT){};
+    l_Struct->sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PRIORITY_FEATURES_EXT;
+    l_Struct->pNext = nullptr;
+    l_Struct->memoryPriority = VK_TRUE;
+    return reinterpret_cast<VkBaseInStructure*>(l_Struct);
+}
@@ -0,0 +1,171 @@
+#include "utils/mapped_file.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <Windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include "utils/logger.hpp"
+
+MappedFile::MappedFile(const std::string_view p_Path)
+{
+    open(p_Path);
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& p_Other) noexcept
+{
+    *this = std::move(p_Other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& p_Other) noexcept
+{
+    if (this != &p_Other)
+    {
+        close();
+        m_Data = std::exchange(p_Other.m_Data, nullptr);
+        m_Size = std::exchange(p_Other.m_Size, 0);
+#ifdef _WIN32
+        m_FileHandle = std::exchange(p_Other.m_FileHandle, nullptr);
+        m_MappingHandle = std::exchange(p_Other.m_MappingHandle, nullptr);
+#else
+        m_FileDescriptor = std::exchange(p_Other.m_FileDescriptor, -1);
+#endif
+    }
+    return *this;
+}
+
+void MappedFile::open(const std::string_view p_Path)
+{
+    close();
+
+    const std::string l_Path{p_Path};
+#ifdef _WIN32
+    m_FileHandle = CreateFileA(l_Path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (m_FileHandle == INVALID_HANDLE_VALUE)
+    {
+        m_FileHandle = nullptr;
+        throw std::runtime_error("Failed to open file " + l_Path + " for mapping");
+    }
+
+    LARGE_INTEGER l_Size;
+    if (!GetFileSizeEx(m_FileHandle, &l_Size) || l_Size.QuadPart == 0)
+    {
+        close();
+        throw std::runtime_error("Failed to map file " + l_Path + ", file is empty or its size could not be read");
+    }
+    m_Size = static_cast<size_t>(l_Size.QuadPart);
+
+    m_MappingHandle = CreateFileMappingA(m_FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_MappingHandle)
+    {
+        close();
+        throw std::runtime_error("Failed to create file mapping for " + l_Path);
+    }
+
+    m_Data = static_cast<uint8_t*>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+#else
+    m_FileDescriptor = ::open(l_Path.c_str(), O_RDONLY);
+    if (m_FileDescriptor < 0)
+    {
+        throw std::runtime_error("Failed to open file " + l_Path + " for mapping");
+    }
+
+    struct stat l_Stat{};
+    if (fstat(m_FileDescriptor, &l_Stat) != 0 || l_Stat.st_size == 0)
+    {
+        close();
+        throw std::runtime_error("Failed to map file " + l_Path + ", file is empty or its size could not be read");
+    }
+    m_Size = static_cast<size_t>(l_Stat.st_size);
+
+    void* l_Mapping = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, m_FileDescriptor, 0);
+    m_Data = l_Mapping != MAP_FAILED ? static_cast<uint8_t*>(l_Mapping) : nullptr;
+#endif
+
+    if (!m_Data)
+    {
+        close();
+        throw std::runtime_error("Failed to map file " + l_Path);
+    }
+
+    LOG_DEBUG("Mapped file ", l_Path, " (", m_Size, " bytes)");
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if (m_Data)
+        UnmapViewOfFile(m_Data);
+    if (m_MappingHandle)
+        CloseHandle(m_MappingHandle);
+    if (m_FileHandle)
+        CloseHandle(m_FileHandle);
+    m_MappingHandle = nullptr;
+    m_FileHandle = nullptr;
+#else
+    if (m_Data)
+        munmap(m_Data, m_Size);
+    if (m_FileDescriptor >= 0)
+        ::close(m_FileDescriptor);
+    m_FileDescriptor = -1;
+#endif
+    m_Data = nullptr;
+    m_Size = 0;
+}
+
+void MappedFile::adviseSequential() const
+{
+    if (!m_Data)
+        return;
+
+#ifndef _WIN32
+    madvise(m_Data, m_Size, MADV_SEQUENTIAL);
+#endif
+}
+
+void MappedFile::prefetch(const size_t p_Offset, const size_t p_Size) const
+{
+    if (!m_Data || p_Offset >= m_Size)
+        return;
+
+    // Both madvise and PrefetchVirtualMemory want page aligned ranges
+    const size_t l_PageSize = getPageSize();
+    const size_t l_Begin = p_Offset & ~(l_PageSize - 1);
+    const size_t l_End = std::min(p_Offset + p_Size, m_Size);
+
+#ifdef _WIN32
+    WIN32_MEMORY_RANGE_ENTRY l_Range;
+    l_Range.VirtualAddress = m_Data + l_Begin;
+    l_Range.NumberOfBytes = l_End - l_Begin;
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &l_Range, 0);
+#else
+    madvise(m_Data + l_Begin, l_End - l_Begin, MADV_WILLNEED);
+#endif
+}
+
+size_t MappedFile::getPageSize()
+{
+#ifdef _WIN32
+    SYSTEM_INFO l_Info;
+    GetSystemInfo(&l_Info);
+    return l_Info.dwPageSize;
+#else
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
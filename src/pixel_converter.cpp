@@ -0,0 +1,614 @@
+#include "utils/pixel_converter.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+#include "utils/logger.hpp"
+
+#if defined(_M_X64) || defined(__x86_64__)
+    #define PIXEL_CONVERTER_X86
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+#endif
+
+#if defined(PIXEL_CONVERTER_X86) && (defined(__GNUC__) || defined(__clang__))
+    #define TARGET_SSE41 __attribute__((target("sse4.1")))
+    #define TARGET_AVX2 __attribute__((target("avx2,f16c")))
+#else
+    #define TARGET_SSE41
+    #define TARGET_AVX2
+#endif
+
+using Conversion = PixelConverter::Conversion;
+
+// Linear values are quantized to 12 bits before the lookup, enough to stay within one step of the exact encoding
+static constexpr uint32_t SRGB_TABLE_SIZE = 4096;
+
+static const uint32_t* getSRGBTable()
+{
+    static const std::array<uint32_t, SRGB_TABLE_SIZE> s_Table = []
+    {
+        std::array<uint32_t, SRGB_TABLE_SIZE> l_Table{};
+        for (uint32_t i = 0; i < SRGB_TABLE_SIZE; i++)
+        {
+            const float l_Linear = static_cast<float>(i) / static_cast<float>(SRGB_TABLE_SIZE - 1);
+            const float l_Encoded = l_Linear <= 0.0031308f ? l_Linear * 12.92f : 1.055f * std::pow(l_Linear, 1.0f / 2.4f) - 0.055f;
+            l_Table[i] = static_cast<uint32_t>(l_Encoded * 255.0f + 0.5f);
+        }
+        return l_Table;
+    }();
+    return s_Table.data();
+}
+
+// NaN maps to 0, matching the SIMD max/min order
+static float saturate(const float p_Value)
+{
+    return p_Value > 0.0f ? (p_Value < 1.0f ? p_Value : 1.0f) : 0.0f;
+}
+
+// Round to nearest even, overflow goes to infinity and NaN stays a quiet NaN
+static uint16_t floatToHalf(const float p_Value)
+{
+    constexpr uint32_t F32_INFINITY = 255u << 23;
+    constexpr uint32_t F16_MAX = (127u + 16) << 23;
+    constexpr uint32_t MIN_NORMAL = (127u - 14) << 23;
+    constexpr uint32_t SUBNORMAL_MAGIC = ((127u - 15) + (23 - 10) + 1) << 23;
+
+    uint32_t l_Bits;
+    memcpy(&l_Bits, &p_Value, sizeof(l_Bits));
+    const uint32_t l_Sign = l_Bits & 0x80000000u;
+    l_Bits ^= l_Sign;
+
+    uint32_t l_Half;
+    if (l_Bits >= F16_MAX)
+    {
+        l_Half = l_Bits > F32_INFINITY ? 0x7E00 : 0x7C00;
+    }
+    else if (l_Bits < MIN_NORMAL)
+    {
+        float l_Float;
+        float l_Magic;
+        memcpy(&l_Float, &l_Bits, sizeof(l_Float));
+        memcpy(&l_Magic, &SUBNORMAL_MAGIC, sizeof(l_Magic));
+        l_Float += l_Magic;
+        memcpy(&l_Half, &l_Float, sizeof(l_Half));
+        l_Half -= SUBNORMAL_MAGIC;
+    }
+    else
+    {
+        const uint32_t l_MantissaOdd = (l_Bits >> 13) & 1;
+        l_Bits += (static_cast<uint32_t>(15 - 127) << 23) + 0xFFF + l_MantissaOdd;
+        l_Half = l_Bits >> 13;
+    }
+    return static_cast<uint16_t>(l_Half | l_Sign >> 16);
+}
+
+static void convertScalar(const Conversion p_Conversion, uint8_t* p_Dst, const uint8_t* p_Src, const size_t p_PixelCount)
+{
+    switch (p_Conversion)
+    {
+    case Conversion::RGB8_TO_RGBA8:
+    case Conversion::BGR8_TO_RGBA8:
+    {
+        const bool l_Swap = p_Conversion == Conversion::BGR8_TO_RGBA8;
+        for (size_t i = 0; i < p_PixelCount; i++, p_Src += 3, p_Dst += 4)
+        {
+            p_Dst[0] = p_Src[l_Swap ? 2 : 0];
+            p_Dst[1] = p_Src[1];
+            p_Dst[2] = p_Src[l_Swap ? 0 : 2];
+            p_Dst[3] = 255;
+        }
+        break;
+    }
+    case Conversion::BGRA8_TO_RGBA8:
+        for (size_t i = 0; i < p_PixelCount; i++, p_Src += 4, p_Dst += 4)
+        {
+            p_Dst[0] = p_Src[2];
+            p_Dst[1] = p_Src[1];
+            p_Dst[2] = p_Src[0];
+            p_Dst[3] = p_Src[3];
+        }
+        break;
+    case Conversion::RGBA16_TO_RGBA8:
+        for (size_t i = 0; i < p_PixelCount * 4; i++, p_Src += 2)
+        {
+            uint16_t l_Value;
+            memcpy(&l_Value, p_Src, sizeof(l_Value));
+            p_Dst[i] = static_cast<uint8_t>((l_Value * 255u + 32895u) >> 16);
+        }
+        break;
+    case Conversion::RGBA32F_TO_RGBA8_SRGB:
+    {
+        const uint32_t* l_Table = getSRGBTable();
+        for (size_t i = 0; i < p_PixelCount; i++, p_Src += 16, p_Dst += 4)
+        {
+            float l_Pixel[4];
+            memcpy(l_Pixel, p_Src, sizeof(l_Pixel));
+            for (uint32_t j = 0; j < 3; j++)
+                p_Dst[j] = static_cast<uint8_t>(l_Table[static_cast<uint32_t>(saturate(l_Pixel[j]) * 4095.0f + 0.5f)]);
+            p_Dst[3] = static_cast<uint8_t>(saturate(l_Pixel[3]) * 255.0f + 0.5f);
+        }
+        break;
+    }
+    case Conversion::RGB32F_TO_RGBA16F:
+    case Conversion::RGBA32F_TO_RGBA16F:
+    {
+        const uint32_t l_Channels = p_Conversion == Conversion::RGB32F_TO_RGBA16F ? 3 : 4;
+        for (size_t i = 0; i < p_PixelCount; i++, p_Src += l_Channels * 4, p_Dst += 8)
+        {
+            uint16_t l_Pixel[4] = {0, 0, 0, 0x3C00};
+            for (uint32_t j = 0; j < l_Channels; j++)
+            {
+                float l_Value;
+                memcpy(&l_Value, p_Src + j * 4, sizeof(l_Value));
+                l_Pixel[j] = floatToHalf(l_Value);
+            }
+            memcpy(p_Dst, l_Pixel, sizeof(l_Pixel));
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+#ifdef PIXEL_CONVERTER_X86
+// SSE version of floatToHalf, results are in the low 16 bits of each lane
+TARGET_SSE41 static __m128i floatToHalfSSE(const __m128 p_Value)
+{
+    const __m128i l_F16Max = _mm_set1_epi32((127 + 16) << 23);
+    const __m128i l_MinNormal = _mm_set1_epi32((127 - 14) << 23);
+    const __m128i l_SubnormalMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+    const __m128i l_NormalBias = _mm_set1_epi32(0xFFF - ((127 - 15) << 23));
+
+    const __m128 l_Sign = _mm_and_ps(p_Value, _mm_castsi128_ps(_mm_set1_epi32(static_cast<int32_t>(0x80000000u))));
+    const __m128 l_Abs = _mm_xor_ps(p_Value, l_Sign);
+    const __m128i l_AbsBits = _mm_castps_si128(l_Abs);
+
+    const __m128i l_IsNaN = _mm_castps_si128(_mm_cmpunord_ps(l_Abs, l_Abs));
+    const __m128i l_IsRegular = _mm_cmpgt_epi32(l_F16Max, l_AbsBits);
+    const __m128i l_Special = _mm_or_si128(_mm_and_si128(l_IsNaN, _mm_set1_epi32(0x200)), _mm_set1_epi32(0x7C00));
+
+    const __m128i l_IsSubnormal = _mm_cmpgt_epi32(l_MinNormal, l_AbsBits);
+    const __m128i l_Subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(l_Abs, _mm_castsi128_ps(l_SubnormalMagic))), l_SubnormalMagic);
+
+    const __m128i l_MantissaOdd = _mm_srai_epi32(_mm_slli_epi32(l_AbsBits, 31 - 13), 31);
+    const __m128i l_Normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(l_AbsBits, l_NormalBias), l_MantissaOdd), 13);
+
+    const __m128i l_Finite = _mm_blendv_epi8(l_Normal, l_Subnormal, l_IsSubnormal);
+    const __m128i l_Joined = _mm_blendv_epi8(l_Special, l_Finite, l_IsRegular);
+    const __m128i l_SignBits = _mm_srli_epi32(_mm_castps_si128(l_Sign), 16);
+    return _mm_or_si128(l_Joined, l_SignBits);
+}
+
+// 8 unorm16 values to 8 unorm8 values, still 16 bits wide
+TARGET_SSE41 static __m128i narrow16To8SSE(const __m128i p_Values)
+{
+    const __m128i l_Scale = _mm_set1_epi32(255);
+    const __m128i l_Round = _mm_set1_epi32(32895);
+    const __m128i l_Low = _mm_srli_epi32(_mm_add_epi32(_mm_mullo_epi32(_mm_cvtepu16_epi32(p_Values), l_Scale), l_Round), 16);
+    const __m128i l_High = _mm_srli_epi32(_mm_add_epi32(_mm_mullo_epi32(_mm_cvtepu16_epi32(_mm_srli_si128(p_Values, 8)), l_Scale), l_Round), 16);
+    return _mm_packus_epi32(l_Low, l_High);
+}
+
+TARGET_SSE41 static size_t convertSSE41(const Conversion p_Conversion, uint8_t* p_Dst, const uint8_t* p_Src, const size_t p_PixelCount)
+{
+    size_t i = 0;
+    switch (p_Conversion)
+    {
+    case Conversion::RGB8_TO_RGBA8:
+    case Conversion::BGR8_TO_RGBA8:
+    {
+        const __m128i l_Shuffle = p_Conversion == Conversion::RGB8_TO_RGBA8
+            ? _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1)
+            : _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+        const __m128i l_Alpha = _mm_set1_epi32(static_cast<int32_t>(0xFF000000u));
+        // Loads read 16 bytes for 4 pixels, so the last pixels are left to the scalar tail
+        for (; i + 6 <= p_PixelCount; i += 4)
+        {
+            const __m128i l_Pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_Src + i * 3));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p_Dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(l_Pixels, l_Shuffle), l_Alpha));
+        }
+        break;
+    }
+    case Conversion::BGRA8_TO_RGBA8:
+    {
+        const __m128i l_Shuffle = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+        for (; i + 4 <= p_PixelCount; i += 4)
+        {
+            const __m128i l_Pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_Src + i * 4));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p_Dst + i * 4), _mm_shuffle_epi8(l_Pixels, l_Shuffle));
+        }
+        break;
+    }
+    case Conversion::RGBA16_TO_RGBA8:
+    {
+        for (; i + 4 <= p_PixelCount; i += 4)
+        {
+            const __m128i l_A = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_Src + i * 8));
+            const __m128i l_B = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_Src + i * 8 + 16));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p_Dst + i * 4), _mm_packus_epi16(narrow16To8SSE(l_A), narrow16To8SSE(l_B)));
+        }
+        break;
+    }
+    case Conversion::RGBA32F_TO_RGBA8_SRGB:
+    {
+        // No gather before AVX2, only the clamp and quantization are vectorized
+        const uint32_t* l_Table = getSRGBTable();
+        const __m128 l_Scale = _mm_setr_ps(4095.0f, 4095.0f, 4095.0f, 255.0f);
+        const __m128 l_Half = _mm_set1_ps(0.5f);
+        const __m128 l_Zero = _mm_setzero_ps();
+        const __m128 l_One = _mm_set1_ps(1.0f);
+        alignas(16) uint32_t l_Indices[4];
+        for (; i < p_PixelCount; i++)
+        {
+            const __m128 l_Pixel = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(reinterpret_cast<const float*>(p_Src + i * 16)), l_Zero), l_One);
+            _mm_store_si128(reinterpret_cast<__m128i*>(l_Indices), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(l_Pixel, l_Scale), l_Half)));
+            const uint32_t l_Packed = l_Table[l_Indices[0]] | l_Table[l_Indices[1]] << 8 | l_Table[l_Indices[2]] << 16 | l_Indices[3] << 24;
+            memcpy(p_Dst + i * 4, &l_Packed, sizeof(l_Packed));
+        }
+        break;
+    }
+    case Conversion::RGB32F_TO_RGBA16F:
+    {
+        const __m128 l_One = _mm_set1_ps(1.0f);
+        const __m128i l_Mask = _mm_set1_epi32(0xFFFF);
+        // The second load reads one float past its pixel
+        for (; i + 3 <= p_PixelCount; i += 2)
+        {
+            const __m128 l_A = _mm_blend_ps(_mm_loadu_ps(reinterpret_cast<const float*>(p_Src + i * 12)), l_One, 0x8);
+            const __m128 l_B = _mm_blend_ps(_mm_loadu_ps(reinterpret_cast<const float*>(p_Src + i * 12 + 12)), l_One, 0x8);
+            const __m128i l_Packed = _mm_packus_epi32(_mm_and_si128(floatToHalfSSE(l_A), l_Mask), _mm_and_si128(floatToHalfSSE(l_B), l_Mask));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p_Dst + i * 8), l_Packed);
+        }
+        break;
+    }
+    case Conversion::RGBA32F_TO_RGBA16F:
+    {
+        const __m128i l_Mask = _mm_set1_epi32(0xFFFF);
+        for (; i + 2 <= p_PixelCount; i += 2)
+        {
+            const __m128 l_A = _mm_loadu_ps(reinterpret_cast<const float*>(p_Src + i * 16));
+            const __m128 l_B = _mm_loadu_ps(reinterpret_cast<const float*>(p_Src + i * 16 + 16));
+            const __m128i l_Packed = _mm_packus_epi32(_mm_and_si128(floatToHalfSSE(l_A), l_Mask), _mm_and_si128(floatToHalfSSE(l_B), l_Mask));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p_Dst + i * 8), l_Packed);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return i;
+}
+
+// 8 unorm16 values to 8 unorm8 values, still 32 bits wide
+TARGET_AVX2 static __m256i narrow16To8AVX2(const uint8_t* p_Values)
+{
+    const __m256i l_Wide = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p_Values)));
+    return _mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(l_Wide, _mm256_set1_epi32(255)), _mm256_set1_epi32(32895)), 16);
+}
+
+// 2 RGBA32F pixels to 8 sRGB encoded values, still 32 bits wide
+// Alpha lanes index the table too, they are always in range and get replaced by the quantized value afterwards
+TARGET_AVX2 static __m256i encodeSRGBAVX2(const int* p_Table, const uint8_t* p_Pixels)
+{
+    const __m256 l_Scale = _mm256_setr_ps(4095.0f, 4095.0f, 4095.0f, 255.0f, 4095.0f, 4095.0f, 4095.0f, 255.0f);
+    const __m256 l_Pixel = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(reinterpret_cast<const float*>(p_Pixels)), _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+    const __m256i l_Indices = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(l_Pixel, l_Scale), _mm256_set1_ps(0.5f)));
+    return _mm256_blend_epi32(_mm256_i32gather_epi32(p_Table, l_Indices, 4), l_Indices, 0x88);
+}
+
+// 2 RGB32F pixels to 2 RGBA16F pixels, reads one float past the second pixel
+TARGET_AVX2 static __m128i packRGB32FPairAVX2(const uint8_t* p_Pixels)
+{
+    const __m128 l_A = _mm_loadu_ps(reinterpret_cast<const float*>(p_Pixels));
+    const __m128 l_B = _mm_loadu_ps(reinterpret_cast<const float*>(p_Pixels + 12));
+    const __m256 l_Both = _mm256_insertf128_ps(_mm256_castps128_ps256(l_A), l_B, 1);
+    return _mm256_cvtps_ph(_mm256_blend_ps(l_Both, _mm256_set1_ps(1.0f), 0x88), _MM_FROUND_TO_NEAREST_INT);
+}
+
+TARGET_AVX2 static size_t convertAVX2(const Conversion p_Conversion, uint8_t* p_Dst, const uint8_t* p_Src, const size_t p_PixelCount)
+{
+    // packus works per 128 bit lane, this puts the 4 byte groups back in pixel order
+    const __m256i l_LaneOrder = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+    size_t i = 0;
+    switch (p_Conversion)
+    {
+    case Conversion::RGB8_TO_RGBA8:
+    case Conversion::BGR8_TO_RGBA8:
+    {
+        const __m256i l_Shuffle = p_Conversion == Conversion::RGB8_TO_RGBA8
+            ? _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1)
+            : _mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+        const __m256i l_Alpha = _mm256_set1_epi32(static_cast<int32_t>(0xFF000000u));
+        // Each lane gets 4 pixels, the upper load reads 16 bytes starting at pixel 4
+        for (; i + 10 <= p_PixelCount; i += 8)
+        {
+            const __m128i l_Low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_Src + i * 3));
+            const __m128i l_High = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_Src + i * 3 + 12));
+            const __m256i l_Pixels = _mm256_inserti128_si256(_mm256_castsi128_si256(l_Low), l_High, 1);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(p_Dst + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(l_Pixels, l_Shuffle), l_Alpha));
+        }
+        break;
+    }
+    case Conversion::BGRA8_TO_RGBA8:
+    {
+        const __m256i l_Shuffle = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15, 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+        for (; i + 8 <= p_PixelCount; i += 8)
+        {
+            const __m256i l_Pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p_Src + i * 4));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(p_Dst + i * 4), _mm256_shuffle_epi8(l_Pixels, l_Shuffle));
+        }
+        break;
+    }
+    case Conversion::RGBA16_TO_RGBA8:
+    {
+        for (; i + 8 <= p_PixelCount; i += 8)
+        {
+            const uint8_t* l_Src = p_Src + i * 8;
+            const __m256i l_Low = _mm256_packus_epi32(narrow16To8AVX2(l_Src), narrow16To8AVX2(l_Src + 16));
+            const __m256i l_High = _mm256_packus_epi32(narrow16To8AVX2(l_Src + 32), narrow16To8AVX2(l_Src + 48));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(p_Dst + i * 4), _mm256_permutevar8x32_epi32(_mm256_packus_epi16(l_Low, l_High), l_LaneOrder));
+        }
+        break;
+    }
+    case Conversion::RGBA32F_TO_RGBA8_SRGB:
+    {
+        const int* l_Table = reinterpret_cast<const int*>(getSRGBTable());
+        for (; i + 8 <= p_PixelCount; i += 8)
+        {
+            const uint8_t* l_Src = p_Src + i * 16;
+            const __m256i l_Low = _mm256_packus_epi32(encodeSRGBAVX2(l_Table, l_Src), encodeSRGBAVX2(l_Table, l_Src + 32));
+            const __m256i l_High = _mm256_packus_epi32(encodeSRGBAVX2(l_Table, l_Src + 64), encodeSRGBAVX2(l_Table, l_Src + 96));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(p_Dst + i * 4), _mm256_permutevar8x32_epi32(_mm256_packus_epi16(l_Low, l_High), l_LaneOrder));
+        }
+        break;
+    }
+    case Conversion::RGB32F_TO_RGBA16F:
+    {
+        // The last load reads one float past its pixel
+        for (; i + 5 <= p_PixelCount; i += 4)
+        {
+            const __m256i l_Packed = _mm256_inserti128_si256(_mm256_castsi128_si256(packRGB32FPairAVX2(p_Src + i * 12)), packRGB32FPairAVX2(p_Src + i * 12 + 24), 1);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(p_Dst + i * 8), l_Packed);
+        }
+        break;
+    }
+    case Conversion::RGBA32F_TO_RGBA16F:
+        for (; i + 4 <= p_PixelCount; i += 4)
+        {
+            const __m128i l_A = _mm256_cvtps_ph(_mm256_loadu_ps(reinterpret_cast<const float*>(p_Src + i * 16)), _MM_FROUND_TO_NEAREST_INT);
+            const __m128i l_B = _mm256_cvtps_ph(_mm256_loadu_ps(reinterpret_cast<const float*>(p_Src + i * 16 + 32)), _MM_FROUND_TO_NEAREST_INT);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(p_Dst + i * 8), _mm256_inserti128_si256(_mm256_castsi128_si256(l_A), l_B, 1));
+        }
+        break;
+    default:
+        break;
+    }
+    return i;
+}
+#endif
+
+PixelConverter::Stats PixelConverter::convert(const Conversion p_Conversion, void* p_Dst, const void* p_Src, const size_t p_PixelCount)
+{
+    if (!s_PathDetected)
+        setPath(getBestSupportedPath());
+
+    const auto l_Start = std::chrono::steady_clock::now();
+    convertRange(p_Conversion, static_cast<uint8_t*>(p_Dst), static_cast<const uint8_t*>(p_Src), p_PixelCount, s_Path);
+    const double l_Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - l_Start).count();
+
+    Stats l_Stats{};
+    l_Stats.pixels = p_PixelCount;
+    l_Stats.seconds = l_Seconds;
+    l_Stats.megapixelsPerSecond = l_Seconds > 0.0 ? static_cast<double>(p_PixelCount) / l_Seconds / 1e6 : 0.0;
+    l_Stats.path = s_Path;
+    return l_Stats;
+}
+
+void PixelConverter::setPath(const Path p_Path)
+{
+    const Path l_Best = getBestSupportedPath();
+    if (static_cast<uint8_t>(p_Path) > static_cast<uint8_t>(l_Best))
+    {
+        LOG_WARN("Pixel conversion path ", getPathName(p_Path), " is not supported by this CPU, falling back to ", getPathName(l_Best));
+        s_Path = l_Best;
+    }
+    else
+    {
+        s_Path = p_Path;
+    }
+    s_PathDetected = true;
+}
+
+PixelConverter::Path PixelConverter::getBestSupportedPath()
+{
+#ifdef PIXEL_CONVERTER_X86
+    #ifdef _MSC_VER
+        int l_Info[4];
+        __cpuid(l_Info, 0);
+        const int l_MaxLeaf = l_Info[0];
+
+        __cpuid(l_Info, 1);
+        const bool l_SSE41 = (l_Info[2] & (1 << 19)) != 0;
+        const bool l_OSXSave = (l_Info[2] & (1 << 27)) != 0;
+        const bool l_AVX = (l_Info[2] & (1 << 28)) != 0;
+        const bool l_F16C = (l_Info[2] & (1 << 29)) != 0;
+
+        // The OS must save the YMM register state for the AVX2 path to be usable
+        if (l_OSXSave && l_AVX && l_F16C && l_MaxLeaf >= 7 && (_xgetbv(0) & 0x6) == 0x6)
+        {
+            __cpuidex(l_Info, 7, 0);
+            if ((l_Info[1] & (1 << 5)) != 0)
+                return Path::AVX2;
+        }
+        if (l_SSE41)
+            return Path::SSE41;
+    #else
+        __builtin_cpu_init();
+        unsigned int l_EAX, l_EBX, l_ECX = 0, l_EDX;
+        __get_cpuid(1, &l_EAX, &l_EBX, &l_ECX, &l_EDX);
+        const bool l_F16C = (l_ECX & (1u << 29)) != 0;
+
+        if (__builtin_cpu_supports("avx2") && l_F16C)
+            return Path::AVX2;
+        if (__builtin_cpu_supports("sse4.1"))
+            return Path::SSE41;
+    #endif
+#endif
+    return Path::SCALAR;
+}
+
+std::string_view PixelConverter::getPathName(const Path p_Path)
+{
+    switch (p_Path)
+    {
+    case Path::SCALAR: return "scalar";
+    case Path::SSE41: return "SSE4.1";
+    case Path::AVX2: return "AVX2";
+    }
+    return "unknown";
+}
+
+std::string_view PixelConverter::getConversionName(const Conversion p_Conversion)
+{
+    switch (p_Conversion)
+    {
+    case Conversion::RGB8_TO_RGBA8: return "RGB8 to RGBA8";
+    case Conversion::BGR8_TO_RGBA8: return "BGR8 to RGBA8";
+    case Conversion::BGRA8_TO_RGBA8: return "BGRA8 to RGBA8";
+    case Conversion::RGBA16_TO_RGBA8: return "RGBA16 to RGBA8";
+    case Conversion::RGBA32F_TO_RGBA8_SRGB: return "RGBA32F to RGBA8 sRGB";
+    case Conversion::RGB32F_TO_RGBA16F: return "RGB32F to RGBA16F";
+    case Conversion::RGBA32F_TO_RGBA16F: return "RGBA32F to RGBA16F";
+    default: return "unknown";
+    }
+}
+
+uint32_t PixelConverter::getSrcPixelSize(const Conversion p_Conversion)
+{
+    switch (p_Conversion)
+    {
+    case Conversion::RGB8_TO_RGBA8:
+    case Conversion::BGR8_TO_RGBA8: return 3;
+    case Conversion::BGRA8_TO_RGBA8: return 4;
+    case Conversion::RGBA16_TO_RGBA8: return 8;
+    case Conversion::RGB32F_TO_RGBA16F: return 12;
+    case Conversion::RGBA32F_TO_RGBA8_SRGB:
+    case Conversion::RGBA32F_TO_RGBA16F: return 16;
+    default: return 0;
+    }
+}
+
+uint32_t PixelConverter::getDstPixelSize(const Conversion p_Conversion)
+{
+    switch (p_Conversion)
+    {
+    case Conversion::RGB32F_TO_RGBA16F:
+    case Conversion::RGBA32F_TO_RGBA16F: return 8;
+    case Conversion::COUNT: return 0;
+    default: return 4;
+    }
+}
+
+PixelConverter::BenchmarkResult PixelConverter::benchmark(const Conversion p_Conversion, const size_t p_PixelCount, const uint32_t p_Iterations)
+{
+    if (!s_PathDetected)
+        setPath(getBestSupportedPath());
+
+    const size_t l_SrcSize = p_PixelCount * getSrcPixelSize(p_Conversion);
+    const size_t l_DstSize = p_PixelCount * getDstPixelSize(p_Conversion);
+    const std::unique_ptr<uint8_t[]> l_Src = std::make_unique<uint8_t[]>(l_SrcSize);
+    const std::unique_ptr<uint8_t[]> l_Expected = std::make_unique<uint8_t[]>(l_DstSize);
+    const std::unique_ptr<uint8_t[]> l_Dst = std::make_unique<uint8_t[]>(l_DstSize);
+
+    const bool l_FloatSource = p_Conversion == Conversion::RGBA32F_TO_RGBA8_SRGB || p_Conversion == Conversion::RGB32F_TO_RGBA16F || p_Conversion == Conversion::RGBA32F_TO_RGBA16F;
+    if (l_FloatSource)
+    {
+        // Slightly out of range values exercise the clamping and half rounding
+        for (size_t i = 0; i < l_SrcSize / sizeof(float); i++)
+        {
+            const float l_Value = static_cast<float>(i % 1031) / 1000.0f - 0.01f;
+            memcpy(l_Src.get() + i * sizeof(float), &l_Value, sizeof(float));
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < l_SrcSize; i++)
+            l_Src[i] = static_cast<uint8_t>(i * 31);
+    }
+
+    // Warm up so page faults are not part of either measurement
+    convertRange(p_Conversion, l_Expected.get(), l_Src.get(), p_PixelCount, Path::SCALAR);
+
+    BenchmarkResult l_Result{};
+    l_Result.conversion = p_Conversion;
+    l_Result.scalar.path = Path::SCALAR;
+    l_Result.converter.path = s_Path;
+
+    const auto l_ScalarStart = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < p_Iterations; i++)
+    {
+        convertRange(p_Conversion, l_Expected.get(), l_Src.get(), p_PixelCount, Path::SCALAR);
+    }
+    l_Result.scalar.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - l_ScalarStart).count();
+
+    for (uint32_t i = 0; i < p_Iterations; i++)
+    {
+        l_Result.converter.seconds += convert(p_Conversion, l_Dst.get(), l_Src.get(), p_PixelCount).seconds;
+    }
+
+    if (memcmp(l_Dst.get(), l_Expected.get(), l_DstSize) != 0)
+        LOG_ERR("Pixel conversion benchmark for ", getConversionName(p_Conversion), " produced output not matching the scalar kernel");
+
+    for (Stats* l_Stats : {&l_Result.scalar, &l_Result.converter})
+    {
+        l_Stats->pixels = p_PixelCount * p_Iterations;
+        l_Stats->megapixelsPerSecond = l_Stats->seconds > 0.0 ? static_cast<double>(l_Stats->pixels) / l_Stats->seconds / 1e6 : 0.0;
+    }
+
+    LOG_INFO("Pixel conversion benchmark ", getConversionName(p_Conversion), " (", p_PixelCount, " pixels x ", p_Iterations, "): scalar ",
+        l_Result.scalar.megapixelsPerSecond, " MP/s, ", getPathName(l_Result.converter.path), " ", l_Result.converter.megapixelsPerSecond, " MP/s");
+    return l_Result;
+}
+
+std::vector<PixelConverter::BenchmarkResult> PixelConverter::benchmarkAll(const size_t p_PixelCount, const uint32_t p_Iterations)
+{
+    std::vector<BenchmarkResult> l_Results;
+    l_Results.reserve(static_cast<size_t>(Conversion::COUNT));
+    for (uint8_t i = 0; i < static_cast<uint8_t>(Conversion::COUNT); i++)
+    {
+        l_Results.push_back(benchmark(static_cast<Conversion>(i), p_PixelCount, p_Iterations));
+    }
+    return l_Results;
+}
+
+void PixelConverter::convertRange(const Conversion p_Conversion, uint8_t* p_Dst, const uint8_t* p_Src, const size_t p_PixelCount, const Path p_Path)
+{
+    size_t l_Done = 0;
+    switch (p_Path)
+    {
+#ifdef PIXEL_CONVERTER_X86
+    case Path::AVX2:
+        l_Done = convertAVX2(p_Conversion, p_Dst, p_Src, p_PixelCount);
+        break;
+    case Path::SSE41:
+        l_Done = convertSSE41(p_Conversion, p_Dst, p_Src, p_PixelCount);
+        break;
+#endif
+    default:
+        break;
+    }
+
+    // Vector kernels leave the pixels that don't fill a whole iteration to the scalar one
+    convertScalar(p_Conversion, p_Dst + l_Done * getDstPixelSize(p_Conversion), p_Src + l_Done * getSrcPixelSize(p_Conversion), p_PixelCount - l_Done);
+}
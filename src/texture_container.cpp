@@ -0,0 +1,806 @@
+#include "utils/texture_container.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "utils/logger.hpp"
+
+static constexpr std::array<uint8_t, 12> KTX2_IDENTIFIER = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+// Caps on header values so the size arithmetic below cannot overflow; well above what any device supports
+static constexpr uint32_t MAX_TEXTURE_DIMENSION = 1u << 16;
+static constexpr uint32_t MAX_TEXTURE_LAYERS = 2048;
+
+static constexpr size_t KTX2_HEADER_SIZE = 80;
+static constexpr size_t KTX2_LEVEL_INDEX_ENTRY_SIZE = 24;
+
+static constexpr uint32_t DDS_MAGIC = 0x20534444;
+static constexpr size_t DDS_HEADER_SIZE = 128;
+static constexpr size_t DDS_DX10_HEADER_SIZE = 20;
+static constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+static constexpr uint32_t DDPF_FOURCC = 0x4;
+static constexpr uint32_t DDPF_RGB = 0x40;
+static constexpr uint32_t DDSCAPS2_CUBEMAP = 0x200;
+static constexpr uint32_t DDSCAPS2_CUBEMAP_ALL_FACES = 0xFC00;
+static constexpr uint32_t DDSCAPS2_VOLUME = 0x200000;
+static constexpr uint32_t DDS_DIMENSION_TEXTURE1D = 2;
+static constexpr uint32_t DDS_DIMENSION_TEXTURE3D = 4;
+static constexpr uint32_t DDS_MISC_TEXTURECUBE = 0x4;
+
+static uint32_t readU32(const uint8_t* p_Data)
+{
+    uint32_t l_Value;
+    memcpy(&l_Value, p_Data, sizeof(l_Value));
+    return l_Value;
+}
+
+static uint64_t readU64(const uint8_t* p_Data)
+{
+    uint64_t l_Value;
+    memcpy(&l_Value, p_Data, sizeof(l_Value));
+    return l_Value;
+}
+
+static void validateExtent(const uint32_t p_Width, const uint32_t p_Height, const uint32_t p_Depth, const uint32_t p_Layers)
+{
+    if (p_Width == 0 || p_Width > MAX_TEXTURE_DIMENSION || p_Height > MAX_TEXTURE_DIMENSION || p_Depth > MAX_TEXTURE_DIMENSION)
+        throw std::runtime_error("invalid extent " + std::to_string(p_Width) + "x" + std::to_string(p_Height) + "x" + std::to_string(p_Depth));
+    if (p_Layers > MAX_TEXTURE_LAYERS)
+        throw std::runtime_error("invalid layer count " + std::to_string(p_Layers));
+}
+
+static uint32_t getMaxMipLevels(const VkExtent3D p_Extent)
+{
+    return static_cast<uint32_t>(std::bit_width(std::max({p_Extent.width, p_Extent.height, p_Extent.depth})));
+}
+
+static constexpr uint32_t makeFourCC(const char p_A, const char p_B, const char p_C, const char p_D)
+{
+    return static_cast<uint32_t>(p_A) | static_cast<uint32_t>(p_B) << 8 | static_cast<uint32_t>(p_C) << 16 | static_cast<uint32_t>(p_D) << 24;
+}
+
+static VkFormat fromDXGIFormat(const uint32_t p_Format)
+{
+    switch (p_Format)
+    {
+    case 2: return VK_FORMAT_R32G32B32A32_SFLOAT;
+    case 10: return VK_FORMAT_R16G16B16A16_SFLOAT;
+    case 24: return VK_FORMAT_A2B10G10R10_UNORM_PACK32;
+    case 26: return VK_FORMAT_B10G11R11_UFLOAT_PACK32;
+    case 28: return VK_FORMAT_R8G8B8A8_UNORM;
+    case 29: return VK_FORMAT_R8G8B8A8_SRGB;
+    case 34: return VK_FORMAT_R16G16_SFLOAT;
+    case 41: return VK_FORMAT_R32_SFLOAT;
+    case 49: return VK_FORMAT_R8G8_UNORM;
+    case 54: return VK_FORMAT_R16_SFLOAT;
+    case 61: return VK_FORMAT_R8_UNORM;
+    case 67: return VK_FORMAT_E5B9G9R9_UFLOAT_PACK32;
+    case 71: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    case 72: return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+    case 74: return VK_FORMAT_BC2_UNORM_BLOCK;
+    case 75: return VK_FORMAT_BC2_SRGB_BLOCK;
+    case 77: return VK_FORMAT_BC3_UNORM_BLOCK;
+    case 78: return VK_FORMAT_BC3_SRGB_BLOCK;
+    case 80: return VK_FORMAT_BC4_UNORM_BLOCK;
+    case 81: return VK_FORMAT_BC4_SNORM_BLOCK;
+    case 83: return VK_FORMAT_BC5_UNORM_BLOCK;
+    case 84: return VK_FORMAT_BC5_SNORM_BLOCK;
+    case 87: return VK_FORMAT_B8G8R8A8_UNORM;
+    case 91: return VK_FORMAT_B8G8R8A8_SRGB;
+    case 95: return VK_FORMAT_BC6H_UFLOAT_BLOCK;
+    case 96: return VK_FORMAT_BC6H_SFLOAT_BLOCK;
+    case 98: return VK_FORMAT_BC7_UNORM_BLOCK;
+    case 99: return VK_FORMAT_BC7_SRGB_BLOCK;
+    default: return VK_FORMAT_UNDEFINED;
+    }
+}
+
+static VkFormat fromDDSPixelFormat(const uint8_t* p_PixelFormat)
+{
+    const uint32_t l_Flags = readU32(p_PixelFormat + 4);
+    const uint32_t l_FourCC = readU32(p_PixelFormat + 8);
+
+    if (l_Flags & DDPF_FOURCC)
+    {
+        switch (l_FourCC)
+        {
+        case makeFourCC('D', 'X', 'T', '1'): return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+        case makeFourCC('D', 'X', 'T', '2'):
+        case makeFourCC('D', 'X', 'T', '3'): return VK_FORMAT_BC2_UNORM_BLOCK;
+        case makeFourCC('D', 'X', 'T', '4'):
+        case makeFourCC('D', 'X', 'T', '5'): return VK_FORMAT_BC3_UNORM_BLOCK;
+        case makeFourCC('A', 'T', 'I', '1'):
+        case makeFourCC('B', 'C', '4', 'U'): return VK_FORMAT_BC4_UNORM_BLOCK;
+        case makeFourCC('B', 'C', '4', 'S'): return VK_FORMAT_BC4_SNORM_BLOCK;
+        case makeFourCC('A', 'T', 'I', '2'):
+        case makeFourCC('B', 'C', '5', 'U'): return VK_FORMAT_BC5_UNORM_BLOCK;
+        case makeFourCC('B', 'C', '5', 'S'): return VK_FORMAT_BC5_SNORM_BLOCK;
+        // D3DFMT_A16B16G16R16F and D3DFMT_A32B32G32R32F
+        case 113: return VK_FORMAT_R16G16B16A16_SFLOAT;
+        case 116: return VK_FORMAT_R32G32B32A32_SFLOAT;
+        default: return VK_FORMAT_UNDEFINED;
+        }
+    }
+
+    if ((l_Flags & DDPF_RGB) && readU32(p_PixelFormat + 12) == 32)
+    {
+        const uint32_t l_RedMask = readU32(p_PixelFormat + 16);
+        if (l_RedMask == 0x000000FF)
+            return VK_FORMAT_R8G8B8A8_UNORM;
+        if (l_RedMask == 0x00FF0000)
+            return VK_FORMAT_B8G8R8A8_UNORM;
+    }
+    return VK_FORMAT_UNDEFINED;
+}
+
+TextureContainer::TextureContainer(const std::string_view p_Path)
+{
+    open(p_Path);
+}
+
+void TextureContainer::open(const std::string_view p_Path)
+{
+    close();
+    m_File.open(p_Path);
+
+    try
+    {
+        if (m_File.getSize() >= KTX2_IDENTIFIER.size() && memcmp(m_File.getData(), KTX2_IDENTIFIER.data(), KTX2_IDENTIFIER.size()) == 0)
+            parseKTX2();
+        else if (m_File.getSize() >= 4 && readU32(m_File.getData()) == DDS_MAGIC)
+            parseDDS();
+        else
+            throw std::runtime_error("unknown container, expected KTX2 or DDS");
+    }
+    catch (const std::runtime_error& l_Error)
+    {
+        close();
+        throw std::runtime_error("Failed to load texture " + std::string(p_Path) + ": " + l_Error.what());
+    }
+    m_File.adviseSequential();
+
+    LOG_DEBUG("Loaded texture ", p_Path, " (", m_Extent.width, "x", m_Extent.height, "x", m_Extent.depth, ", ", m_MipLevels, " mip level(s), ", m_ArrayLayers, " layer(s))");
+}
+
+void TextureContainer::close()
+{
+    m_File.close();
+    m_Format = VK_FORMAT_UNDEFINED;
+    m_ImageType = VK_IMAGE_TYPE_2D;
+    m_Extent = {};
+    m_MipLevels = 0;
+    m_ArrayLayers = 0;
+    m_Cube = false;
+    m_Subresources.clear();
+}
+
+std::span<const uint8_t> TextureContainer::getData(const Subresource& p_Subresource) const
+{
+    return {m_File.getData() + p_Subresource.offset, p_Subresource.size};
+}
+
+void TextureContainer::parseKTX2()
+{
+    const uint8_t* l_Data = m_File.getData();
+    if (m_File.getSize() < KTX2_HEADER_SIZE)
+        throw std::runtime_error("truncated KTX2 header");
+
+    m_Format = static_cast<VkFormat>(readU32(l_Data + 12));
+    const uint32_t l_Width = readU32(l_Data + 20);
+    const uint32_t l_Height = readU32(l_Data + 24);
+    const uint32_t l_Depth = readU32(l_Data + 28);
+    const uint32_t l_Layers = std::max(readU32(l_Data + 32), 1u);
+    const uint32_t l_Faces = readU32(l_Data + 36);
+    // 0 asks the loader to generate mips, which is left to the caller
+    m_MipLevels = std::max(readU32(l_Data + 40), 1u);
+
+    if (readU32(l_Data + 44) != 0)
+        throw std::runtime_error("supercompressed KTX2 files are not supported");
+    if (m_Format == VK_FORMAT_UNDEFINED)
+        throw std::runtime_error("KTX2 files without a Vulkan format are not supported");
+    if (getBlockInfo(m_Format).bytes == 0)
+        throw std::runtime_error("unsupported format " + std::to_string(m_Format));
+    if (l_Faces != 1 && l_Faces != 6)
+        throw std::runtime_error("invalid face count " + std::to_string(l_Faces));
+    validateExtent(l_Width, l_Height, l_Depth, l_Layers);
+
+    m_Extent = {l_Width, std::max(l_Height, 1u), std::max(l_Depth, 1u)};
+    m_ImageType = l_Depth > 0 ? VK_IMAGE_TYPE_3D : l_Height > 0 ? VK_IMAGE_TYPE_2D : VK_IMAGE_TYPE_1D;
+    m_ArrayLayers = l_Layers * l_Faces;
+    m_Cube = l_Faces == 6;
+
+    // Levels past the 1x1x1 one carry no data, the level index for them is simply ignored
+    const uint32_t l_MaxMipLevels = getMaxMipLevels(m_Extent);
+    if (m_MipLevels > l_MaxMipLevels)
+    {
+        LOG_WARN("KTX2 file declares ", m_MipLevels, " mip levels, clamping to ", l_MaxMipLevels);
+        m_MipLevels = l_MaxMipLevels;
+    }
+
+    if (m_File.getSize() < KTX2_HEADER_SIZE + m_MipLevels * KTX2_LEVEL_INDEX_ENTRY_SIZE)
+        throw std::runtime_error("truncated KTX2 level index");
+
+    // Each level holds its layers back to back, faces innermost
+    m_Subresources.reserve(static_cast<size_t>(m_MipLevels) * m_ArrayLayers);
+    for (uint32_t i = 0; i < m_MipLevels; i++)
+    {
+        const uint8_t* l_Entry = l_Data + KTX2_HEADER_SIZE + i * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+        const uint64_t l_Offset = readU64(l_Entry);
+        const uint64_t l_Length = readU64(l_Entry + 8);
+
+        const size_t l_Size = getSubresourceSize(m_Format, getMipExtent(m_Extent, i));
+        if (l_Length < l_Size * m_ArrayLayers || l_Offset > m_File.getSize() || l_Length > m_File.getSize() - l_Offset)
+            throw std::runtime_error("level " + std::to_string(i) + " is out of bounds");
+
+        for (uint32_t j = 0; j < m_ArrayLayers; j++)
+        {
+            m_Subresources.push_back({i, j, static_cast<size_t>(l_Offset) + j * l_Size, l_Size});
+        }
+    }
+}
+
+void TextureContainer::parseDDS()
+{
+    const uint8_t* l_Data = m_File.getData();
+    if (m_File.getSize() < DDS_HEADER_SIZE)
+        throw std::runtime_error("truncated DDS header");
+
+    const uint8_t* l_Header = l_Data + 4;
+    const uint32_t l_Flags = readU32(l_Header + 4);
+    const uint32_t l_Height = readU32(l_Header + 8);
+    const uint32_t l_Width = readU32(l_Header + 12);
+    const uint32_t l_Depth = readU32(l_Header + 20);
+    const uint32_t l_Caps2 = readU32(l_Header + 108);
+    m_MipLevels = (l_Flags & DDSD_MIPMAPCOUNT) ? std::max(readU32(l_Header + 24), 1u) : 1;
+
+    size_t l_Offset = DDS_HEADER_SIZE;
+    uint32_t l_Layers = 1;
+    bool l_Volume = (l_Caps2 & DDSCAPS2_VOLUME) != 0;
+    m_Cube = (l_Caps2 & DDSCAPS2_CUBEMAP) != 0;
+    m_ImageType = VK_IMAGE_TYPE_2D;
+
+    if (readU32(l_Header + 80) == makeFourCC('D', 'X', '1', '0'))
+    {
+        if (m_File.getSize() < DDS_HEADER_SIZE + DDS_DX10_HEADER_SIZE)
+            throw std::runtime_error("truncated DDS DX10 header");
+
+        const uint8_t* l_DX10 = l_Data + DDS_HEADER_SIZE;
+        m_Format = fromDXGIFormat(readU32(l_DX10));
+        const uint32_t l_Dimension = readU32(l_DX10 + 4);
+        m_Cube = (readU32(l_DX10 + 8) & DDS_MISC_TEXTURECUBE) != 0;
+        l_Layers = std::max(readU32(l_DX10 + 12), 1u);
+        l_Volume = l_Dimension == DDS_DIMENSION_TEXTURE3D;
+        if (l_Dimension == DDS_DIMENSION_TEXTURE1D)
+            m_ImageType = VK_IMAGE_TYPE_1D;
+        l_Offset += DDS_DX10_HEADER_SIZE;
+    }
+    else
+    {
+        m_Format = fromDDSPixelFormat(l_Header + 72);
+        if (m_Cube && (l_Caps2 & DDSCAPS2_CUBEMAP_ALL_FACES) != DDSCAPS2_CUBEMAP_ALL_FACES)
+            throw std::runtime_error("cube maps with missing faces are not supported");
+    }
+
+    if (m_Format == VK_FORMAT_UNDEFINED)
+        throw std::runtime_error("unsupported DDS pixel format");
+    if (getBlockInfo(m_Format).bytes == 0)
+        throw std::runtime_error("unsupported format " + std::to_string(m_Format));
+    validateExtent(l_Width, l_Height, l_Volume ? l_Depth : 1, l_Layers);
+
+    if (l_Volume)
+        m_ImageType = VK_IMAGE_TYPE_3D;
+    m_Extent = {l_Width, std::max(l_Height, 1u), l_Volume ? std::max(l_Depth, 1u) : 1};
+    m_ArrayLayers = l_Layers * (m_Cube ? 6 : 1);
+
+    // The mip count decides where every following layer starts, so an impossible one can't be clamped away
+    if (m_MipLevels > getMaxMipLevels(m_Extent))
+        throw std::runtime_error("invalid mip level count " + std::to_string(m_MipLevels));
+
+    // Unlike KTX2, every layer holds its whole mip chain before the next one starts
+    m_Subresources.reserve(static_cast<size_t>(m_MipLevels) * m_ArrayLayers);
+    for (uint32_t i = 0; i < m_ArrayLayers; i++)
+    {
+        for (uint32_t j = 0; j < m_MipLevels; j++)
+        {
+            const size_t l_Size = getSubresourceSize(m_Format, getMipExtent(m_Extent, j));
+            if (l_Size > m_File.getSize() - l_Offset)
+                throw std::runtime_error("mip level " + std::to_string(j) + " of layer " + std::to_string(i) + " is out of bounds");
+
+            m_Subresources.push_back({j, i, l_Offset, l_Size});
+            l_Offset += l_Size;
+        }
+    }
+}
+
+TextureContainer::BlockInfo TextureContainer::getBlockInfo(const VkFormat p_Format)
+{
+    switch (p_Format)
+    {
+    case VK_FORMAT_R8_UNORM:
+    case VK_FORMAT_R8_SRGB:
+        return {1, 1, 1};
+    case VK_FORMAT_R8G8_UNORM:
+    case VK_FORMAT_R16_SFLOAT:
+        return {1, 1, 2};
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+    case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+    case VK_FORMAT_E5B9G9R9_UFLOAT_PACK32:
+    case VK_FORMAT_R16G16_SFLOAT:
+    case VK_FORMAT_R32_SFLOAT:
+        return {1, 1, 4};
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+        return {1, 1, 8};
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        return {1, 1, 16};
+
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC4_SNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+    case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+    case VK_FORMAT_EAC_R11_SNORM_BLOCK:
+        return {4, 4, 8};
+    case VK_FORMAT_BC2_UNORM_BLOCK:
+    case VK_FORMAT_BC2_SRGB_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+    case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+    case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+    case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:
+    case VK_FORMAT_EAC_R11G11_SNORM_BLOCK:
+        return {4, 4, 16};
+
+    case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+        return {4, 4, 16};
+    case VK_FORMAT_ASTC_5x4_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_5x4_SRGB_BLOCK:
+        return {5, 4, 16};
+    case VK_FORMAT_ASTC_5x5_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_5x5_SRGB_BLOCK:
+        return {5, 5, 16};
+    case VK_FORMAT_ASTC_6x5_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_6x5_SRGB_BLOCK:
+        return {6, 5, 16};
+    case VK_FORMAT_ASTC_6x6_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_6x6_SRGB_BLOCK:
+        return {6, 6, 16};
+    case VK_FORMAT_ASTC_8x5_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_8x5_SRGB_BLOCK:
+        return {8, 5, 16};
+    case VK_FORMAT_ASTC_8x6_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_8x6_SRGB_BLOCK:
+        return {8, 6, 16};
+    case VK_FORMAT_ASTC_8x8_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_8x8_SRGB_BLOCK:
+        return {8, 8, 16};
+    case VK_FORMAT_ASTC_10x5_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_10x5_SRGB_BLOCK:
+        return {10, 5, 16};
+    case VK_FORMAT_ASTC_10x6_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_10x6_SRGB_BLOCK:
+        return {10, 6, 16};
+    case VK_FORMAT_ASTC_10x8_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_10x8_SRGB_BLOCK:
+        return {10, 8, 16};
+    case VK_FORMAT_ASTC_10x10_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_10x10_SRGB_BLOCK:
+        return {10, 10, 16};
+    case VK_FORMAT_ASTC_12x10_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_12x10_SRGB_BLOCK:
+        return {12, 10, 16};
+    case VK_FORMAT_ASTC_12x12_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_12x12_SRGB_BLOCK:
+        return {12, 12, 16};
+    default:
+        return {};
+    }
+}
+
+bool TextureContainer::isBlockCompressed(const VkFormat p_Format)
+{
+    const BlockInfo l_Info = getBlockInfo(p_Format);
+    return l_Info.width > 1 || l_Info.height > 1;
+}
+
+VkExtent3D TextureContainer::getMipExtent(const VkExtent3D p_Extent, const uint32_t p_MipLevel)
+{
+    return {std::max(p_Extent.width >> p_MipLevel, 1u), std::max(p_Extent.height >> p_MipLevel, 1u), std::max(p_Extent.depth >> p_MipLevel, 1u)};
+}
+
+size_t TextureContainer::getSubresourceSize(const VkFormat p_Format, const VkExtent3D p_Extent)
+{
+    const BlockInfo l_Info = getBlockInfo(p_Format);
+    const size_t l_BlocksX = (p_Extent.width + l_Info.width - 1) / l_Info.width;
+    const size_t l_BlocksY = (p_Extent.height + l_Info.height - 1) / l_Info.height;
+    return l_BlocksX * l_BlocksY * p_Extent.depth * l_Info.bytes;
+}
+
+VkFormat TextureContainer::getTranscodeFormat(const VkFormat p_Format)
+{
+    switch (p_Format)
+    {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC2_UNORM_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+    case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+    case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:
+        return VK_FORMAT_R8G8B8A8_UNORM;
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC2_SRGB_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+        return VK_FORMAT_R8G8B8A8_SRGB;
+    default:
+        return VK_FORMAT_UNDEFINED;
+    }
+}
+
+// Decoded blocks are 16 RGBA texels, row major
+
+static void expand565(const uint16_t p_Color, uint8_t* p_Out)
+{
+    const uint32_t l_R = (p_Color >> 11) & 31;
+    const uint32_t l_G = (p_Color >> 5) & 63;
+    const uint32_t l_B = p_Color & 31;
+    p_Out[0] = static_cast<uint8_t>(l_R << 3 | l_R >> 2);
+    p_Out[1] = static_cast<uint8_t>(l_G << 2 | l_G >> 4);
+    p_Out[2] = static_cast<uint8_t>(l_B << 3 | l_B >> 2);
+    p_Out[3] = 255;
+}
+
+// BC2 and BC3 color blocks always use the four color palette, only BC1 has the punch through alpha mode
+static void decodeBC1Block(const uint8_t* p_Block, uint8_t* p_Out, const bool p_FourColors)
+{
+    const uint16_t l_Color0 = static_cast<uint16_t>(p_Block[0] | p_Block[1] << 8);
+    const uint16_t l_Color1 = static_cast<uint16_t>(p_Block[2] | p_Block[3] << 8);
+    const uint32_t l_Indices = readU32(p_Block + 4);
+
+    uint8_t l_Palette[4][4];
+    expand565(l_Color0, l_Palette[0]);
+    expand565(l_Color1, l_Palette[1]);
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        if (p_FourColors || l_Color0 > l_Color1)
+        {
+            l_Palette[2][i] = static_cast<uint8_t>((2 * l_Palette[0][i] + l_Palette[1][i]) / 3);
+            l_Palette[3][i] = static_cast<uint8_t>((l_Palette[0][i] + 2 * l_Palette[1][i]) / 3);
+        }
+        else
+        {
+            l_Palette[2][i] = static_cast<uint8_t>((l_Palette[0][i] + l_Palette[1][i]) / 2);
+            l_Palette[3][i] = 0;
+        }
+    }
+    l_Palette[2][3] = 255;
+    l_Palette[3][3] = (p_FourColors || l_Color0 > l_Color1) ? 255 : 0;
+
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        memcpy(p_Out + i * 4, l_Palette[(l_Indices >> (2 * i)) & 3], 4);
+    }
+}
+
+// BC3 alpha, BC4 and BC5 channels share the same 8 value interpolated block
+static void decodeBC4Block(const uint8_t* p_Block, uint8_t* p_Out, const uint32_t p_Channel)
+{
+    uint8_t l_Values[8];
+    l_Values[0] = p_Block[0];
+    l_Values[1] = p_Block[1];
+    if (l_Values[0] > l_Values[1])
+    {
+        for (uint32_t i = 1; i < 7; i++)
+            l_Values[i + 1] = static_cast<uint8_t>(((7 - i) * l_Values[0] + i * l_Values[1]) / 7);
+    }
+    else
+    {
+        for (uint32_t i = 1; i < 5; i++)
+            l_Values[i + 1] = static_cast<uint8_t>(((5 - i) * l_Values[0] + i * l_Values[1]) / 5);
+        l_Values[6] = 0;
+        l_Values[7] = 255;
+    }
+
+    uint64_t l_Indices = 0;
+    for (uint32_t i = 0; i < 6; i++)
+        l_Indices |= static_cast<uint64_t>(p_Block[2 + i]) << (8 * i);
+
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        p_Out[i * 4 + p_Channel] = l_Values[(l_Indices >> (3 * i)) & 7];
+    }
+}
+
+static uint64_t readBigEndian64(const uint8_t* p_Block)
+{
+    uint64_t l_Value = 0;
+    for (uint32_t i = 0; i < 8; i++)
+        l_Value = l_Value << 8 | p_Block[i];
+    return l_Value;
+}
+
+static uint8_t clampColor(const int32_t p_Value)
+{
+    return static_cast<uint8_t>(std::clamp(p_Value, 0, 255));
+}
+
+static uint8_t extend4(const uint32_t p_Value) { return static_cast<uint8_t>(p_Value << 4 | p_Value); }
+static uint8_t extend5(const uint32_t p_Value) { return static_cast<uint8_t>(p_Value << 3 | p_Value >> 2); }
+static uint8_t extend6(const uint32_t p_Value) { return static_cast<uint8_t>(p_Value << 2 | p_Value >> 4); }
+static uint8_t extend7(const uint32_t p_Value) { return static_cast<uint8_t>(p_Value << 1 | p_Value >> 6); }
+
+// ETC indices are column major, texel (x, y) is index x * 4 + y
+static uint32_t getETCIndex(const uint64_t p_Bits, const uint32_t p_X, const uint32_t p_Y)
+{
+    const uint32_t l_Texel = p_X * 4 + p_Y;
+    return static_cast<uint32_t>(((p_Bits >> (l_Texel + 16)) & 1) << 1 | ((p_Bits >> l_Texel) & 1));
+}
+
+// Covers ETC1 and the T, H and planar modes ETC2 hides behind overflowing differential colors. Alpha is left untouched
+static void decodeETC2Block(const uint8_t* p_Block, uint8_t* p_Out)
+{
+    static constexpr int32_t MODIFIERS[8][2] = {{2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183}};
+    static constexpr int32_t DISTANCES[8] = {3, 6, 11, 16, 23, 32, 41, 64};
+
+    const uint64_t l_Bits = readBigEndian64(p_Block);
+    const bool l_Differential = (l_Bits >> 33) & 1;
+    const bool l_Flip = (l_Bits >> 32) & 1;
+
+    const auto l_WritePaint = [&](const uint8_t (&p_Paint)[4][3])
+    {
+        for (uint32_t y = 0; y < 4; y++)
+            for (uint32_t x = 0; x < 4; x++)
+                memcpy(p_Out + (y * 4 + x) * 4, p_Paint[getETCIndex(l_Bits, x, y)], 3);
+    };
+
+    uint8_t l_Base[2][3];
+    if (l_Differential)
+    {
+        const int32_t l_R = static_cast<int32_t>((l_Bits >> 59) & 31);
+        const int32_t l_G = static_cast<int32_t>((l_Bits >> 51) & 31);
+        const int32_t l_B = static_cast<int32_t>((l_Bits >> 43) & 31);
+        const int32_t l_R2 = l_R + ((static_cast<int32_t>((l_Bits >> 56) & 7) ^ 4) - 4);
+        const int32_t l_G2 = l_G + ((static_cast<int32_t>((l_Bits >> 48) & 7) ^ 4) - 4);
+        const int32_t l_B2 = l_B + ((static_cast<int32_t>((l_Bits >> 40) & 7) ^ 4) - 4);
+
+        if (l_R2 < 0 || l_R2 > 31)
+        {
+            // T mode
+            const uint8_t l_Color1[3] = {extend4(static_cast<uint32_t>(((l_Bits >> 59) & 3) << 2 | ((l_Bits >> 56) & 3))), extend4((l_Bits >> 52) & 15), extend4((l_Bits >> 48) & 15)};
+            const uint8_t l_Color2[3] = {extend4((l_Bits >> 44) & 15), extend4((l_Bits >> 40) & 15), extend4((l_Bits >> 36) & 15)};
+            const int32_t l_Distance = DISTANCES[((l_Bits >> 34) & 3) << 1 | ((l_Bits >> 32) & 1)];
+
+            uint8_t l_Paint[4][3];
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                l_Paint[0][i] = l_Color1[i];
+                l_Paint[1][i] = clampColor(l_Color2[i] + l_Distance);
+                l_Paint[2][i] = l_Color2[i];
+                l_Paint[3][i] = clampColor(l_Color2[i] - l_Distance);
+            }
+            l_WritePaint(l_Paint);
+            return;
+        }
+        if (l_G2 < 0 || l_G2 > 31)
+        {
+            // H mode
+            const uint32_t l_R1 = (l_Bits >> 59) & 15;
+            const uint32_t l_G1 = ((l_Bits >> 56) & 7) << 1 | ((l_Bits >> 52) & 1);
+            const uint32_t l_B1 = ((l_Bits >> 51) & 1) << 3 | ((l_Bits >> 47) & 7);
+            const uint32_t l_RH = (l_Bits >> 43) & 15;
+            const uint32_t l_GH = (l_Bits >> 39) & 15;
+            const uint32_t l_BH = (l_Bits >> 35) & 15;
+            const uint32_t l_Order = (l_R1 << 8 | l_G1 << 4 | l_B1) >= (l_RH << 8 | l_GH << 4 | l_BH) ? 1 : 0;
+            const int32_t l_Distance = DISTANCES[((l_Bits >> 34) & 1) << 2 | ((l_Bits >> 32) & 1) << 1 | l_Order];
+
+            const uint8_t l_Color1[3] = {extend4(l_R1), extend4(l_G1), extend4(l_B1)};
+            const uint8_t l_Color2[3] = {extend4(l_RH), extend4(l_GH), extend4(l_BH)};
+            uint8_t l_Paint[4][3];
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                l_Paint[0][i] = clampColor(l_Color1[i] + l_Distance);
+                l_Paint[1][i] = clampColor(l_Color1[i] - l_Distance);
+                l_Paint[2][i] = clampColor(l_Color2[i] + l_Distance);
+                l_Paint[3][i] = clampColor(l_Color2[i] - l_Distance);
+            }
+            l_WritePaint(l_Paint);
+            return;
+        }
+        if (l_B2 < 0 || l_B2 > 31)
+        {
+            // Planar mode, the whole block is a gradient between three colors
+            const int32_t l_Origin[3] = {
+                extend6((l_Bits >> 57) & 63),
+                extend7(static_cast<uint32_t>(((l_Bits >> 56) & 1) << 6 | ((l_Bits >> 49) & 63))),
+                extend6(static_cast<uint32_t>(((l_Bits >> 48) & 1) << 5 | ((l_Bits >> 43) & 3) << 3 | ((l_Bits >> 39) & 7)))
+            };
+            const int32_t l_Horizontal[3] = {extend6(static_cast<uint32_t>(((l_Bits >> 34) & 31) << 1 | ((l_Bits >> 32) & 1))), extend7((l_Bits >> 25) & 127), extend6((l_Bits >> 19) & 63)};
+            const int32_t l_Vertical[3] = {extend6((l_Bits >> 13) & 63), extend7((l_Bits >> 6) & 127), extend6(l_Bits & 63)};
+
+            for (int32_t y = 0; y < 4; y++)
+                for (int32_t x = 0; x < 4; x++)
+                    for (uint32_t i = 0; i < 3; i++)
+                        p_Out[(y * 4 + x) * 4 + i] = clampColor((x * (l_Horizontal[i] - l_Origin[i]) + y * (l_Vertical[i] - l_Origin[i]) + 4 * l_Origin[i] + 2) >> 2);
+            return;
+        }
+
+        l_Base[0][0] = extend5(static_cast<uint32_t>(l_R));
+        l_Base[0][1] = extend5(static_cast<uint32_t>(l_G));
+        l_Base[0][2] = extend5(static_cast<uint32_t>(l_B));
+        l_Base[1][0] = extend5(static_cast<uint32_t>(l_R2));
+        l_Base[1][1] = extend5(static_cast<uint32_t>(l_G2));
+        l_Base[1][2] = extend5(static_cast<uint32_t>(l_B2));
+    }
+    else
+    {
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            l_Base[0][i] = extend4((l_Bits >> (60 - 8 * i)) & 15);
+            l_Base[1][i] = extend4((l_Bits >> (56 - 8 * i)) & 15);
+        }
+    }
+
+    const uint32_t l_Tables[2] = {static_cast<uint32_t>((l_Bits >> 37) & 7), static_cast<uint32_t>((l_Bits >> 34) & 7)};
+    for (uint32_t y = 0; y < 4; y++)
+    {
+        for (uint32_t x = 0; x < 4; x++)
+        {
+            const uint32_t l_SubBlock = l_Flip ? (y >= 2 ? 1 : 0) : (x >= 2 ? 1 : 0);
+            const uint32_t l_Index = getETCIndex(l_Bits, x, y);
+            const int32_t l_Modifier = MODIFIERS[l_Tables[l_SubBlock]][l_Index & 1];
+            const int32_t l_Delta = (l_Index & 2) ? -l_Modifier : l_Modifier;
+            for (uint32_t i = 0; i < 3; i++)
+                p_Out[(y * 4 + x) * 4 + i] = clampColor(l_Base[l_SubBlock][i] + l_Delta);
+        }
+    }
+}
+
+// EAC blocks carry one 11 bit channel, p_Eleven picks the R11 precision rules over the 8 bit ETC2 alpha ones
+static void decodeEACBlock(const uint8_t* p_Block, uint8_t* p_Out, const uint32_t p_Channel, const bool p_Eleven)
+{
+    static constexpr int32_t MODIFIERS[16][8] = {
+        {-3, -6, -9, -15, 2, 5, 8, 14}, {-3, -7, -10, -13, 2, 6, 9, 12}, {-2, -5, -8, -13, 1, 4, 7, 12}, {-2, -4, -6, -13, 1, 3, 5, 12},
+        {-3, -6, -8, -12, 2, 5, 7, 11}, {-3, -7, -9, -11, 2, 6, 8, 10}, {-4, -7, -8, -11, 3, 6, 7, 10}, {-3, -5, -8, -11, 2, 4, 7, 10},
+        {-2, -6, -8, -10, 1, 5, 7, 9}, {-2, -5, -8, -10, 1, 4, 7, 9}, {-2, -4, -8, -10, 1, 3, 7, 9}, {-2, -5, -7, -10, 1, 4, 6, 9},
+        {-3, -4, -7, -10, 2, 3, 6, 9}, {-1, -2, -3, -10, 0, 1, 2, 9}, {-4, -6, -8, -9, 3, 5, 7, 8}, {-3, -5, -7, -9, 2, 4, 6, 8}
+    };
+
+    const uint64_t l_Bits = readBigEndian64(p_Block);
+    const int32_t l_Base = p_Block[0];
+    const int32_t l_Multiplier = p_Block[1] >> 4;
+    const int32_t* l_Modifiers = MODIFIERS[p_Block[1] & 15];
+
+    for (uint32_t y = 0; y < 4; y++)
+    {
+        for (uint32_t x = 0; x < 4; x++)
+        {
+            const int32_t l_Modifier = l_Modifiers[(l_Bits >> (45 - 3 * (x * 4 + y))) & 7];
+            uint8_t l_Value;
+            if (p_Eleven)
+            {
+                const int32_t l_Scaled = l_Multiplier == 0 ? l_Modifier : l_Modifier * l_Multiplier * 8;
+                l_Value = static_cast<uint8_t>(std::clamp(l_Base * 8 + 4 + l_Scaled, 0, 2047) >> 3);
+            }
+            else
+            {
+                l_Value = clampColor(l_Base + l_Modifier * l_Multiplier);
+            }
+            p_Out[(y * 4 + x) * 4 + p_Channel] = l_Value;
+        }
+    }
+}
+
+void TextureContainer::transcode(const VkFormat p_Format, const VkExtent3D p_Extent, const std::span<const uint8_t> p_Src, uint8_t* p_Dst)
+{
+    if (getTranscodeFormat(p_Format) == VK_FORMAT_UNDEFINED)
+    {
+        throw std::runtime_error("Format " + std::to_string(p_Format) + " can't be transcoded on the CPU");
+    }
+    if (p_Src.size() < getSubresourceSize(p_Format, p_Extent))
+    {
+        throw std::runtime_error("Transcode source holds " + std::to_string(p_Src.size()) + " bytes, but format " + std::to_string(p_Format) + " needs " + std::to_string(getSubresourceSize(p_Format, p_Extent)));
+    }
+
+    const BlockInfo l_Info = getBlockInfo(p_Format);
+    const uint32_t l_BlocksX = (p_Extent.width + 3) / 4;
+    const uint32_t l_BlocksY = (p_Extent.height + 3) / 4;
+    const uint8_t* l_Block = p_Src.data();
+
+    uint8_t l_Texels[64];
+    for (uint32_t z = 0; z < p_Extent.depth; z++)
+    {
+        uint8_t* l_Slice = p_Dst + static_cast<size_t>(z) * p_Extent.width * p_Extent.height * 4;
+        for (uint32_t by = 0; by < l_BlocksY; by++)
+        {
+            for (uint32_t bx = 0; bx < l_BlocksX; bx++, l_Block += l_Info.bytes)
+            {
+                memset(l_Texels, 0, sizeof(l_Texels));
+                for (uint32_t i = 0; i < 16; i++)
+                    l_Texels[i * 4 + 3] = 255;
+
+                switch (p_Format)
+                {
+                case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+                case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+                    decodeBC1Block(l_Block, l_Texels, false);
+                    for (uint32_t i = 0; i < 16; i++)
+                        l_Texels[i * 4 + 3] = 255;
+                    break;
+                case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+                case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+                    decodeBC1Block(l_Block, l_Texels, false);
+                    break;
+                case VK_FORMAT_BC2_UNORM_BLOCK:
+                case VK_FORMAT_BC2_SRGB_BLOCK:
+                    decodeBC1Block(l_Block + 8, l_Texels, true);
+                    for (uint32_t i = 0; i < 16; i++)
+                        l_Texels[i * 4 + 3] = static_cast<uint8_t>(((l_Block[i / 2] >> (4 * (i % 2))) & 15) * 17);
+                    break;
+                case VK_FORMAT_BC3_UNORM_BLOCK:
+                case VK_FORMAT_BC3_SRGB_BLOCK:
+                    decodeBC1Block(l_Block + 8, l_Texels, true);
+                    decodeBC4Block(l_Block, l_Texels, 3);
+                    break;
+                case VK_FORMAT_BC4_UNORM_BLOCK:
+                    decodeBC4Block(l_Block, l_Texels, 0);
+                    break;
+                case VK_FORMAT_BC5_UNORM_BLOCK:
+                    decodeBC4Block(l_Block, l_Texels, 0);
+                    decodeBC4Block(l_Block + 8, l_Texels, 1);
+                    break;
+                case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+                case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+                    decodeETC2Block(l_Block, l_Texels);
+                    break;
+                case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+                case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+                    decodeETC2Block(l_Block + 8, l_Texels);
+                    decodeEACBlock(l_Block, l_Texels, 3, false);
+                    break;
+                case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+                    decodeEACBlock(l_Block, l_Texels, 0, true);
+                    break;
+                case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:
+                    decodeEACBlock(l_Block, l_Texels, 0, true);
+                    decodeEACBlock(l_Block + 8, l_Texels, 1, true);
+                    break;
+                default:
+                    break;
+                }
+
+                // Edge blocks are clipped to the texture
+                const uint32_t l_Width = std::min(4u, p_Extent.width - bx * 4);
+                const uint32_t l_Height = std::min(4u, p_Extent.height - by * 4);
+                for (uint32_t y = 0; y < l_Height; y++)
+                {
+                    memcpy(l_Slice + ((static_cast<size_t>(by) * 4 + y) * p_Extent.width + bx * 4) * 4, l_Texels + y * 16, l_Width * 4);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#include "utils/thread_pool.hpp"
+
+ThreadPool::ThreadPool(const uint32_t p_ThreadCount)
+{
+    m_Threads.reserve(p_ThreadCount);
+    for (uint32_t i = 0; i < p_ThreadCount; i++)
+    {
+        m_Threads.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::scoped_lock l_Lock{m_Mutex};
+        m_Stopping = true;
+    }
+    m_Condition.notify_all();
+
+    for (std::thread& l_Thread : m_Threads)
+    {
+        l_Thread.join();
+    }
+}
+
+void ThreadPool::enqueue(std::function<void()> p_Task)
+{
+    {
+        std::scoped_lock l_Lock{m_Mutex};
+        m_Tasks.push_back(std::move(p_Task));
+    }
+    m_Condition.notify_one();
+}
+
+void ThreadPool::workerLoop()
+{
+    while (true)
+    {
+        std::function<void()> l_Task;
+        {
+            std::unique_lock l_Lock{m_Mutex};
+            m_Condition.wait(l_Lock, [this] { return m_Stopping || !m_Tasks.empty(); });
+            if (m_Stopping && m_Tasks.empty())
+                return;
+
+            l_Task = std::move(m_Tasks.front());
+            m_Tasks.pop_front();
+        }
+        l_Task();
+    }
+}
@@ -0,0 +1,283 @@
+#include "vulkan_bindless.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "ext/vulkan_descriptor_indexing.hpp"
+#include "utils/logger.hpp"
+#include "vulkan_device.hpp"
+
+static constexpr VkDescriptorBindingFlags BINDLESS_BINDING_FLAGS = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+VulkanBindlessHeap::VulkanBindlessHeap(const ResourceID p_Device, const Config& p_Config)
+    : m_Device(p_Device), m_Config(p_Config)
+{
+    const VulkanDescriptorIndexingExtension* l_Extension = VulkanDescriptorIndexingExtension::get(m_Device);
+    if (l_Extension == nullptr)
+    {
+        throw std::runtime_error("Tried to create a bindless heap on device (ID:" + std::to_string(m_Device) + ") without descriptor indexing enabled");
+    }
+
+    const VkPhysicalDeviceDescriptorIndexingPropertiesEXT& l_Limits = l_Extension->getProperties();
+    const std::array<uint32_t, static_cast<size_t>(Type::COUNT)> l_Requested{m_Config.sampledImages, m_Config.storageImages, m_Config.storageBuffers, m_Config.samplers};
+    const std::array<uint32_t, static_cast<size_t>(Type::COUNT)> l_Max{
+        std::min(l_Limits.maxDescriptorSetUpdateAfterBindSampledImages, l_Limits.maxPerStageDescriptorUpdateAfterBindSampledImages),
+        std::min(l_Limits.maxDescriptorSetUpdateAfterBindStorageImages, l_Limits.maxPerStageDescriptorUpdateAfterBindStorageImages),
+        std::min(l_Limits.maxDescriptorSetUpdateAfterBindStorageBuffers, l_Limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers),
+        std::min(l_Limits.maxDescriptorSetUpdateAfterBindSamplers, l_Limits.maxPerStageDescriptorUpdateAfterBindSamplers)
+    };
+
+    TRANS_VECTOR(l_Bindings, VkDescriptorSetLayoutBinding);
+    TRANS_VECTOR(l_PoolSizes, VkDescriptorPoolSize);
+    l_Bindings.reserve(l_Requested.size());
+    l_PoolSizes.reserve(l_Requested.size());
+    for (uint32_t i = 0; i < l_Requested.size(); i++)
+    {
+        const Type l_Type = static_cast<Type>(i);
+        SlotList& l_Slots = m_Slots[i];
+        l_Slots.capacity = std::max(std::min(l_Requested[i], l_Max[i]), 1u);
+        if (l_Slots.capacity < l_Requested[i])
+        {
+            LOG_WARN("Bindless heap asked for ", l_Requested[i], " descriptors at binding ", i, ", device (ID:", m_Device, ") only allows ", l_Slots.capacity);
+        }
+        l_Slots.next = std::make_unique<std::atomic<uint32_t>[]>(l_Slots.capacity);
+
+        l_Bindings.push_back({getBinding(l_Type), getDescriptorType(l_Type), l_Slots.capacity, m_Config.stages, nullptr});
+        l_PoolSizes.push_back({getDescriptorType(l_Type), l_Slots.capacity});
+    }
+    const std::array<VkDescriptorBindingFlags, static_cast<size_t>(Type::COUNT)> l_BindingFlags{BINDLESS_BINDING_FLAGS, BINDLESS_BINDING_FLAGS, BINDLESS_BINDING_FLAGS, BINDLESS_BINDING_FLAGS};
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    m_Layout = l_Device.createDescriptorSetLayout(l_Bindings, VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT, l_BindingFlags);
+    m_Pool = l_Device.createDescriptorPool(l_PoolSizes, 1, VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT);
+    m_Set = l_Device.createDescriptorSet(m_Pool, m_Layout);
+
+    LOG_DEBUG("Created bindless heap (set ID:", m_Set, ") with ", m_Slots[0].capacity, " sampled images, ", m_Slots[1].capacity, " storage images, ",
+        m_Slots[2].capacity, " storage buffers and ", m_Slots[3].capacity, " samplers");
+}
+
+uint32_t VulkanBindlessHeap::registerSampledImage(const ResourceID p_Image, const ResourceID p_ImageView, const VkImageLayout p_Layout)
+{
+    const uint32_t l_Index = allocateSlot(Type::SAMPLED_IMAGE);
+    if (l_Index != INVALID_INDEX)
+    {
+        const VkImageView l_View = *VulkanContext::getDevice(m_Device).getImage(p_Image).getImageView(p_ImageView);
+        queueWrite({Type::SAMPLED_IMAGE, l_Index, {VK_NULL_HANDLE, l_View, p_Layout}, {}});
+    }
+    return l_Index;
+}
+
+uint32_t VulkanBindlessHeap::registerStorageImage(const ResourceID p_Image, const ResourceID p_ImageView)
+{
+    const uint32_t l_Index = allocateSlot(Type::STORAGE_IMAGE);
+    if (l_Index != INVALID_INDEX)
+    {
+        const VkImageView l_View = *VulkanContext::getDevice(m_Device).getImage(p_Image).getImageView(p_ImageView);
+        queueWrite({Type::STORAGE_IMAGE, l_Index, {VK_NULL_HANDLE, l_View, VK_IMAGE_LAYOUT_GENERAL}, {}});
+    }
+    return l_Index;
+}
+
+uint32_t VulkanBindlessHeap::registerStorageBuffer(const ResourceID p_Buffer, const VkDeviceSize p_Offset, const VkDeviceSize p_Range)
+{
+    const uint32_t l_Index = allocateSlot(Type::STORAGE_BUFFER);
+    if (l_Index != INVALID_INDEX)
+    {
+        const VkBuffer l_Buffer = *VulkanContext::getDevice(m_Device).getBuffer(p_Buffer);
+        queueWrite({Type::STORAGE_BUFFER, l_Index, {}, {l_Buffer, p_Offset, p_Range}});
+    }
+    return l_Index;
+}
+
+uint32_t VulkanBindlessHeap::registerSampler(const ResourceID p_Sampler)
+{
+    const uint32_t l_Index = allocateSlot(Type::SAMPLER);
+    if (l_Index != INVALID_INDEX)
+    {
+        const VkSampler l_Sampler = *VulkanContext::getDevice(m_Device).getSampler(p_Sampler);
+        queueWrite({Type::SAMPLER, l_Index, {l_Sampler, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_UNDEFINED}, {}});
+    }
+    return l_Index;
+}
+
+void VulkanBindlessHeap::unregister(const Type p_Type, const uint32_t p_Index, const ResourceID p_Fence)
+{
+    if (p_Index >= getCapacity(p_Type))
+    {
+        throw std::runtime_error("Tried to unregister slot " + std::to_string(p_Index) + " outside of bindless heap (set ID:" + std::to_string(m_Set) + ")");
+    }
+
+    if (p_Fence == UINT32_MAX)
+    {
+        releaseSlot(p_Type, p_Index);
+        return;
+    }
+
+    std::scoped_lock l_Lock(m_Mutex);
+    m_Retired.push_back({p_Fence, p_Type, p_Index});
+}
+
+void VulkanBindlessHeap::flush()
+{
+    std::vector<PendingWrite> l_Pending;
+    {
+        std::scoped_lock l_Lock(m_Mutex);
+        reclaim();
+        l_Pending.swap(m_PendingWrites);
+    }
+    if (l_Pending.empty())
+        return;
+
+    // A slot released and registered again before the flush only needs its latest write
+    std::ranges::stable_sort(l_Pending, [](const PendingWrite& p_A, const PendingWrite& p_B)
+    {
+        return p_A.type != p_B.type ? p_A.type < p_B.type : p_A.index < p_B.index;
+    });
+
+    // Reserved up front, the writes point into these arrays
+    TRANS_VECTOR(l_ImageInfos, VkDescriptorImageInfo);
+    TRANS_VECTOR(l_BufferInfos, VkDescriptorBufferInfo);
+    TRANS_VECTOR(l_Writes, VkWriteDescriptorSet);
+    l_ImageInfos.reserve(l_Pending.size());
+    l_BufferInfos.reserve(l_Pending.size());
+    l_Writes.reserve(l_Pending.size());
+
+    const VkDescriptorSet l_Set = *VulkanContext::getDevice(m_Device).getDescriptorSet(m_Set);
+    for (size_t i = 0; i < l_Pending.size(); i++)
+    {
+        const PendingWrite& l_Write = l_Pending[i];
+        if (i + 1 < l_Pending.size() && l_Pending[i + 1].type == l_Write.type && l_Pending[i + 1].index == l_Write.index)
+            continue;
+
+        const bool l_IsBuffer = l_Write.type == Type::STORAGE_BUFFER;
+        if (l_IsBuffer)
+            l_BufferInfos.push_back(l_Write.buffer);
+        else
+            l_ImageInfos.push_back(l_Write.image);
+
+        if (!l_Writes.empty())
+        {
+            VkWriteDescriptorSet& l_Last = l_Writes.back();
+            if (l_Last.descriptorType == getDescriptorType(l_Write.type) && l_Last.dstArrayElement + l_Last.descriptorCount == l_Write.index)
+            {
+                l_Last.descriptorCount++;
+                continue;
+            }
+        }
+
+        VkWriteDescriptorSet l_VkWrite{};
+        l_VkWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        l_VkWrite.dstSet = l_Set;
+        l_VkWrite.dstBinding = getBinding(l_Write.type);
+        l_VkWrite.dstArrayElement = l_Write.index;
+        l_VkWrite.descriptorCount = 1;
+        l_VkWrite.descriptorType = getDescriptorType(l_Write.type);
+        l_VkWrite.pImageInfo = l_IsBuffer ? nullptr : &l_ImageInfos.back();
+        l_VkWrite.pBufferInfo = l_IsBuffer ? &l_BufferInfos.back() : nullptr;
+        l_Writes.push_back(l_VkWrite);
+    }
+
+    VulkanContext::getDevice(m_Device).updateDescriptorSets(l_Writes);
+    LOG_DEBUG("Flushed ", l_Pending.size(), " bindless descriptor(s) in ", l_Writes.size(), " write(s)");
+}
+
+void VulkanBindlessHeap::free()
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    {
+        std::scoped_lock l_Lock(m_Mutex);
+        m_PendingWrites.clear();
+        m_Retired.clear();
+    }
+
+    // The pool can't free individual sets, so this only drops the set object and the handle goes away with the pool
+    if (m_Set != UINT32_MAX)
+        l_Device.freeDescriptorSet(m_Set);
+    if (m_Pool != UINT32_MAX)
+        l_Device.freeDescriptorPool(m_Pool);
+    if (m_Layout != UINT32_MAX)
+        l_Device.freeDescriptorSetLayout(m_Layout);
+    m_Pool = UINT32_MAX;
+    m_Layout = UINT32_MAX;
+    m_Set = UINT32_MAX;
+}
+
+size_t VulkanBindlessHeap::getPendingWriteCount() const
+{
+    std::scoped_lock l_Lock(m_Mutex);
+    return m_PendingWrites.size();
+}
+
+VkDescriptorType VulkanBindlessHeap::getDescriptorType(const Type p_Type)
+{
+    switch (p_Type)
+    {
+    case Type::SAMPLED_IMAGE: return VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    case Type::STORAGE_IMAGE: return VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    case Type::STORAGE_BUFFER: return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    case Type::SAMPLER: return VK_DESCRIPTOR_TYPE_SAMPLER;
+    default:
+        throw std::invalid_argument("Invalid bindless descriptor type " + std::to_string(static_cast<uint32_t>(p_Type)));
+    }
+}
+
+uint32_t VulkanBindlessHeap::allocateSlot(const Type p_Type)
+{
+    SlotList& l_Slots = m_Slots[static_cast<uint32_t>(p_Type)];
+
+    uint64_t l_Head = l_Slots.head.load(std::memory_order_acquire);
+    while (static_cast<uint32_t>(l_Head) != INVALID_INDEX)
+    {
+        const uint32_t l_Index = static_cast<uint32_t>(l_Head);
+        const uint32_t l_Next = l_Slots.next[l_Index].load(std::memory_order_relaxed);
+        const uint64_t l_NewHead = ((l_Head >> 32) + 1) << 32 | l_Next;
+        if (l_Slots.head.compare_exchange_weak(l_Head, l_NewHead, std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            l_Slots.used.fetch_add(1, std::memory_order_relaxed);
+            return l_Index;
+        }
+    }
+
+    // Nothing to reuse, so take a fresh slot. The counter may run past capacity under contention, which only means full
+    const uint32_t l_Index = l_Slots.untouched.fetch_add(1, std::memory_order_relaxed);
+    if (l_Index >= l_Slots.capacity)
+    {
+        LOG_ERR("Bindless heap (set ID:", m_Set, ") ran out of slots at binding ", getBinding(p_Type), " (capacity ", l_Slots.capacity, ")");
+        return INVALID_INDEX;
+    }
+    l_Slots.used.fetch_add(1, std::memory_order_relaxed);
+    return l_Index;
+}
+
+void VulkanBindlessHeap::releaseSlot(const Type p_Type, const uint32_t p_Index)
+{
+    SlotList& l_Slots = m_Slots[static_cast<uint32_t>(p_Type)];
+
+    uint64_t l_Head = l_Slots.head.load(std::memory_order_relaxed);
+    uint64_t l_NewHead;
+    do
+    {
+        l_Slots.next[p_Index].store(static_cast<uint32_t>(l_Head), std::memory_order_relaxed);
+        l_NewHead = ((l_Head >> 32) + 1) << 32 | p_Index;
+    } while (!l_Slots.head.compare_exchange_weak(l_Head, l_NewHead, std::memory_order_release, std::memory_order_relaxed));
+    l_Slots.used.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void VulkanBindlessHeap::queueWrite(const PendingWrite& p_Write)
+{
+    std::scoped_lock l_Lock(m_Mutex);
+    m_PendingWrites.push_back(p_Write);
+}
+
+void VulkanBindlessHeap::reclaim()
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    std::erase_if(m_Retired, [&](const RetiredSlot& p_Slot)
+    {
+        if (!l_Device.getFence(p_Slot.fence).poll())
+            return false;
+        releaseSlot(p_Slot.type, p_Slot.index);
+        return true;
+    });
+}
@@ -1,6 +1,7 @@
 #include "vulkan_buffer.hpp"
 
 #include <stdexcept>
+#include <utility>
 #include <vulkan/vk_enum_string_helper.h>
 
 #include "utils/logger.hpp"
@@ -46,11 +47,60 @@ bool VulkanMemArray::isMemoryMapped() const
     return m_MappedData != nullptr;
 }
 
+bool VulkanMemArray::isPersistentlyMapped() const
+{
+    return m_PersistentlyMapped;
+}
+
 void* VulkanMemArray::getMappedData() const
 {
     return m_MappedData;
 }
 
+void VulkanMemArray::markDirty(const VkDeviceSize p_Offset, const VkDeviceSize p_Size) const
+{
+    if (!m_Allocation)
+    {
+        throw std::runtime_error("Buffer (ID:" + std::to_string(m_ID) + ") does not have memory bound to it!");
+    }
+    VulkanContext::getDevice(getDeviceID()).getMemoryAllocator().markDirty(m_Allocation, p_Offset, p_Size);
+}
+
+void VulkanMemArray::flush(const VkDeviceSize p_Offset, const VkDeviceSize p_Size) const
+{
+    if (!m_Allocation)
+    {
+        throw std::runtime_error("Buffer (ID:" + std::to_string(m_ID) + ") does not have memory bound to it!");
+    }
+    VulkanContext::getDevice(getDeviceID()).getMemoryAllocator().flush(m_Allocation, p_Offset, p_Size);
+}
+
+void VulkanMemArray::invalidate(const VkDeviceSize p_Offset, const VkDeviceSize p_Size) const
+{
+    if (!m_Allocation)
+    {
+        throw std::runtime_error("Buffer (ID:" + std::to_string(m_ID) + ") does not have memory bound to it!");
+    }
+    VulkanContext::getDevice(getDeviceID()).getMemoryAllocator().invalidate(m_Allocation, p_Offset, p_Size);
+}
+
+void VulkanMemArray::updateMappingState()
+{
+    if (!m_Allocation)
+    {
+        m_MappedData = nullptr;
+        m_PersistentlyMapped = false;
+        return;
+    }
+
+    const VulkanMemoryAllocator& l_Allocator = VulkanContext::getDevice(getDeviceID()).getMemoryAllocator();
+    l_Allocator.setAllocationOwner(m_Allocation, m_ID);
+
+    // Allocations created with VMA_ALLOCATION_CREATE_MAPPED_BIT stay mapped for their whole lifetime
+    m_MappedData = l_Allocator.getAllocationInfo(m_Allocation).pMappedData;
+    m_PersistentlyMapped = m_MappedData != nullptr;
+}
+
 VkDeviceAddress VulkanBuffer::getDeviceAddress() const
 {
     const VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
@@ -63,6 +113,9 @@ VkDeviceAddress VulkanBuffer::getDeviceAddress() const
 
 void* VulkanMemArray::map(const VkDeviceSize p_Size, const VkDeviceSize p_Offset)
 {
+    if (isMemoryMapped())
+        return m_MappedData;
+
     const VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
 
     void* l_Data = l_Device.getMemoryAllocator().map(m_Allocation);
@@ -93,6 +146,11 @@ VkDeviceSize VulkanBuffer::getSize() const
     return m_Size;
 }
 
+VkBufferUsageFlags VulkanBuffer::getUsage() const
+{
+    return m_Usage;
+}
+
 uint32_t VulkanBuffer::getQueue() const
 {
     return m_QueueFamilyIndex;
@@ -116,6 +174,9 @@ void VulkanMemArray::unmap()
         return;
     }
 
+    if (m_PersistentlyMapped)
+        return;
+
     const VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
 
     l_Device.getMemoryAllocator().unmap(m_Allocation);
@@ -123,12 +184,38 @@ void VulkanMemArray::unmap()
     m_MappedData = nullptr;
 }
 
-VulkanBuffer::VulkanBuffer(const uint32_t p_Device, const VkBuffer p_VkHandle, const VkDeviceSize p_Size)
-    : VulkanMemArray(p_Device), m_VkHandle(p_VkHandle), m_Size(p_Size) {}
+VulkanBuffer::VulkanBuffer(const uint32_t p_Device, const VkBuffer p_VkHandle, const VkDeviceSize p_Size, const VkBufferUsageFlags p_Usage)
+    : VulkanMemArray(p_Device), m_VkHandle(p_VkHandle), m_Size(p_Size), m_Usage(p_Usage) {}
 
 void VulkanBuffer::setBoundMemory(VmaAllocation p_Allocation)
 {
     m_Allocation = p_Allocation;
+    updateMappingState();
+}
+
+void VulkanBuffer::swapBacking(VulkanBuffer& p_Other)
+{
+    if (m_Size != p_Other.m_Size)
+    {
+        throw std::runtime_error("Tried to swap backing of buffer (ID:" + std::to_string(m_ID) + ") with buffer (ID:" + std::to_string(p_Other.m_ID) + ") of a different size");
+    }
+
+    // Transient mappings point into the old memory, drop them before the handles move
+    if (isMemoryMapped() && !m_PersistentlyMapped)
+        unmap();
+    if (p_Other.isMemoryMapped() && !p_Other.m_PersistentlyMapped)
+        p_Other.unmap();
+
+    std::swap(m_VkHandle, p_Other.m_VkHandle);
+    std::swap(m_Usage, p_Other.m_Usage);
+    std::swap(m_Allocation, p_Other.m_Allocation);
+    updateMappingState();
+    p_Other.updateMappingState();
+}
+
+void VulkanBuffer::swapHandle(VulkanBuffer& p_Other)
+{
+    std::swap(m_VkHandle, p_Other.m_VkHandle);
 }
 
 void VulkanBuffer::free()
@@ -141,8 +228,9 @@ void VulkanBuffer::free()
     
     if (m_Allocation)
     {
-        if (isMemoryMapped())
+        if (isMemoryMapped() && !m_PersistentlyMapped)
             unmap();
+        m_MappedData = nullptr;
 
         Logger::pushContext("Buffer memory free");
         l_Device.getMemoryAllocator().deallocate(m_Allocation);
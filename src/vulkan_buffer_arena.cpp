@@ -0,0 +1,132 @@
+#include "vulkan_buffer_arena.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <numeric>
+#include <stdexcept>
+
+#include "utils/logger.hpp"
+#include "vulkan_base.hpp"
+#include "vulkan_device.hpp"
+
+VulkanBufferArena::VulkanBufferArena(const ResourceID p_Device, const VkDeviceSize p_Size, const VkBufferUsageFlags p_Usage, const MemoryPreferences& p_Preferences, const uint32_t p_QueueFamilyIndex)
+    : m_Device(p_Device), m_Size(p_Size)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+
+    const VkPhysicalDeviceLimits l_Limits = l_Device.getGPU().getProperties().limits;
+    if (p_Usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+        m_MinAlignment = std::max(m_MinAlignment, l_Limits.minUniformBufferOffsetAlignment);
+    if (p_Usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
+        m_MinAlignment = std::max(m_MinAlignment, l_Limits.minStorageBufferOffsetAlignment);
+
+    m_Buffer = l_Device.createAndAllocateBuffer(p_Preferences, {p_Size, p_Usage, p_QueueFamilyIndex});
+
+    VmaVirtualBlockCreateInfo l_BlockInfo{};
+    l_BlockInfo.size = p_Size;
+    VULKAN_TRY(vmaCreateVirtualBlock(&l_BlockInfo, &m_Block));
+
+    LOG_DEBUG("Created buffer arena over buffer (ID:", m_Buffer, ") with size ", VulkanMemoryAllocator::compactBytes(p_Size));
+}
+
+VulkanBufferSlice VulkanBufferArena::allocate(const VkDeviceSize p_Size, const VkDeviceSize p_Alignment)
+{
+    if (m_Block == VK_NULL_HANDLE)
+    {
+        throw std::runtime_error("Tried to allocate a slice from a freed buffer arena (buffer ID:" + std::to_string(m_Buffer) + ")");
+    }
+
+    if (p_Alignment > 1 && !std::has_single_bit(p_Alignment))
+    {
+        // Virtual blocks only align to powers of two, so pad the slice enough to fit an offset that is a multiple of both the requested and the device alignment
+        const VkDeviceSize l_Alignment = std::lcm(p_Alignment, m_MinAlignment);
+        VulkanBufferSlice l_Slice = allocate(p_Size + l_Alignment - 1, 1);
+        if (!l_Slice.isValid())
+            return l_Slice;
+
+        l_Slice.offset = (l_Slice.offset + l_Alignment - 1) / l_Alignment * l_Alignment;
+        l_Slice.size = p_Size;
+        return l_Slice;
+    }
+
+    VmaVirtualAllocationCreateInfo l_AllocInfo{};
+    l_AllocInfo.size = p_Size;
+    l_AllocInfo.alignment = std::max(m_MinAlignment, p_Alignment);
+
+    VulkanBufferSlice l_Slice{};
+    if (vmaVirtualAllocate(m_Block, &l_AllocInfo, &l_Slice.allocation, &l_Slice.offset) != VK_SUCCESS)
+    {
+        LOG_DEBUG("Buffer arena (buffer ID:", m_Buffer, ") can't fit a slice of ", VulkanMemoryAllocator::compactBytes(p_Size));
+        return {};
+    }
+
+    l_Slice.buffer = m_Buffer;
+    l_Slice.size = p_Size;
+    m_SliceCount++;
+    return l_Slice;
+}
+
+VulkanBufferSlice VulkanBufferArena::allocateElements(const uint32_t p_Count, const uint32_t p_Stride)
+{
+    return allocate(static_cast<VkDeviceSize>(p_Count) * p_Stride, p_Stride);
+}
+
+void VulkanBufferArena::freeSlice(VulkanBufferSlice& p_Slice)
+{
+    if (!p_Slice.isValid())
+        return;
+
+    if (p_Slice.buffer != m_Buffer)
+    {
+        throw std::runtime_error("Tried to free a slice of buffer (ID:" + std::to_string(p_Slice.buffer) + ") in the arena of buffer (ID:" + std::to_string(m_Buffer) + ")");
+    }
+
+    vmaVirtualFree(m_Block, p_Slice.allocation);
+    p_Slice = {};
+    m_SliceCount--;
+}
+
+void VulkanBufferArena::clear()
+{
+    if (m_Block != VK_NULL_HANDLE)
+        vmaClearVirtualBlock(m_Block);
+    m_SliceCount = 0;
+}
+
+void VulkanBufferArena::free()
+{
+    if (m_Block != VK_NULL_HANDLE)
+    {
+        if (m_SliceCount > 0)
+        {
+            LOG_WARN("Freeing buffer arena (buffer ID:", m_Buffer, ") with ", m_SliceCount, " live slice(s)");
+        }
+        // Destroying a virtual block with live allocations trips a VMA assert
+        vmaClearVirtualBlock(m_Block);
+        vmaDestroyVirtualBlock(m_Block);
+        m_Block = VK_NULL_HANDLE;
+    }
+
+    if (m_Buffer != UINT32_MAX)
+    {
+        VulkanContext::getDevice(m_Device).freeBuffer(m_Buffer);
+        m_Buffer = UINT32_MAX;
+    }
+    m_SliceCount = 0;
+    m_Size = 0;
+}
+
+VkDescriptorBufferInfo VulkanBufferArena::getDescriptorInfo(const VulkanBufferSlice& p_Slice) const
+{
+    return {*VulkanContext::getDevice(m_Device).getBuffer(p_Slice.buffer), p_Slice.offset, p_Slice.size};
+}
+
+VkDeviceSize VulkanBufferArena::getUsedBytes() const
+{
+    if (m_Block == VK_NULL_HANDLE)
+        return 0;
+
+    VmaStatistics l_Stats;
+    vmaGetVirtualBlockStatistics(m_Block, &l_Stats);
+    return l_Stats.allocationBytes;
+}
@@ -1,10 +1,12 @@
 #include "vulkan_command_buffer.hpp"
 
+#include <algorithm>
 #include <stdexcept>
 #include <vector>
 #include <vulkan/vk_enum_string_helper.h>
 
 #include "vulkan_buffer.hpp"
+#include "vulkan_buffer_arena.hpp"
 #include "vulkan_context.hpp"
 #include "vulkan_descriptors.hpp"
 #include "vulkan_device.hpp"
@@ -14,6 +16,8 @@
 #include "vulkan_pipeline.hpp"
 #include "vulkan_queues.hpp"
 #include "vulkan_render_pass.hpp"
+#include "vulkan_transfer.hpp"
+#include "utils/copy_engine.hpp"
 #include "utils/logger.hpp"
 #include "vulkan_base.hpp"
 
@@ -207,11 +211,22 @@ void VulkanMemoryBarrierBuilder::addImageMemoryBarrier(const VulkanImage& p_Imag
         l_Barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     }
     l_Barrier.image = *p_Image;
-    l_Barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    l_Barrier.subresourceRange.baseMipLevel = 0;
-    l_Barrier.subresourceRange.levelCount = 1;
-    l_Barrier.subresourceRange.baseArrayLayer = 0;
-    l_Barrier.subresourceRange.layerCount = 1;
+    l_Barrier.subresourceRange = p_Image.getFullRange();
+    m_ImageMemoryBarriers.push_back(l_Barrier);
+}
+
+void VulkanMemoryBarrierBuilder::addImageMemoryBarrier(const VulkanImage& p_Image, const VkImageSubresourceRange& p_Range, const VkImageLayout p_OldLayout, const VkImageLayout p_NewLayout, const VkAccessFlags p_SrcAccessMask, const VkAccessFlags p_DstAccessMask)
+{
+    VkImageMemoryBarrier l_Barrier{};
+    l_Barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    l_Barrier.srcAccessMask = p_SrcAccessMask == VK_ACCESS_FLAG_BITS_MAX_ENUM ? s_TransitionMapping[p_OldLayout].srcAccessMask : p_SrcAccessMask;
+    l_Barrier.dstAccessMask = p_DstAccessMask == VK_ACCESS_FLAG_BITS_MAX_ENUM ? s_TransitionMapping[p_NewLayout].dstAccessMask : p_DstAccessMask;
+    l_Barrier.oldLayout = p_OldLayout;
+    l_Barrier.newLayout = p_NewLayout;
+    l_Barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    l_Barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    l_Barrier.image = *p_Image;
+    l_Barrier.subresourceRange = p_Range;
     m_ImageMemoryBarriers.push_back(l_Barrier);
 }
 
@@ -257,6 +272,17 @@ void VulkanCommandBuffer::cmdCopyBuffer(const ResourceID p_Source, const Resourc
     l_Device.getTable().vkCmdCopyBuffer(m_VkHandle, *l_Device.getBuffer(p_Source), *l_Device.getBuffer(p_Destination), static_cast<uint32_t>(p_CopyRegions.size()), p_CopyRegions.data());
 }
 
+void VulkanCommandBuffer::cmdUpdateBuffer(const ResourceID p_Buffer, const VkDeviceSize p_Offset, const VkDeviceSize p_Size, const void* p_Data) const
+{
+    if (!m_IsRecording)
+    {
+        throw std::runtime_error("Tried to execute command CmdUpdateBuffer, but command buffer (ID:" + std::to_string(m_ID) + ") is not recording");
+    }
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
+    l_Device.getTable().vkCmdUpdateBuffer(m_VkHandle, *l_Device.getBuffer(p_Buffer), p_Offset, p_Size, p_Data);
+}
+
 void VulkanCommandBuffer::cmdCopyBufferToImage(const ResourceID p_Buffer, const ResourceID p_Image, const VkImageLayout p_ImageLayout, const std::span<const VkBufferImageCopy> p_CopyRegions) const
 {
     if (!m_IsRecording)
@@ -268,6 +294,17 @@ void VulkanCommandBuffer::cmdCopyBufferToImage(const ResourceID p_Buffer, const
     l_Device.getTable().vkCmdCopyBufferToImage(m_VkHandle, *l_Device.getBuffer(p_Buffer), *l_Device.getImage(p_Image), p_ImageLayout, static_cast<uint32_t>(p_CopyRegions.size()), p_CopyRegions.data());
 }
 
+void VulkanCommandBuffer::cmdCopyImageToBuffer(const ResourceID p_Image, const VkImageLayout p_ImageLayout, const ResourceID p_Buffer, const std::span<const VkBufferImageCopy> p_CopyRegions) const
+{
+    if (!m_IsRecording)
+    {
+        throw std::runtime_error("Command buffer (ID:" + std::to_string(m_ID) + ") is not recording");
+    }
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
+    l_Device.getTable().vkCmdCopyImageToBuffer(m_VkHandle, *l_Device.getImage(p_Image), p_ImageLayout, *l_Device.getBuffer(p_Buffer), static_cast<uint32_t>(p_CopyRegions.size()), p_CopyRegions.data());
+}
+
 void VulkanCommandBuffer::cmdBlitImage(const ResourceID p_Source, const ResourceID p_Destination, const std::span<const VkImageBlit> p_Regions, const VkFilter p_Filter) const
 {
     VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
@@ -287,6 +324,19 @@ void VulkanCommandBuffer::cmdBlitImage(const VulkanImage& p_Source, const Vulkan
     l_Device.getTable().vkCmdBlitImage(m_VkHandle, *p_Source, p_Source.getLayout(), *p_Destination, p_Destination.getLayout(), static_cast<uint32_t>(p_Regions.size()), p_Regions.data(), p_Filter);
 }
 
+void VulkanCommandBuffer::cmdCopyImage(const ResourceID p_Source, const ResourceID p_Destination, const std::span<const VkImageCopy> p_Regions) const
+{
+    if (!m_IsRecording)
+    {
+        throw std::runtime_error("Tried to execute command CmdCopyImage, but command buffer (ID:" + std::to_string(m_ID) + ") is not recording");
+    }
+
+    const VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
+    const VulkanImage& l_Source = l_Device.getImage(p_Source);
+    const VulkanImage& l_Destination = l_Device.getImage(p_Destination);
+    l_Device.getTable().vkCmdCopyImage(m_VkHandle, *l_Source, l_Source.getLayout(), *l_Destination, l_Destination.getLayout(), static_cast<uint32_t>(p_Regions.size()), p_Regions.data());
+}
+
 void VulkanCommandBuffer::cmdSimpleBlitImage(const ResourceID p_Source, const ResourceID p_Destination, const VkFilter p_Filter) const
 {
     VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
@@ -357,12 +407,17 @@ void VulkanCommandBuffer::ecmdDumpStagingBuffer(ResourceID p_Buffer, const std::
         throw std::runtime_error("Tried to dump staging buffer (ID: " + std::to_string(p_Buffer) + ") data, but staging buffer is not configured");
     }
 
-    if (l_StagingBuffer.isMemoryMapped())
+    if (l_StagingBuffer.isMemoryMapped() && !l_StagingBuffer.isPersistentlyMapped())
     {
         LOG_DEBUG("Automatically unmapping staging buffer before dumping into buffer (ID: ", p_Buffer, ")");
         l_StagingBuffer.unmap();
     }
 
+    for (const VkBufferCopy& l_Region : p_Regions)
+    {
+        l_StagingBuffer.markDirty(l_Region.srcOffset, l_Region.size);
+    }
+
     cmdCopyBuffer(l_StagingBufferID, p_Buffer, p_Regions);
 }
 
@@ -394,8 +449,15 @@ void VulkanCommandBuffer::ecmdDumpStagingBufferToImage(const ResourceID p_Image,
         l_BarrierBuilder.addImageMemoryBarrier(p_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
         cmdPipelineBarrier(l_BarrierBuilder);
     }
+    VulkanBuffer& l_StagingBuffer = l_Device.getBuffer(l_Device.getStagingBufferData().stagingBuffer);
+    if (l_StagingBuffer.isMemoryMapped() && !l_StagingBuffer.isPersistentlyMapped())
+    {
+        l_StagingBuffer.unmap();
+    }
+    l_StagingBuffer.markDirty(0, VK_WHOLE_SIZE);
+
     std::array<VkBufferImageCopy, 1> l_RegionArray = {l_Region};
-    cmdCopyBufferToImage(l_Device.getStagingBufferData().stagingBuffer, p_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, l_RegionArray);
+    cmdCopyBufferToImage(l_StagingBuffer.getID(), p_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, l_RegionArray);
     if (l_Layout != VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && p_KeepLayout)
     {
         VulkanMemoryBarrierBuilder l_BarrierBuilder{getDeviceID(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0};
@@ -414,7 +476,8 @@ void VulkanCommandBuffer::ecmdDumpDataIntoBuffer(const ResourceID p_DestBuffer,
     {
         const VkDeviceSize l_NextSize = std::min(l_StagingBufferSize, p_Size - l_Offset);
         void* l_StagePtr = l_Device.mapStagingBuffer(l_NextSize, 0);
-        memcpy(l_StagePtr, p_Data + l_Offset, l_NextSize);
+        const CopyEngine::Stats l_Stats = CopyEngine::copy(l_StagePtr, p_Data + l_Offset, l_NextSize);
+        LOG_DEBUG("Staged ", VulkanMemoryAllocator::compactBytes(l_NextSize), " for buffer (ID:", p_DestBuffer, ") at ", l_Stats.gigabytesPerSecond, " GB/s");
         ecmdDumpStagingBuffer(p_DestBuffer, l_NextSize, l_Offset);
         l_Offset += l_NextSize;
     }
@@ -430,16 +493,229 @@ void VulkanCommandBuffer::ecmdDumpDataIntoImage(const ResourceID p_DestImage, co
     {
         l_Device.freeStagingBuffer();
         l_Device.configureStagingBuffer(p_Extent.width * p_Extent.height * p_BytesPerPixel, l_StagingBufferInfo.queue);
-        l_StagingBufferSize = l_Device.getBuffer(l_StagingBufferInfo.stagingBuffer).getSize();
+        l_StagingBufferSize = l_Device.getStagingBufferSize();
     }
 
     const VkDeviceSize l_Size = std::min(l_StagingBufferSize, static_cast<VkDeviceSize>(p_Extent.width * p_Extent.height * p_BytesPerPixel));
 
     void* l_StagePtr = l_Device.mapStagingBuffer(l_Size, 0);
-    memcpy(l_StagePtr, p_Data, l_Size);
+    const CopyEngine::Stats l_Stats = CopyEngine::copy(l_StagePtr, p_Data, l_Size);
+    LOG_DEBUG("Staged ", VulkanMemoryAllocator::compactBytes(l_Size), " for image (ID:", p_DestImage, ") at ", l_Stats.gigabytesPerSecond, " GB/s");
+    ecmdDumpStagingBufferToImage(p_DestImage, p_Extent, {0, 0, 0}, p_KeepLayout);
+}
+
+bool VulkanCommandBuffer::ecmdUploadDataIntoImage(const ResourceID p_DestImage, const uint8_t* p_Data, const VkExtent3D p_Extent, const uint32_t p_BytesPerPixel, const bool p_KeepLayout, const bool p_ImageIdle) const
+{
+    // Ends in the layout the staging path would leave the image in
+    VulkanImage& l_Image = VulkanContext::getDevice(getDeviceID()).getImage(p_DestImage);
+    const VkImageLayout l_CurrentLayout = l_Image.getLayout();
+    const bool l_KeepCurrent = p_KeepLayout && l_CurrentLayout != VK_IMAGE_LAYOUT_UNDEFINED && l_CurrentLayout != VK_IMAGE_LAYOUT_PREINITIALIZED;
+    const VkImageLayout l_HostLayout = l_KeepCurrent ? l_CurrentLayout : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    if (p_ImageIdle && l_Image.canCopyFromHost(l_HostLayout))
+    {
+        l_Image.copyFromHost(p_Data, {l_Image.getAspectFlags(), 0, 0, 1}, {0, 0, 0}, p_Extent, l_HostLayout);
+        return true;
+    }
+
+    ecmdDumpDataIntoImage(p_DestImage, p_Data, p_Extent, p_BytesPerPixel, p_KeepLayout);
+    return false;
+}
+
+void VulkanCommandBuffer::ecmdConvertDataIntoImage(const ResourceID p_DestImage, const void* p_Data, const VkExtent3D p_Extent, const PixelConverter::Conversion p_Conversion, const bool p_KeepLayout) const
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
+    const VulkanDevice::StagingBufferInfo l_StagingBufferInfo = l_Device.getStagingBufferData();
+    const size_t l_PixelCount = static_cast<size_t>(p_Extent.width) * p_Extent.height * p_Extent.depth;
+    const VkDeviceSize l_Size = l_PixelCount * PixelConverter::getDstPixelSize(p_Conversion);
+    if (l_Device.getBuffer(l_StagingBufferInfo.stagingBuffer).getSize() < l_Size)
+    {
+        l_Device.freeStagingBuffer();
+        l_Device.configureStagingBuffer(l_Size, l_StagingBufferInfo.queue);
+    }
+
+    void* l_StagePtr = l_Device.mapStagingBuffer(l_Size, 0);
+    const PixelConverter::Stats l_Stats = PixelConverter::convert(p_Conversion, l_StagePtr, p_Data, l_PixelCount);
+    LOG_DEBUG("Converted ", PixelConverter::getConversionName(p_Conversion), " into staging for image (ID:", p_DestImage, ") at ", l_Stats.megapixelsPerSecond, " MP/s");
     ecmdDumpStagingBufferToImage(p_DestImage, p_Extent, {0, 0, 0}, p_KeepLayout);
 }
 
+void VulkanCommandBuffer::ecmdGenerateMipmaps(const ResourceID p_Image, const VkImageLayout p_FinalLayout, const VkFilter p_Filter) const
+{
+    if (!m_IsRecording)
+    {
+        throw std::runtime_error("Tried to execute command GenerateMipmaps, but command buffer (ID:" + std::to_string(m_ID) + ") is not recording");
+    }
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
+    VulkanImage& l_Image = l_Device.getImage(p_Image);
+    const uint32_t l_Levels = l_Image.getMipLevels();
+    const VkImageAspectFlags l_Aspect = l_Image.getAspectFlags();
+
+    if (l_Image.getSamples() != VK_SAMPLE_COUNT_1_BIT)
+    {
+        throw std::runtime_error("Tried to generate mipmaps for multisampled image (ID:" + std::to_string(p_Image) + ")");
+    }
+
+    VkFilter l_Filter = p_Filter;
+    const VkFormatProperties l_FormatProperties = l_Device.getGPU().getFormatProperties(l_Image.getFormat());
+    const VkFormatFeatureFlags l_Features = l_Image.getConfig().tiling == VK_IMAGE_TILING_LINEAR ? l_FormatProperties.linearTilingFeatures : l_FormatProperties.optimalTilingFeatures;
+    if (!(l_Features & VK_FORMAT_FEATURE_BLIT_SRC_BIT) || !(l_Features & VK_FORMAT_FEATURE_BLIT_DST_BIT))
+    {
+        throw std::runtime_error("Tried to generate mipmaps for image (ID:" + std::to_string(p_Image) + "), but its format can't be blitted");
+    }
+    // Depth and stencil blits only allow nearest filtering
+    if (l_Filter == VK_FILTER_LINEAR && (!(l_Features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) || l_Aspect != VK_IMAGE_ASPECT_COLOR_BIT))
+    {
+        LOG_WARN("Format of image (ID:", p_Image, ") doesn't support linear blits, generating mipmaps with nearest filtering");
+        l_Filter = VK_FILTER_NEAREST;
+    }
+
+    if (l_Levels > 1)
+    {
+        VulkanMemoryBarrierBuilder l_Setup{getDeviceID(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0};
+        l_Setup.addImageMemoryBarrier(l_Image, {l_Aspect, 0, 1, 0, l_Image.getArrayLayers()}, l_Image.getLayout(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_MEMORY_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+        l_Setup.addImageMemoryBarrier(l_Image, {l_Aspect, 1, l_Levels - 1, 0, l_Image.getArrayLayers()}, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT);
+        cmdPipelineBarrier(l_Setup);
+
+        VkExtent3D l_Extent = l_Image.getSize();
+        for (uint32_t i = 1; i < l_Levels; i++)
+        {
+            const VkExtent3D l_Next{std::max(l_Extent.width / 2, 1u), std::max(l_Extent.height / 2, 1u), std::max(l_Extent.depth / 2, 1u)};
+
+            // Every array layer of a level goes through a single blit
+            VkImageBlit l_Blit{};
+            l_Blit.srcSubresource = {l_Aspect, i - 1, 0, l_Image.getArrayLayers()};
+            l_Blit.srcOffsets[1] = {static_cast<int32_t>(l_Extent.width), static_cast<int32_t>(l_Extent.height), static_cast<int32_t>(l_Extent.depth)};
+            l_Blit.dstSubresource = {l_Aspect, i, 0, l_Image.getArrayLayers()};
+            l_Blit.dstOffsets[1] = {static_cast<int32_t>(l_Next.width), static_cast<int32_t>(l_Next.height), static_cast<int32_t>(l_Next.depth)};
+            l_Device.getTable().vkCmdBlitImage(m_VkHandle, *l_Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, *l_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &l_Blit, l_Filter);
+
+            if (i + 1 < l_Levels)
+            {
+                VulkanMemoryBarrierBuilder l_LevelDone{getDeviceID(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0};
+                l_LevelDone.addImageMemoryBarrier(l_Image, {l_Aspect, i, 1, 0, l_Image.getArrayLayers()}, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+                cmdPipelineBarrier(l_LevelDone);
+            }
+            l_Extent = l_Next;
+        }
+
+        VulkanMemoryBarrierBuilder l_Finish{getDeviceID(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0};
+        l_Finish.addImageMemoryBarrier(l_Image, {l_Aspect, 0, l_Levels - 1, 0, l_Image.getArrayLayers()}, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, p_FinalLayout, VK_ACCESS_TRANSFER_READ_BIT);
+        l_Finish.addImageMemoryBarrier(l_Image, {l_Aspect, l_Levels - 1, 1, 0, l_Image.getArrayLayers()}, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, p_FinalLayout, VK_ACCESS_TRANSFER_WRITE_BIT);
+        cmdPipelineBarrier(l_Finish);
+    }
+    else if (l_Image.getLayout() != p_FinalLayout)
+    {
+        VulkanMemoryBarrierBuilder l_Finish{getDeviceID(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0};
+        l_Finish.addImageMemoryBarrier(l_Image, p_FinalLayout);
+        cmdPipelineBarrier(l_Finish);
+    }
+
+    l_Image.setLayout(p_FinalLayout);
+    LOG_DEBUG("Generated ", l_Levels - 1, " mip level(s) for image (ID:", p_Image, ")");
+}
+
+void VulkanCommandBuffer::ecmdFlushBufferUpdates(VulkanBufferUpdateBatcher& p_Batcher) const
+{
+    if (!m_IsRecording)
+    {
+        throw std::runtime_error("Command buffer (ID:" + std::to_string(m_ID) + ") is not recording");
+    }
+
+    if (p_Batcher.m_Updates.empty())
+        return;
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
+    VulkanBuffer& l_StagingBuffer = l_Device.getBuffer(p_Batcher.m_StagingBuffer);
+
+    // Group updates per destination while keeping submission order inside each group
+    std::ranges::stable_sort(p_Batcher.m_Updates, {}, &VulkanBufferUpdateBatcher::Update::buffer);
+
+    uint32_t l_CopyCount = 0;
+    uint32_t l_InlineCount = 0;
+    uint32_t l_BarrierCount = 0;
+    TRANS_VECTOR(l_Regions, VkBufferCopy);
+    // Destination ranges recorded since the last barrier on the current buffer
+    TRANS_VECTOR(l_Written, VkBufferCopy);
+    for (size_t l_Begin = 0; l_Begin < p_Batcher.m_Updates.size();)
+    {
+        const ResourceID l_Buffer = p_Batcher.m_Updates[l_Begin].buffer;
+        size_t l_End = l_Begin + 1;
+        while (l_End < p_Batcher.m_Updates.size() && p_Batcher.m_Updates[l_End].buffer == l_Buffer)
+            l_End++;
+
+        // A lone small update is cheaper embedded in the command buffer than staged and copied
+        const VulkanBufferUpdateBatcher::Update& l_First = p_Batcher.m_Updates[l_Begin];
+        if (l_End - l_Begin == 1 && l_First.isInline)
+        {
+            cmdUpdateBuffer(l_Buffer, l_First.dstOffset, l_First.size, p_Batcher.m_InlineData.data() + l_First.srcOffset);
+            l_InlineCount++;
+            l_Begin = l_End;
+            continue;
+        }
+
+        // vkCmdCopyBuffer doesn't order overlapping regions, and nothing orders two transfer writes without a barrier. Pending
+        // regions are recorded and a barrier is placed before any update that touches a range written earlier in the group
+        l_Regions.clear();
+        l_Written.clear();
+        const auto l_Overlaps = [](const auto& p_Ranges, const VkDeviceSize p_Offset, const VkDeviceSize p_Size)
+        {
+            return std::ranges::any_of(p_Ranges, [&](const VkBufferCopy& p_Range) { return p_Range.dstOffset < p_Offset + p_Size && p_Offset < p_Range.dstOffset + p_Range.size; });
+        };
+        const auto l_RecordRegions = [&]
+        {
+            if (l_Regions.empty())
+                return;
+            for (const VkBufferCopy& l_Region : l_Regions)
+            {
+                l_StagingBuffer.markDirty(l_Region.srcOffset, l_Region.size);
+            }
+            cmdCopyBuffer(p_Batcher.m_StagingBuffer, l_Buffer, l_Regions);
+            l_CopyCount++;
+            l_Written.insert(l_Written.end(), l_Regions.begin(), l_Regions.end());
+            l_Regions.clear();
+        };
+
+        for (size_t i = l_Begin; i < l_End; i++)
+        {
+            const VulkanBufferUpdateBatcher::Update& l_Update = p_Batcher.m_Updates[i];
+            if (l_Overlaps(l_Regions, l_Update.dstOffset, l_Update.size))
+                l_RecordRegions();
+            if (l_Overlaps(l_Written, l_Update.dstOffset, l_Update.size))
+            {
+                VulkanMemoryBarrierBuilder l_Barrier{getDeviceID(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0};
+                l_Barrier.addBufferMemoryBarrier(l_Buffer, 0, VK_WHOLE_SIZE, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+                cmdPipelineBarrier(l_Barrier);
+                l_Written.clear();
+                l_BarrierCount++;
+            }
+
+            if (!l_Update.isInline)
+            {
+                l_Regions.push_back({l_Update.srcOffset, l_Update.dstOffset, l_Update.size});
+                continue;
+            }
+
+            VkDeviceSize l_StagingOffset;
+            if (!p_Batcher.reserveStaging(l_Update.size, l_StagingOffset))
+            {
+                cmdUpdateBuffer(l_Buffer, l_Update.dstOffset, l_Update.size, p_Batcher.m_InlineData.data() + l_Update.srcOffset);
+                l_Written.push_back({0, l_Update.dstOffset, l_Update.size});
+                l_InlineCount++;
+                continue;
+            }
+            memcpy(p_Batcher.m_StagingData + l_StagingOffset, p_Batcher.m_InlineData.data() + l_Update.srcOffset, l_Update.size);
+            l_Regions.push_back({l_StagingOffset, l_Update.dstOffset, l_Update.size});
+        }
+        l_RecordRegions();
+        l_Begin = l_End;
+    }
+
+    LOG_DEBUG("Flushed ", p_Batcher.m_Updates.size(), " buffer update(s) with ", l_CopyCount, " copy command(s), ", l_InlineCount, " inline update(s) and ", l_BarrierCount, " barrier(s) between overlapping writes");
+    p_Batcher.m_Updates.clear();
+    p_Batcher.m_InlineData.clear();
+}
+
 void VulkanCommandBuffer::cmdPushConstant(const ResourceID p_Layout, const VkShaderStageFlags p_StageFlags, const uint32_t p_Offset, const uint32_t p_Size, const void* p_Values) const
 {
     if (!m_IsRecording)
@@ -459,6 +735,30 @@ void VulkanCommandBuffer::cmdBindDescriptorSet(const VkPipelineBindPoint p_BindP
     VulkanContext::getDevice(getDeviceID()).getTable().vkCmdBindDescriptorSets(m_VkHandle, p_BindPoint, l_VkLayout, 0, 1, &l_VkDescriptorSet, 0, nullptr);
 }
 
+void VulkanCommandBuffer::cmdBindDescriptorSets(const VkPipelineBindPoint p_BindPoint, const ResourceID p_Layout, const uint32_t p_FirstSet, const std::span<const VkDescriptorSet> p_DescriptorSets,
+                                                const std::span<const uint32_t> p_DynamicOffsets) const
+{
+    const VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
+    l_Device.getTable().vkCmdBindDescriptorSets(m_VkHandle, p_BindPoint, *l_Device.getPipelineLayout(p_Layout), p_FirstSet, static_cast<uint32_t>(p_DescriptorSets.size()), p_DescriptorSets.data(),
+                                                static_cast<uint32_t>(p_DynamicOffsets.size()), p_DynamicOffsets.data());
+}
+
+void VulkanCommandBuffer::cmdBindDescriptorBuffers(const std::span<const VkDescriptorBufferBindingInfoEXT> p_Buffers) const
+{
+    VulkanContext::getDevice(getDeviceID()).getTable().vkCmdBindDescriptorBuffersEXT(m_VkHandle, static_cast<uint32_t>(p_Buffers.size()), p_Buffers.data());
+}
+
+void VulkanCommandBuffer::cmdSetDescriptorBufferOffsets(const VkPipelineBindPoint p_BindPoint, const ResourceID p_Layout, const uint32_t p_FirstSet, const std::span<const uint32_t> p_BufferIndices,
+                                                        const std::span<const VkDeviceSize> p_Offsets) const
+{
+    if (p_BufferIndices.size() != p_Offsets.size())
+    {
+        throw std::runtime_error("Got " + std::to_string(p_BufferIndices.size()) + " descriptor buffer indices for " + std::to_string(p_Offsets.size()) + " offsets (ID:" + std::to_string(m_ID) + ")");
+    }
+    const VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
+    l_Device.getTable().vkCmdSetDescriptorBufferOffsetsEXT(m_VkHandle, p_BindPoint, *l_Device.getPipelineLayout(p_Layout), p_FirstSet, static_cast<uint32_t>(p_Offsets.size()), p_BufferIndices.data(), p_Offsets.data());
+}
+
 void VulkanCommandBuffer::submit(const VulkanQueue& p_Queue, const std::span<const WaitSemaphoreData> p_WaitSemaphoreData, const std::span<const ResourceID> p_SignalSemaphores, const ResourceID p_Fence)
 {
     if (m_IsRecording)
@@ -475,6 +775,9 @@ void VulkanCommandBuffer::submit(const VulkanQueue& p_Queue, const std::span<con
 
     VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
 
+    // Host writes to non-coherent memory must be visible before the GPU consumes them
+    l_Device.getMemoryAllocator().flushDirtyRanges();
+
     TRANS_VECTOR(l_WaitSemaphores, VkSemaphore);
     l_WaitSemaphores.resize(p_WaitSemaphoreData.size());
     TRANS_VECTOR(l_WaitStages, VkPipelineStageFlags);
@@ -503,6 +806,8 @@ void VulkanCommandBuffer::submit(const VulkanQueue& p_Queue, const std::span<con
     l_SubmitInfo.pSignalSemaphores = l_SignalSemaphoresVk.data();
 
     VULKAN_TRY(l_Device.getTable().vkQueueSubmit(p_Queue.m_VkHandle, 1, &l_SubmitInfo, p_Fence != UINT32_MAX ? l_Device.getFence(p_Fence).m_VkHandle : VK_NULL_HANDLE));
+    if (p_Fence != UINT32_MAX)
+        l_Device.getFence(p_Fence).m_SubmitCount++;
 
     m_HasSubmitted = true;
 }
@@ -620,6 +925,16 @@ void VulkanCommandBuffer::cmdBindIndexBuffer(const ResourceID p_BufferID, const
     l_Device.getTable().vkCmdBindIndexBuffer(m_VkHandle, l_Device.getBuffer(p_BufferID).m_VkHandle, p_Offset, p_IndexType);
 }
 
+void VulkanCommandBuffer::cmdBindVertexBuffer(const VulkanBufferSlice& p_Slice) const
+{
+    cmdBindVertexBuffer(p_Slice.buffer, 0);
+}
+
+void VulkanCommandBuffer::cmdBindIndexBuffer(const VulkanBufferSlice& p_Slice, const VkIndexType p_IndexType) const
+{
+    cmdBindIndexBuffer(p_Slice.buffer, 0, p_IndexType);
+}
+
 void VulkanCommandBuffer::cmdSetViewport(const VkViewport& p_Viewport) const
 {
     if (!m_IsRecording)
@@ -659,6 +974,35 @@ void VulkanCommandBuffer::cmdDrawIndexed(const uint32_t p_IndexCount, const uint
     VulkanContext::getDevice(getDeviceID()).getTable().vkCmdDrawIndexed(m_VkHandle, p_IndexCount, p_InstanceCount, p_FirstIndex, p_VertexOffset, p_FirstInstance);
 }
 
+void VulkanCommandBuffer::cmdDraw(const VulkanBufferSlice& p_Vertices, const uint32_t p_VertexStride, const uint32_t p_InstanceCount, const uint32_t p_FirstInstance) const
+{
+    if (p_Vertices.offset % p_VertexStride != 0)
+    {
+        throw std::runtime_error("Tried to draw vertex slice at offset " + std::to_string(p_Vertices.offset) + ", which is not a multiple of its stride " + std::to_string(p_VertexStride) + " (command buffer ID:" + std::to_string(m_ID) + ")");
+    }
+
+    cmdDraw(static_cast<uint32_t>(p_Vertices.size / p_VertexStride), static_cast<uint32_t>(p_Vertices.offset / p_VertexStride), p_InstanceCount, p_FirstInstance);
+}
+
+void VulkanCommandBuffer::cmdDrawIndexed(const VulkanBufferSlice& p_Indices, const VkIndexType p_IndexType, const VulkanBufferSlice& p_Vertices, const uint32_t p_VertexStride, const uint32_t p_InstanceCount, const uint32_t p_FirstInstance) const
+{
+    VkDeviceSize l_IndexSize;
+    switch (p_IndexType)
+    {
+    case VK_INDEX_TYPE_UINT16: l_IndexSize = 2; break;
+    case VK_INDEX_TYPE_UINT32: l_IndexSize = 4; break;
+    case VK_INDEX_TYPE_UINT8_EXT: l_IndexSize = 1; break;
+    default: throw std::runtime_error("Tried to draw index slice with unsupported index type " + std::string(string_VkIndexType(p_IndexType)));
+    }
+
+    if (p_Indices.offset % l_IndexSize != 0 || p_Vertices.offset % p_VertexStride != 0)
+    {
+        throw std::runtime_error("Tried to draw slices that are not aligned to their element size (command buffer ID:" + std::to_string(m_ID) + ")");
+    }
+
+    cmdDrawIndexed(static_cast<uint32_t>(p_Indices.size / l_IndexSize), static_cast<uint32_t>(p_Indices.offset / l_IndexSize), static_cast<int32_t>(p_Vertices.offset / p_VertexStride), p_InstanceCount, p_FirstInstance);
+}
+
 void VulkanCommandBuffer::cmdDispatch(const uint32_t p_GroupCountX, const uint32_t p_GroupCountY, const uint32_t p_GroupCountZ) const
 {
     if (!m_IsRecording)
@@ -0,0 +1,264 @@
+#include "vulkan_defragmenter.hpp"
+
+#include <algorithm>
+#include <array>
+
+#include "utils/logger.hpp"
+#include "vulkan_base.hpp"
+#include "vulkan_command_buffer.hpp"
+#include "vulkan_device.hpp"
+
+VulkanDefragmenter::VulkanDefragmenter(const ResourceID p_Device, const Config& p_Config)
+    : m_Device(p_Device), m_Config(p_Config) {}
+
+void VulkanDefragmenter::begin()
+{
+    if (isRunning())
+        return;
+
+    const VulkanMemoryAllocator& l_Allocator = VulkanContext::getDevice(m_Device).getMemoryAllocator();
+
+    VmaDefragmentationInfo l_Info{};
+    l_Info.flags = m_Config.flags;
+    l_Info.pool = m_Config.pool != UINT32_MAX ? l_Allocator.getPool(m_Config.pool) : VK_NULL_HANDLE;
+    l_Info.maxBytesPerPass = m_Config.maxBytesPerPass;
+    l_Info.maxAllocationsPerPass = m_Config.maxMovesPerPass;
+
+    VULKAN_TRY(vmaBeginDefragmentation(*l_Allocator, &l_Info, &m_Context));
+    m_State = State::READY;
+    m_Stats = {};
+    LOG_DEBUG("Started defragmentation on device (ID:", m_Device, ")");
+}
+
+bool VulkanDefragmenter::update(const uint32_t p_FrameIndex, const VulkanCommandBuffer& p_CommandBuffer, const ResourceID p_Fence)
+{
+    m_Frame = p_FrameIndex;
+
+    if (m_State == State::COPYING && VulkanContext::getDevice(m_Device).getFence(m_Fence).poll())
+    {
+        swapMoved();
+        m_State = State::DRAINING;
+        m_SwapFrame = m_Frame;
+    }
+
+    // Frames recorded before the swap still point at the old handles and memory, those have to retire before VMA reuses it
+    if (m_State == State::DRAINING && m_Frame - m_SwapFrame >= m_Config.framesInFlight)
+        endPass();
+
+    if (m_State == State::READY)
+        beginPass(p_CommandBuffer, p_Fence);
+
+    return isRunning();
+}
+
+void VulkanDefragmenter::cancel()
+{
+    if (!isRunning())
+        return;
+
+    VulkanContext::getDevice(m_Device).waitIdle();
+    if (m_State == State::COPYING)
+        swapMoved();
+    if (m_State == State::COPYING || m_State == State::DRAINING)
+        endPass();
+    if (isRunning())
+        finish();
+}
+
+void VulkanDefragmenter::beginPass(const VulkanCommandBuffer& p_CommandBuffer, const ResourceID p_Fence)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    const VulkanMemoryAllocator& l_Allocator = l_Device.getMemoryAllocator();
+
+    if (vmaBeginDefragmentationPass(*l_Allocator, m_Context, &m_Pass) == VK_SUCCESS)
+    {
+        finish();
+        return;
+    }
+    m_Stats.passes++;
+
+    m_Moves.clear();
+    for (uint32_t i = 0; i < m_Pass.moveCount; i++)
+    {
+        VmaDefragmentationMove& l_Move = m_Pass.pMoves[i];
+
+        const ResourceID l_Owner = l_Allocator.getAllocationOwner(l_Move.srcAllocation);
+        const VulkanMemArray* l_MemArray = l_Owner != UINT32_MAX ? l_Device.getSubresource<VulkanMemArray>(l_Owner) : nullptr;
+        // Mapped memory can't move under the host's feet, and allocations we don't know the owner of can't be rebound
+        if (!l_MemArray || m_Excluded.contains(l_Owner) || l_MemArray->isMemoryMapped())
+        {
+            l_Move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+            continue;
+        }
+
+        const bool l_Recorded = l_Device.getSubresource<VulkanBuffer>(l_Owner)
+            ? recordBufferMove(l_Move, l_Owner, p_CommandBuffer)
+            : recordImageMove(l_Move, l_Owner, p_CommandBuffer);
+        if (!l_Recorded)
+            l_Move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+    }
+
+    if (m_Moves.empty())
+    {
+        // Nothing to copy, VMA still needs the pass closed to hand out the next one
+        endPass();
+        return;
+    }
+
+    m_Fence = p_Fence;
+    m_State = State::COPYING;
+    LOG_DEBUG("Defragmentation pass recorded ", m_Moves.size(), " of ", m_Pass.moveCount, " moves");
+}
+
+bool VulkanDefragmenter::recordBufferMove(const VmaDefragmentationMove& p_Move, const ResourceID p_Buffer, const VulkanCommandBuffer& p_CommandBuffer)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    const VulkanBuffer& l_Buffer = l_Device.getBuffer(p_Buffer);
+
+    constexpr VkBufferUsageFlags TRANSFER_USAGE = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    if ((l_Buffer.getUsage() & TRANSFER_USAGE) != TRANSFER_USAGE)
+        return false;
+
+    const ResourceID l_Copy = l_Device.createBuffer({l_Buffer.getSize(), l_Buffer.getUsage(), l_Buffer.getQueue()});
+    VULKAN_TRY(vmaBindBufferMemory(*l_Device.getMemoryAllocator(), p_Move.dstTmpAllocation, *l_Device.getBuffer(l_Copy)));
+
+    VulkanMemoryBarrierBuilder l_Before{m_Device, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0};
+    l_Before.addBufferMemoryBarrier(p_Buffer, 0, l_Buffer.getSize(), VK_ACCESS_MEMORY_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+    p_CommandBuffer.cmdPipelineBarrier(l_Before);
+
+    const std::array<VkBufferCopy, 1> l_Regions = {{{0, 0, l_Buffer.getSize()}}};
+    p_CommandBuffer.cmdCopyBuffer(p_Buffer, l_Copy, l_Regions);
+
+    VulkanMemoryBarrierBuilder l_After{m_Device, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0};
+    l_After.addBufferMemoryBarrier(l_Copy, 0, l_Buffer.getSize(), VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT);
+    p_CommandBuffer.cmdPipelineBarrier(l_After);
+
+    m_Moves.push_back({p_Buffer, l_Copy, false});
+    return true;
+}
+
+bool VulkanDefragmenter::recordImageMove(const VmaDefragmentationMove& p_Move, const ResourceID p_Image, const VulkanCommandBuffer& p_CommandBuffer)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    VulkanImage& l_Image = l_Device.getImage(p_Image);
+    const VulkanImage::Config l_Config = l_Image.getConfig();
+
+    constexpr VkImageUsageFlags TRANSFER_USAGE = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    if ((l_Config.usage & TRANSFER_USAGE) != TRANSFER_USAGE || l_Config.format == VK_FORMAT_UNDEFINED)
+        return false;
+
+    const ResourceID l_CopyID = l_Device.createImage(l_Config);
+    VulkanImage& l_Copy = l_Device.getImage(l_CopyID);
+    l_Copy.setQueue(l_Image.getQueue());
+    VULKAN_TRY(vmaBindImageMemory(*l_Device.getMemoryAllocator(), p_Move.dstTmpAllocation, *l_Copy));
+
+    // Undefined contents have nothing worth copying
+    const VkImageLayout l_Layout = l_Image.getLayout();
+    if (l_Layout != VK_IMAGE_LAYOUT_UNDEFINED)
+    {
+        VulkanMemoryBarrierBuilder l_Before{m_Device, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0};
+        l_Before.addImageMemoryBarrier(l_Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_QUEUE_FAMILY_IGNORED, VK_ACCESS_MEMORY_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+        l_Before.addImageMemoryBarrier(l_Copy, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_QUEUE_FAMILY_IGNORED, 0, VK_ACCESS_TRANSFER_WRITE_BIT);
+        p_CommandBuffer.cmdPipelineBarrier(l_Before);
+        l_Image.setLayout(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+        l_Copy.setLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+        // One region per mip level, each covering every array layer
+        TRANS_VECTOR(l_Regions, VkImageCopy);
+        for (uint32_t i = 0; i < l_Config.mipLevels; i++)
+        {
+            VkImageCopy l_Region{};
+            l_Region.srcSubresource = {l_Image.getAspectFlags(), i, 0, l_Config.arrayLayers};
+            l_Region.dstSubresource = l_Region.srcSubresource;
+            l_Region.extent = {std::max(l_Config.extent.width >> i, 1u), std::max(l_Config.extent.height >> i, 1u), std::max(l_Config.extent.depth >> i, 1u)};
+            l_Regions.push_back(l_Region);
+        }
+        p_CommandBuffer.cmdCopyImage(p_Image, l_CopyID, l_Regions);
+
+        VulkanMemoryBarrierBuilder l_After{m_Device, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0};
+        l_After.addImageMemoryBarrier(l_Image, l_Layout, VK_QUEUE_FAMILY_IGNORED, 0, VK_ACCESS_MEMORY_READ_BIT);
+        l_After.addImageMemoryBarrier(l_Copy, l_Layout, VK_QUEUE_FAMILY_IGNORED, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT);
+        p_CommandBuffer.cmdPipelineBarrier(l_After);
+        l_Image.setLayout(l_Layout);
+        l_Copy.setLayout(l_Layout);
+    }
+
+    m_Moves.push_back({p_Image, l_CopyID, true});
+    return true;
+}
+
+void VulkanDefragmenter::swapMoved()
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+
+    std::vector<uint64_t> l_OldHandles;
+    for (const Move& l_Move : m_Moves)
+    {
+        if (l_Move.image)
+        {
+            VulkanImage& l_Copy = l_Device.getImage(l_Move.copy);
+            l_Device.getImage(l_Move.resource).swapHandle(l_Copy);
+            for (const VulkanImageView* l_View : l_Copy.m_ImageViews)
+            {
+                l_OldHandles.push_back(reinterpret_cast<uint64_t>(**l_View));
+            }
+        }
+        else
+        {
+            VulkanBuffer& l_Copy = l_Device.getBuffer(l_Move.copy);
+            l_Device.getBuffer(l_Move.resource).swapHandle(l_Copy);
+            l_OldHandles.push_back(reinterpret_cast<uint64_t>(*l_Copy));
+        }
+    }
+
+    l_Device.flagDescriptorSetsReferencing(l_OldHandles);
+    if (m_RelocationCallback)
+    {
+        for (const Move& l_Move : m_Moves)
+        {
+            m_RelocationCallback(l_Move.resource);
+        }
+    }
+}
+
+void VulkanDefragmenter::endPass()
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    const VkResult l_Result = vmaEndDefragmentationPass(*l_Device.getMemoryAllocator(), m_Context, &m_Pass);
+
+    // VMA moved the allocations themselves, the copies only carry the old handles now and own no memory
+    for (const Move& l_Move : m_Moves)
+    {
+        if (l_Move.image)
+        {
+            l_Device.freeImage(l_Move.copy);
+            l_Device.getImage(l_Move.resource).updateMappingState();
+        }
+        else
+        {
+            l_Device.freeBuffer(l_Move.copy);
+            l_Device.getBuffer(l_Move.resource).updateMappingState();
+        }
+    }
+    m_Moves.clear();
+    m_Pass = {};
+
+    if (l_Result == VK_SUCCESS)
+        finish();
+    else
+        m_State = State::READY;
+}
+
+void VulkanDefragmenter::finish()
+{
+    VmaDefragmentationStats l_Stats{};
+    vmaEndDefragmentation(*VulkanContext::getDevice(m_Device).getMemoryAllocator(), m_Context, &l_Stats);
+    m_Context = VK_NULL_HANDLE;
+    m_State = State::IDLE;
+
+    m_Stats.bytesMoved = l_Stats.bytesMoved;
+    m_Stats.bytesFreed = l_Stats.bytesFreed;
+    m_Stats.allocationsMoved = l_Stats.allocationsMoved;
+    m_Stats.blocksFreed = l_Stats.deviceMemoryBlocksFreed;
+    LOG_DEBUG("Defragmentation finished after ", m_Stats.passes, " passes, moved ", m_Stats.allocationsMoved, " allocations (", VulkanMemoryAllocator::compactBytes(m_Stats.bytesMoved), ") and freed ", VulkanMemoryAllocator::compactBytes(m_Stats.bytesFreed));
+}
@@ -0,0 +1,260 @@
+#include "vulkan_descriptor_allocator.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+#include "utils/logger.hpp"
+#include "vulkan_device.hpp"
+
+VulkanDescriptorAllocator::VulkanDescriptorAllocator(const ResourceID p_Device, const Config& p_Config)
+    : m_Device(p_Device), m_Config(p_Config)
+{
+    m_Config.initialSetsPerPool = std::max(m_Config.initialSetsPerPool, 1u);
+    m_Config.maxSetsPerPool = std::max(m_Config.maxSetsPerPool, m_Config.initialSetsPerPool);
+}
+
+void VulkanDescriptorAllocator::beginFrame(const ResourceID p_Fence)
+{
+    // Pools only ever hold sets of one frame, so the frame being closed takes every current pool with it
+    for (uint32_t i = 0; i < m_Classes.size(); i++)
+    {
+        if (m_Classes[i].current.pool != UINT32_MAX)
+            m_Current.pools.push_back({i, m_Classes[i].current});
+        m_Classes[i].current = {};
+    }
+
+    if (m_Current.fence != UINT32_MAX)
+        m_Pending.push_back(std::move(m_Current));
+    m_Current = {p_Fence, {}};
+    m_FrameSetCount = 0;
+
+    // Reusing a fence means the caller already waited on it and reset it, polling it now would never succeed
+    const auto l_Reused = std::ranges::find(m_Pending, p_Fence, &Frame::fence);
+    if (l_Reused != m_Pending.end())
+    {
+        const auto l_End = std::next(l_Reused);
+        std::for_each(m_Pending.begin(), l_End, [this](Frame& p_Frame) { releaseFrame(p_Frame); });
+        m_Pending.erase(m_Pending.begin(), l_End);
+    }
+
+    reclaim();
+
+    while (m_Pending.size() > m_Config.framesInFlight)
+    {
+        VulkanContext::getDevice(m_Device).getFence(m_Pending.front().fence).wait();
+        releaseFrame(m_Pending.front());
+        m_Pending.pop_front();
+    }
+}
+
+void VulkanDescriptorAllocator::allocate(const std::span<const ResourceID> p_Layouts, VkDescriptorSet* p_Sets)
+{
+    if (m_Current.fence == UINT32_MAX)
+    {
+        throw std::runtime_error("Tried to allocate descriptor sets before the first beginFrame (device ID:" + std::to_string(m_Device) + ")");
+    }
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+
+    TRANS_VECTOR(l_Classes, uint32_t);
+    l_Classes.reserve(p_Layouts.size());
+    for (const ResourceID l_Layout : p_Layouts)
+    {
+        l_Classes.push_back(getLayoutClass(l_Layout));
+    }
+
+    TRANS_VECTOR(l_Targets, uint32_t);
+    TRANS_VECTOR(l_Handles, VkDescriptorSetLayout);
+    TRANS_VECTOR(l_Sets, VkDescriptorSet);
+    l_Targets.reserve(p_Layouts.size());
+    l_Handles.reserve(p_Layouts.size());
+    l_Sets.reserve(p_Layouts.size());
+
+    for (uint32_t i = 0; i < p_Layouts.size(); i++)
+    {
+        const uint32_t l_Class = l_Classes[i];
+        // Each class is handled when it first shows up, together with every later layout of the same class
+        if (std::find(l_Classes.begin(), l_Classes.begin() + i, l_Class) != l_Classes.begin() + i)
+            continue;
+
+        l_Targets.clear();
+        l_Handles.clear();
+        for (uint32_t j = i; j < p_Layouts.size(); j++)
+        {
+            if (l_Classes[j] != l_Class)
+                continue;
+            l_Targets.push_back(j);
+            l_Handles.push_back(*l_Device.getDescriptorSetLayout(p_Layouts[j]));
+        }
+        l_Sets.resize(l_Handles.size());
+
+        uint32_t l_Done = 0;
+        bool l_FreshPool = false;
+        while (l_Done < l_Handles.size())
+        {
+            if (m_Classes[l_Class].current.setsLeft == 0)
+            {
+                nextPool(l_Class);
+                l_FreshPool = true;
+            }
+
+            Pool& l_Pool = m_Classes[l_Class].current;
+            const uint32_t l_Count = std::min(static_cast<uint32_t>(l_Handles.size()) - l_Done, l_Pool.setsLeft);
+
+            VkDescriptorSetAllocateInfo l_AllocInfo{};
+            l_AllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            l_AllocInfo.descriptorPool = *l_Device.getDescriptorPool(l_Pool.pool);
+            l_AllocInfo.descriptorSetCount = l_Count;
+            l_AllocInfo.pSetLayouts = l_Handles.data() + l_Done;
+
+            const VkResult l_Result = l_Device.getTable().vkAllocateDescriptorSets(*l_Device, &l_AllocInfo, l_Sets.data() + l_Done);
+            if (l_Result == VK_ERROR_OUT_OF_POOL_MEMORY || l_Result == VK_ERROR_FRAGMENTED_POOL)
+            {
+                if (l_FreshPool)
+                {
+                    throw std::runtime_error("Descriptor sets don't fit in a fresh pool of " + std::to_string(l_Pool.maxSets) + " sets (device ID:" + std::to_string(m_Device) + ")");
+                }
+                l_Pool.setsLeft = 0;
+                continue;
+            }
+            if (l_Result != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to allocate " + std::to_string(l_Count) + " descriptor sets, error " + std::to_string(l_Result) + " (device ID:" + std::to_string(m_Device) + ")");
+            }
+
+            l_Pool.setsLeft -= l_Count;
+            l_Done += l_Count;
+            l_FreshPool = false;
+        }
+
+        for (uint32_t j = 0; j < l_Targets.size(); j++)
+        {
+            p_Sets[l_Targets[j]] = l_Sets[j];
+        }
+    }
+    m_FrameSetCount += static_cast<uint32_t>(p_Layouts.size());
+}
+
+VkDescriptorSet VulkanDescriptorAllocator::allocate(const ResourceID p_Layout)
+{
+    VkDescriptorSet l_Set = VK_NULL_HANDLE;
+    allocate({&p_Layout, 1}, &l_Set);
+    return l_Set;
+}
+
+void VulkanDescriptorAllocator::free()
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+
+    for (const Frame& l_Frame : m_Pending)
+    {
+        l_Device.getFence(l_Frame.fence).wait();
+    }
+    // The frame being recorded was never submitted, or the caller already waited for it
+    m_Pending.push_back(std::move(m_Current));
+    m_Current = {UINT32_MAX, {}};
+
+    // Every pool is either held by a frame, current in its class or free
+    for (const Frame& l_Frame : m_Pending)
+    {
+        for (const UsedPool& l_Used : l_Frame.pools)
+            l_Device.freeDescriptorPool(l_Used.pool.pool);
+    }
+    for (LayoutClass& l_Class : m_Classes)
+    {
+        if (l_Class.current.pool != UINT32_MAX)
+            l_Device.freeDescriptorPool(l_Class.current.pool);
+        for (const Pool& l_Pool : l_Class.freePools)
+            l_Device.freeDescriptorPool(l_Pool.pool);
+    }
+
+    LOG_DEBUG("Freed descriptor allocator with ", m_PoolCount, " pool(s) across ", m_Classes.size(), " layout class(es)");
+    m_Pending.clear();
+    m_Classes.clear();
+    m_LayoutClasses.clear();
+    m_PoolCount = 0;
+    m_FrameSetCount = 0;
+}
+
+uint32_t VulkanDescriptorAllocator::getLayoutClass(const ResourceID p_Layout)
+{
+    const auto l_Known = m_LayoutClasses.find(p_Layout);
+    if (l_Known != m_LayoutClasses.end())
+        return l_Known->second;
+
+    const VulkanDescriptorSetLayout& l_Layout = VulkanContext::getDevice(m_Device).getDescriptorSetLayout(p_Layout);
+    const std::vector<VkDescriptorPoolSize>& l_PerSet = l_Layout.getPoolSizes();
+    const VkDescriptorPoolCreateFlags l_PoolFlags = (l_Layout.getFlags() & VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT) ? VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT : 0;
+
+    const auto l_SameSizes = [](const VkDescriptorPoolSize& p_A, const VkDescriptorPoolSize& p_B)
+    {
+        return p_A.type == p_B.type && p_A.descriptorCount == p_B.descriptorCount;
+    };
+
+    uint32_t l_Class = 0;
+    for (; l_Class < m_Classes.size(); l_Class++)
+    {
+        if (m_Classes[l_Class].poolFlags == l_PoolFlags && std::ranges::equal(m_Classes[l_Class].perSet, l_PerSet, l_SameSizes))
+            break;
+    }
+    if (l_Class == m_Classes.size())
+    {
+        m_Classes.push_back({l_PerSet, l_PoolFlags, m_Config.initialSetsPerPool, {}, {}});
+        LOG_DEBUG("Descriptor allocator created layout class ", l_Class, " with ", l_PerSet.size(), " descriptor type(s) per set");
+    }
+
+    m_LayoutClasses.emplace(p_Layout, l_Class);
+    return l_Class;
+}
+
+void VulkanDescriptorAllocator::nextPool(const uint32_t p_Class)
+{
+    LayoutClass& l_Class = m_Classes[p_Class];
+    if (l_Class.current.pool != UINT32_MAX)
+        m_Current.pools.push_back({p_Class, l_Class.current});
+
+    if (!l_Class.freePools.empty())
+    {
+        l_Class.current = l_Class.freePools.back();
+        l_Class.freePools.pop_back();
+        return;
+    }
+
+    const uint32_t l_MaxSets = l_Class.nextPoolSets;
+    l_Class.nextPoolSets = std::min(l_MaxSets * 2, m_Config.maxSetsPerPool);
+
+    TRANS_VECTOR(l_Sizes, VkDescriptorPoolSize);
+    l_Sizes.reserve(l_Class.perSet.size());
+    for (const VkDescriptorPoolSize& l_Size : l_Class.perSet)
+    {
+        l_Sizes.push_back({l_Size.type, l_Size.descriptorCount * l_MaxSets});
+    }
+
+    const ResourceID l_Pool = VulkanContext::getDevice(m_Device).createDescriptorPool(l_Sizes, l_MaxSets, l_Class.poolFlags);
+    l_Class.current = {l_Pool, l_MaxSets, l_MaxSets};
+    m_PoolCount++;
+}
+
+void VulkanDescriptorAllocator::releaseFrame(Frame& p_Frame)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    for (UsedPool& l_Used : p_Frame.pools)
+    {
+        l_Device.getDescriptorPool(l_Used.pool.pool).reset();
+        l_Used.pool.setsLeft = l_Used.pool.maxSets;
+        m_Classes[l_Used.layoutClass].freePools.push_back(l_Used.pool);
+    }
+    p_Frame.pools.clear();
+}
+
+void VulkanDescriptorAllocator::reclaim()
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    while (!m_Pending.empty() && l_Device.getFence(m_Pending.front().fence).poll())
+    {
+        releaseFrame(m_Pending.front());
+        m_Pending.pop_front();
+    }
+}
@@ -0,0 +1,177 @@
+#include "vulkan_descriptor_buffer.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <vulkan/vk_enum_string_helper.h>
+
+#include "ext/vulkan_buffer_device_address.hpp"
+#include "ext/vulkan_descriptor_buffer.hpp"
+#include "utils/logger.hpp"
+#include "vulkan_device.hpp"
+
+VulkanDescriptorBuffer::VulkanDescriptorBuffer(const ResourceID p_Device, const Config& p_Config)
+    : m_Device(p_Device), m_Config(p_Config)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    const VulkanDescriptorBufferExtension* l_Extension = VulkanDescriptorBufferExtension::get(l_Device);
+    if (l_Extension == nullptr || VulkanBufferDeviceAddressExtension::get(l_Device) == nullptr)
+    {
+        throw std::runtime_error("Tried to create a descriptor buffer on device (ID:" + std::to_string(m_Device) + ") without descriptor buffers and buffer device addresses enabled");
+    }
+
+    const VkPhysicalDeviceDescriptorBufferPropertiesEXT& l_Properties = l_Extension->getProperties();
+    const VkDeviceSize l_MaxRange = m_Config.samplers ? l_Properties.maxSamplerDescriptorBufferRange : l_Properties.maxResourceDescriptorBufferRange;
+    if (m_Config.size > l_MaxRange)
+    {
+        LOG_WARN("Descriptor buffer asked for ", m_Config.size, " bytes, device (ID:", m_Device, ") only addresses ", l_MaxRange);
+        m_Config.size = l_MaxRange;
+    }
+    m_Alignment = l_Properties.descriptorBufferOffsetAlignment;
+
+    m_Usage = VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | (m_Config.samplers ? VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT : VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT);
+    constexpr VulkanMemoryAllocator::MemoryPreferences PREFS{
+        .usage = VMA_MEMORY_USAGE_AUTO,
+        .vmaFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+        .preferredProperties = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    };
+    m_Buffer = l_Device.createAndAllocateBuffer(PREFS, {m_Config.size, m_Usage});
+
+    const VulkanBuffer& l_Buffer = l_Device.getBuffer(m_Buffer);
+    m_Mapped = static_cast<uint8_t*>(l_Buffer.getMappedData());
+    m_Address = l_Buffer.getDeviceAddress();
+
+    LOG_DEBUG("Created ", m_Config.samplers ? "sampler" : "resource", " descriptor buffer (buffer ID:", m_Buffer, ") of ", VulkanMemoryAllocator::compactBytes(m_Config.size));
+}
+
+VkDeviceSize VulkanDescriptorBuffer::allocateSet(const ResourceID p_Layout)
+{
+    const VkDeviceSize l_Size = VulkanContext::getDevice(m_Device).getDescriptorSetLayout(p_Layout).getDescriptorBufferSize();
+    const VkDeviceSize l_Offset = (m_Used + m_Alignment - 1) / m_Alignment * m_Alignment;
+    if (l_Offset + l_Size > m_Config.size)
+        return INVALID_OFFSET;
+
+    m_Used = l_Offset + l_Size;
+    return l_Offset;
+}
+
+void VulkanDescriptorBuffer::reset()
+{
+    m_Used = 0;
+}
+
+void VulkanDescriptorBuffer::writeImage(const VkDeviceSize p_Set, const ResourceID p_Layout, const uint32_t p_Binding, const VkDescriptorType p_Type, const VkDescriptorImageInfo& p_Info,
+                                        const uint32_t p_ArrayElement) const
+{
+    VkDescriptorGetInfoEXT l_Info{};
+    l_Info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT;
+    l_Info.type = p_Type;
+    switch (p_Type)
+    {
+    case VK_DESCRIPTOR_TYPE_SAMPLER:
+        l_Info.data.pSampler = &p_Info.sampler;
+        break;
+    case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+        l_Info.data.pCombinedImageSampler = &p_Info;
+        break;
+    case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+        l_Info.data.pSampledImage = &p_Info;
+        break;
+    case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+        l_Info.data.pStorageImage = &p_Info;
+        break;
+    case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+        l_Info.data.pInputAttachmentImage = &p_Info;
+        break;
+    default:
+        throw std::runtime_error(std::string("Descriptor type ") + string_VkDescriptorType(p_Type) + " is not an image descriptor (buffer ID:" + std::to_string(m_Buffer) + ")");
+    }
+    write(p_Set, p_Layout, p_Binding, p_ArrayElement, l_Info);
+}
+
+void VulkanDescriptorBuffer::writeBuffer(const VkDeviceSize p_Set, const ResourceID p_Layout, const uint32_t p_Binding, const VkDescriptorType p_Type, const ResourceID p_Buffer,
+                                         const VkDeviceSize p_Offset, const VkDeviceSize p_Range, const uint32_t p_ArrayElement) const
+{
+    if (p_Type != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER && p_Type != VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+    {
+        throw std::runtime_error(std::string("Descriptor type ") + string_VkDescriptorType(p_Type) + " is not a buffer descriptor a descriptor buffer can hold (buffer ID:" + std::to_string(m_Buffer) + ")");
+    }
+    writeAddress(p_Set, p_Layout, p_Binding, p_Type, p_Buffer, VK_FORMAT_UNDEFINED, p_Offset, p_Range, p_ArrayElement);
+}
+
+void VulkanDescriptorBuffer::writeTexelBuffer(const VkDeviceSize p_Set, const ResourceID p_Layout, const uint32_t p_Binding, const VkDescriptorType p_Type, const ResourceID p_Buffer,
+                                              const VkFormat p_Format, const VkDeviceSize p_Offset, const VkDeviceSize p_Range, const uint32_t p_ArrayElement) const
+{
+    if (p_Type != VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER && p_Type != VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER)
+    {
+        throw std::runtime_error(std::string("Descriptor type ") + string_VkDescriptorType(p_Type) + " is not a texel buffer descriptor (buffer ID:" + std::to_string(m_Buffer) + ")");
+    }
+    writeAddress(p_Set, p_Layout, p_Binding, p_Type, p_Buffer, p_Format, p_Offset, p_Range, p_ArrayElement);
+}
+
+void VulkanDescriptorBuffer::writeAddress(const VkDeviceSize p_Set, const ResourceID p_Layout, const uint32_t p_Binding, const VkDescriptorType p_Type, const ResourceID p_Buffer,
+                                          const VkFormat p_Format, const VkDeviceSize p_Offset, const VkDeviceSize p_Range, const uint32_t p_ArrayElement) const
+{
+    const VulkanBuffer& l_Buffer = VulkanContext::getDevice(m_Device).getBuffer(p_Buffer);
+
+    // Address descriptors have no notion of the whole buffer, the range has to be spelled out
+    VkDescriptorAddressInfoEXT l_Address{};
+    l_Address.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT;
+    l_Address.address = l_Buffer.getDeviceAddress() + p_Offset;
+    l_Address.range = p_Range == VK_WHOLE_SIZE ? l_Buffer.getSize() - p_Offset : p_Range;
+    l_Address.format = p_Format;
+
+    VkDescriptorGetInfoEXT l_Info{};
+    l_Info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT;
+    l_Info.type = p_Type;
+    switch (p_Type)
+    {
+    case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+        l_Info.data.pUniformBuffer = &l_Address;
+        break;
+    case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+        l_Info.data.pStorageBuffer = &l_Address;
+        break;
+    case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+        l_Info.data.pUniformTexelBuffer = &l_Address;
+        break;
+    default:
+        l_Info.data.pStorageTexelBuffer = &l_Address;
+        break;
+    }
+    write(p_Set, p_Layout, p_Binding, p_ArrayElement, l_Info);
+}
+
+void VulkanDescriptorBuffer::write(const VkDeviceSize p_Set, const ResourceID p_Layout, const uint32_t p_Binding, const uint32_t p_ArrayElement, const VkDescriptorGetInfoEXT& p_Info) const
+{
+    const VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    const size_t l_Size = VulkanDescriptorBufferExtension::get(l_Device)->getDescriptorSize(p_Info.type);
+    const VkDeviceSize l_Offset = p_Set + l_Device.getDescriptorSetLayout(p_Layout).getDescriptorBufferOffset(p_Binding) + p_ArrayElement * l_Size;
+    if (l_Offset + l_Size > m_Config.size)
+    {
+        throw std::runtime_error("Descriptor write at offset " + std::to_string(l_Offset) + " runs past the end of descriptor buffer (buffer ID:" + std::to_string(m_Buffer) + ")");
+    }
+
+    l_Device.getTable().vkGetDescriptorEXT(*l_Device, &p_Info, l_Size, m_Mapped + l_Offset);
+    l_Device.getBuffer(m_Buffer).markDirty(l_Offset, l_Size);
+}
+
+VkDescriptorBufferBindingInfoEXT VulkanDescriptorBuffer::getBindingInfo() const
+{
+    VkDescriptorBufferBindingInfoEXT l_Info{};
+    l_Info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT;
+    l_Info.address = m_Address;
+    l_Info.usage = m_Usage;
+    return l_Info;
+}
+
+void VulkanDescriptorBuffer::free()
+{
+    if (m_Buffer != UINT32_MAX)
+    {
+        VulkanContext::getDevice(m_Device).freeBuffer(m_Buffer);
+        m_Buffer = UINT32_MAX;
+    }
+    m_Mapped = nullptr;
+    m_Address = 0;
+    m_Used = 0;
+}
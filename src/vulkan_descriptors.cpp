@@ -1,8 +1,11 @@
 #include "vulkan_descriptors.hpp"
 
+#include <cstring>
+#include <stdexcept>
 #include <vulkan/vk_enum_string_helper.h>
 
 #include "utils/logger.hpp"
+#include "vulkan_base.hpp"
 #include "vulkan_context.hpp"
 #include "vulkan_device.hpp"
 
@@ -22,6 +25,12 @@ void VulkanDescriptorPool::free()
     }
 }
 
+void VulkanDescriptorPool::reset() const
+{
+    const VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
+    VULKAN_TRY(l_Device.getTable().vkResetDescriptorPool(l_Device.m_VkHandle, m_VkHandle, 0));
+}
+
 VulkanDescriptorPool::VulkanDescriptorPool(const ResourceID p_Device, const VkDescriptorPool p_DescriptorPool, const VkDescriptorPoolCreateFlags p_Flags)
     : VulkanDeviceSubresource(p_Device), m_VkHandle(p_DescriptorPool), m_Flags(p_Flags) {}
 
@@ -38,6 +47,54 @@ void VulkanDescriptorSetLayout::free()
         VulkanContext::getDevice(getDeviceID()).getTable().vkDestroyDescriptorSetLayout(VulkanContext::getDevice(getDeviceID()).m_VkHandle, m_VkHandle, nullptr);
         m_VkHandle = VK_NULL_HANDLE;
     }
+    for (const ResourceID l_Sampler : m_ImmutableSamplers)
+    {
+        VulkanContext::getDevice(getDeviceID()).releaseSampler(l_Sampler);
+    }
+    m_ImmutableSamplers.clear();
+}
+
+VkDeviceSize VulkanDescriptorSetLayout::getDescriptorBufferSize() const
+{
+    if (m_DescriptorBufferSize == UINT64_MAX)
+    {
+        if ((m_Flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT) == 0)
+        {
+            throw std::runtime_error("Descriptor set layout (ID:" + std::to_string(m_ID) + ") was not created for descriptor buffers");
+        }
+
+        const VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
+        VkDeviceSize l_Size;
+        l_Device.getTable().vkGetDescriptorSetLayoutSizeEXT(l_Device.m_VkHandle, m_VkHandle, &l_Size);
+        m_DescriptorBufferOffsets.resize(m_Bindings.size());
+        for (uint32_t i = 0; i < m_Bindings.size(); i++)
+        {
+            l_Device.getTable().vkGetDescriptorSetLayoutBindingOffsetEXT(l_Device.m_VkHandle, m_VkHandle, m_Bindings[i].binding, &m_DescriptorBufferOffsets[i]);
+        }
+        m_DescriptorBufferSize = l_Size;
+    }
+    return m_DescriptorBufferSize;
+}
+
+bool VulkanDescriptorSetLayout::hasImmutableSamplers(const uint32_t p_Binding) const
+{
+    for (uint32_t i = 0; i < m_Bindings.size(); i++)
+    {
+        if (m_Bindings[i].binding == p_Binding)
+            return m_HasImmutableSamplers[i];
+    }
+    return false;
+}
+
+VkDeviceSize VulkanDescriptorSetLayout::getDescriptorBufferOffset(const uint32_t p_Binding) const
+{
+    getDescriptorBufferSize();
+    for (uint32_t i = 0; i < m_Bindings.size(); i++)
+    {
+        if (m_Bindings[i].binding == p_Binding)
+            return m_DescriptorBufferOffsets[i];
+    }
+    throw std::runtime_error("Descriptor set layout (ID:" + std::to_string(m_ID) + ") has no binding " + std::to_string(p_Binding));
 }
 
 VulkanDescriptorSetLayout::VulkanDescriptorSetLayout(const ResourceID p_Device, const VkDescriptorSetLayout p_DescriptorSetLayout)
@@ -53,6 +110,54 @@ void VulkanDescriptorSet::updateDescriptorSet(const VkWriteDescriptorSet& p_Writ
     LOG_DEBUG("Updating descriptor set (ID: ", m_ID, ")");
     LOG_DEBUG("  Update info: descriptor type: ", string_VkDescriptorType(p_WriteDescriptorSet.descriptorType));
     VulkanContext::getDevice(getDeviceID()).getTable().vkUpdateDescriptorSets(VulkanContext::getDevice(getDeviceID()).m_VkHandle, 1, &p_WriteDescriptorSet, 0, nullptr);
+    recordWrite(p_WriteDescriptorSet);
+}
+
+void VulkanDescriptorSet::recordWrite(const VkWriteDescriptorSet& p_WriteDescriptorSet) const
+{
+    for (uint32_t i = 0; i < p_WriteDescriptorSet.descriptorCount; i++)
+    {
+        const uint64_t l_Slot = static_cast<uint64_t>(p_WriteDescriptorSet.dstBinding) << 32 | (p_WriteDescriptorSet.dstArrayElement + i);
+        // Only the info array matching the type is valid, the others may hold anything
+        uint64_t l_Handle = 0;
+        switch (p_WriteDescriptorSet.descriptorType)
+        {
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+            l_Handle = reinterpret_cast<uint64_t>(p_WriteDescriptorSet.pBufferInfo[i].buffer);
+            break;
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+        case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+            l_Handle = reinterpret_cast<uint64_t>(p_WriteDescriptorSet.pImageInfo[i].imageView);
+            break;
+        default:
+            break;
+        }
+
+        m_StaleSlots.erase(l_Slot);
+        if (l_Handle != 0)
+            m_SlotHandles[l_Slot] = l_Handle;
+        else
+            m_SlotHandles.erase(l_Slot);
+    }
+}
+
+bool VulkanDescriptorSet::markHandleMoved(const uint64_t p_Handle)
+{
+    bool l_Referenced = false;
+    for (const auto& [l_Slot, l_Handle] : m_SlotHandles)
+    {
+        if (l_Handle == p_Handle)
+        {
+            m_StaleSlots.insert(l_Slot);
+            l_Referenced = true;
+        }
+    }
+    return l_Referenced;
 }
 
 void VulkanDescriptorSet::free()
@@ -61,6 +166,11 @@ void VulkanDescriptorSet::free()
     {
         VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
 
+        // A reset pool may have handed this handle to a newer set already
+        const auto l_It = l_Device.m_DescriptorSetsByHandle.find(m_VkHandle);
+        if (l_It != l_Device.m_DescriptorSetsByHandle.end() && l_It->second == m_ID)
+            l_Device.m_DescriptorSetsByHandle.erase(l_It);
+
         if (!m_CanBeFreed)
         {
             return;
@@ -73,3 +183,218 @@ void VulkanDescriptorSet::free()
 
 VulkanDescriptorSet::VulkanDescriptorSet(const uint32_t p_Device, const uint32_t p_Pool, const VkDescriptorSet p_DescriptorSet)
     : VulkanDeviceSubresource(p_Device), m_VkHandle(p_DescriptorSet), m_Pool(p_Pool), m_CanBeFreed((VulkanContext::getDevice(getDeviceID()).getDescriptorPool(p_Pool).m_Flags & VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT) != 0) {}
+
+static bool isImageDescriptor(const VkDescriptorType p_Type)
+{
+    return p_Type == VK_DESCRIPTOR_TYPE_SAMPLER || p_Type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER || p_Type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE
+        || p_Type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE || p_Type == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+}
+
+static bool isBufferDescriptor(const VkDescriptorType p_Type)
+{
+    return p_Type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || p_Type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+        || p_Type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC || p_Type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+}
+
+VkDescriptorUpdateTemplate VulkanDescriptorUpdateTemplate::operator*() const
+{
+    return m_VkHandle;
+}
+
+uint32_t VulkanDescriptorUpdateTemplate::getOffset(const uint32_t p_Binding, const uint32_t p_ArrayElement) const
+{
+    for (const Entry& l_Entry : m_Entries)
+    {
+        if (l_Entry.binding == p_Binding && p_ArrayElement < l_Entry.count)
+            return l_Entry.offset + p_ArrayElement * l_Entry.stride;
+    }
+    return UINT32_MAX;
+}
+
+void VulkanDescriptorUpdateTemplate::setImage(void* p_Data, const uint32_t p_Binding, const VkDescriptorImageInfo& p_Info, const uint32_t p_ArrayElement) const
+{
+    setDescriptor(p_Data, p_Binding, p_ArrayElement, &p_Info, sizeof(VkDescriptorImageInfo));
+}
+
+void VulkanDescriptorUpdateTemplate::setBuffer(void* p_Data, const uint32_t p_Binding, const VkDescriptorBufferInfo& p_Info, const uint32_t p_ArrayElement) const
+{
+    setDescriptor(p_Data, p_Binding, p_ArrayElement, &p_Info, sizeof(VkDescriptorBufferInfo));
+}
+
+void VulkanDescriptorUpdateTemplate::setTexelBuffer(void* p_Data, const uint32_t p_Binding, const VkBufferView p_View, const uint32_t p_ArrayElement) const
+{
+    setDescriptor(p_Data, p_Binding, p_ArrayElement, &p_View, sizeof(VkBufferView));
+}
+
+void VulkanDescriptorUpdateTemplate::setDescriptor(void* p_Data, const uint32_t p_Binding, const uint32_t p_ArrayElement, const void* p_Descriptor, const uint32_t p_Size) const
+{
+    const uint32_t l_Offset = getOffset(p_Binding, p_ArrayElement);
+    if (l_Offset == UINT32_MAX)
+    {
+        throw std::runtime_error("Descriptor update template does not write binding " + std::to_string(p_Binding) + " element " + std::to_string(p_ArrayElement) + " (ID:" + std::to_string(m_ID) + ")");
+    }
+    std::memcpy(static_cast<uint8_t*>(p_Data) + l_Offset, p_Descriptor, p_Size);
+}
+
+void VulkanDescriptorUpdateTemplate::update(const VkDescriptorSet p_Set, const void* p_Data) const
+{
+    const VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
+    l_Device.getTable().vkUpdateDescriptorSetWithTemplate(l_Device.m_VkHandle, p_Set, m_VkHandle, p_Data);
+}
+
+void VulkanDescriptorUpdateTemplate::update(const ResourceID p_Set, const void* p_Data) const
+{
+    const VulkanDescriptorSet& l_Set = VulkanContext::getDevice(getDeviceID()).getDescriptorSet(p_Set);
+    update(l_Set.m_VkHandle, p_Data);
+
+    for (const Entry& l_Entry : m_Entries)
+    {
+        VkWriteDescriptorSet l_Write{};
+        l_Write.dstBinding = l_Entry.binding;
+        l_Write.descriptorCount = l_Entry.count;
+        l_Write.descriptorType = l_Entry.type;
+        const void* l_Infos = static_cast<const uint8_t*>(p_Data) + l_Entry.offset;
+        if (isImageDescriptor(l_Entry.type))
+            l_Write.pImageInfo = static_cast<const VkDescriptorImageInfo*>(l_Infos);
+        else if (isBufferDescriptor(l_Entry.type))
+            l_Write.pBufferInfo = static_cast<const VkDescriptorBufferInfo*>(l_Infos);
+        else
+            continue;
+        l_Set.recordWrite(l_Write);
+    }
+}
+
+uint32_t VulkanDescriptorUpdateTemplate::getDescriptorStride(const VkDescriptorType p_Type)
+{
+    if (isImageDescriptor(p_Type))
+        return sizeof(VkDescriptorImageInfo);
+    if (isBufferDescriptor(p_Type))
+        return sizeof(VkDescriptorBufferInfo);
+
+    switch (p_Type)
+    {
+    case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+    case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+        return sizeof(VkBufferView);
+    case VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR:
+        return sizeof(VkAccelerationStructureKHR);
+    case VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK:
+        return 1;
+    default:
+        throw std::runtime_error(std::string("Descriptor type ") + string_VkDescriptorType(p_Type) + " can't be written through an update template");
+    }
+}
+
+void VulkanDescriptorUpdateTemplate::free()
+{
+    if (m_VkHandle != VK_NULL_HANDLE)
+    {
+        LOG_DEBUG("Freeing descriptor update template (ID: ", m_ID, ")");
+        const VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
+        l_Device.getTable().vkDestroyDescriptorUpdateTemplate(l_Device.m_VkHandle, m_VkHandle, nullptr);
+        m_VkHandle = VK_NULL_HANDLE;
+    }
+    m_Entries.clear();
+}
+
+VulkanDescriptorUpdateTemplate::VulkanDescriptorUpdateTemplate(const ResourceID p_Device, const VkDescriptorUpdateTemplate p_Template, const ResourceID p_Layout, std::vector<Entry>&& p_Entries, const uint32_t p_DataSize)
+    : VulkanDeviceSubresource(p_Device), m_VkHandle(p_Template), m_Layout(p_Layout), m_Entries(std::move(p_Entries)), m_DataSize(p_DataSize) {}
+
+VulkanDescriptorWriteBatcher::VulkanDescriptorWriteBatcher(const ResourceID p_Device)
+    : m_Device(p_Device) {}
+
+void VulkanDescriptorWriteBatcher::writeImages(const VkDescriptorSet p_Set, const uint32_t p_Binding, const VkDescriptorType p_Type, const std::span<const VkDescriptorImageInfo> p_Infos, const uint32_t p_ArrayElement)
+{
+    const uint32_t l_First = static_cast<uint32_t>(m_ImageInfos.size());
+    m_ImageInfos.insert(m_ImageInfos.end(), p_Infos.begin(), p_Infos.end());
+    queue(p_Set, p_Binding, p_Type, InfoKind::IMAGE, l_First, static_cast<uint32_t>(p_Infos.size()), p_ArrayElement);
+}
+
+void VulkanDescriptorWriteBatcher::writeBuffers(const VkDescriptorSet p_Set, const uint32_t p_Binding, const VkDescriptorType p_Type, const std::span<const VkDescriptorBufferInfo> p_Infos, const uint32_t p_ArrayElement)
+{
+    const uint32_t l_First = static_cast<uint32_t>(m_BufferInfos.size());
+    m_BufferInfos.insert(m_BufferInfos.end(), p_Infos.begin(), p_Infos.end());
+    queue(p_Set, p_Binding, p_Type, InfoKind::BUFFER, l_First, static_cast<uint32_t>(p_Infos.size()), p_ArrayElement);
+}
+
+void VulkanDescriptorWriteBatcher::writeTexelBuffers(const VkDescriptorSet p_Set, const uint32_t p_Binding, const VkDescriptorType p_Type, const std::span<const VkBufferView> p_Views, const uint32_t p_ArrayElement)
+{
+    const uint32_t l_First = static_cast<uint32_t>(m_TexelViews.size());
+    m_TexelViews.insert(m_TexelViews.end(), p_Views.begin(), p_Views.end());
+    queue(p_Set, p_Binding, p_Type, InfoKind::TEXEL_BUFFER, l_First, static_cast<uint32_t>(p_Views.size()), p_ArrayElement);
+}
+
+void VulkanDescriptorWriteBatcher::writeImages(const ResourceID p_Set, const uint32_t p_Binding, const VkDescriptorType p_Type, const std::span<const VkDescriptorImageInfo> p_Infos, const uint32_t p_ArrayElement)
+{
+    const VkDescriptorSet l_Set = *VulkanContext::getDevice(m_Device).getDescriptorSet(p_Set);
+    const uint32_t l_First = static_cast<uint32_t>(m_ImageInfos.size());
+    m_ImageInfos.insert(m_ImageInfos.end(), p_Infos.begin(), p_Infos.end());
+    queue(l_Set, p_Binding, p_Type, InfoKind::IMAGE, l_First, static_cast<uint32_t>(p_Infos.size()), p_ArrayElement);
+}
+
+void VulkanDescriptorWriteBatcher::writeBuffers(const ResourceID p_Set, const uint32_t p_Binding, const VkDescriptorType p_Type, const std::span<const VkDescriptorBufferInfo> p_Infos, const uint32_t p_ArrayElement)
+{
+    const VkDescriptorSet l_Set = *VulkanContext::getDevice(m_Device).getDescriptorSet(p_Set);
+    const uint32_t l_First = static_cast<uint32_t>(m_BufferInfos.size());
+    m_BufferInfos.insert(m_BufferInfos.end(), p_Infos.begin(), p_Infos.end());
+    queue(l_Set, p_Binding, p_Type, InfoKind::BUFFER, l_First, static_cast<uint32_t>(p_Infos.size()), p_ArrayElement);
+}
+
+void VulkanDescriptorWriteBatcher::queue(const VkDescriptorSet p_Set, const uint32_t p_Binding, const VkDescriptorType p_Type, const InfoKind p_Kind,
+                                         const uint32_t p_FirstInfo, const uint32_t p_Count, const uint32_t p_ArrayElement)
+{
+    if (p_Count == 0)
+        return;
+    m_DescriptorCount += p_Count;
+
+    if (!m_Writes.empty())
+    {
+        PendingWrite& l_Last = m_Writes.back();
+        if (l_Last.set == p_Set && l_Last.binding == p_Binding && l_Last.type == p_Type && l_Last.kind == p_Kind
+            && l_Last.arrayElement + l_Last.count == p_ArrayElement && l_Last.firstInfo + l_Last.count == p_FirstInfo)
+        {
+            l_Last.count += p_Count;
+            return;
+        }
+    }
+    m_Writes.push_back({p_Set, p_Binding, p_ArrayElement, p_Count, p_Type, p_Kind, p_FirstInfo});
+}
+
+void VulkanDescriptorWriteBatcher::flush()
+{
+    if (m_Writes.empty())
+        return;
+
+    m_VkWrites.clear();
+    m_VkWrites.reserve(m_Writes.size());
+    for (const PendingWrite& l_Write : m_Writes)
+    {
+        VkWriteDescriptorSet l_VkWrite{};
+        l_VkWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        l_VkWrite.dstSet = l_Write.set;
+        l_VkWrite.dstBinding = l_Write.binding;
+        l_VkWrite.dstArrayElement = l_Write.arrayElement;
+        l_VkWrite.descriptorCount = l_Write.count;
+        l_VkWrite.descriptorType = l_Write.type;
+        if (l_Write.kind == InfoKind::IMAGE)
+            l_VkWrite.pImageInfo = &m_ImageInfos[l_Write.firstInfo];
+        else if (l_Write.kind == InfoKind::BUFFER)
+            l_VkWrite.pBufferInfo = &m_BufferInfos[l_Write.firstInfo];
+        else
+            l_VkWrite.pTexelBufferView = &m_TexelViews[l_Write.firstInfo];
+        m_VkWrites.push_back(l_VkWrite);
+    }
+
+    // The device records the writes into sets it owns
+    VulkanContext::getDevice(m_Device).updateDescriptorSets(m_VkWrites);
+    clear();
+}
+
+void VulkanDescriptorWriteBatcher::clear()
+{
+    m_Writes.clear();
+    m_ImageInfos.clear();
+    m_BufferInfos.clear();
+    m_TexelViews.clear();
+    m_DescriptorCount = 0;
+}
@@ -1,5 +1,6 @@
 #include "vulkan_device.hpp"
 
+#include <algorithm>
 #include <ranges>
 #include <stdexcept>
 #include <vulkan/vk_enum_string_helper.h>
@@ -7,8 +8,37 @@
 #include "vulkan_context.hpp"
 #include "ext/vulkan_extension_management.hpp"
 #include "utils/logger.hpp"
+#include "utils/shader_reflection.hpp"
 #include "vulkan_base.hpp"
 
+static void hashCombine(size_t& p_Seed, const uint64_t p_Value)
+{
+    p_Seed ^= std::hash<uint64_t>{}(p_Value) + 0x9e3779b97f4a7c15ULL + (p_Seed << 6) + (p_Seed >> 2);
+}
+
+static bool sameLayoutBinding(const VkDescriptorSetLayoutBinding& p_A, const VkDescriptorSetLayoutBinding& p_B)
+{
+    return p_A.binding == p_B.binding && p_A.descriptorType == p_B.descriptorType && p_A.descriptorCount == p_B.descriptorCount && p_A.stageFlags == p_B.stageFlags;
+}
+
+static bool samePushConstantRange(const VkPushConstantRange& p_A, const VkPushConstantRange& p_B)
+{
+    return p_A.stageFlags == p_B.stageFlags && p_A.offset == p_B.offset && p_A.size == p_B.size;
+}
+
+static void eraseCacheEntry(std::unordered_multimap<size_t, ResourceID>& p_Cache, const size_t p_Hash, const ResourceID p_ID)
+{
+    const auto [l_First, l_Last] = p_Cache.equal_range(p_Hash);
+    for (auto l_It = l_First; l_It != l_Last; ++l_It)
+    {
+        if (l_It->second == p_ID)
+        {
+            p_Cache.erase(l_It);
+            return;
+        }
+    }
+}
+
 VulkanQueue VulkanDevice::getQueue(const QueueSelection& p_QueueSelection) const
 {
     VkQueue l_Queue;
@@ -235,47 +265,89 @@ ResourceID VulkanDevice::createFramebuffer(const VkExtent3D p_Size, const Resour
     return l_NewRes->getID();
 }
 
-ResourceID VulkanDevice::createAndAllocateBuffer(const VulkanMemoryAllocator::MemoryPreferences& p_MemoryPreferences, const VulkanBuffer::Config& p_Config)
+// The returned info points into p_Config, which has to outlive it
+static VkBufferCreateInfo toBufferCreateInfo(const VulkanBuffer::Config& p_Config)
 {
     VkBufferCreateInfo l_BufferInfo{};
     l_BufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     l_BufferInfo.size = p_Config.size;
     l_BufferInfo.usage = p_Config.usage;
     l_BufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    l_BufferInfo.flags = 0;
+    l_BufferInfo.flags = p_Config.flags;
     if (p_Config.ownerQueueFamilyIndex != VK_QUEUE_FAMILY_IGNORED)
     {
         l_BufferInfo.queueFamilyIndexCount = 1;
         l_BufferInfo.pQueueFamilyIndices = &p_Config.ownerQueueFamilyIndex;
     }
+    return l_BufferInfo;
+}
+
+static VkImageCreateInfo toImageCreateInfo(const VulkanImage::Config& p_Config)
+{
+    VkImageCreateInfo l_ImageInfo{};
+    l_ImageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    l_ImageInfo.imageType = p_Config.type;
+    l_ImageInfo.format = p_Config.format;
+    l_ImageInfo.extent = p_Config.extent;
+    l_ImageInfo.mipLevels = p_Config.mipLevels;
+    l_ImageInfo.arrayLayers = p_Config.arrayLayers;
+    l_ImageInfo.samples = p_Config.samples;
+    l_ImageInfo.tiling = p_Config.tiling;
+    l_ImageInfo.usage = p_Config.usage;
+    l_ImageInfo.flags = p_Config.flags;
+    l_ImageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    l_ImageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    l_ImageInfo.queueFamilyIndexCount = 0;
+    l_ImageInfo.pQueueFamilyIndices = nullptr;
+    return l_ImageInfo;
+}
+
+ResourceID VulkanDevice::createAndAllocateBuffer(const VulkanMemoryAllocator::MemoryPreferences& p_MemoryPreferences, const VulkanBuffer::Config& p_Config)
+{
+    const VkBufferCreateInfo l_BufferInfo = toBufferCreateInfo(p_Config);
 
     const VulkanMemoryAllocator::AllocationReturn l_Ret = m_MemoryAllocator.createBuffer(l_BufferInfo, p_MemoryPreferences);
 
-    VulkanBuffer* l_NewRes = ARENA_ALLOC(VulkanBuffer){m_ID, l_Ret.as<VkBuffer>(), p_Config.size};
+    VulkanBuffer* l_NewRes = ARENA_ALLOC(VulkanBuffer){m_ID, l_Ret.as<VkBuffer>(), p_Config.size, p_Config.usage};
     m_Subresources[l_NewRes->getID()] = l_NewRes;
     l_NewRes->setBoundMemory(l_Ret.allocation);
     LOG_DEBUG("Created and allocated buffer (ID:", l_NewRes->getID(), ") with size ", VulkanMemoryAllocator::compactBytes(l_NewRes->getSize()));
     return l_NewRes->getID();
 }
 
-ResourceID VulkanDevice::createBuffer(const VulkanBuffer::Config& p_Config)
+std::vector<ResourceID> VulkanDevice::createAndAllocateBuffers(const VulkanMemoryAllocator::MemoryPreferences& p_MemoryPreferences, const std::span<const VulkanBuffer::Config> p_Configs)
 {
-    VkBufferCreateInfo l_BufferInfo{};
-    l_BufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    l_BufferInfo.size = p_Config.size;
-    l_BufferInfo.usage = p_Config.usage;
-    l_BufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    l_BufferInfo.flags = 0;
-    if (p_Config.ownerQueueFamilyIndex != VK_QUEUE_FAMILY_IGNORED)
+    TRANS_VECTOR(l_BufferInfos, VkBufferCreateInfo);
+    l_BufferInfos.reserve(p_Configs.size());
+    for (const VulkanBuffer::Config& l_Config : p_Configs)
+        l_BufferInfos.push_back(toBufferCreateInfo(l_Config));
+
+    TRANS_VECTOR(l_Rets, VulkanMemoryAllocator::AllocationReturn);
+    l_Rets.resize(p_Configs.size());
+    m_MemoryAllocator.createBuffers(l_BufferInfos, p_MemoryPreferences, l_Rets);
+
+    std::vector<ResourceID> l_IDs;
+    l_IDs.reserve(p_Configs.size());
+    m_Subresources.reserve(m_Subresources.size() + p_Configs.size());
+    for (size_t i = 0; i < p_Configs.size(); i++)
     {
-        l_BufferInfo.queueFamilyIndexCount = 1;
-        l_BufferInfo.pQueueFamilyIndices = &p_Config.ownerQueueFamilyIndex;
+        VulkanBuffer* l_NewRes = ARENA_ALLOC(VulkanBuffer){m_ID, l_Rets[i].as<VkBuffer>(), p_Configs[i].size, p_Configs[i].usage};
+        m_Subresources[l_NewRes->getID()] = l_NewRes;
+        l_NewRes->setBoundMemory(l_Rets[i].allocation);
+        l_IDs.push_back(l_NewRes->getID());
     }
+    LOG_DEBUG("Created and allocated ", l_IDs.size(), " buffers in batch");
+    return l_IDs;
+}
+
+ResourceID VulkanDevice::createBuffer(const VulkanBuffer::Config& p_Config)
+{
+    const VkBufferCreateInfo l_BufferInfo = toBufferCreateInfo(p_Config);
 
     VkBuffer l_Buffer;
     VULKAN_TRY(getTable().vkCreateBuffer(m_VkHandle, &l_BufferInfo, nullptr, &l_Buffer));
 
-    VulkanBuffer* l_NewRes = ARENA_ALLOC(VulkanBuffer){m_ID, l_Buffer, p_Config.size};
+    VulkanBuffer* l_NewRes = ARENA_ALLOC(VulkanBuffer){m_ID, l_Buffer, p_Config.size, p_Config.usage};
     m_Subresources[l_NewRes->getID()] = l_NewRes;
     LOG_DEBUG("Created buffer (ID:", l_NewRes->getID(), ") with size ", VulkanMemoryAllocator::compactBytes(l_NewRes->getSize()));
     return l_NewRes->getID();
@@ -283,59 +355,99 @@ ResourceID VulkanDevice::createBuffer(const VulkanBuffer::Config& p_Config)
 
 ResourceID VulkanDevice::createAndAllocateImage(const VulkanMemoryAllocator::MemoryPreferences& p_MemoryPreferences, const VulkanImage::Config& p_Config)
 {
-    VkImageCreateInfo l_ImageInfo{};
-    l_ImageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    l_ImageInfo.imageType = p_Config.type;
-    l_ImageInfo.format = p_Config.format;
-    l_ImageInfo.extent = p_Config.extent;
-    l_ImageInfo.mipLevels = 1;
-    l_ImageInfo.arrayLayers = 1;
-    l_ImageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-    l_ImageInfo.tiling = p_Config.tiling;
-    l_ImageInfo.usage = p_Config.usage;
-    l_ImageInfo.flags = p_Config.flags;
-    l_ImageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    l_ImageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    l_ImageInfo.queueFamilyIndexCount = 0;
-    l_ImageInfo.pQueueFamilyIndices = nullptr;
+    const VkImageCreateInfo l_ImageInfo = toImageCreateInfo(p_Config);
 
     const VulkanMemoryAllocator::AllocationReturn l_Ret = m_MemoryAllocator.createImage(l_ImageInfo, p_MemoryPreferences);
 
-    VulkanImage* l_NewRes = ARENA_ALLOC(VulkanImage) { m_ID, l_Ret.as<VkImage>(), p_Config.extent, p_Config.type, VK_IMAGE_LAYOUT_UNDEFINED };
+    VulkanImage* l_NewRes = ARENA_ALLOC(VulkanImage) { m_ID, l_Ret.as<VkImage>(), p_Config, VK_IMAGE_LAYOUT_UNDEFINED };
     m_Subresources[l_NewRes->getID()] = l_NewRes;
     l_NewRes->setBoundMemory(l_Ret.allocation);
     LOG_DEBUG("Created and allocated image (ID:", l_NewRes->getID(), ")");
     return l_NewRes->getID();
 }
 
+std::vector<ResourceID> VulkanDevice::createAndAllocateImages(const VulkanMemoryAllocator::MemoryPreferences& p_MemoryPreferences, const std::span<const VulkanImage::Config> p_Configs)
+{
+    TRANS_VECTOR(l_ImageInfos, VkImageCreateInfo);
+    l_ImageInfos.reserve(p_Configs.size());
+    for (const VulkanImage::Config& l_Config : p_Configs)
+        l_ImageInfos.push_back(toImageCreateInfo(l_Config));
+
+    TRANS_VECTOR(l_Rets, VulkanMemoryAllocator::AllocationReturn);
+    l_Rets.resize(p_Configs.size());
+    m_MemoryAllocator.createImages(l_ImageInfos, p_MemoryPreferences, l_Rets);
+
+    std::vector<ResourceID> l_IDs;
+    l_IDs.reserve(p_Configs.size());
+    m_Subresources.reserve(m_Subresources.size() + p_Configs.size());
+    for (size_t i = 0; i < p_Configs.size(); i++)
+    {
+        VulkanImage* l_NewRes = ARENA_ALLOC(VulkanImage){m_ID, l_Rets[i].as<VkImage>(), p_Configs[i], VK_IMAGE_LAYOUT_UNDEFINED};
+        m_Subresources[l_NewRes->getID()] = l_NewRes;
+        l_NewRes->setBoundMemory(l_Rets[i].allocation);
+        l_IDs.push_back(l_NewRes->getID());
+    }
+    LOG_DEBUG("Created and allocated ", l_IDs.size(), " images in batch");
+    return l_IDs;
+}
+
 ResourceID VulkanDevice::createImage(const VulkanImage::Config& p_Config)
 {
-    VkImageCreateInfo l_ImageInfo{};
-    l_ImageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    l_ImageInfo.imageType = p_Config.type;
-    l_ImageInfo.format = p_Config.format;
-    l_ImageInfo.extent = p_Config.extent;
-    l_ImageInfo.mipLevels = 1;
-    l_ImageInfo.arrayLayers = 1;
-    l_ImageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-    l_ImageInfo.tiling = p_Config.tiling;
-    l_ImageInfo.usage = p_Config.usage;
-    l_ImageInfo.flags = p_Config.flags;
-    l_ImageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    l_ImageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    l_ImageInfo.queueFamilyIndexCount = 0;
-    l_ImageInfo.pQueueFamilyIndices = nullptr;
+    const VkImageCreateInfo l_ImageInfo = toImageCreateInfo(p_Config);
 
     VkImage l_Image;
     VULKAN_TRY(getTable().vkCreateImage(m_VkHandle, &l_ImageInfo, nullptr, &l_Image));
 
-    VulkanImage* l_NewRes = ARENA_ALLOC(VulkanImage){m_ID, l_Image, p_Config.extent, p_Config.type, VK_IMAGE_LAYOUT_UNDEFINED};
+    VulkanImage* l_NewRes = ARENA_ALLOC(VulkanImage){m_ID, l_Image, p_Config, VK_IMAGE_LAYOUT_UNDEFINED};
     m_Subresources[l_NewRes->getID()] = l_NewRes;
     LOG_DEBUG("Created image (ID:", l_NewRes->getID(), ")");
 
     return l_NewRes->getID();
 }
 
+ResourceID VulkanDevice::createSparseBuffer(const VulkanBuffer::Config& p_Config)
+{
+    VulkanBuffer::Config l_Config = p_Config;
+    l_Config.flags |= VK_BUFFER_CREATE_SPARSE_BINDING_BIT | VK_BUFFER_CREATE_SPARSE_RESIDENCY_BIT;
+    return createBuffer(l_Config);
+}
+
+ResourceID VulkanDevice::createSparseImage(const VulkanImage::Config& p_Config)
+{
+    VulkanImage::Config l_Config = p_Config;
+    l_Config.flags |= VK_IMAGE_CREATE_SPARSE_BINDING_BIT | VK_IMAGE_CREATE_SPARSE_RESIDENCY_BIT;
+    return createImage(l_Config);
+}
+
+ResourceID VulkanDevice::createTransientAttachment(const VulkanImage::Config& p_Config)
+{
+    constexpr VkImageUsageFlags TRANSIENT_COMPATIBLE_USAGE = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+    if (p_Config.usage & ~(TRANSIENT_COMPATIBLE_USAGE | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT))
+    {
+        throw std::runtime_error("Transient attachments can only be used as color, depth stencil or input attachments");
+    }
+
+    VulkanImage::Config l_Config = p_Config;
+    l_Config.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
+    const ResourceID l_ImageID = createImage(l_Config);
+    VulkanImage& l_Image = getImage(l_ImageID);
+
+    const uint32_t l_TypeBits = l_Image.getMemoryRequirements().memoryTypeBits;
+    const bool l_HasLazyMemory = !m_MemoryAllocator.getMemoryStructure().getMemoryTypes(VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, l_TypeBits).empty();
+    if (l_HasLazyMemory)
+    {
+        l_Image.allocate(VulkanMemoryAllocator::MemoryPreferences::fromUsage(VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED, 0));
+    }
+    else
+    {
+        l_Image.allocate(VulkanMemoryAllocator::MemoryPreferences::fromUsage(VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0));
+    }
+
+    LOG_DEBUG("Created transient attachment (ID:", l_ImageID, ")", l_HasLazyMemory ? " in lazily allocated memory" : "");
+    return l_ImageID;
+}
+
 void VulkanDevice::configureStagingBuffer(const VkDeviceSize p_Size, const QueueSelection& p_Queue, const bool p_ForceAllowStagingMemory)
 {
     if (m_StagingBufferInfo.stagingBuffer != UINT32_MAX)
@@ -344,7 +456,7 @@ void VulkanDevice::configureStagingBuffer(const VkDeviceSize p_Size, const Queue
     }
     constexpr VulkanMemoryAllocator::MemoryPreferences PREFS{
         .usage = VMA_MEMORY_USAGE_AUTO,
-        .vmaFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+        .vmaFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
         .preferredProperties = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
     };
 
@@ -392,10 +504,12 @@ VulkanDevice::StagingBufferInfo VulkanDevice::getStagingBufferData() const
 
 ResourceID VulkanDevice::createRenderPass(const VulkanRenderPassBuilder& p_Builder, const VkRenderPassCreateFlags p_Flags)
 {
+    const std::vector<VkAttachmentDescription> l_Attachments = p_Builder.resolveAttachments();
+
     VkRenderPassCreateInfo l_RenderPassInfo{};
     l_RenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    l_RenderPassInfo.attachmentCount = static_cast<uint32_t>(p_Builder.m_Attachments.size());
-    l_RenderPassInfo.pAttachments = p_Builder.m_Attachments.data();
+    l_RenderPassInfo.attachmentCount = static_cast<uint32_t>(l_Attachments.size());
+    l_RenderPassInfo.pAttachments = l_Attachments.data();
     l_RenderPassInfo.subpassCount = static_cast<uint32_t>(p_Builder.m_Subpasses.size());
     TRANS_VECTOR(l_Subpasses, VkSubpassDescription);
     for (const VulkanRenderPassBuilder::SubpassInfo& l_Subpass : p_Builder.m_Subpasses)
@@ -431,6 +545,28 @@ ResourceID VulkanDevice::createRenderPass(const VulkanRenderPassBuilder& p_Build
 
 ResourceID VulkanDevice::createPipelineLayout(const std::span<const ResourceID> p_DescriptorSetLayouts, const std::span<const VkPushConstantRange> p_PushConstantRanges)
 {
+    // Equal set layouts are already shared, so their IDs stand in for their contents
+    size_t l_Hash = p_DescriptorSetLayouts.size();
+    for (const ResourceID l_ID : p_DescriptorSetLayouts)
+        hashCombine(l_Hash, l_ID);
+    for (const VkPushConstantRange& l_Range : p_PushConstantRanges)
+    {
+        hashCombine(l_Hash, l_Range.stageFlags);
+        hashCombine(l_Hash, static_cast<uint64_t>(l_Range.offset) << 32 | l_Range.size);
+    }
+
+    const auto [l_First, l_Last] = m_PipelineLayoutCache.equal_range(l_Hash);
+    for (auto l_It = l_First; l_It != l_Last; ++l_It)
+    {
+        VulkanPipelineLayout& l_Cached = getPipelineLayout(l_It->second);
+        if (std::ranges::equal(l_Cached.m_SetLayouts, p_DescriptorSetLayouts) && std::ranges::equal(l_Cached.m_PushConstantRanges, p_PushConstantRanges, samePushConstantRange))
+        {
+            l_Cached.m_References++;
+            LOG_DEBUG("Reusing pipeline layout (ID:", l_Cached.getID(), "), now shared by ", l_Cached.m_References, " user(s)");
+            return l_Cached.getID();
+        }
+    }
+
     TRANS_VECTOR(l_Layouts, VkDescriptorSetLayout);
     l_Layouts.reserve(p_DescriptorSetLayouts.size());
     for (const ResourceID l_ID : p_DescriptorSetLayouts)
@@ -448,12 +584,32 @@ ResourceID VulkanDevice::createPipelineLayout(const std::span<const ResourceID>
     VkPipelineLayout l_Layout;
     VULKAN_TRY(getTable().vkCreatePipelineLayout(m_VkHandle, &l_PipelineLayoutInfo, nullptr, &l_Layout));
 
-    VulkanPipelineLayout* l_NewRes = ARENA_ALLOC(VulkanPipelineLayout){m_ID, l_Layout};
+    VulkanPipelineLayout* l_NewRes = ARENA_ALLOC(VulkanPipelineLayout){m_ID, l_Layout, l_Hash};
+    l_NewRes->m_SetLayouts.assign(p_DescriptorSetLayouts.begin(), p_DescriptorSetLayouts.end());
+    l_NewRes->m_PushConstantRanges.assign(p_PushConstantRanges.begin(), p_PushConstantRanges.end());
+    for (const ResourceID l_ID : p_DescriptorSetLayouts)
+    {
+        getDescriptorSetLayout(l_ID).m_References++;
+    }
     m_Subresources[l_NewRes->getID()] = l_NewRes;
+    m_PipelineLayoutCache.emplace(l_Hash, l_NewRes->getID());
     LOG_DEBUG("Created pipeline layout (ID:", l_NewRes->getID(), ") with ", l_Layouts.size(), " descriptor set layout(s) and ", p_PushConstantRanges.size(), " push constant range(s)");
     return l_NewRes->getID();
 }
 
+bool VulkanDevice::freePipelineLayout(const ResourceID p_ID)
+{
+    VulkanPipelineLayout* l_Layout = getSubresource<VulkanPipelineLayout>(p_ID);
+    if (l_Layout == nullptr)
+        return false;
+
+    if (--l_Layout->m_References > 0)
+        return true;
+
+    eraseCacheEntry(m_PipelineLayoutCache, l_Layout->m_Hash, p_ID);
+    return freeSubresource<VulkanPipelineLayout>(p_ID);
+}
+
 ResourceID VulkanDevice::createDescriptorPool(const std::span<const VkDescriptorPoolSize> p_PoolSizes, const uint32_t p_MaxSets, const VkDescriptorPoolCreateFlags p_Flags)
 {
     VkDescriptorPoolCreateInfo l_PoolInfo{};
@@ -472,10 +628,72 @@ ResourceID VulkanDevice::createDescriptorPool(const std::span<const VkDescriptor
     return l_NewRes->getID();
 }
 
-ResourceID VulkanDevice::createDescriptorSetLayout(const std::span<const VkDescriptorSetLayoutBinding> p_Bindings, const VkDescriptorSetLayoutCreateFlags p_Flags)
+ResourceID VulkanDevice::createDescriptorSetLayout(const std::span<const VkDescriptorSetLayoutBinding> p_Bindings, const VkDescriptorSetLayoutCreateFlags p_Flags,
+                                                   const std::span<const VkDescriptorBindingFlags> p_BindingFlags)
 {
+    if (!p_BindingFlags.empty() && p_BindingFlags.size() != p_Bindings.size())
+    {
+        throw std::runtime_error("Descriptor set layout got " + std::to_string(p_BindingFlags.size()) + " binding flags for " + std::to_string(p_Bindings.size()) + " bindings (ID:" + std::to_string(m_ID) + ")");
+    }
+
+    // The key is built in binding order so the same bindings listed differently land on the same layout
+    TRANS_VECTOR(l_Order, uint32_t);
+    l_Order.resize(p_Bindings.size());
+    for (uint32_t i = 0; i < l_Order.size(); i++)
+        l_Order[i] = i;
+    std::ranges::sort(l_Order, {}, [&](const uint32_t p_Index) { return p_Bindings[p_Index].binding; });
+
+    TRANS_VECTOR(l_SortedBindings, VkDescriptorSetLayoutBinding);
+    TRANS_VECTOR(l_SortedFlags, VkDescriptorBindingFlags);
+    TRANS_VECTOR(l_Samplers, VkSampler);
+    TRANS_VECTOR(l_HasSamplers, uint8_t);
+    size_t l_Hash = p_Flags;
+    for (const uint32_t l_Index : l_Order)
+    {
+        VkDescriptorSetLayoutBinding l_Binding = p_Bindings[l_Index];
+        const bool l_Immutable = l_Binding.pImmutableSamplers != nullptr && (l_Binding.descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER || l_Binding.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        l_HasSamplers.push_back(l_Immutable);
+        if (l_Immutable)
+        {
+            for (uint32_t i = 0; i < l_Binding.descriptorCount; i++)
+            {
+                l_Samplers.push_back(l_Binding.pImmutableSamplers[i]);
+                hashCombine(l_Hash, reinterpret_cast<uint64_t>(l_Binding.pImmutableSamplers[i]));
+            }
+        }
+        l_Binding.pImmutableSamplers = nullptr;
+        l_SortedBindings.push_back(l_Binding);
+        hashCombine(l_Hash, static_cast<uint64_t>(l_Binding.binding) << 32 | l_Binding.descriptorType);
+        hashCombine(l_Hash, static_cast<uint64_t>(l_Binding.descriptorCount) << 32 | l_Binding.stageFlags);
+
+        if (!p_BindingFlags.empty())
+        {
+            l_SortedFlags.push_back(p_BindingFlags[l_Index]);
+            hashCombine(l_Hash, p_BindingFlags[l_Index]);
+        }
+    }
+
+    const auto [l_First, l_Last] = m_DescriptorSetLayoutCache.equal_range(l_Hash);
+    for (auto l_It = l_First; l_It != l_Last; ++l_It)
+    {
+        VulkanDescriptorSetLayout& l_Cached = getDescriptorSetLayout(l_It->second);
+        if (l_Cached.m_Flags == p_Flags && std::ranges::equal(l_Cached.m_Bindings, l_SortedBindings, sameLayoutBinding)
+            && std::ranges::equal(l_Cached.m_BindingFlags, l_SortedFlags) && std::ranges::equal(l_Cached.m_ImmutableSamplerHandles, l_Samplers))
+        {
+            l_Cached.m_References++;
+            LOG_DEBUG("Reusing descriptor set layout (ID:", l_Cached.getID(), "), now shared by ", l_Cached.m_References, " user(s)");
+            return l_Cached.getID();
+        }
+    }
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo l_BindingFlagsInfo{};
+    l_BindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    l_BindingFlagsInfo.bindingCount = static_cast<uint32_t>(p_BindingFlags.size());
+    l_BindingFlagsInfo.pBindingFlags = p_BindingFlags.data();
+
     VkDescriptorSetLayoutCreateInfo l_LayoutInfo{};
     l_LayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    l_LayoutInfo.pNext = p_BindingFlags.empty() ? nullptr : &l_BindingFlagsInfo;
     l_LayoutInfo.flags = p_Flags;
     l_LayoutInfo.bindingCount = static_cast<uint32_t>(p_Bindings.size());
     l_LayoutInfo.pBindings = p_Bindings.data();
@@ -484,11 +702,50 @@ ResourceID VulkanDevice::createDescriptorSetLayout(const std::span<const VkDescr
     VULKAN_TRY(getTable().vkCreateDescriptorSetLayout(m_VkHandle, &l_LayoutInfo, nullptr, &l_DescriptorSetLayout));
 
     VulkanDescriptorSetLayout* l_NewRes = ARENA_ALLOC(VulkanDescriptorSetLayout){m_ID, l_DescriptorSetLayout};
+    l_NewRes->m_Flags = p_Flags;
+    l_NewRes->m_Hash = l_Hash;
+    for (const VkDescriptorSetLayoutBinding& l_Binding : p_Bindings)
+    {
+        if (l_Binding.descriptorCount == 0)
+            continue;
+        const auto l_Size = std::ranges::find(l_NewRes->m_PoolSizes, l_Binding.descriptorType, &VkDescriptorPoolSize::type);
+        if (l_Size != l_NewRes->m_PoolSizes.end())
+            l_Size->descriptorCount += l_Binding.descriptorCount;
+        else
+            l_NewRes->m_PoolSizes.push_back({l_Binding.descriptorType, l_Binding.descriptorCount});
+    }
+    std::ranges::sort(l_NewRes->m_PoolSizes, {}, &VkDescriptorPoolSize::type);
+    l_NewRes->m_Bindings.assign(l_SortedBindings.begin(), l_SortedBindings.end());
+    l_NewRes->m_HasImmutableSamplers.assign(l_HasSamplers.begin(), l_HasSamplers.end());
+    l_NewRes->m_BindingFlags.assign(l_SortedFlags.begin(), l_SortedFlags.end());
+    l_NewRes->m_ImmutableSamplerHandles.assign(l_Samplers.begin(), l_Samplers.end());
+    for (const VkSampler l_Sampler : l_Samplers)
+    {
+        const auto l_It = m_SamplersByHandle.find(l_Sampler);
+        if (l_It == m_SamplersByHandle.end())
+            continue;
+        getSampler(l_It->second).m_References++;
+        l_NewRes->m_ImmutableSamplers.push_back(l_It->second);
+    }
     m_Subresources[l_NewRes->getID()] = l_NewRes;
-    LOG_DEBUG("Created descriptor set layout (ID:", l_NewRes->getID(), ") with ", p_Bindings.size(), " binding(s)");
+    m_DescriptorSetLayoutCache.emplace(l_Hash, l_NewRes->getID());
+    LOG_DEBUG("Created descriptor set layout (ID:", l_NewRes->getID(), ") with ", p_Bindings.size(), " binding(s) and ", l_NewRes->m_ImmutableSamplers.size(), " cached immutable sampler(s)");
     return l_NewRes->getID();
 }
 
+bool VulkanDevice::freeDescriptorSetLayout(const ResourceID p_ID)
+{
+    VulkanDescriptorSetLayout* l_Layout = getSubresource<VulkanDescriptorSetLayout>(p_ID);
+    if (l_Layout == nullptr)
+        return false;
+
+    if (--l_Layout->m_References > 0)
+        return true;
+
+    eraseCacheEntry(m_DescriptorSetLayoutCache, l_Layout->m_Hash, p_ID);
+    return freeSubresource<VulkanDescriptorSetLayout>(p_ID);
+}
+
 ResourceID VulkanDevice::createDescriptorSet(ResourceID p_Pool, ResourceID p_Layout)
 {
     const VkDescriptorSetLayout l_DescriptorSetLayout = getDescriptorSetLayout(p_Layout).m_VkHandle;
@@ -505,37 +762,156 @@ ResourceID VulkanDevice::createDescriptorSet(ResourceID p_Pool, ResourceID p_Lay
 
     VulkanDescriptorSet* l_NewRes = ARENA_ALLOC(VulkanDescriptorSet){m_ID, p_Pool, l_DescriptorSet};
     m_Subresources[l_NewRes->getID()] = l_NewRes;
+    m_DescriptorSetsByHandle[l_DescriptorSet] = l_NewRes->getID();
     LOG_DEBUG("Created descriptor set (ID:", l_NewRes->getID(), ")");
     return l_NewRes->getID();
 }
 
-void VulkanDevice::createDescriptorSets(ResourceID p_Pool, ResourceID p_Layout, const uint32_t p_Count, ResourceID p_Container[])
+void VulkanDevice::createDescriptorSets(const ResourceID p_Pool, const ResourceID p_Layout, const uint32_t p_Count, ResourceID p_Container[])
 {
-    const VkDescriptorSetLayout l_DescriptorSetLayout = getDescriptorSetLayout(p_Layout).m_VkHandle;
-    const VkDescriptorPool l_DescriptorPool = getDescriptorPool(p_Pool).m_VkHandle;
+    TRANS_VECTOR(l_Layouts, ResourceID);
+    l_Layouts.assign(p_Count, p_Layout);
+    createDescriptorSets(p_Pool, l_Layouts, p_Container);
+}
+
+void VulkanDevice::createDescriptorSets(const ResourceID p_Pool, const std::span<const ResourceID> p_Layouts, ResourceID p_Container[])
+{
+    TRANS_VECTOR(l_DescriptorSetLayouts, VkDescriptorSetLayout);
+    l_DescriptorSetLayouts.reserve(p_Layouts.size());
+    for (const ResourceID l_Layout : p_Layouts)
+    {
+        l_DescriptorSetLayouts.push_back(getDescriptorSetLayout(l_Layout).m_VkHandle);
+    }
 
     VkDescriptorSetAllocateInfo l_AllocInfo{};
     l_AllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    l_AllocInfo.descriptorPool = l_DescriptorPool;
-    l_AllocInfo.descriptorSetCount = p_Count;
-    l_AllocInfo.pSetLayouts = &l_DescriptorSetLayout;
+    l_AllocInfo.descriptorPool = getDescriptorPool(p_Pool).m_VkHandle;
+    l_AllocInfo.descriptorSetCount = static_cast<uint32_t>(l_DescriptorSetLayouts.size());
+    l_AllocInfo.pSetLayouts = l_DescriptorSetLayouts.data();
 
     TRANS_VECTOR(l_DescriptorSets, VkDescriptorSet);
+    l_DescriptorSets.resize(l_DescriptorSetLayouts.size());
     VULKAN_TRY(getTable().vkAllocateDescriptorSets(m_VkHandle, &l_AllocInfo, l_DescriptorSets.data()));
 
-    for (uint32_t i = 0; i < p_Count; i++)
+    for (uint32_t i = 0; i < l_DescriptorSets.size(); i++)
     {
         VulkanDescriptorSet* l_NewRes = ARENA_ALLOC(VulkanDescriptorSet){m_ID, p_Pool, l_DescriptorSets[i]};
         m_Subresources[l_NewRes->getID()] = l_NewRes;
+        m_DescriptorSetsByHandle[l_DescriptorSets[i]] = l_NewRes->getID();
         p_Container[i] = l_NewRes->getID();
-        LOG_DEBUG("Created descriptor set (ID:", l_NewRes->getID(), ") in batch");
     }
+    LOG_DEBUG("Created ", l_DescriptorSets.size(), " descriptor sets in batch from pool (ID:", p_Pool, ")");
 }
 
 void VulkanDevice::updateDescriptorSets(const std::span<const VkWriteDescriptorSet> p_DescriptorWrites) const
 {
     LOG_DEBUG("Updating ", p_DescriptorWrites.size(), " descriptor sets directly from device (ID: ", m_ID, ")");
     getTable().vkUpdateDescriptorSets(m_VkHandle, static_cast<uint32_t>(p_DescriptorWrites.size()), p_DescriptorWrites.data(), 0, nullptr);
+    for (const VkWriteDescriptorSet& l_Write : p_DescriptorWrites)
+    {
+        const auto l_It = m_DescriptorSetsByHandle.find(l_Write.dstSet);
+        if (l_It != m_DescriptorSetsByHandle.end())
+            getDescriptorSet(l_It->second).recordWrite(l_Write);
+    }
+}
+
+ResourceID VulkanDevice::createDescriptorUpdateTemplate(const ResourceID p_Layout)
+{
+    return createDescriptorUpdateTemplate(p_Layout, std::span<const VkDescriptorSetLayoutBinding>(getDescriptorSetLayout(p_Layout).m_Bindings));
+}
+
+ResourceID VulkanDevice::createDescriptorUpdateTemplate(const ResourceID p_Layout, const ShaderReflectionData& p_Reflection, const uint32_t p_Set)
+{
+    const std::vector<VkDescriptorSetLayoutBinding>& l_LayoutBindings = getDescriptorSetLayout(p_Layout).m_Bindings;
+
+    TRANS_VECTOR(l_Bindings, VkDescriptorSetLayoutBinding);
+    for (const VkDescriptorSetLayoutBinding& l_Reflected : p_Reflection.getDescriptorSetLayoutBindings(p_Set))
+    {
+        const auto l_Binding = std::ranges::find(l_LayoutBindings, l_Reflected.binding, &VkDescriptorSetLayoutBinding::binding);
+        if (l_Binding == l_LayoutBindings.end())
+        {
+            throw std::runtime_error("Shader binding " + std::to_string(l_Reflected.binding) + " of set " + std::to_string(p_Set) + " is not part of descriptor set layout " + std::to_string(p_Layout) + " (ID:" + std::to_string(m_ID) + ")");
+        }
+        // The layout decides the type, reflection can't tell a sampled image from a combined image sampler
+        l_Bindings.push_back(*l_Binding);
+    }
+    return createDescriptorUpdateTemplate(p_Layout, std::span<const VkDescriptorSetLayoutBinding>(l_Bindings));
+}
+
+ResourceID VulkanDevice::createDescriptorUpdateTemplate(const ResourceID p_Layout, const std::span<const VkDescriptorSetLayoutBinding> p_Bindings)
+{
+    std::vector<VulkanDescriptorUpdateTemplate::Entry> l_Entries;
+    TRANS_VECTOR(l_VkEntries, VkDescriptorUpdateTemplateEntry);
+    l_Entries.reserve(p_Bindings.size());
+    l_VkEntries.reserve(p_Bindings.size());
+
+    const VulkanDescriptorSetLayout& l_Layout = getDescriptorSetLayout(p_Layout);
+    uint32_t l_DataSize = 0;
+    for (const VkDescriptorSetLayoutBinding& l_Binding : p_Bindings)
+    {
+        // Samplers baked into the layout can't be written, combined image samplers still take their image
+        if (l_Binding.descriptorCount == 0 || (l_Binding.descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER && l_Layout.hasImmutableSamplers(l_Binding.binding)))
+            continue;
+
+        const uint32_t l_Stride = VulkanDescriptorUpdateTemplate::getDescriptorStride(l_Binding.descriptorType);
+        // Keep every entry 8 byte aligned so the info structs and handles in the block can be written in place
+        l_DataSize = (l_DataSize + 7) & ~7u;
+        l_Entries.push_back({l_Binding.binding, l_Binding.descriptorCount, l_Binding.descriptorType, l_DataSize, l_Stride});
+
+        VkDescriptorUpdateTemplateEntry l_VkEntry{};
+        l_VkEntry.dstBinding = l_Binding.binding;
+        l_VkEntry.dstArrayElement = 0;
+        l_VkEntry.descriptorCount = l_Binding.descriptorCount;
+        l_VkEntry.descriptorType = l_Binding.descriptorType;
+        l_VkEntry.offset = l_DataSize;
+        l_VkEntry.stride = l_Stride;
+        l_VkEntries.push_back(l_VkEntry);
+
+        l_DataSize += l_Stride * l_Binding.descriptorCount;
+    }
+
+    VkDescriptorUpdateTemplateCreateInfo l_TemplateInfo{};
+    l_TemplateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+    l_TemplateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(l_VkEntries.size());
+    l_TemplateInfo.pDescriptorUpdateEntries = l_VkEntries.data();
+    l_TemplateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+    l_TemplateInfo.descriptorSetLayout = getDescriptorSetLayout(p_Layout).m_VkHandle;
+
+    VkDescriptorUpdateTemplate l_Template;
+    VULKAN_TRY(getTable().vkCreateDescriptorUpdateTemplate(m_VkHandle, &l_TemplateInfo, nullptr, &l_Template));
+
+    VulkanDescriptorUpdateTemplate* l_NewRes = ARENA_ALLOC(VulkanDescriptorUpdateTemplate){m_ID, l_Template, p_Layout, std::move(l_Entries), l_DataSize};
+    m_Subresources[l_NewRes->getID()] = l_NewRes;
+    LOG_DEBUG("Created descriptor update template (ID:", l_NewRes->getID(), ") with ", l_VkEntries.size(), " entries and a ", l_DataSize, " byte data block");
+    return l_NewRes->getID();
+}
+
+std::vector<ResourceID> VulkanDevice::flagDescriptorSetsReferencing(const std::span<const uint64_t> p_MovedHandles)
+{
+    std::vector<ResourceID> l_Flagged;
+    if (p_MovedHandles.empty())
+        return l_Flagged;
+
+    for (VulkanDeviceSubresource* l_Subresource : m_Subresources | std::views::values)
+    {
+        VulkanDescriptorSet* l_Set = dynamic_cast<VulkanDescriptorSet*>(l_Subresource);
+        if (!l_Set)
+            continue;
+
+        bool l_Referenced = false;
+        for (const uint64_t l_Handle : p_MovedHandles)
+        {
+            l_Referenced |= l_Set->markHandleMoved(l_Handle);
+        }
+        if (l_Referenced)
+            l_Flagged.push_back(l_Set->getID());
+    }
+
+    if (!l_Flagged.empty())
+    {
+        LOG_DEBUG("Flagged ", l_Flagged.size(), " descriptor sets for rewrite after ", p_MovedHandles.size(), " handles moved");
+    }
+    return l_Flagged;
 }
 
 ResourceID VulkanDevice::createShaderModule(VulkanShader& p_ShaderCode, const VkShaderStageFlagBits p_Stage)
@@ -596,6 +972,51 @@ bool VulkanDevice::freeAllShaderModules()
     return l_Count > 0;
 }
 
+ResourceID VulkanDevice::acquireSampler(const VkSamplerCreateInfo& p_CreateInfo)
+{
+    VulkanImageSampler::Key l_Key;
+    const bool l_Shared = VulkanImageSampler::makeKey(p_CreateInfo, l_Key);
+    if (l_Shared)
+    {
+        const auto l_It = m_SamplerCache.find(l_Key);
+        if (l_It != m_SamplerCache.end())
+        {
+            getSampler(l_It->second).m_References++;
+            return l_It->second;
+        }
+    }
+
+    VkSampler l_Sampler;
+    VULKAN_TRY(getTable().vkCreateSampler(m_VkHandle, &p_CreateInfo, nullptr, &l_Sampler));
+
+    VulkanImageSampler* l_NewRes = ARENA_ALLOC(VulkanImageSampler){m_ID, l_Sampler};
+    l_NewRes->m_Key = l_Key;
+    l_NewRes->m_References = 1;
+    l_NewRes->m_Shared = l_Shared;
+    m_Subresources[l_NewRes->getID()] = l_NewRes;
+    m_SamplersByHandle[l_Sampler] = l_NewRes->getID();
+    if (l_Shared)
+        m_SamplerCache[l_Key] = l_NewRes->getID();
+
+    LOG_DEBUG("Created ", l_Shared ? "shared" : "unshared", " sampler (ID:", l_NewRes->getID(), "), device now has ", m_SamplersByHandle.size(), " sampler(s)");
+    return l_NewRes->getID();
+}
+
+bool VulkanDevice::releaseSampler(const ResourceID p_ID)
+{
+    VulkanImageSampler* l_Sampler = getSubresource<VulkanImageSampler>(p_ID);
+    if (l_Sampler == nullptr)
+        return false;
+
+    if (--l_Sampler->m_References > 0)
+        return true;
+
+    if (l_Sampler->m_Shared)
+        m_SamplerCache.erase(l_Sampler->m_Key);
+    m_SamplersByHandle.erase(l_Sampler->m_VkHandle);
+    return freeSubresource<VulkanImageSampler>(p_ID);
+}
+
 ResourceID VulkanDevice::createSemaphore()
 {
     VkSemaphoreCreateInfo l_SemaphoreInfo{};
@@ -740,6 +1161,11 @@ bool VulkanDevice::free()
     {
         freeSubresource(l_ID);
     }
+    m_SamplerCache.clear();
+    m_SamplersByHandle.clear();
+    m_DescriptorSetsByHandle.clear();
+    m_DescriptorSetLayoutCache.clear();
+    m_PipelineLayoutCache.clear();
 
     if (m_ExtensionManager != nullptr)
     {
@@ -786,3 +1212,14 @@ void VulkanDevice::insertImage(VulkanImage* p_Image)
     m_Subresources[p_Image->getID()] = p_Image;
     LOG_DEBUG("Inserted image (ID:", p_Image->getID(), ") into device");
 }
+
+void VulkanDevice::insertBuffer(VulkanBuffer* p_Buffer)
+{
+    if (m_Subresources.contains(p_Buffer->getID()))
+    {
+        LOG_DEBUG("Buffer with ID ", p_Buffer->getID(), " already exists, not inserting again");
+        return;
+    }
+    m_Subresources[p_Buffer->getID()] = p_Buffer;
+    LOG_DEBUG("Inserted buffer (ID:", p_Buffer->getID(), ") into device");
+}
@@ -0,0 +1,205 @@
+#include "vulkan_frame_allocator.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <ranges>
+#include <stdexcept>
+
+#include "utils/allocators.hpp"
+#include "utils/logger.hpp"
+#include "vulkan_base.hpp"
+#include "vulkan_device.hpp"
+#include "vulkan_sync.hpp"
+
+static constexpr VmaAllocationCreateFlags FRAME_ALLOCATION_FLAGS = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+
+VulkanFrameAllocator::VulkanFrameAllocator(const ResourceID p_Device, const Config& p_Config)
+    : m_Device(p_Device), m_Config(p_Config)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    VulkanMemoryAllocator& l_Allocator = l_Device.getMemoryAllocator();
+
+    const VkPhysicalDeviceLimits l_Limits = l_Device.getGPU().getProperties().limits;
+    if (m_Config.usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+        m_MinAlignment = std::max(m_MinAlignment, l_Limits.minUniformBufferOffsetAlignment);
+    if (m_Config.usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
+        m_MinAlignment = std::max(m_MinAlignment, l_Limits.minStorageBufferOffsetAlignment);
+
+    VkBufferCreateInfo l_BufferInfo{};
+    l_BufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    l_BufferInfo.size = m_Config.segmentSize;
+    l_BufferInfo.usage = m_Config.usage;
+    l_BufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VmaAllocationCreateInfo l_AllocInfo{};
+    l_AllocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+    l_AllocInfo.flags = FRAME_ALLOCATION_FLAGS;
+
+    uint32_t l_MemoryType;
+    VULKAN_TRY(vmaFindMemoryTypeIndexForBufferInfo(*l_Allocator, &l_BufferInfo, &l_AllocInfo, &l_MemoryType));
+    m_Coherent = l_Allocator.getMemoryStructure().doesMemoryContainProperties(l_MemoryType, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    // Segments are packed back to back, padding each one to the buffer alignment lets the block hold exactly the ring
+    const ResourceID l_Probe = l_Device.createBuffer({m_Config.segmentSize, m_Config.usage});
+    m_Config.segmentSize = alignUp(m_Config.segmentSize, l_Device.getBuffer(l_Probe).getMemoryRequirements().alignment);
+    l_Device.freeBuffer(l_Probe);
+
+    // One segment per frame in flight and one for the frame being recorded, all allocated up front in order. The linear
+    // algorithm keeps that a plain bump within the single block, segments are then recycled by the free list below
+    const uint32_t l_RingSize = m_Config.framesInFlight + 1;
+    VulkanMemoryAllocator::PoolPreferences l_PoolPrefs{};
+    l_PoolPrefs.memoryTypeIndex = l_MemoryType;
+    l_PoolPrefs.flags = VMA_POOL_CREATE_LINEAR_ALGORITHM_BIT;
+    l_PoolPrefs.blockSize = m_Config.segmentSize * l_RingSize;
+    l_PoolPrefs.minBlockCount = 1;
+    l_PoolPrefs.maxBlockCount = 1;
+    // Never shared through getOrCreatePool, the block is sized for this ring alone
+    m_Pool = l_Allocator.createPool(l_PoolPrefs);
+
+    // The ring segments live as long as the allocator, only overflow segments are created and freed per frame
+    m_Ring.reserve(l_RingSize);
+    m_FreeRing.reserve(l_RingSize);
+    for (uint32_t i = 0; i < l_RingSize; i++)
+    {
+        m_Ring.push_back(createSegment(m_Config.segmentSize, i));
+        m_FreeRing.push_back(l_RingSize - 1 - i);
+    }
+
+    LOG_DEBUG("Created frame allocator with ", m_Config.framesInFlight, " frames of ", VulkanMemoryAllocator::compactBytes(m_Config.segmentSize), " in memory type ", l_MemoryType);
+}
+
+void VulkanFrameAllocator::beginFrame(const ResourceID p_Fence)
+{
+    if (m_Current.fence != UINT32_MAX)
+        m_Pending.push_back(std::move(m_Current));
+    m_Current = {p_Fence, {}};
+    m_Cursor = 0;
+    m_FrameUsage = 0;
+
+    // Reusing a fence means the caller already waited on it and reset it, polling it now would never succeed
+    const auto l_Reused = std::ranges::find(m_Pending, p_Fence, &Frame::fence);
+    if (l_Reused != m_Pending.end())
+    {
+        const auto l_End = std::next(l_Reused);
+        std::for_each(m_Pending.begin(), l_End, [this](Frame& p_Frame) { releaseFrame(p_Frame); });
+        m_Pending.erase(m_Pending.begin(), l_End);
+    }
+
+    reclaim();
+
+    while (m_Pending.size() > m_Config.framesInFlight)
+    {
+        VulkanContext::getDevice(m_Device).getFence(m_Pending.front().fence).wait();
+        releaseFrame(m_Pending.front());
+        m_Pending.pop_front();
+    }
+}
+
+VulkanFrameAllocation VulkanFrameAllocator::allocate(const VkDeviceSize p_Size, const VkDeviceSize p_Alignment)
+{
+    if (m_Current.fence == UINT32_MAX)
+    {
+        throw std::runtime_error("Tried to allocate from a frame allocator before calling beginFrame");
+    }
+
+    if (m_Current.segments.empty())
+    {
+        m_Current.segments.push_back(acquireSegment());
+        m_Cursor = 0;
+    }
+
+    VkDeviceSize l_Offset = alignUp(m_Cursor, std::max(m_MinAlignment, p_Alignment));
+    if (l_Offset + p_Size > m_Current.segments.back().size)
+    {
+        LOG_WARN("Frame allocator went over its ", VulkanMemoryAllocator::compactBytes(m_Config.segmentSize), " segment, spilling into a regular allocation");
+        m_Current.segments.push_back(createSegment(std::max(p_Size, m_Config.segmentSize), UINT32_MAX));
+        l_Offset = 0;
+    }
+
+    const Segment& l_Segment = m_Current.segments.back();
+    m_Cursor = l_Offset + p_Size;
+    m_FrameUsage += p_Size;
+
+    if (!m_Coherent)
+        VulkanContext::getDevice(m_Device).getBuffer(l_Segment.buffer).markDirty(l_Offset, p_Size);
+
+    return {l_Segment.buffer, l_Offset, l_Segment.data + l_Offset};
+}
+
+void VulkanFrameAllocator::free()
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    for (Frame& l_Frame : m_Pending)
+    {
+        l_Device.getFence(l_Frame.fence).wait();
+        releaseFrame(l_Frame);
+    }
+    m_Pending.clear();
+
+    // The frame being recorded was never submitted, or the caller already waited for it
+    releaseFrame(m_Current);
+    m_Current = {UINT32_MAX, {}};
+
+    for (const Segment& l_Segment : m_Ring)
+    {
+        l_Device.freeBuffer(l_Segment.buffer);
+    }
+    m_Ring.clear();
+    m_FreeRing.clear();
+
+    if (m_Pool != UINT32_MAX)
+    {
+        l_Device.getMemoryAllocator().destroyPool(m_Pool);
+        m_Pool = UINT32_MAX;
+    }
+}
+
+VulkanFrameAllocator::Segment VulkanFrameAllocator::createSegment(const VkDeviceSize p_Size, const uint32_t p_RingIndex)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+
+    VulkanMemoryAllocator::MemoryPreferences l_Prefs{};
+    l_Prefs.vmaFlags = FRAME_ALLOCATION_FLAGS;
+    if (p_RingIndex != UINT32_MAX)
+        l_Prefs.pool = m_Pool;
+
+    const ResourceID l_Buffer = l_Device.createAndAllocateBuffer(l_Prefs, {p_Size, m_Config.usage});
+    return {l_Buffer, static_cast<uint8_t*>(l_Device.getBuffer(l_Buffer).getMappedData()), p_Size, p_RingIndex};
+}
+
+VulkanFrameAllocator::Segment VulkanFrameAllocator::acquireSegment()
+{
+    // beginFrame keeps at most framesInFlight frames pending, so this only runs dry if the ring was already freed
+    if (m_FreeRing.empty())
+    {
+        LOG_WARN("Frame allocator ran out of ring segments, spilling into a regular allocation");
+        return createSegment(m_Config.segmentSize, UINT32_MAX);
+    }
+
+    const uint32_t l_Index = m_FreeRing.back();
+    m_FreeRing.pop_back();
+    return m_Ring[l_Index];
+}
+
+void VulkanFrameAllocator::releaseFrame(Frame& p_Frame)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    for (const Segment& l_Segment : p_Frame.segments)
+    {
+        if (l_Segment.ringIndex != UINT32_MAX)
+            m_FreeRing.push_back(l_Segment.ringIndex);
+        else
+            l_Device.freeBuffer(l_Segment.buffer);
+    }
+    p_Frame.segments.clear();
+}
+
+void VulkanFrameAllocator::reclaim()
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    while (!m_Pending.empty() && l_Device.getFence(m_Pending.front().fence).poll())
+    {
+        releaseFrame(m_Pending.front());
+        m_Pending.pop_front();
+    }
+}
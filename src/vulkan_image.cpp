@@ -1,17 +1,30 @@
 #include "vulkan_image.hpp"
 
+#include <algorithm>
+#include <bit>
 #include <ranges>
 #include <stdexcept>
+#include <utility>
 #include <vulkan/vk_enum_string_helper.h>
 
+#include "ext/vulkan_host_image_copy.hpp"
 #include "utils/logger.hpp"
 #include "vulkan_base.hpp"
 #include "vulkan_command_buffer.hpp"
 #include "vulkan_context.hpp"
 #include "vulkan_device.hpp"
 
-VulkanImageView::VulkanImageView(const ResourceID p_Device, const VkImageView p_VkHandle)
-    : VulkanDeviceSubresource(p_Device), m_VkHandle(p_VkHandle) {}
+VulkanImageView::VulkanImageView(const ResourceID p_Device, const VkImageView p_VkHandle, const VkFormat p_Format, const VkImageViewType p_ViewType, const VkImageSubresourceRange& p_Range,
+                                 const VkComponentMapping& p_Components)
+    : VulkanDeviceSubresource(p_Device), m_VkHandle(p_VkHandle), m_Format(p_Format), m_ViewType(p_ViewType), m_Range(p_Range), m_Components(p_Components) {}
+
+bool VulkanImageView::matches(const VkFormat p_Format, const VkImageViewType p_ViewType, const VkImageSubresourceRange& p_Range, const VkComponentMapping& p_Components) const
+{
+    return m_Format == p_Format && m_ViewType == p_ViewType
+        && m_Range.aspectMask == p_Range.aspectMask && m_Range.baseMipLevel == p_Range.baseMipLevel && m_Range.levelCount == p_Range.levelCount
+        && m_Range.baseArrayLayer == p_Range.baseArrayLayer && m_Range.layerCount == p_Range.layerCount
+        && m_Components.r == p_Components.r && m_Components.g == p_Components.g && m_Components.b == p_Components.b && m_Components.a == p_Components.a;
+}
 
 VulkanImageSampler::VulkanImageSampler(const ResourceID p_Device, const VkSampler p_VkHandle)
     : VulkanDeviceSubresource(p_Device), m_VkHandle(p_VkHandle) {}
@@ -23,6 +36,75 @@ void VulkanImageSampler::free()
     Logger::print(Logger::DEBUG, "Destroyed image sampler ", m_ID);
 }
 
+static void hashCombine(size_t& p_Seed, const uint64_t p_Value)
+{
+    p_Seed ^= std::hash<uint64_t>{}(p_Value) + 0x9e3779b97f4a7c15ULL + (p_Seed << 6) + (p_Seed >> 2);
+}
+
+size_t VulkanImageSampler::KeyHash::operator()(const Key& p_Key) const
+{
+    size_t l_Hash = std::hash<uint64_t>{}(static_cast<uint64_t>(p_Key.flags) << 32 | static_cast<uint64_t>(p_Key.magFilter) << 16 | p_Key.minFilter);
+    hashCombine(l_Hash, static_cast<uint64_t>(p_Key.mipmapMode) << 48 | static_cast<uint64_t>(p_Key.addressModeU) << 32 | static_cast<uint64_t>(p_Key.addressModeV) << 16 | p_Key.addressModeW);
+    hashCombine(l_Hash, static_cast<uint64_t>(p_Key.mipLodBias) << 32 | p_Key.maxAnisotropy);
+    hashCombine(l_Hash, static_cast<uint64_t>(p_Key.minLod) << 32 | p_Key.maxLod);
+    hashCombine(l_Hash, static_cast<uint64_t>(p_Key.compareOp) << 32 | p_Key.borderColor);
+    hashCombine(l_Hash, static_cast<uint64_t>(p_Key.anisotropyEnable) << 2 | p_Key.compareEnable << 1 | p_Key.unnormalizedCoordinates);
+    hashCombine(l_Hash, static_cast<uint64_t>(p_Key.reductionMode) << 32 | p_Key.customBorderFormat);
+    hashCombine(l_Hash, static_cast<uint64_t>(p_Key.customBorderColor[0]) << 32 | p_Key.customBorderColor[1]);
+    hashCombine(l_Hash, static_cast<uint64_t>(p_Key.customBorderColor[2]) << 32 | p_Key.customBorderColor[3]);
+    return l_Hash;
+}
+
+bool VulkanImageSampler::makeKey(const VkSamplerCreateInfo& p_CreateInfo, Key& p_Key)
+{
+    p_Key = {};
+    p_Key.flags = p_CreateInfo.flags;
+    p_Key.magFilter = p_CreateInfo.magFilter;
+    p_Key.minFilter = p_CreateInfo.minFilter;
+    p_Key.mipmapMode = p_CreateInfo.mipmapMode;
+    p_Key.addressModeU = p_CreateInfo.addressModeU;
+    p_Key.addressModeV = p_CreateInfo.addressModeV;
+    p_Key.addressModeW = p_CreateInfo.addressModeW;
+    p_Key.mipLodBias = std::bit_cast<uint32_t>(p_CreateInfo.mipLodBias);
+    p_Key.minLod = std::bit_cast<uint32_t>(p_CreateInfo.minLod);
+    p_Key.maxLod = std::bit_cast<uint32_t>(p_CreateInfo.maxLod);
+    p_Key.anisotropyEnable = p_CreateInfo.anisotropyEnable;
+    p_Key.compareEnable = p_CreateInfo.compareEnable;
+    p_Key.unnormalizedCoordinates = p_CreateInfo.unnormalizedCoordinates;
+
+    // Ignored state stays zeroed so it can't split otherwise equal samplers
+    if (p_CreateInfo.anisotropyEnable)
+        p_Key.maxAnisotropy = std::bit_cast<uint32_t>(p_CreateInfo.maxAnisotropy);
+    if (p_CreateInfo.compareEnable)
+        p_Key.compareOp = p_CreateInfo.compareOp;
+    const bool l_UsesBorder = p_CreateInfo.addressModeU == VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER || p_CreateInfo.addressModeV == VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER
+                              || p_CreateInfo.addressModeW == VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    if (l_UsesBorder)
+        p_Key.borderColor = p_CreateInfo.borderColor;
+
+    for (const VkBaseInStructure* l_Next = static_cast<const VkBaseInStructure*>(p_CreateInfo.pNext); l_Next != nullptr; l_Next = l_Next->pNext)
+    {
+        if (l_Next->sType == VK_STRUCTURE_TYPE_SAMPLER_REDUCTION_MODE_CREATE_INFO)
+        {
+            p_Key.reductionMode = reinterpret_cast<const VkSamplerReductionModeCreateInfo*>(l_Next)->reductionMode;
+        }
+        else if (l_Next->sType == VK_STRUCTURE_TYPE_SAMPLER_CUSTOM_BORDER_COLOR_CREATE_INFO_EXT)
+        {
+            if (!l_UsesBorder)
+                continue;
+            const auto* l_Border = reinterpret_cast<const VkSamplerCustomBorderColorCreateInfoEXT*>(l_Next);
+            for (uint32_t i = 0; i < 4; i++)
+                p_Key.customBorderColor[i] = l_Border->customBorderColor.uint32[i];
+            p_Key.customBorderFormat = l_Border->format;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 void VulkanImageView::free()
 {
     const VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
@@ -61,6 +143,21 @@ VkImageType VulkanImage::getType() const
     return m_Type;
 }
 
+VkFormat VulkanImage::getFormat() const
+{
+    return m_Format;
+}
+
+VulkanImage::Config VulkanImage::getConfig() const
+{
+    return {m_Type, m_Format, m_Size, m_Usage, m_Flags, m_Tiling, m_MipLevels, m_ArrayLayers, m_Samples};
+}
+
+VkImageSubresourceRange VulkanImage::getFullRange() const
+{
+    return {getAspectFlags(), 0, m_MipLevels, 0, m_ArrayLayers};
+}
+
 VkImageLayout VulkanImage::getLayout() const
 {
     return m_Layout;
@@ -81,65 +178,188 @@ void VulkanImage::setQueue(const uint32_t p_QueueFamilyIndex)
     m_QueueFamilyIndex = p_QueueFamilyIndex;
 }
 
+bool VulkanImage::canCopyFromHost(const VkImageLayout p_Layout) const
+{
+    if (!(m_Usage & VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT))
+        return false;
+
+    const VulkanHostImageCopyExtension* l_Extension = VulkanHostImageCopyExtension::get(getDeviceID());
+    return l_Extension != nullptr && l_Extension->isCopyDstLayout(p_Layout) && l_Extension->isFormatSupported(m_Format, m_Tiling);
+}
+
+void VulkanImage::copyFromHost(const void* p_Data, const VkImageSubresourceLayers& p_Subresource, const VkOffset3D p_Offset, const VkExtent3D p_Extent, const VkImageLayout p_Layout)
+{
+    if (!canCopyFromHost(p_Layout))
+    {
+        throw std::runtime_error("Tried to copy from host into image (ID:" + std::to_string(getID()) + "), but host image copies into layout " + string_VkImageLayout(p_Layout) + " are not available for it");
+    }
+
+    const VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
+
+    if (m_Layout != p_Layout)
+    {
+        VkHostImageLayoutTransitionInfoEXT l_Transition{};
+        l_Transition.sType = VK_STRUCTURE_TYPE_HOST_IMAGE_LAYOUT_TRANSITION_INFO_EXT;
+        l_Transition.image = m_VkHandle;
+        l_Transition.oldLayout = m_Layout;
+        l_Transition.newLayout = p_Layout;
+        l_Transition.subresourceRange = getFullRange();
+        VULKAN_TRY(l_Device.getTable().vkTransitionImageLayoutEXT(*l_Device, 1, &l_Transition));
+        m_Layout = p_Layout;
+    }
+
+    VkMemoryToImageCopyEXT l_Region{};
+    l_Region.sType = VK_STRUCTURE_TYPE_MEMORY_TO_IMAGE_COPY_EXT;
+    l_Region.pHostPointer = p_Data;
+    l_Region.memoryRowLength = 0;
+    l_Region.memoryImageHeight = 0;
+    l_Region.imageSubresource = p_Subresource;
+    l_Region.imageOffset = p_Offset;
+    l_Region.imageExtent = p_Extent;
+
+    VkCopyMemoryToImageInfoEXT l_CopyInfo{};
+    l_CopyInfo.sType = VK_STRUCTURE_TYPE_COPY_MEMORY_TO_IMAGE_INFO_EXT;
+    l_CopyInfo.dstImage = m_VkHandle;
+    l_CopyInfo.dstImageLayout = p_Layout;
+    l_CopyInfo.regionCount = 1;
+    l_CopyInfo.pRegions = &l_Region;
+    VULKAN_TRY(l_Device.getTable().vkCopyMemoryToImageEXT(*l_Device, &l_CopyInfo));
+
+    LOG_DEBUG("Copied ", p_Extent.width, "x", p_Extent.height, "x", p_Extent.depth, " texels from host into image (ID:", getID(), ")");
+}
+
 VkImage VulkanImage::operator*() const
 {
     return m_VkHandle;
 }
 
-ResourceID VulkanImage::createImageView(const VkFormat p_Format, const VkImageAspectFlags p_AspectFlags)
+VkImageAspectFlags VulkanImage::getAspectFlags(const VkFormat p_Format)
+{
+    switch (p_Format)
+    {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+        return VK_IMAGE_ASPECT_DEPTH_BIT;
+    case VK_FORMAT_S8_UINT:
+        return VK_IMAGE_ASPECT_STENCIL_BIT;
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+        return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    default:
+        return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+}
+
+uint32_t VulkanImage::getFullMipCount(const VkExtent3D p_Extent)
+{
+    const uint32_t l_Largest = std::max({p_Extent.width, p_Extent.height, p_Extent.depth});
+    return static_cast<uint32_t>(std::bit_width(l_Largest));
+}
+
+VkImageViewType VulkanImage::getDefaultViewType() const
 {
-    VkImageViewType l_Type = VK_IMAGE_VIEW_TYPE_MAX_ENUM;
     switch (m_Type)
     {
     case VK_IMAGE_TYPE_1D:
-        l_Type = VK_IMAGE_VIEW_TYPE_1D;
-        break;
+        return m_ArrayLayers > 1 ? VK_IMAGE_VIEW_TYPE_1D_ARRAY : VK_IMAGE_VIEW_TYPE_1D;
     case VK_IMAGE_TYPE_2D:
-        l_Type = VK_IMAGE_VIEW_TYPE_2D;
-        break;
+        if ((m_Flags & VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT) && m_ArrayLayers % 6 == 0)
+            return m_ArrayLayers > 6 ? VK_IMAGE_VIEW_TYPE_CUBE_ARRAY : VK_IMAGE_VIEW_TYPE_CUBE;
+        return m_ArrayLayers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
     case VK_IMAGE_TYPE_3D:
-        l_Type = VK_IMAGE_VIEW_TYPE_3D;
-        break;
+        return VK_IMAGE_VIEW_TYPE_3D;
     default:
-        throw std::invalid_argument("Invalid image type on create view, requested: " + std::to_string(l_Type));
+        throw std::invalid_argument("Invalid image type on create view, requested: " + std::to_string(m_Type));
     }
+}
 
+VkImageView VulkanImage::createViewHandle(const VkFormat p_Format, const VkImageViewType p_ViewType, const VkImageSubresourceRange& p_Range, const VkComponentMapping& p_Components) const
+{
     VkImageViewCreateInfo l_CreateInfo = {};
     l_CreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     l_CreateInfo.image = m_VkHandle;
-    l_CreateInfo.viewType = l_Type;
+    l_CreateInfo.viewType = p_ViewType;
     l_CreateInfo.format = p_Format;
-    l_CreateInfo.subresourceRange.aspectMask = p_AspectFlags;
-    l_CreateInfo.subresourceRange.baseMipLevel = 0;
-    l_CreateInfo.subresourceRange.levelCount = 1;
-    l_CreateInfo.subresourceRange.baseArrayLayer = 0;
-    l_CreateInfo.subresourceRange.layerCount = 1;
+    l_CreateInfo.components = p_Components;
+    l_CreateInfo.subresourceRange = p_Range;
 
     const VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
 
     VkImageView l_ImageView;
     VULKAN_TRY(l_Device.getTable().vkCreateImageView(l_Device.m_VkHandle, &l_CreateInfo, nullptr, &l_ImageView));
+    return l_ImageView;
+}
+
+ResourceID VulkanImage::createImageView(const VkFormat p_Format, const VkImageAspectFlags p_AspectFlags)
+{
+    return createImageView(p_Format, getDefaultViewType(), {p_AspectFlags, 0, m_MipLevels, 0, m_ArrayLayers});
+}
+
+static VkComponentSwizzle normalizeSwizzle(const VkComponentSwizzle p_Swizzle, const VkComponentSwizzle p_Own)
+{
+    return p_Swizzle == p_Own ? VK_COMPONENT_SWIZZLE_IDENTITY : p_Swizzle;
+}
+
+ResourceID VulkanImage::createImageView(const VkFormat p_Format, const VkImageViewType p_ViewType, const VkImageSubresourceRange& p_Range, const VkComponentMapping& p_Components)
+{
+    // Spelled out counts and swizzles that name their own channel are the same view as the shorthand, so they share a cache entry
+    VkImageSubresourceRange l_Range = p_Range;
+    if (l_Range.levelCount == VK_REMAINING_MIP_LEVELS)
+        l_Range.levelCount = m_MipLevels - l_Range.baseMipLevel;
+    if (l_Range.layerCount == VK_REMAINING_ARRAY_LAYERS)
+        l_Range.layerCount = m_ArrayLayers - l_Range.baseArrayLayer;
+    const VkComponentMapping l_Components{
+        normalizeSwizzle(p_Components.r, VK_COMPONENT_SWIZZLE_R),
+        normalizeSwizzle(p_Components.g, VK_COMPONENT_SWIZZLE_G),
+        normalizeSwizzle(p_Components.b, VK_COMPONENT_SWIZZLE_B),
+        normalizeSwizzle(p_Components.a, VK_COMPONENT_SWIZZLE_A)
+    };
+
+    for (VulkanImageView* l_View : m_ImageViews)
+    {
+        if (l_View->matches(p_Format, p_ViewType, l_Range, l_Components))
+        {
+            l_View->m_References++;
+            return l_View->getID();
+        }
+    }
 
-    VulkanImageView* l_ImageViewObj = ARENA_ALLOC(VulkanImageView)(getDeviceID(), l_ImageView);
-    m_ImageViews.emplace(l_ImageViewObj->getID(), l_ImageViewObj);
+    VulkanImageView* l_ImageViewObj = ARENA_ALLOC(VulkanImageView)(getDeviceID(), createViewHandle(p_Format, p_ViewType, l_Range, l_Components), p_Format, p_ViewType, l_Range, l_Components);
+    m_ImageViews.push_back(l_ImageViewObj);
     Logger::print(Logger::DEBUG, "Created image view ", l_ImageViewObj->getID(), " for image ", m_ID);
     return l_ImageViewObj->getID();
 }
 
+ResourceID VulkanImage::createMipView(const uint32_t p_MipLevel)
+{
+    VkImageViewType l_ViewType = getDefaultViewType();
+    if (l_ViewType == VK_IMAGE_VIEW_TYPE_CUBE || l_ViewType == VK_IMAGE_VIEW_TYPE_CUBE_ARRAY)
+        l_ViewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+    return createImageView(m_Format, l_ViewType, {getAspectFlags(), p_MipLevel, 1, 0, m_ArrayLayers});
+}
+
+ResourceID VulkanImage::createLayerView(const uint32_t p_ArrayLayer, const uint32_t p_MipLevel)
+{
+    const VkImageViewType l_ViewType = m_Type == VK_IMAGE_TYPE_1D ? VK_IMAGE_VIEW_TYPE_1D : m_Type == VK_IMAGE_TYPE_3D ? VK_IMAGE_VIEW_TYPE_3D : VK_IMAGE_VIEW_TYPE_2D;
+    return createImageView(m_Format, l_ViewType, {getAspectFlags(), p_MipLevel, 1, p_ArrayLayer, 1});
+}
+
 VulkanImageView& VulkanImage::getImageView(const ResourceID p_ImageView)
 {
-    if (m_ImageViews.contains(p_ImageView))
+    if (VulkanImageView* l_View = getImageViewPtr(p_ImageView))
     {
-        return *m_ImageViews.at(p_ImageView);
+        return *l_View;
     }
     throw std::runtime_error("Tried to get image view that doesn't belong to image " + std::to_string(m_ID));
 }
 
 const VulkanImageView& VulkanImage::getImageView(const ResourceID p_ImageView) const
 {
-    if (m_ImageViews.contains(p_ImageView))
+    if (const VulkanImageView* l_View = getImageViewPtr(p_ImageView))
     {
-        return *m_ImageViews.at(p_ImageView);
+        return *l_View;
     }
     throw std::runtime_error("Tried to get image view that doesn't belong to image " + std::to_string(m_ID));
 }
@@ -164,23 +384,30 @@ const VulkanImageSampler& VulkanImage::getSampler(const ResourceID p_Sampler) co
 
 VulkanImageView* VulkanImage::getImageViewPtr(const ResourceID p_ImageView) const
 {
-    if (m_ImageViews.contains(p_ImageView))
+    for (VulkanImageView* l_View : m_ImageViews)
     {
-        return m_ImageViews.at(p_ImageView);
+        if (l_View->getID() == p_ImageView)
+            return l_View;
     }
     return nullptr;
 }
 
 void VulkanImage::freeImageView(const ResourceID p_ImageView)
 {
-    VulkanImageView* l_ImageView = getImageViewPtr(p_ImageView);
-    if (l_ImageView == nullptr)
+    for (uint32_t i = 0; i < m_ImageViews.size(); i++)
     {
-        throw std::runtime_error("Tried to free image view that doesn't belong to image " + std::to_string(m_ID));
+        VulkanImageView* l_ImageView = m_ImageViews[i];
+        if (l_ImageView->getID() != p_ImageView)
+            continue;
+
+        if (--l_ImageView->m_References > 0)
+            return;
+        l_ImageView->free();
+        ARENA_FREE(l_ImageView, sizeof(VulkanImageView));
+        m_ImageViews.eraseUnordered(i);
+        return;
     }
-    l_ImageView->free();
-    ARENA_FREE(l_ImageView, sizeof(VulkanImageView));
-    m_ImageViews.erase(p_ImageView);
+    throw std::runtime_error("Tried to free image view that doesn't belong to image " + std::to_string(m_ID));
 }
 
 void VulkanImage::freeImageView(const VulkanImageView& p_ImageView)
@@ -208,14 +435,12 @@ ResourceID VulkanImage::createSampler(const VkFilter p_Filter, const VkSamplerAd
     l_CreateInfo.minLod = 0.0f;
     l_CreateInfo.maxLod = 0.0f;
 
-    const VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
-
-    VkSampler l_Sampler;
-    VULKAN_TRY(l_Device.getTable().vkCreateSampler(l_Device.m_VkHandle, &l_CreateInfo, nullptr, &l_Sampler));
-
-    VulkanImageSampler* l_SamplerObj = ARENA_ALLOC(VulkanImageSampler)(getDeviceID(), l_Sampler);
-    m_Samplers.emplace(l_SamplerObj->getID(), l_SamplerObj);
-    return l_SamplerObj->getID();
+    VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
+    const ResourceID l_Sampler = l_Device.acquireSampler(l_CreateInfo);
+    // The image only ever holds one reference to each sampler
+    if (!m_Samplers.emplace(l_Sampler, &l_Device.getSampler(l_Sampler)).second)
+        l_Device.releaseSampler(l_Sampler);
+    return l_Sampler;
 }
 
 VulkanImageSampler* VulkanImage::getSamplerPtr(const ResourceID p_Sampler) const
@@ -234,9 +459,8 @@ void VulkanImage::freeSampler(const ResourceID p_Sampler)
     {
         throw std::runtime_error("Tried to free sampler that doesn't belong to image " + std::to_string(m_ID));
     }
-    l_Sampler->free();
-    ARENA_FREE(l_Sampler, sizeof(VulkanImageSampler));
     m_Samplers.erase(p_Sampler);
+    VulkanContext::getDevice(getDeviceID()).releaseSampler(p_Sampler);
 }
 
 void VulkanImage::freeSampler(const VulkanImageSampler& p_Sampler)
@@ -247,26 +471,45 @@ void VulkanImage::freeSampler(const VulkanImageSampler& p_Sampler)
 VulkanImage::VulkanImage(const ResourceID p_Device, const VkImage p_VkHandle, const VkExtent3D p_Size, const VkImageType p_Type, const VkImageLayout p_Layout)
     : VulkanMemArray(p_Device), m_Size(p_Size), m_Type(p_Type), m_Layout(p_Layout), m_VkHandle(p_VkHandle) {}
 
+VulkanImage::VulkanImage(const ResourceID p_Device, const VkImage p_VkHandle, const Config& p_Config, const VkImageLayout p_Layout)
+    : VulkanMemArray(p_Device), m_Size(p_Config.extent), m_Type(p_Config.type), m_Layout(p_Layout), m_Format(p_Config.format),
+      m_Usage(p_Config.usage), m_Flags(p_Config.flags), m_Tiling(p_Config.tiling), m_MipLevels(p_Config.mipLevels), m_ArrayLayers(p_Config.arrayLayers),
+      m_Samples(p_Config.samples), m_VkHandle(p_VkHandle) {}
+
 void VulkanImage::setBoundMemory(const VmaAllocation p_Allocation)
 {
     m_Allocation = p_Allocation;
+    updateMappingState();
+}
+
+void VulkanImage::swapHandle(VulkanImage& p_Other)
+{
+    std::swap(m_VkHandle, p_Other.m_VkHandle);
+
+    // Views keep their IDs but get rebuilt on the new image. The old view handles go to p_Other, so they are destroyed together with the old image
+    for (VulkanImageView* l_View : m_ImageViews)
+    {
+        VulkanImageView* l_OldView = ARENA_ALLOC(VulkanImageView)(getDeviceID(), l_View->m_VkHandle, l_View->m_Format, l_View->m_ViewType, l_View->m_Range, l_View->m_Components);
+        p_Other.m_ImageViews.push_back(l_OldView);
+        l_View->m_VkHandle = createViewHandle(l_View->m_Format, l_View->m_ViewType, l_View->m_Range, l_View->m_Components);
+    }
 }
 
 void VulkanImage::free()
 {
     VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
 
-    for (VulkanImageView* l_ImageView : m_ImageViews | std::views::values)
+    for (VulkanImageView* l_ImageView : m_ImageViews)
     {
         l_ImageView->free();
         ARENA_FREE(l_ImageView, sizeof(VulkanImageView));
     }
     m_ImageViews.clear();
 
-    for (VulkanImageSampler* l_Sampler : m_Samplers | std::views::values)
+    // Released by ID, the device may already have destroyed the samplers while tearing down
+    for (const ResourceID l_Sampler : m_Samplers | std::views::keys)
     {
-        l_Sampler->free();
-        ARENA_FREE(l_Sampler, sizeof(VulkanImageSampler));
+        l_Device.releaseSampler(l_Sampler);
     }
     m_Samplers.clear();
 
@@ -280,6 +523,9 @@ void VulkanImage::free()
 
     if (m_Allocation)
     {
+        if (isMemoryMapped() && !m_PersistentlyMapped)
+            unmap();
+        m_MappedData = nullptr;
         l_Device.m_MemoryAllocator.deallocate(m_Allocation);
         m_Allocation = VK_NULL_HANDLE;
     }
@@ -1,11 +1,14 @@
 #include "vulkan_memory.hpp"
 
 #include <algorithm>
+#include <array>
 #include <ranges>
 #include <stdexcept>
+#include <tuple>
 #include <vulkan/vk_enum_string_helper.h>
 #include <Volk/volk.h>
 
+#include "ext/vulkan_memory_priority.hpp"
 #include "utils/logger.hpp"
 #include "vulkan_context.hpp"
 #include "vulkan_device.hpp"
@@ -141,6 +144,32 @@ bool VulkanMemoryAllocator::PoolPreferences::operator==(const PoolPreferences& p
     return l_Equal && pNextIdentifier == p_Other.pNextIdentifier;
 }
 
+static void hashCombine(size_t& p_Seed, const uint64_t p_Value)
+{
+    p_Seed ^= std::hash<uint64_t>{}(p_Value) + 0x9e3779b97f4a7c15ULL + (p_Seed << 6) + (p_Seed >> 2);
+}
+
+size_t VulkanMemoryAllocator::PoolPreferencesHash::operator()(const PoolPreferences& p_Prefs) const
+{
+    // Must agree with operator==, which only compares the pNext identifier when both sides have a pNext
+    size_t l_Hash = std::hash<uint64_t>{}(static_cast<uint64_t>(p_Prefs.memoryTypeIndex) << 32 | p_Prefs.flags);
+    hashCombine(l_Hash, p_Prefs.blockSize);
+    hashCombine(l_Hash, static_cast<uint64_t>(p_Prefs.minBlockCount) << 32 | p_Prefs.maxBlockCount);
+    hashCombine(l_Hash, std::hash<float>{}(p_Prefs.priority));
+    hashCombine(l_Hash, p_Prefs.customMinAlignment);
+    if (p_Prefs.pNext != nullptr)
+        hashCombine(l_Hash, p_Prefs.pNextIdentifier);
+    return l_Hash;
+}
+
+size_t VulkanMemoryAllocator::MemoryTypeKeyHash::operator()(const MemoryTypeKey& p_Key) const
+{
+    size_t l_Hash = std::hash<uint64_t>{}(static_cast<uint64_t>(p_Key.typeBits) << 32 | p_Key.usage);
+    hashCombine(l_Hash, static_cast<uint64_t>(p_Key.flags) << 32 | p_Key.pool);
+    hashCombine(l_Hash, static_cast<uint64_t>(p_Key.desiredProperties) << 32 | p_Key.preferredProperties);
+    return l_Hash;
+}
+
 uint32_t VulkanMemoryAllocator::findMemoryType(const MemoryPreferences& p_Preferences) const
 {
     return findMemoryType(p_Preferences, UINT32_MAX);
@@ -161,14 +190,21 @@ uint32_t VulkanMemoryAllocator::findMemoryType(const MemoryPreferences& p_Prefer
     if (!l_AllMask) 
         return UINT32_MAX;
 
+    const MemoryTypeKey l_Key{l_AllMask, p_Preferences.usage, p_Preferences.vmaFlags, p_Preferences.pool, p_Preferences.desiredProperties, p_Preferences.preferredProperties};
+    const auto l_Cached = m_MemoryTypeCache.find(l_Key);
+    if (l_Cached != m_MemoryTypeCache.end())
+        return l_Cached->second;
+
     VmaAllocationCreateInfo l_Aci = toVmaAllocCI(p_Preferences, 0);
     uint32_t l_Idx = UINT32_MAX;
 
     l_Aci.memoryTypeBits = l_AllMask;
-    if (vmaFindMemoryTypeIndex(m_Allocator, l_AllMask, &l_Aci, &l_Idx) == VK_SUCCESS)
-        return l_Idx;
+    if (vmaFindMemoryTypeIndex(m_Allocator, l_AllMask, &l_Aci, &l_Idx) != VK_SUCCESS)
+        l_Idx = UINT32_MAX;
 
-    return UINT32_MAX;
+    // Failures are cached too, the answer only depends on the key
+    m_MemoryTypeCache.emplace(l_Key, l_Idx);
+    return l_Idx;
 }
 
 VmaAllocation VulkanMemoryAllocator::allocateMemArray(ResourceID p_MemArray, const MemoryPreferences& p_Preferences) const
@@ -245,20 +281,16 @@ VmaAllocation VulkanMemoryAllocator::allocateImage(const ResourceID p_Image, con
 
 uint32_t VulkanMemoryAllocator::getOrCreatePool(const PoolPreferences& p_Prefs)
 {
-    for (const PoolData& l_Pool : m_Pools)
+    const auto l_It = m_PoolsByPrefs.find(p_Prefs);
+    if (l_It != m_PoolsByPrefs.end())
     {
-        if (l_Pool.prefs == p_Prefs)
-        {
-            return l_Pool.id;
-        }
+        return l_It->second;
     }
     return createPool(p_Prefs);
 }
 
 uint32_t VulkanMemoryAllocator::createPool(const PoolPreferences& p_Prefs)
 {
-    static uint32_t l_NewID = 0;
-
     const VmaPoolCreateInfo l_Pci{
         .memoryTypeIndex = p_Prefs.memoryTypeIndex,
         .flags = p_Prefs.flags,
@@ -272,10 +304,31 @@ uint32_t VulkanMemoryAllocator::createPool(const PoolPreferences& p_Prefs)
 
     VmaPool l_Pool;
     VULKAN_TRY(vmaCreatePool(m_Allocator, &l_Pci, &l_Pool));
-    m_Pools.push_back({l_NewID++, l_Pool, p_Prefs});
-    m_Pools.back().prefs.pNext = m_Pools.back().prefs.pNext == nullptr ? nullptr : reinterpret_cast<void*>(UINT64_MAX);
-    LOG_DEBUG("Created memory pool with ID ", m_Pools.back().id, " for memory type ", p_Prefs.memoryTypeIndex);
-    return m_Pools.back().id;
+    const uint32_t l_ID = m_NextPoolID++;
+    PoolData& l_Data = m_Pools[l_ID] = {l_ID, l_Pool, p_Prefs};
+    // The caller's pNext chain won't outlive this call, only whether there was one matters for comparisons
+    l_Data.prefs.pNext = l_Data.prefs.pNext == nullptr ? nullptr : reinterpret_cast<void*>(UINT64_MAX);
+    m_PoolsByPrefs.try_emplace(l_Data.prefs, l_ID);
+    LOG_DEBUG("Created memory pool with ID ", l_ID, " for memory type ", p_Prefs.memoryTypeIndex);
+    return l_ID;
+}
+
+void VulkanMemoryAllocator::destroyPool(const uint32_t p_Id)
+{
+    const auto l_It = m_Pools.find(p_Id);
+    if (l_It == m_Pools.end())
+    {
+        LOG_WARN("Tried to destroy memory pool with ID ", p_Id, " but it doesn't exist");
+        return;
+    }
+
+    const auto l_ByPrefs = m_PoolsByPrefs.find(l_It->second.prefs);
+    if (l_ByPrefs != m_PoolsByPrefs.end() && l_ByPrefs->second == p_Id)
+        m_PoolsByPrefs.erase(l_ByPrefs);
+
+    vmaDestroyPool(m_Allocator, l_It->second.pool);
+    m_Pools.erase(l_It);
+    LOG_DEBUG("Destroyed memory pool with ID ", p_Id);
 }
 
 void* VulkanMemoryAllocator::map(const VmaAllocation p_Alloc) const
@@ -290,11 +343,90 @@ void VulkanMemoryAllocator::unmap(const VmaAllocation p_Alloc) const
     vmaUnmapMemory(m_Allocator, p_Alloc);
 }
 
-void VulkanMemoryAllocator::deallocate(const VmaAllocation p_Alloc) const
+void VulkanMemoryAllocator::deallocate(const VmaAllocation p_Alloc)
 {
+    m_DirtyRanges.erase(p_Alloc);
     vmaFreeMemory(m_Allocator, p_Alloc);
 }
 
+void VulkanMemoryAllocator::flush(const VmaAllocation p_Alloc, const VkDeviceSize p_Offset, const VkDeviceSize p_Size) const
+{
+    VULKAN_TRY(vmaFlushAllocation(m_Allocator, p_Alloc, p_Offset, p_Size));
+}
+
+void VulkanMemoryAllocator::invalidate(const VmaAllocation p_Alloc, const VkDeviceSize p_Offset, const VkDeviceSize p_Size) const
+{
+    VULKAN_TRY(vmaInvalidateAllocation(m_Allocator, p_Alloc, p_Offset, p_Size));
+}
+
+bool VulkanMemoryAllocator::isHostCoherent(const VmaAllocation p_Alloc) const
+{
+    VkMemoryPropertyFlags l_Flags = 0;
+    vmaGetAllocationMemoryProperties(m_Allocator, p_Alloc, &l_Flags);
+    return (l_Flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+}
+
+void VulkanMemoryAllocator::markDirty(const VmaAllocation p_Alloc, const VkDeviceSize p_Offset, const VkDeviceSize p_Size)
+{
+    if (p_Alloc == VK_NULL_HANDLE || p_Size == 0 || isHostCoherent(p_Alloc))
+        return;
+
+    const VkDeviceSize l_End = p_Size == VK_WHOLE_SIZE ? VK_WHOLE_SIZE : p_Offset + p_Size;
+    std::vector<DirtyRange>& l_Ranges = m_DirtyRanges[p_Alloc];
+
+    // Writes are mostly sequential, so grow the last range in place instead of appending
+    if (!l_Ranges.empty() && l_Ranges.back().begin <= p_Offset && p_Offset <= l_Ranges.back().end)
+    {
+        l_Ranges.back().end = std::max(l_Ranges.back().end, l_End);
+        return;
+    }
+    l_Ranges.push_back({p_Offset, l_End});
+}
+
+void VulkanMemoryAllocator::flushDirtyRanges()
+{
+    if (m_DirtyRanges.empty())
+        return;
+
+    TRANS_VECTOR(l_Allocations, VmaAllocation);
+    TRANS_VECTOR(l_Offsets, VkDeviceSize);
+    TRANS_VECTOR(l_Sizes, VkDeviceSize);
+
+    const auto l_Push = [&](const VmaAllocation p_Alloc, const DirtyRange& p_Range)
+    {
+        l_Allocations.push_back(p_Alloc);
+        l_Offsets.push_back(p_Range.begin);
+        l_Sizes.push_back(p_Range.end == VK_WHOLE_SIZE ? VK_WHOLE_SIZE : p_Range.end - p_Range.begin);
+    };
+
+    for (auto& [l_Alloc, l_Ranges] : m_DirtyRanges)
+    {
+        std::ranges::sort(l_Ranges, {}, &DirtyRange::begin);
+
+        DirtyRange l_Current = l_Ranges.front();
+        for (size_t i = 1; i < l_Ranges.size(); i++)
+        {
+            if (l_Ranges[i].begin <= l_Current.end)
+            {
+                l_Current.end = std::max(l_Current.end, l_Ranges[i].end);
+                continue;
+            }
+            l_Push(l_Alloc, l_Current);
+            l_Current = l_Ranges[i];
+        }
+        l_Push(l_Alloc, l_Current);
+    }
+
+    VULKAN_TRY(vmaFlushAllocations(m_Allocator, static_cast<uint32_t>(l_Allocations.size()), l_Allocations.data(), l_Offsets.data(), l_Sizes.data()));
+    LOG_DEBUG("Flushed ", l_Allocations.size(), " dirty range(s) from ", m_DirtyRanges.size(), " allocation(s)");
+    m_DirtyRanges.clear();
+}
+
+bool VulkanMemoryAllocator::hasDirtyRanges() const
+{
+    return !m_DirtyRanges.empty();
+}
+
 const MemoryStructure& VulkanMemoryAllocator::getMemoryStructure() const
 {
     return m_MemoryStructure;
@@ -321,9 +453,69 @@ VulkanMemoryAllocator::VulkanMemoryAllocator(const VulkanDevice& p_Device)
     l_AllocInfo.vulkanApiVersion = VK_HEADER_VERSION_COMPLETE;
     l_AllocInfo.pVulkanFunctions = &l_Funcs;
 
+    if (p_Device.isExtensionEnabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+        l_AllocInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+    // Having the extension enabled isn't enough, VMA needs the memoryPriority feature that the extension class turns on
+    if (VulkanMemoryPriorityExtension::get(p_Device) != nullptr)
+        l_AllocInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_PRIORITY_BIT;
+    if (p_Device.isExtensionEnabled(VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME))
+        l_AllocInfo.flags |= VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+    m_BudgetTracked = l_AllocInfo.flags & VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+    m_PriorityEnabled = l_AllocInfo.flags & VMA_ALLOCATOR_CREATE_EXT_MEMORY_PRIORITY_BIT;
+
     VULKAN_TRY(vmaCreateAllocator(&l_AllocInfo, &m_Allocator));
 }
 
+void VulkanMemoryAllocator::setAllocationOwner(const VmaAllocation p_Allocation, const ResourceID p_Owner) const
+{
+    // Stored off by one so a null user data, as on allocations nobody claimed, reads back as no owner
+    vmaSetAllocationUserData(m_Allocator, p_Allocation, reinterpret_cast<void*>(static_cast<uintptr_t>(p_Owner) + 1));
+}
+
+ResourceID VulkanMemoryAllocator::getAllocationOwner(const VmaAllocation p_Allocation) const
+{
+    const uintptr_t l_UserData = reinterpret_cast<uintptr_t>(getAllocationInfo(p_Allocation).pUserData);
+    return l_UserData == 0 ? UINT32_MAX : static_cast<ResourceID>(l_UserData - 1);
+}
+
+void VulkanMemoryAllocator::setCurrentFrameIndex(const uint32_t p_FrameIndex) const
+{
+    vmaSetCurrentFrameIndex(m_Allocator, p_FrameIndex);
+}
+
+std::vector<VulkanMemoryAllocator::HeapBudget> VulkanMemoryAllocator::getHeapBudgets() const
+{
+    std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> l_Budgets{};
+    vmaGetHeapBudgets(m_Allocator, l_Budgets.data());
+
+    const uint32_t l_HeapCount = m_MemoryStructure.getMemoryHeapCount();
+    std::vector<HeapBudget> l_Result(l_HeapCount);
+    for (uint32_t l_Heap = 0; l_Heap < l_HeapCount; l_Heap++)
+    {
+        l_Result[l_Heap].usage = l_Budgets[l_Heap].usage;
+        l_Result[l_Heap].budget = l_Budgets[l_Heap].budget;
+        l_Result[l_Heap].allocationBytes = l_Budgets[l_Heap].statistics.allocationBytes;
+        l_Result[l_Heap].blockBytes = l_Budgets[l_Heap].statistics.blockBytes;
+        l_Result[l_Heap].deviceLocal = m_MemoryStructure.getMemoryProperties().memoryHeaps[l_Heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+    }
+    return l_Result;
+}
+
+VulkanMemoryAllocator::HeapBudget VulkanMemoryAllocator::getHeapBudget(const uint32_t p_Heap) const
+{
+    const std::vector<HeapBudget> l_Budgets = getHeapBudgets();
+    if (p_Heap >= l_Budgets.size())
+    {
+        throw std::runtime_error("Tried to get budget of memory heap " + std::to_string(p_Heap) + ", but the device only has " + std::to_string(l_Budgets.size()) + " heaps");
+    }
+    return l_Budgets[p_Heap];
+}
+
+uint32_t VulkanMemoryAllocator::getAllocationHeap(const VmaAllocation p_Allocation) const
+{
+    return m_MemoryStructure.getTypeData(getAllocationInfo(p_Allocation).memoryType).heapIndex;
+}
+
 VulkanMemoryAllocator::AllocationReturn VulkanMemoryAllocator::createBuffer(const VkBufferCreateInfo& p_Info, const MemoryPreferences& p_Preferences) const
 {
     const VmaAllocationCreateInfo l_Aci = toVmaAllocCI(p_Preferences, 0);
@@ -346,6 +538,236 @@ VulkanMemoryAllocator::AllocationReturn VulkanMemoryAllocator::createImage(const
     return { reinterpret_cast<uintptr_t>(l_Image), l_Alloc };
 }
 
+void VulkanMemoryAllocator::createBuffers(const std::span<const VkBufferCreateInfo> p_Infos, const MemoryPreferences& p_Preferences, const std::span<AllocationReturn> p_Results) const
+{
+    const VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    std::ranges::fill(p_Results, AllocationReturn{0, VK_NULL_HANDLE});
+
+    TRANS_VECTOR(l_Batched, uint32_t);
+    try
+    {
+        TRANS_VECTOR(l_Requirements, VkMemoryRequirements);
+        TRANS_VECTOR(l_MemoryTypes, uint32_t);
+        for (uint32_t i = 0; i < p_Infos.size(); i++)
+        {
+            VkBuffer l_Buffer;
+            VULKAN_TRY(l_Device.getTable().vkCreateBuffer(*l_Device, &p_Infos[i], nullptr, &l_Buffer));
+            p_Results[i].vkObj = reinterpret_cast<uintptr_t>(l_Buffer);
+
+            VkMemoryDedicatedRequirements l_Dedicated{};
+            l_Dedicated.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+            VkMemoryRequirements2 l_Reqs{};
+            l_Reqs.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+            l_Reqs.pNext = &l_Dedicated;
+            VkBufferMemoryRequirementsInfo2 l_ReqsInfo{};
+            l_ReqsInfo.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+            l_ReqsInfo.buffer = l_Buffer;
+            l_Device.getTable().vkGetBufferMemoryRequirements2(*l_Device, &l_ReqsInfo, &l_Reqs);
+
+            if (l_Dedicated.prefersDedicatedAllocation || l_Dedicated.requiresDedicatedAllocation)
+            {
+                l_Device.getTable().vkDestroyBuffer(*l_Device, l_Buffer, nullptr);
+                p_Results[i].vkObj = 0;
+                p_Results[i] = createBuffer(p_Infos[i], p_Preferences);
+                continue;
+            }
+
+            // Consecutive buffers usually share their create info, which saves VMA a temporary buffer per lookup
+            const bool l_SameAsLast = !l_Batched.empty() && p_Infos[l_Batched.back()].usage == p_Infos[i].usage && p_Infos[l_Batched.back()].flags == p_Infos[i].flags
+                && l_Requirements.back().memoryTypeBits == l_Reqs.memoryRequirements.memoryTypeBits;
+            l_MemoryTypes.push_back(l_SameAsLast ? l_MemoryTypes.back() : findMemoryType(p_Infos[i], l_Reqs.memoryRequirements, p_Preferences));
+            l_Batched.push_back(i);
+            l_Requirements.push_back(l_Reqs.memoryRequirements);
+        }
+
+        TRANS_VECTOR(l_BatchResults, AllocationReturn);
+        l_BatchResults.resize(l_Batched.size(), {0, VK_NULL_HANDLE});
+        allocatePages(l_Requirements, l_MemoryTypes, p_Preferences, l_BatchResults);
+        for (size_t i = 0; i < l_Batched.size(); i++)
+        {
+            p_Results[l_Batched[i]].allocation = l_BatchResults[i].allocation;
+        }
+
+        for (const uint32_t l_Index : l_Batched)
+        {
+            VULKAN_TRY(vmaBindBufferMemory(m_Allocator, p_Results[l_Index].allocation, p_Results[l_Index].as<VkBuffer>()));
+        }
+    }
+    catch (const std::runtime_error&)
+    {
+        // Nothing from a failed batch is handed out, so everything created so far goes away here
+        for (AllocationReturn& l_Result : p_Results)
+        {
+            if (l_Result.vkObj != 0)
+                l_Device.getTable().vkDestroyBuffer(*l_Device, l_Result.as<VkBuffer>(), nullptr);
+            if (l_Result.allocation != VK_NULL_HANDLE)
+                vmaFreeMemory(m_Allocator, l_Result.allocation);
+            l_Result = {0, VK_NULL_HANDLE};
+        }
+        throw;
+    }
+    LOG_DEBUG("Created ", p_Infos.size(), " buffers in batch, ", p_Infos.size() - l_Batched.size(), " of them with dedicated memory");
+}
+
+void VulkanMemoryAllocator::createImages(const std::span<const VkImageCreateInfo> p_Infos, const MemoryPreferences& p_Preferences, const std::span<AllocationReturn> p_Results) const
+{
+    const VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    std::ranges::fill(p_Results, AllocationReturn{0, VK_NULL_HANDLE});
+
+    TRANS_VECTOR(l_Batched, uint32_t);
+    try
+    {
+        TRANS_VECTOR(l_Requirements, VkMemoryRequirements);
+        TRANS_VECTOR(l_MemoryTypes, uint32_t);
+        for (uint32_t i = 0; i < p_Infos.size(); i++)
+        {
+            VkImage l_Image;
+            VULKAN_TRY(l_Device.getTable().vkCreateImage(*l_Device, &p_Infos[i], nullptr, &l_Image));
+            p_Results[i].vkObj = reinterpret_cast<uintptr_t>(l_Image);
+
+            VkMemoryDedicatedRequirements l_Dedicated{};
+            l_Dedicated.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+            VkMemoryRequirements2 l_Reqs{};
+            l_Reqs.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+            l_Reqs.pNext = &l_Dedicated;
+            VkImageMemoryRequirementsInfo2 l_ReqsInfo{};
+            l_ReqsInfo.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+            l_ReqsInfo.image = l_Image;
+            l_Device.getTable().vkGetImageMemoryRequirements2(*l_Device, &l_ReqsInfo, &l_Reqs);
+
+            // Render targets and other images the driver wants on their own memory would lose that in a shared page
+            if (l_Dedicated.prefersDedicatedAllocation || l_Dedicated.requiresDedicatedAllocation)
+            {
+                l_Device.getTable().vkDestroyImage(*l_Device, l_Image, nullptr);
+                p_Results[i].vkObj = 0;
+                p_Results[i] = createImage(p_Infos[i], p_Preferences);
+                continue;
+            }
+
+            // Consecutive images usually share their create info, which saves VMA a temporary image per lookup
+            const bool l_SameAsLast = !l_Batched.empty() && p_Infos[l_Batched.back()].usage == p_Infos[i].usage && p_Infos[l_Batched.back()].tiling == p_Infos[i].tiling
+                && p_Infos[l_Batched.back()].flags == p_Infos[i].flags && l_Requirements.back().memoryTypeBits == l_Reqs.memoryRequirements.memoryTypeBits;
+            l_MemoryTypes.push_back(l_SameAsLast ? l_MemoryTypes.back() : findMemoryType(p_Infos[i], l_Reqs.memoryRequirements, p_Preferences));
+            l_Batched.push_back(i);
+            l_Requirements.push_back(l_Reqs.memoryRequirements);
+        }
+
+        TRANS_VECTOR(l_BatchResults, AllocationReturn);
+        l_BatchResults.resize(l_Batched.size(), {0, VK_NULL_HANDLE});
+        allocatePages(l_Requirements, l_MemoryTypes, p_Preferences, l_BatchResults);
+        for (size_t i = 0; i < l_Batched.size(); i++)
+        {
+            p_Results[l_Batched[i]].allocation = l_BatchResults[i].allocation;
+        }
+
+        for (const uint32_t l_Index : l_Batched)
+        {
+            VULKAN_TRY(vmaBindImageMemory(m_Allocator, p_Results[l_Index].allocation, p_Results[l_Index].as<VkImage>()));
+        }
+    }
+    catch (const std::runtime_error&)
+    {
+        // Nothing from a failed batch is handed out, so everything created so far goes away here
+        for (AllocationReturn& l_Result : p_Results)
+        {
+            if (l_Result.vkObj != 0)
+                l_Device.getTable().vkDestroyImage(*l_Device, l_Result.as<VkImage>(), nullptr);
+            if (l_Result.allocation != VK_NULL_HANDLE)
+                vmaFreeMemory(m_Allocator, l_Result.allocation);
+            l_Result = {0, VK_NULL_HANDLE};
+        }
+        throw;
+    }
+    LOG_DEBUG("Created ", p_Infos.size(), " images in batch, ", p_Infos.size() - l_Batched.size(), " of them with dedicated memory");
+}
+
+uint32_t VulkanMemoryAllocator::findMemoryType(const VkBufferCreateInfo& p_Info, const VkMemoryRequirements& p_Reqs, const MemoryPreferences& p_Preferences) const
+{
+    if (p_Preferences.forceMemoryIndex != UINT32_MAX)
+        return (p_Reqs.memoryTypeBits & (1u << p_Preferences.forceMemoryIndex)) ? p_Preferences.forceMemoryIndex : UINT32_MAX;
+
+    // The AUTO usages need the buffer usage to pick a type, which only the buffer info lookup provides
+    const VmaAllocationCreateInfo l_Aci = toVmaAllocCI(p_Preferences, p_Reqs.memoryTypeBits);
+    uint32_t l_Idx;
+    if (vmaFindMemoryTypeIndexForBufferInfo(m_Allocator, &p_Info, &l_Aci, &l_Idx) != VK_SUCCESS)
+        return UINT32_MAX;
+    return l_Idx;
+}
+
+uint32_t VulkanMemoryAllocator::findMemoryType(const VkImageCreateInfo& p_Info, const VkMemoryRequirements& p_Reqs, const MemoryPreferences& p_Preferences) const
+{
+    if (p_Preferences.forceMemoryIndex != UINT32_MAX)
+        return (p_Reqs.memoryTypeBits & (1u << p_Preferences.forceMemoryIndex)) ? p_Preferences.forceMemoryIndex : UINT32_MAX;
+
+    const VmaAllocationCreateInfo l_Aci = toVmaAllocCI(p_Preferences, p_Reqs.memoryTypeBits);
+    uint32_t l_Idx;
+    if (vmaFindMemoryTypeIndexForImageInfo(m_Allocator, &p_Info, &l_Aci, &l_Idx) != VK_SUCCESS)
+        return UINT32_MAX;
+    return l_Idx;
+}
+
+void VulkanMemoryAllocator::allocatePages(const std::span<const VkMemoryRequirements> p_Requirements, const std::span<const uint32_t> p_MemoryTypes, const MemoryPreferences& p_Preferences, const std::span<AllocationReturn> p_Results) const
+{
+    const auto l_Key = [&](const uint32_t p_Index)
+    {
+        const VkMemoryRequirements& l_Reqs = p_Requirements[p_Index];
+        return std::tie(p_MemoryTypes[p_Index], l_Reqs.size, l_Reqs.alignment, l_Reqs.memoryTypeBits);
+    };
+
+    for (uint32_t i = 0; i < p_MemoryTypes.size(); i++)
+    {
+        if (p_MemoryTypes[i] == UINT32_MAX)
+        {
+            throw std::runtime_error("Failed to find a memory type for resource " + std::to_string(i) + " of a batch of " + std::to_string(p_Requirements.size()));
+        }
+    }
+
+    // Sorting brings resources with the same requirements next to each other, each run is then allocated in one call
+    TRANS_VECTOR(l_Order, uint32_t);
+    l_Order.resize(p_Requirements.size());
+    for (uint32_t i = 0; i < l_Order.size(); i++)
+        l_Order[i] = i;
+    std::ranges::sort(l_Order, {}, l_Key);
+
+    TRANS_VECTOR(l_Allocations, VmaAllocation);
+    size_t l_Runs = 0;
+    for (size_t l_Begin = 0; l_Begin < l_Order.size();)
+    {
+        size_t l_End = l_Begin + 1;
+        while (l_End < l_Order.size() && l_Key(l_Order[l_End]) == l_Key(l_Order[l_Begin]))
+            l_End++;
+
+        // vmaAllocateMemoryPages never sees the resources, so the AUTO usages are rejected there. The type was picked per
+        // resource above, the run only pins it. Host access flags only steer the AUTO choice and are dropped with it
+        VmaAllocationCreateInfo l_Aci = toVmaAllocCI(p_Preferences, 1u << p_MemoryTypes[l_Order[l_Begin]]);
+        l_Aci.usage = VMA_MEMORY_USAGE_UNKNOWN;
+        l_Aci.requiredFlags = 0;
+        l_Aci.preferredFlags = 0;
+        l_Aci.flags &= ~(VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_ALLOW_TRANSFER_INSTEAD_BIT);
+
+        l_Allocations.resize(l_End - l_Begin);
+        const VkResult l_Result = vmaAllocateMemoryPages(m_Allocator, &p_Requirements[l_Order[l_Begin]], &l_Aci, l_Allocations.size(), l_Allocations.data(), nullptr);
+        if (l_Result != VK_SUCCESS)
+        {
+            // VMA already rolled back the failed run, the earlier runs are released here so callers only clean up their handles
+            for (size_t i = 0; i < l_Begin; i++)
+            {
+                vmaFreeMemory(m_Allocator, p_Results[l_Order[i]].allocation);
+                p_Results[l_Order[i]].allocation = VK_NULL_HANDLE;
+            }
+            throw std::runtime_error("Failed to allocate memory for " + std::to_string(p_Requirements.size()) + " resources - " + string_VkResult(l_Result));
+        }
+        for (size_t i = l_Begin; i < l_End; i++)
+        {
+            p_Results[l_Order[i]].allocation = l_Allocations[i - l_Begin];
+        }
+
+        l_Runs++;
+        l_Begin = l_End;
+    }
+    LOG_DEBUG("Allocated ", p_Requirements.size(), " resources with ", l_Runs, " allocation calls");
+}
+
 VmaAllocationCreateInfo VulkanMemoryAllocator::toVmaAllocCI(const MemoryPreferences& p_Preferences, const uint32_t p_MemoryTypeBits) const
 {
     VmaAllocationCreateInfo l_Aci{};
@@ -353,10 +775,10 @@ VmaAllocationCreateInfo VulkanMemoryAllocator::toVmaAllocCI(const MemoryPreferen
     l_Aci.requiredFlags = p_Preferences.desiredProperties;
     l_Aci.preferredFlags = p_Preferences.preferredProperties;
     l_Aci.memoryTypeBits = p_MemoryTypeBits;
-    l_Aci.pool = p_Preferences.pool < m_Pools.size() ? getPool(p_Preferences.pool) : VK_NULL_HANDLE;
+    l_Aci.pool = p_Preferences.pool != UINT32_MAX ? getPool(p_Preferences.pool) : VK_NULL_HANDLE;
     l_Aci.flags = p_Preferences.vmaFlags;
 
-    if (VulkanContext::getDevice(m_Device).isExtensionEnabled(VK_EXT_MEMORY_PRIORITY_EXTENSION_NAME))
+    if (m_PriorityEnabled)
         l_Aci.priority = p_Preferences.priority;
 
     return l_Aci;
@@ -364,12 +786,10 @@ VmaAllocationCreateInfo VulkanMemoryAllocator::toVmaAllocCI(const MemoryPreferen
 
 VmaPool VulkanMemoryAllocator::getPool(const uint32_t p_Id) const
 {
-    for (const PoolData& l_Pool : m_Pools)
+    const auto l_It = m_Pools.find(p_Id);
+    if (l_It != m_Pools.end())
     {
-        if (l_Pool.id == p_Id)
-        {
-            return l_Pool.pool;
-        }
+        return l_It->second.pool;
     }
     LOG_WARN("Tried to get memory pool with ID ", p_Id, " but it doesn't exist");
     return VK_NULL_HANDLE;
@@ -748,6 +748,11 @@ void VulkanPipelineLayout::free()
         LOG_DEBUG("Freed pipeline layout (ID: ", m_ID, ")");
         m_VkHandle = VK_NULL_HANDLE;
     }
+    for (const ResourceID l_SetLayout : m_SetLayouts)
+    {
+        VulkanContext::getDevice(getDeviceID()).freeDescriptorSetLayout(l_SetLayout);
+    }
+    m_SetLayouts.clear();
 }
 
 VulkanPipelineLayout::VulkanPipelineLayout(const uint32_t p_Device, const VkPipelineLayout p_Handle, const size_t p_Hash)
@@ -6,9 +6,10 @@
 #include "vulkan_context.hpp"
 #include "vulkan_device.hpp"
 
-VulkanRenderPassBuilder& VulkanRenderPassBuilder::addAttachment(const VkAttachmentDescription& p_Attachment)
+VulkanRenderPassBuilder& VulkanRenderPassBuilder::addAttachment(const VkAttachmentDescription& p_Attachment, const AttachmentStore p_Store)
 {
     m_Attachments.push_back(p_Attachment);
+    m_AttachmentStores.push_back(p_Store);
     return *this;
 }
 
@@ -77,6 +78,62 @@ VkAttachmentDescription VulkanRenderPassBuilder::createAttachment(const VkFormat
     return l_Attachment;
 }
 
+static bool isAttachmentOnlyLayout(const VkImageLayout p_Layout)
+{
+    switch (p_Layout)
+    {
+    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+    case VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL:
+    case VK_IMAGE_LAYOUT_STENCIL_ATTACHMENT_OPTIMAL:
+    case VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL:
+        return true;
+    default:
+        return false;
+    }
+}
+
+std::vector<VkAttachmentDescription> VulkanRenderPassBuilder::resolveAttachments() const
+{
+    std::vector<VkAttachmentDescription> l_Attachments = m_Attachments;
+    for (uint32_t i = 0; i < l_Attachments.size(); i++)
+    {
+        VkAttachmentDescription& l_Attachment = l_Attachments[i];
+        bool l_Discard = m_AttachmentStores[i] == AttachmentStore::DISCARD;
+
+        if (m_AttachmentStores[i] == AttachmentStore::AUTO && isAttachmentOnlyLayout(l_Attachment.finalLayout))
+        {
+            for (const SubpassInfo& l_Subpass : m_Subpasses)
+            {
+                const bool l_IsDepth = l_Subpass.hasDepthStencilAttachment && l_Subpass.depthStencilAttachment.attachment == i;
+                // Only a color attachment with an actual resolve target has its contents kept elsewhere
+                bool l_IsResolvedColor = false;
+                if (l_Attachment.samples != VK_SAMPLE_COUNT_1_BIT)
+                {
+                    for (uint32_t j = 0; j < l_Subpass.colorAttachments.size() && j < l_Subpass.resolveAttachments.size(); j++)
+                    {
+                        if (l_Subpass.colorAttachments[j].attachment == i && l_Subpass.resolveAttachments[j].attachment != VK_ATTACHMENT_UNUSED)
+                            l_IsResolvedColor = true;
+                    }
+                }
+                if (l_IsDepth || l_IsResolvedColor)
+                {
+                    l_Discard = true;
+                    break;
+                }
+            }
+        }
+
+        if (l_Discard)
+        {
+            l_Attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            l_Attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            LOG_DEBUG("Render pass attachment ", i, " is not stored");
+        }
+    }
+    return l_Attachments;
+}
+
 VkRenderPass VulkanRenderPass::operator*() const
 {
     return m_VkHandle;
@@ -0,0 +1,302 @@
+#include "vulkan_residency.hpp"
+
+#include <algorithm>
+#include <array>
+#include <ranges>
+
+#include "utils/logger.hpp"
+#include "vulkan_command_buffer.hpp"
+#include "vulkan_device.hpp"
+#include "vulkan_sync.hpp"
+
+VulkanResidencyManager::VulkanResidencyManager(const ResourceID p_Device, const Config& p_Config)
+    : m_Device(p_Device), m_Config(p_Config)
+{
+    if (!VulkanContext::getDevice(m_Device).getMemoryAllocator().isBudgetTracked())
+    {
+        LOG_WARN("Residency manager created without VK_EXT_memory_budget, heap usage is only estimated from this device's own allocations");
+    }
+}
+
+void VulkanResidencyManager::track(const ResourceID p_Resource, const float p_Priority, const bool p_Streamable)
+{
+    m_Entries[p_Resource] = {p_Priority, m_Frame, p_Streamable, false, false};
+}
+
+void VulkanResidencyManager::untrack(const ResourceID p_Resource)
+{
+    m_Entries.erase(p_Resource);
+}
+
+void VulkanResidencyManager::setPriority(const ResourceID p_Resource, const float p_Priority)
+{
+    const auto l_It = m_Entries.find(p_Resource);
+    if (l_It != m_Entries.end())
+        l_It->second.priority = p_Priority;
+}
+
+void VulkanResidencyManager::markUsed(const ResourceID p_Resource)
+{
+    const auto l_It = m_Entries.find(p_Resource);
+    if (l_It != m_Entries.end())
+        l_It->second.lastUsedFrame = m_Frame;
+}
+
+bool VulkanResidencyManager::isDemoted(const ResourceID p_Resource) const
+{
+    const auto l_It = m_Entries.find(p_Resource);
+    return l_It != m_Entries.end() && l_It->second.demoted;
+}
+
+void VulkanResidencyManager::update(const uint32_t p_FrameIndex, const VulkanCommandBuffer& p_CommandBuffer, const ResourceID p_Fence)
+{
+    const VulkanMemoryAllocator& l_Allocator = VulkanContext::getDevice(m_Device).getMemoryAllocator();
+
+    m_Frame = p_FrameIndex;
+    l_Allocator.setCurrentFrameIndex(p_FrameIndex);
+
+    completeMigrations();
+    releaseRetired(false);
+
+    const std::vector<VulkanMemoryAllocator::HeapBudget> l_Budgets = l_Allocator.getHeapBudgets();
+    m_PendingRelease.resize(l_Budgets.size(), 0);
+
+    bool l_OverBudget = false;
+    for (uint32_t l_Heap = 0; l_Heap < l_Budgets.size(); l_Heap++)
+    {
+        const VulkanMemoryAllocator::HeapBudget& l_Budget = l_Budgets[l_Heap];
+        if (!l_Budget.deviceLocal || l_Budget.budget == 0)
+            continue;
+
+        const VkDeviceSize l_Usage = l_Budget.usage - std::min(l_Budget.usage, m_PendingRelease[l_Heap]);
+        if (static_cast<double>(l_Usage) <= static_cast<double>(l_Budget.budget) * m_Config.evictionThreshold)
+            continue;
+
+        const VkDeviceSize l_Target = static_cast<VkDeviceSize>(static_cast<double>(l_Budget.budget) * m_Config.targetUsage);
+        LOG_DEBUG("Memory heap ", l_Heap, " at ", VulkanMemoryAllocator::compactBytes(l_Usage), " of a ", VulkanMemoryAllocator::compactBytes(l_Budget.budget), " budget, evicting");
+        evict(l_Heap, l_Usage - std::min(l_Usage, l_Target), p_CommandBuffer, p_Fence);
+        l_OverBudget = true;
+    }
+
+    // Never bring anything back in the same frame something was pushed out
+    if (m_Config.promoteWhenIdle && !l_OverBudget)
+        promote(l_Budgets, p_CommandBuffer, p_Fence);
+}
+
+void VulkanResidencyManager::free()
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    for (const Migration& l_Migration : m_Migrations)
+    {
+        l_Device.getFence(l_Migration.fence).wait();
+    }
+    completeMigrations();
+    releaseRetired(true);
+
+    m_Entries.clear();
+    m_PendingRelease.clear();
+}
+
+void VulkanResidencyManager::completeMigrations()
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+
+    std::erase_if(m_Migrations, [&](const Migration& l_Migration)
+    {
+        if (!l_Device.getFence(l_Migration.fence).poll())
+            return false;
+
+        VulkanBuffer* l_Buffer = l_Device.getSubresource<VulkanBuffer>(l_Migration.resource);
+        if (!l_Buffer)
+        {
+            // Freed by its owner while the copy was running, the copy has nothing left to replace
+            l_Device.freeBuffer(l_Migration.copy);
+            if (l_Migration.demote)
+                m_PendingRelease[l_Migration.releasedHeap] -= std::min(m_PendingRelease[l_Migration.releasedHeap], l_Migration.size);
+            return true;
+        }
+
+        // The copy now owns the old handle, which in-flight frames may still reference
+        l_Buffer->swapBacking(l_Device.getBuffer(l_Migration.copy));
+        const std::array<uint64_t, 1> l_OldHandle = {reinterpret_cast<uint64_t>(*l_Device.getBuffer(l_Migration.copy))};
+        l_Device.flagDescriptorSetsReferencing(l_OldHandle);
+        // Promotions release host memory, which isn't counted against any device local budget
+        m_Retired.push_back({l_Migration.copy, m_Frame, l_Migration.releasedHeap, l_Migration.demote ? l_Migration.size : 0});
+
+        const auto l_Entry = m_Entries.find(l_Migration.resource);
+        if (l_Entry != m_Entries.end())
+        {
+            l_Entry->second.demoted = l_Migration.demote;
+            l_Entry->second.migrating = false;
+        }
+
+        LOG_DEBUG(l_Migration.demote ? "Demoted" : "Promoted", " buffer (ID:", l_Migration.resource, ") of size ", VulkanMemoryAllocator::compactBytes(l_Migration.size));
+        if (m_RelocationCallback)
+            m_RelocationCallback(l_Migration.resource);
+        return true;
+    });
+}
+
+void VulkanResidencyManager::releaseRetired(const bool p_Force)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+
+    std::erase_if(m_Retired, [&](const Retired& l_Retired)
+    {
+        if (!p_Force && m_Frame - l_Retired.frame < m_Config.framesInFlight)
+            return false;
+
+        l_Device.freeBuffer(l_Retired.buffer);
+        if (l_Retired.heap < m_PendingRelease.size())
+            m_PendingRelease[l_Retired.heap] -= std::min(m_PendingRelease[l_Retired.heap], l_Retired.size);
+        return true;
+    });
+}
+
+void VulkanResidencyManager::evict(const uint32_t p_Heap, const VkDeviceSize p_Bytes, const VulkanCommandBuffer& p_CommandBuffer, const ResourceID p_Fence)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    const VulkanMemoryAllocator& l_Allocator = l_Device.getMemoryAllocator();
+
+    struct Candidate
+    {
+        ResourceID resource;
+        float priority;
+        uint32_t lastUsedFrame;
+        VkDeviceSize size;
+    };
+
+    std::vector<Candidate> l_Candidates;
+    for (const auto& [l_ID, l_Entry] : m_Entries)
+    {
+        if (!l_Entry.streamable || l_Entry.demoted || l_Entry.migrating || m_Frame - l_Entry.lastUsedFrame < m_Config.minIdleFrames)
+            continue;
+
+        const VulkanMemArray* l_MemArray = l_Device.getSubresource<VulkanMemArray>(l_ID);
+        if (!l_MemArray || !l_MemArray->isMemoryBound() || l_Allocator.getAllocationHeap(l_MemArray->getAllocation()) != p_Heap)
+            continue;
+
+        l_Candidates.push_back({l_ID, l_Entry.priority, l_Entry.lastUsedFrame, l_MemArray->getMemorySize()});
+    }
+
+    std::ranges::sort(l_Candidates, [](const Candidate& p_A, const Candidate& p_B)
+    {
+        if (p_A.priority != p_B.priority)
+            return p_A.priority < p_B.priority;
+        return p_A.lastUsedFrame < p_B.lastUsedFrame;
+    });
+
+    VkDeviceSize l_Freed = 0;
+    for (const Candidate& l_Candidate : l_Candidates)
+    {
+        if (l_Freed >= p_Bytes)
+            break;
+
+        if (migrate(l_Candidate.resource, true, p_CommandBuffer, p_Fence))
+        {
+            l_Freed += l_Candidate.size;
+        }
+        else if (m_EvictionCallback)
+        {
+            LOG_DEBUG("Evicting resource (ID:", l_Candidate.resource, ") of size ", VulkanMemoryAllocator::compactBytes(l_Candidate.size));
+            m_Entries.erase(l_Candidate.resource);
+            m_EvictionCallback(l_Candidate.resource);
+            l_Freed += l_Candidate.size;
+        }
+    }
+
+    if (l_Freed < p_Bytes)
+    {
+        LOG_WARN("Memory heap ", p_Heap, " is over budget, but only ", VulkanMemoryAllocator::compactBytes(l_Freed), " of ", VulkanMemoryAllocator::compactBytes(p_Bytes), " could be evicted");
+    }
+}
+
+void VulkanResidencyManager::promote(const std::vector<VulkanMemoryAllocator::HeapBudget>& p_Budgets, const VulkanCommandBuffer& p_CommandBuffer, const ResourceID p_Fence)
+{
+    // Promotions land wherever VMA prefers device memory, which is the biggest device local heap on discrete cards
+    uint32_t l_Heap = UINT32_MAX;
+    for (uint32_t l_Index = 0; l_Index < p_Budgets.size(); l_Index++)
+    {
+        if (p_Budgets[l_Index].deviceLocal && (l_Heap == UINT32_MAX || p_Budgets[l_Index].budget > p_Budgets[l_Heap].budget))
+            l_Heap = l_Index;
+    }
+    if (l_Heap == UINT32_MAX)
+        return;
+
+    const VkDeviceSize l_Target = static_cast<VkDeviceSize>(static_cast<double>(p_Budgets[l_Heap].budget) * m_Config.targetUsage);
+    const VkDeviceSize l_Usage = p_Budgets[l_Heap].usage - std::min(p_Budgets[l_Heap].usage, m_PendingRelease[l_Heap]);
+    if (l_Usage >= l_Target)
+        return;
+    VkDeviceSize l_Headroom = l_Target - l_Usage;
+
+    std::vector<std::pair<ResourceID, float>> l_Candidates;
+    for (const auto& [l_ID, l_Entry] : m_Entries)
+    {
+        // Only what is actually being used again is worth the copy
+        if (l_Entry.demoted && !l_Entry.migrating && m_Frame - l_Entry.lastUsedFrame < m_Config.minIdleFrames)
+            l_Candidates.emplace_back(l_ID, l_Entry.priority);
+    }
+    std::ranges::sort(l_Candidates, [](const auto& p_A, const auto& p_B) { return p_A.second > p_B.second; });
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    for (const ResourceID l_ID : l_Candidates | std::views::keys)
+    {
+        const VulkanBuffer* l_Buffer = l_Device.getSubresource<VulkanBuffer>(l_ID);
+        if (!l_Buffer || l_Buffer->getSize() > l_Headroom)
+            continue;
+
+        if (migrate(l_ID, false, p_CommandBuffer, p_Fence))
+            l_Headroom -= l_Buffer->getSize();
+    }
+}
+
+bool VulkanResidencyManager::migrate(const ResourceID p_Buffer, const bool p_Demote, const VulkanCommandBuffer& p_CommandBuffer, const ResourceID p_Fence)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    const VulkanMemoryAllocator& l_Allocator = l_Device.getMemoryAllocator();
+
+    const VulkanBuffer* l_Buffer = l_Device.getSubresource<VulkanBuffer>(p_Buffer);
+    if (!l_Buffer || !l_Buffer->isMemoryBound())
+        return false;
+
+    if (!(l_Buffer->getUsage() & VK_BUFFER_USAGE_TRANSFER_SRC_BIT))
+    {
+        LOG_DEBUG("Buffer (ID:", p_Buffer, ") can't be migrated, it was not created with VK_BUFFER_USAGE_TRANSFER_SRC_BIT");
+        return false;
+    }
+
+    Entry& l_Entry = m_Entries.at(p_Buffer);
+    const VkDeviceSize l_Size = l_Buffer->getSize();
+    const uint32_t l_OldHeap = l_Allocator.getAllocationHeap(l_Buffer->getAllocation());
+
+    VulkanMemoryAllocator::MemoryPreferences l_Prefs{};
+    l_Prefs.usage = p_Demote ? VMA_MEMORY_USAGE_AUTO_PREFER_HOST : VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+    l_Prefs.priority = p_Demote ? 0.0f : std::clamp(l_Entry.priority, 0.0f, 1.0f);
+    if (l_Buffer->isPersistentlyMapped())
+        l_Prefs.vmaFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    const ResourceID l_Copy = l_Device.createAndAllocateBuffer(l_Prefs, {l_Size, l_Buffer->getUsage() | VK_BUFFER_USAGE_TRANSFER_DST_BIT, l_Buffer->getQueue()});
+    if (l_Allocator.getAllocationHeap(l_Device.getBuffer(l_Copy).getAllocation()) == l_OldHeap)
+    {
+        // Integrated GPUs only have one heap, and a full device heap sends promotions straight back to the host
+        l_Device.freeBuffer(l_Copy);
+        return false;
+    }
+
+    VulkanMemoryBarrierBuilder l_Before{m_Device, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0};
+    l_Before.addBufferMemoryBarrier(p_Buffer, 0, l_Size, VK_ACCESS_MEMORY_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+    p_CommandBuffer.cmdPipelineBarrier(l_Before);
+
+    const std::array<VkBufferCopy, 1> l_Regions = {{{0, 0, l_Size}}};
+    p_CommandBuffer.cmdCopyBuffer(p_Buffer, l_Copy, l_Regions);
+
+    VulkanMemoryBarrierBuilder l_After{m_Device, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0};
+    l_After.addBufferMemoryBarrier(l_Copy, 0, l_Size, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT);
+    p_CommandBuffer.cmdPipelineBarrier(l_After);
+
+    m_Migrations.push_back({p_Buffer, l_Copy, p_Fence, l_OldHeap, l_Size, p_Demote});
+    if (p_Demote)
+        m_PendingRelease[l_OldHeap] += l_Size;
+    l_Entry.migrating = true;
+    return true;
+}
@@ -0,0 +1,424 @@
+#include "vulkan_sparse.hpp"
+
+#include <algorithm>
+#include <ranges>
+#include <stdexcept>
+
+#include "utils/logger.hpp"
+#include "vulkan_base.hpp"
+#include "vulkan_device.hpp"
+#include "vulkan_queues.hpp"
+#include "vulkan_sync.hpp"
+
+bool VulkanSparsePage::operator==(const VulkanSparsePage& p_Other) const
+{
+    return resource == p_Other.resource && mipLevel == p_Other.mipLevel && arrayLayer == p_Other.arrayLayer
+        && tile.x == p_Other.tile.x && tile.y == p_Other.tile.y && tile.z == p_Other.tile.z;
+}
+
+size_t VulkanSparsePageHash::operator()(const VulkanSparsePage& p_Page) const
+{
+    size_t l_Hash = std::hash<uint32_t>{}(p_Page.resource);
+    for (const uint32_t l_Value : {p_Page.mipLevel, p_Page.arrayLayer, static_cast<uint32_t>(p_Page.tile.x), static_cast<uint32_t>(p_Page.tile.y), static_cast<uint32_t>(p_Page.tile.z)})
+    {
+        l_Hash ^= std::hash<uint32_t>{}(l_Value) + 0x9e3779b9 + (l_Hash << 6) + (l_Hash >> 2);
+    }
+    return l_Hash;
+}
+
+static VkExtent3D getMipExtent(const VkExtent3D p_Extent, const uint32_t p_MipLevel)
+{
+    return {std::max(p_Extent.width >> p_MipLevel, 1u), std::max(p_Extent.height >> p_MipLevel, 1u), std::max(p_Extent.depth >> p_MipLevel, 1u)};
+}
+
+VulkanSparseBinder::VulkanSparseBinder(const ResourceID p_Device, const Config& p_Config)
+    : m_Device(p_Device), m_Config(p_Config) {}
+
+void VulkanSparseBinder::registerBuffer(const ResourceID p_Buffer)
+{
+    const VulkanBuffer& l_Buffer = VulkanContext::getDevice(m_Device).getBuffer(p_Buffer);
+    m_Resources[p_Buffer] = {l_Buffer.getMemoryRequirements(), false, {}, VK_NULL_HANDLE, 0};
+    LOG_DEBUG("Registered sparse buffer (ID:", p_Buffer, ") with ", VulkanMemoryAllocator::compactBytes(l_Buffer.getMemoryRequirements().alignment), " pages");
+}
+
+void VulkanSparseBinder::registerImage(const ResourceID p_Image)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    const VulkanImage& l_Image = l_Device.getImage(p_Image);
+
+    uint32_t l_Count = 0;
+    l_Device.getTable().vkGetImageSparseMemoryRequirements(*l_Device, *l_Image, &l_Count, nullptr);
+    TRANS_VECTOR(l_SparseRequirements, VkSparseImageMemoryRequirements);
+    l_SparseRequirements.resize(l_Count);
+    l_Device.getTable().vkGetImageSparseMemoryRequirements(*l_Device, *l_Image, &l_Count, l_SparseRequirements.data());
+
+    if (l_SparseRequirements.empty())
+    {
+        throw std::runtime_error("Tried to register image (ID:" + std::to_string(p_Image) + ") as sparse, but it has no sparse memory requirements");
+    }
+
+    // Metadata aspects are not supported, the color or depth aspect is the one paged in
+    const auto l_Color = std::ranges::find_if(l_SparseRequirements, [](const VkSparseImageMemoryRequirements& p_Reqs)
+    {
+        return (p_Reqs.formatProperties.aspectMask & VK_IMAGE_ASPECT_METADATA_BIT) == 0;
+    });
+
+    Resource& l_Resource = m_Resources[p_Image] = {l_Image.getMemoryRequirements(), true, l_Color != l_SparseRequirements.end() ? *l_Color : l_SparseRequirements.front(), VK_NULL_HANDLE, 0};
+    l_Resource.mipTailCount = l_Resource.sparse.formatProperties.flags & VK_SPARSE_IMAGE_FORMAT_SINGLE_MIPTAIL_BIT ? 1 : l_Image.getArrayLayers();
+
+    if (l_Resource.sparse.imageMipTailSize > 0)
+    {
+        VkMemoryRequirements l_TailRequirements = l_Resource.requirements;
+        l_TailRequirements.size = l_Resource.sparse.imageMipTailSize * l_Resource.mipTailCount;
+
+        VmaAllocationCreateInfo l_AllocInfo{};
+        l_AllocInfo.preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        VULKAN_TRY(vmaAllocateMemory(*l_Device.getMemoryAllocator(), &l_TailRequirements, &l_AllocInfo, &l_Resource.mipTail, nullptr));
+        queueMipTailBind(p_Image, l_Resource, l_Resource.mipTail);
+    }
+
+    const VkExtent3D l_Granularity = l_Resource.sparse.formatProperties.imageGranularity;
+    LOG_DEBUG("Registered sparse image (ID:", p_Image, ") with ", l_Granularity.width, "x", l_Granularity.height, "x", l_Granularity.depth, " tiles and mip tail from level ", l_Resource.sparse.imageMipTailFirstLod);
+}
+
+void VulkanSparseBinder::unregister(const ResourceID p_Resource)
+{
+    const auto l_It = m_Resources.find(p_Resource);
+    if (l_It == m_Resources.end())
+        return;
+
+    TRANS_VECTOR(l_Pages, VulkanSparsePage);
+    for (const VulkanSparsePage& l_Page : m_Resident | std::views::keys)
+    {
+        if (l_Page.resource == p_Resource)
+            l_Pages.push_back(l_Page);
+    }
+    for (const VulkanSparsePage& l_Page : l_Pages)
+    {
+        evict(l_Page);
+    }
+
+    // Binds still queued for a resource about to be destroyed would reference a dead handle
+    m_BufferBinds.erase(p_Resource);
+    m_ImageBinds.erase(p_Resource);
+    m_OpaqueImageBinds.erase(p_Resource);
+
+    if (l_It->second.mipTail != VK_NULL_HANDLE)
+    {
+        m_Evicted.push_back({l_It->second.mipTail, UINT64_MAX});
+    }
+    m_Resources.erase(l_It);
+}
+
+bool VulkanSparseBinder::commit(const VulkanSparsePage& p_Page)
+{
+    const auto l_Resident = m_Resident.find(p_Page);
+    if (l_Resident != m_Resident.end())
+    {
+        l_Resident->second.lastRequestFrame = m_Frame;
+        return true;
+    }
+
+    const Resource& l_Resource = getResource(p_Page.resource);
+    if (l_Resource.image && p_Page.mipLevel >= l_Resource.sparse.imageMipTailFirstLod)
+    {
+        // Part of the mip tail, which stays resident as long as the image is registered
+        return true;
+    }
+
+    const VmaAllocation l_Page = acquirePage(l_Resource.requirements);
+    if (l_Page == VK_NULL_HANDLE)
+        return false;
+
+    m_Resident[p_Page] = {l_Page, m_Frame};
+    queueBind(p_Page, l_Page);
+    return true;
+}
+
+void VulkanSparseBinder::evict(const VulkanSparsePage& p_Page)
+{
+    const auto l_It = m_Resident.find(p_Page);
+    if (l_It == m_Resident.end())
+        return;
+
+    queueBind(p_Page, VK_NULL_HANDLE);
+    m_Evicted.push_back({l_It->second.page, getPoolKey(getResource(p_Page.resource).requirements)});
+    m_Resident.erase(l_It);
+}
+
+void VulkanSparseBinder::request(const std::span<const VulkanSparsePage> p_Pages)
+{
+    uint32_t l_Failed = 0;
+    for (const VulkanSparsePage& l_Page : p_Pages)
+    {
+        if (!commit(l_Page))
+            l_Failed++;
+    }
+
+    if (l_Failed == 0)
+        return;
+
+    // Pages not requested this frame make room, least recently requested first. Their memory is only reusable after the next flush completes
+    using Candidate = std::pair<uint32_t, VulkanSparsePage>;
+    TRANS_VECTOR(l_Candidates, Candidate);
+    for (const auto& [l_Page, l_Resident] : m_Resident)
+    {
+        if (l_Resident.lastRequestFrame < m_Frame)
+            l_Candidates.emplace_back(l_Resident.lastRequestFrame, l_Page);
+    }
+
+    const size_t l_Count = std::min<size_t>(l_Failed, l_Candidates.size());
+    std::ranges::partial_sort(l_Candidates, l_Candidates.begin() + static_cast<ptrdiff_t>(l_Count), {}, &Candidate::first);
+    for (size_t i = 0; i < l_Count; i++)
+    {
+        evict(l_Candidates[i].second);
+    }
+    LOG_DEBUG("Sparse page pool exhausted, ", l_Failed, " page(s) deferred and ", l_Count, " evicted");
+}
+
+void VulkanSparseBinder::evictIdle()
+{
+    TRANS_VECTOR(l_Idle, VulkanSparsePage);
+    for (const auto& [l_Page, l_Resident] : m_Resident)
+    {
+        if (m_Frame - l_Resident.lastRequestFrame > m_Config.minIdleFrames)
+            l_Idle.push_back(l_Page);
+    }
+    for (const VulkanSparsePage& l_Page : l_Idle)
+    {
+        evict(l_Page);
+    }
+}
+
+void VulkanSparseBinder::flush(const VulkanQueue& p_Queue, const std::span<const ResourceID> p_WaitSemaphores, const std::span<const ResourceID> p_SignalSemaphores)
+{
+    m_Frame++;
+    reclaim();
+
+    if (m_BufferBinds.empty() && m_ImageBinds.empty() && m_OpaqueImageBinds.empty() && m_Evicted.empty() && p_WaitSemaphores.empty() && p_SignalSemaphores.empty())
+        return;
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+
+    TRANS_VECTOR(l_BufferInfos, VkSparseBufferMemoryBindInfo);
+    for (const auto& [l_Buffer, l_Binds] : m_BufferBinds)
+    {
+        l_BufferInfos.push_back({*l_Device.getBuffer(l_Buffer), static_cast<uint32_t>(l_Binds.size()), l_Binds.data()});
+    }
+    TRANS_VECTOR(l_OpaqueInfos, VkSparseImageOpaqueMemoryBindInfo);
+    for (const auto& [l_Image, l_Binds] : m_OpaqueImageBinds)
+    {
+        l_OpaqueInfos.push_back({*l_Device.getImage(l_Image), static_cast<uint32_t>(l_Binds.size()), l_Binds.data()});
+    }
+    TRANS_VECTOR(l_ImageInfos, VkSparseImageMemoryBindInfo);
+    for (const auto& [l_Image, l_Binds] : m_ImageBinds)
+    {
+        l_ImageInfos.push_back({*l_Device.getImage(l_Image), static_cast<uint32_t>(l_Binds.size()), l_Binds.data()});
+    }
+
+    TRANS_VECTOR(l_WaitSemaphores, VkSemaphore);
+    for (const ResourceID l_Semaphore : p_WaitSemaphores)
+    {
+        l_WaitSemaphores.push_back(*l_Device.getSemaphore(l_Semaphore));
+    }
+    TRANS_VECTOR(l_SignalSemaphores, VkSemaphore);
+    for (const ResourceID l_Semaphore : p_SignalSemaphores)
+    {
+        l_SignalSemaphores.push_back(*l_Device.getSemaphore(l_Semaphore));
+    }
+
+    VkBindSparseInfo l_BindInfo{};
+    l_BindInfo.sType = VK_STRUCTURE_TYPE_BIND_SPARSE_INFO;
+    l_BindInfo.waitSemaphoreCount = static_cast<uint32_t>(l_WaitSemaphores.size());
+    l_BindInfo.pWaitSemaphores = l_WaitSemaphores.data();
+    l_BindInfo.bufferBindCount = static_cast<uint32_t>(l_BufferInfos.size());
+    l_BindInfo.pBufferBinds = l_BufferInfos.data();
+    l_BindInfo.imageOpaqueBindCount = static_cast<uint32_t>(l_OpaqueInfos.size());
+    l_BindInfo.pImageOpaqueBinds = l_OpaqueInfos.data();
+    l_BindInfo.imageBindCount = static_cast<uint32_t>(l_ImageInfos.size());
+    l_BindInfo.pImageBinds = l_ImageInfos.data();
+    l_BindInfo.signalSemaphoreCount = static_cast<uint32_t>(l_SignalSemaphores.size());
+    l_BindInfo.pSignalSemaphores = l_SignalSemaphores.data();
+
+    // Only flushes that unbind memory need to know when they are done
+    ResourceID l_Fence = UINT32_MAX;
+    if (!m_Evicted.empty())
+    {
+        l_Fence = l_Device.createFence(false);
+        m_Retired.push_back({l_Fence, std::move(m_Evicted)});
+        m_Evicted.clear();
+    }
+
+    VULKAN_TRY(l_Device.getTable().vkQueueBindSparse(*p_Queue, 1, &l_BindInfo, l_Fence != UINT32_MAX ? *l_Device.getFence(l_Fence) : VK_NULL_HANDLE));
+    LOG_DEBUG("Flushed sparse binds for ", l_BufferInfos.size(), " buffer(s) and ", l_ImageInfos.size() + l_OpaqueInfos.size(), " image(s)");
+
+    m_BufferBinds.clear();
+    m_OpaqueImageBinds.clear();
+    m_ImageBinds.clear();
+}
+
+void VulkanSparseBinder::free()
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    const VmaAllocator l_Allocator = *l_Device.getMemoryAllocator();
+
+    for (Retired& l_Retired : m_Retired)
+    {
+        l_Device.getFence(l_Retired.fence).wait();
+        l_Device.freeFence(l_Retired.fence);
+        for (const FreedPage& l_Page : l_Retired.pages)
+            vmaFreeMemory(l_Allocator, l_Page.page);
+    }
+    m_Retired.clear();
+
+    for (const FreedPage& l_Page : m_Evicted)
+        vmaFreeMemory(l_Allocator, l_Page.page);
+    m_Evicted.clear();
+
+    for (const Resident& l_Resident : m_Resident | std::views::values)
+        vmaFreeMemory(l_Allocator, l_Resident.page);
+    m_Resident.clear();
+
+    for (std::vector<VmaAllocation>& l_Pages : m_FreePages | std::views::values)
+        vmaFreeMemoryPages(l_Allocator, l_Pages.size(), l_Pages.data());
+    m_FreePages.clear();
+
+    for (const Resource& l_Resource : m_Resources | std::views::values)
+    {
+        if (l_Resource.mipTail != VK_NULL_HANDLE)
+            vmaFreeMemory(l_Allocator, l_Resource.mipTail);
+    }
+    m_Resources.clear();
+
+    m_BufferBinds.clear();
+    m_OpaqueImageBinds.clear();
+    m_ImageBinds.clear();
+    m_AllocatedPages = 0;
+}
+
+VkDeviceSize VulkanSparseBinder::getPageSize(const ResourceID p_Resource) const
+{
+    return getResource(p_Resource).requirements.alignment;
+}
+
+VkExtent3D VulkanSparseBinder::getTileExtent(const ResourceID p_Image) const
+{
+    return getResource(p_Image).sparse.formatProperties.imageGranularity;
+}
+
+uint64_t VulkanSparseBinder::getPoolKey(const VkMemoryRequirements& p_Requirements)
+{
+    return p_Requirements.alignment << 32 | p_Requirements.memoryTypeBits;
+}
+
+VmaAllocation VulkanSparseBinder::acquirePage(const VkMemoryRequirements& p_Requirements)
+{
+    std::vector<VmaAllocation>& l_FreePages = m_FreePages[getPoolKey(p_Requirements)];
+    if (l_FreePages.empty())
+    {
+        reclaim();
+    }
+
+    if (l_FreePages.empty())
+    {
+        const uint32_t l_Count = std::min(m_Config.pagesPerAllocation, m_Config.maxPages - m_AllocatedPages);
+        if (l_Count == 0)
+            return VK_NULL_HANDLE;
+
+        // Sparse resources report their page size as alignment
+        const VkMemoryRequirements l_PageRequirements{p_Requirements.alignment, p_Requirements.alignment, p_Requirements.memoryTypeBits};
+        VmaAllocationCreateInfo l_AllocInfo{};
+        l_AllocInfo.preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+        l_FreePages.resize(l_Count);
+        VULKAN_TRY(vmaAllocateMemoryPages(*VulkanContext::getDevice(m_Device).getMemoryAllocator(), &l_PageRequirements, &l_AllocInfo, l_Count, l_FreePages.data(), nullptr));
+        m_AllocatedPages += l_Count;
+    }
+
+    const VmaAllocation l_Page = l_FreePages.back();
+    l_FreePages.pop_back();
+    return l_Page;
+}
+
+void VulkanSparseBinder::queueBind(const VulkanSparsePage& p_Page, const VmaAllocation p_Memory)
+{
+    const VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    const Resource& l_Resource = getResource(p_Page.resource);
+
+    VmaAllocationInfo l_MemoryInfo{};
+    if (p_Memory != VK_NULL_HANDLE)
+        l_MemoryInfo = l_Device.getMemoryAllocator().getAllocationInfo(p_Memory);
+
+    if (!l_Resource.image)
+    {
+        const VkDeviceSize l_PageSize = l_Resource.requirements.alignment;
+        const VkDeviceSize l_Offset = static_cast<VkDeviceSize>(p_Page.tile.x) * l_PageSize;
+        m_BufferBinds[p_Page.resource].push_back({l_Offset, std::min(l_PageSize, l_Resource.requirements.size - l_Offset), l_MemoryInfo.deviceMemory, l_MemoryInfo.offset, 0});
+        return;
+    }
+
+    const VkExtent3D l_Granularity = l_Resource.sparse.formatProperties.imageGranularity;
+    const VkExtent3D l_MipExtent = getMipExtent(l_Device.getImage(p_Page.resource).getSize(), p_Page.mipLevel);
+    const VkOffset3D l_Offset{
+        p_Page.tile.x * static_cast<int32_t>(l_Granularity.width),
+        p_Page.tile.y * static_cast<int32_t>(l_Granularity.height),
+        p_Page.tile.z * static_cast<int32_t>(l_Granularity.depth)
+    };
+
+    VkSparseImageMemoryBind l_Bind{};
+    l_Bind.subresource = {l_Resource.sparse.formatProperties.aspectMask, p_Page.mipLevel, p_Page.arrayLayer};
+    l_Bind.offset = l_Offset;
+    // Tiles on the edge of a mip level are cut to its extent
+    l_Bind.extent = {
+        std::min(l_Granularity.width, l_MipExtent.width - l_Offset.x),
+        std::min(l_Granularity.height, l_MipExtent.height - l_Offset.y),
+        std::min(l_Granularity.depth, l_MipExtent.depth - l_Offset.z)
+    };
+    l_Bind.memory = l_MemoryInfo.deviceMemory;
+    l_Bind.memoryOffset = l_MemoryInfo.offset;
+    m_ImageBinds[p_Page.resource].push_back(l_Bind);
+}
+
+void VulkanSparseBinder::queueMipTailBind(const ResourceID p_Image, const Resource& p_Resource, const VmaAllocation p_Memory)
+{
+    const VmaAllocationInfo l_MemoryInfo = VulkanContext::getDevice(m_Device).getMemoryAllocator().getAllocationInfo(p_Memory);
+
+    for (uint32_t i = 0; i < p_Resource.mipTailCount; i++)
+    {
+        VkSparseMemoryBind l_Bind{};
+        l_Bind.resourceOffset = p_Resource.sparse.imageMipTailOffset + i * p_Resource.sparse.imageMipTailStride;
+        l_Bind.size = p_Resource.sparse.imageMipTailSize;
+        l_Bind.memory = l_MemoryInfo.deviceMemory;
+        l_Bind.memoryOffset = l_MemoryInfo.offset + i * p_Resource.sparse.imageMipTailSize;
+        m_OpaqueImageBinds[p_Image].push_back(l_Bind);
+    }
+}
+
+void VulkanSparseBinder::reclaim()
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    const VmaAllocator l_Allocator = *l_Device.getMemoryAllocator();
+    while (!m_Retired.empty() && l_Device.getFence(m_Retired.front().fence).poll())
+    {
+        for (const FreedPage& l_Page : m_Retired.front().pages)
+        {
+            // Mip tails aren't pool pages and go straight back to VMA
+            if (l_Page.poolKey == UINT64_MAX)
+                vmaFreeMemory(l_Allocator, l_Page.page);
+            else
+                m_FreePages[l_Page.poolKey].push_back(l_Page.page);
+        }
+        l_Device.freeFence(m_Retired.front().fence);
+        m_Retired.pop_front();
+    }
+}
+
+const VulkanSparseBinder::Resource& VulkanSparseBinder::getResource(const ResourceID p_Resource) const
+{
+    const auto l_It = m_Resources.find(p_Resource);
+    if (l_It == m_Resources.end())
+    {
+        throw std::runtime_error("Resource (ID:" + std::to_string(p_Resource) + ") is not registered with the sparse binder");
+    }
+    return l_It->second;
+}
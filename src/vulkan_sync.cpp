@@ -37,6 +37,23 @@ void VulkanFence::wait()
     m_IsSignaled = true;
 }
 
+bool VulkanFence::poll()
+{
+    if (m_IsSignaled)
+        return true;
+
+    const VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
+
+    const VkResult l_Result = l_Device.getTable().vkGetFenceStatus(l_Device.m_VkHandle, m_VkHandle);
+    if (l_Result == VK_ERROR_DEVICE_LOST)
+    {
+        throw std::runtime_error("Device lost while polling fence (ID: " + std::to_string(m_ID) + ")");
+    }
+
+    m_IsSignaled = l_Result == VK_SUCCESS;
+    return m_IsSignaled;
+}
+
 void VulkanFence::free()
 {
     const VulkanDevice& l_Device = VulkanContext::getDevice(getDeviceID());
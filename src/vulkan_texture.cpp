@@ -0,0 +1,162 @@
+#include "vulkan_texture.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "utils/allocators.hpp"
+#include "utils/copy_engine.hpp"
+#include "utils/logger.hpp"
+#include "vulkan_command_buffer.hpp"
+#include "vulkan_context.hpp"
+#include "vulkan_device.hpp"
+
+VulkanTextureLoader::VulkanTextureLoader(const ResourceID p_Device, const Config& p_Config)
+    : m_Device(p_Device), m_Config(p_Config) {}
+
+VulkanTextureLoader::Texture VulkanTextureLoader::load(const VulkanCommandBuffer& p_CommandBuffer, const ResourceID p_Fence, const std::string_view p_Path)
+{
+    const TextureContainer l_Container{p_Path};
+    return load(p_CommandBuffer, p_Fence, l_Container);
+}
+
+VulkanTextureLoader::Texture VulkanTextureLoader::load(const VulkanCommandBuffer& p_CommandBuffer, const ResourceID p_Fence, const TextureContainer& p_Container)
+{
+    if (!p_Container.isOpen())
+    {
+        throw std::runtime_error("Tried to load a texture from a closed container");
+    }
+
+    Texture l_Texture{UINT32_MAX, p_Container.getFormat(), false};
+    if (!isFormatSupported(l_Texture.format))
+    {
+        const VkFormat l_Fallback = m_Config.allowTranscoding ? TextureContainer::getTranscodeFormat(l_Texture.format) : VK_FORMAT_UNDEFINED;
+        if (l_Fallback == VK_FORMAT_UNDEFINED || !isFormatSupported(l_Fallback))
+        {
+            throw std::runtime_error("Texture format " + std::to_string(l_Texture.format) + " is not supported by device (ID:" + std::to_string(m_Device) + ") and can't be transcoded");
+        }
+        LOG_WARN("Texture format ", l_Texture.format, " is not supported by device (ID:", m_Device, "), transcoding to ", l_Fallback, " on the CPU");
+        l_Texture.format = l_Fallback;
+        l_Texture.transcoded = true;
+    }
+
+    const VkExtent3D l_Extent = p_Container.getExtent();
+    const uint32_t l_MipLevels = p_Container.getMipLevels();
+    const uint32_t l_ArrayLayers = p_Container.getArrayLayers();
+    const TextureContainer::BlockInfo l_Block = TextureContainer::getBlockInfo(l_Texture.format);
+
+    // Layers of a level are packed back to back so a single region covers them, levels start on a texel block and 4 byte boundary
+    TRANS_VECTOR(l_LevelOffsets, VkDeviceSize);
+    l_LevelOffsets.resize(l_MipLevels);
+    VkDeviceSize l_StagingSize = 0;
+    for (uint32_t i = 0; i < l_MipLevels; i++)
+    {
+        l_StagingSize = alignUp(l_StagingSize, std::max(l_Block.bytes, 4u));
+        l_LevelOffsets[i] = l_StagingSize;
+        l_StagingSize += TextureContainer::getSubresourceSize(l_Texture.format, TextureContainer::getMipExtent(l_Extent, i)) * l_ArrayLayers;
+    }
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+
+    constexpr VulkanMemoryAllocator::MemoryPreferences STAGING_PREFS{
+        .usage = VMA_MEMORY_USAGE_AUTO,
+        .vmaFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT
+    };
+    const ResourceID l_Staging = l_Device.createAndAllocateBuffer(STAGING_PREFS, {l_StagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT});
+    const VulkanBuffer& l_StagingBuffer = l_Device.getBuffer(l_Staging);
+    uint8_t* l_StagingData = static_cast<uint8_t*>(l_StagingBuffer.getMappedData());
+
+    for (const TextureContainer::Subresource& l_Subresource : p_Container.getSubresources())
+    {
+        const VkExtent3D l_MipExtent = TextureContainer::getMipExtent(l_Extent, l_Subresource.mipLevel);
+        const size_t l_LayerSize = TextureContainer::getSubresourceSize(l_Texture.format, l_MipExtent);
+        uint8_t* l_Dst = l_StagingData + l_LevelOffsets[l_Subresource.mipLevel] + l_LayerSize * l_Subresource.arrayLayer;
+
+        if (l_Texture.transcoded)
+            TextureContainer::transcode(p_Container.getFormat(), l_MipExtent, p_Container.getData(l_Subresource), l_Dst);
+        else
+            CopyEngine::copy(l_Dst, p_Container.getData(l_Subresource).data(), l_Subresource.size);
+    }
+    l_StagingBuffer.flush();
+
+    VkImageCreateFlags l_Flags = 0;
+    if (p_Container.isCube() && l_Extent.width == l_Extent.height)
+        l_Flags |= VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+
+    const VulkanImage::Config l_ImageConfig{
+        .type = p_Container.getImageType(),
+        .format = l_Texture.format,
+        .extent = l_Extent,
+        .usage = m_Config.usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        .flags = l_Flags,
+        .mipLevels = l_MipLevels,
+        .arrayLayers = l_ArrayLayers
+    };
+    l_Texture.image = l_Device.createAndAllocateImage({.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE}, l_ImageConfig);
+    VulkanImage& l_Image = l_Device.getImage(l_Texture.image);
+
+    // Image extents are given in texels, partial edge blocks are allowed since each region reaches the edge of its level
+    TRANS_VECTOR(l_Regions, VkBufferImageCopy);
+    l_Regions.reserve(l_MipLevels);
+    for (uint32_t i = 0; i < l_MipLevels; i++)
+    {
+        VkBufferImageCopy l_Region{};
+        l_Region.bufferOffset = l_LevelOffsets[i];
+        l_Region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i, 0, l_ArrayLayers};
+        l_Region.imageExtent = TextureContainer::getMipExtent(l_Extent, i);
+        l_Regions.push_back(l_Region);
+    }
+
+    VulkanMemoryBarrierBuilder l_Before{m_Device, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0};
+    l_Before.addImageMemoryBarrier(l_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    p_CommandBuffer.cmdPipelineBarrier(l_Before);
+    l_Image.setLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+    p_CommandBuffer.cmdCopyBufferToImage(l_Staging, l_Texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, l_Regions);
+
+    if (m_Config.finalLayout != VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+    {
+        VulkanMemoryBarrierBuilder l_After{m_Device, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0};
+        l_After.addImageMemoryBarrier(l_Image, m_Config.finalLayout);
+        p_CommandBuffer.cmdPipelineBarrier(l_After);
+        l_Image.setLayout(m_Config.finalLayout);
+    }
+
+    m_Pending.push_back({p_Fence, l_Staging, l_Device.getFence(p_Fence).getSubmitCount()});
+    LOG_DEBUG("Recorded upload of texture (ID:", l_Texture.image, ") with ", l_Regions.size(), " region(s), staging ", VulkanMemoryAllocator::compactBytes(l_StagingSize));
+    return l_Texture;
+}
+
+void VulkanTextureLoader::reclaim()
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    std::erase_if(m_Pending, [&](const PendingUpload& p_Upload)
+    {
+        VulkanFence& l_Fence = l_Device.getFence(p_Upload.fence);
+        if (l_Fence.getSubmitCount() == p_Upload.submitCount || !l_Fence.poll())
+            return false;
+        l_Device.freeBuffer(p_Upload.staging);
+        return true;
+    });
+}
+
+void VulkanTextureLoader::free()
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    for (const PendingUpload& l_Upload : m_Pending)
+    {
+        VulkanFence& l_Fence = l_Device.getFence(l_Upload.fence);
+        if (l_Fence.getSubmitCount() == l_Upload.submitCount)
+            LOG_WARN("Freeing texture loader with an upload that was never submitted, staging buffer (ID:", l_Upload.staging, ") is freed right away");
+        else if (!l_Fence.isSignaled())
+            l_Fence.wait();
+        l_Device.freeBuffer(l_Upload.staging);
+    }
+    m_Pending.clear();
+}
+
+bool VulkanTextureLoader::isFormatSupported(const VkFormat p_Format) const
+{
+    const VkFormatProperties l_Properties = VulkanContext::getDevice(m_Device).getGPU().getFormatProperties(p_Format);
+    return (l_Properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) && (l_Properties.optimalTilingFeatures & VK_FORMAT_FEATURE_TRANSFER_DST_BIT);
+}
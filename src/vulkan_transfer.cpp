@@ -0,0 +1,757 @@
+#include "vulkan_transfer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#include "utils/copy_engine.hpp"
+#include "utils/logger.hpp"
+#include "vulkan_device.hpp"
+#include "ext/vulkan_external_memory_host.hpp"
+
+VulkanBufferUpdateBatcher::VulkanBufferUpdateBatcher(const ResourceID p_Device, const VkDeviceSize p_StagingSize, const uint32_t p_QueueFamilyIndex)
+    : m_Device(p_Device)
+{
+    constexpr VulkanMemoryAllocator::MemoryPreferences PREFS{
+        .usage = VMA_MEMORY_USAGE_AUTO,
+        .vmaFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+        .preferredProperties = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    };
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    m_StagingBuffer = l_Device.createAndAllocateBuffer(PREFS, {p_StagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, p_QueueFamilyIndex});
+
+    VulkanBuffer& l_Staging = l_Device.getBuffer(m_StagingBuffer);
+    m_StagingData = static_cast<uint8_t*>(l_Staging.map(p_StagingSize, 0));
+    m_StagingSize = p_StagingSize;
+}
+
+bool VulkanBufferUpdateBatcher::addUpdate(const ResourceID p_Buffer, const VkDeviceSize p_Offset, const void* p_Data, const VkDeviceSize p_Size)
+{
+    if (m_StagingBuffer == UINT32_MAX)
+    {
+        throw std::runtime_error("Tried to add an update for buffer (ID:" + std::to_string(p_Buffer) + ") to a freed update batcher");
+    }
+    if (p_Size == 0)
+        return true;
+
+    // Small updates are kept in host memory until recording, since they may end up inlined in the command buffer
+    if (isInlineCandidate(p_Offset, p_Size))
+    {
+        const VkDeviceSize l_HostOffset = m_InlineData.size();
+        m_InlineData.resize(l_HostOffset + p_Size);
+        memcpy(m_InlineData.data() + l_HostOffset, p_Data, p_Size);
+        m_Updates.push_back({p_Buffer, p_Offset, p_Size, l_HostOffset, true});
+        return true;
+    }
+
+    VkDeviceSize l_StagingOffset;
+    if (!reserveStaging(p_Size, l_StagingOffset))
+    {
+        LOG_DEBUG("Update batcher staging buffer is full, could not add update of ", VulkanMemoryAllocator::compactBytes(p_Size), " for buffer (ID:", p_Buffer, ")");
+        return false;
+    }
+
+    memcpy(m_StagingData + l_StagingOffset, p_Data, p_Size);
+    m_Updates.push_back({p_Buffer, p_Offset, p_Size, l_StagingOffset, false});
+    return true;
+}
+
+void VulkanBufferUpdateBatcher::setInlineThreshold(const VkDeviceSize p_Threshold)
+{
+    m_InlineThreshold = std::min(p_Threshold, MAX_INLINE_UPDATE_SIZE);
+}
+
+void VulkanBufferUpdateBatcher::reset()
+{
+    m_Updates.clear();
+    m_InlineData.clear();
+    m_StagingCursor = 0;
+}
+
+void VulkanBufferUpdateBatcher::free()
+{
+    if (m_StagingBuffer != UINT32_MAX)
+    {
+        VulkanContext::getDevice(m_Device).freeBuffer(m_StagingBuffer);
+        m_StagingBuffer = UINT32_MAX;
+        m_StagingData = nullptr;
+        m_StagingSize = 0;
+    }
+    reset();
+}
+
+bool VulkanBufferUpdateBatcher::isInlineCandidate(const VkDeviceSize p_Offset, const VkDeviceSize p_Size) const
+{
+    return p_Size <= m_InlineThreshold && p_Offset % 4 == 0 && p_Size % 4 == 0;
+}
+
+bool VulkanBufferUpdateBatcher::reserveStaging(const VkDeviceSize p_Size, VkDeviceSize& p_Offset)
+{
+    const VkDeviceSize l_Offset = alignUp(m_StagingCursor, 16);
+    if (l_Offset + p_Size > m_StagingSize)
+        return false;
+
+    p_Offset = l_Offset;
+    m_StagingCursor = l_Offset + p_Size;
+    return true;
+}
+
+static constexpr VkDeviceSize MIN_READBACK_BUFFER_SIZE = 64 * 1024;
+
+VulkanReadbackManager::VulkanReadbackManager(const ResourceID p_Device)
+    : m_Device(p_Device) {}
+
+void VulkanReadbackManager::readBuffer(const VulkanCommandBuffer& p_CommandBuffer, const ResourceID p_Fence, const ResourceID p_Buffer, const VkDeviceSize p_Offset, const VkDeviceSize p_Size, Callback p_Callback)
+{
+    const uint32_t l_PoolIndex = acquireBuffer(p_Size);
+    const ResourceID l_Readback = m_Pool[l_PoolIndex].buffer;
+
+    VulkanMemoryBarrierBuilder l_Before{m_Device, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0};
+    l_Before.addBufferMemoryBarrier(p_Buffer, p_Offset, p_Size, VK_ACCESS_MEMORY_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+    p_CommandBuffer.cmdPipelineBarrier(l_Before);
+
+    const std::array<VkBufferCopy, 1> l_Regions = {{{p_Offset, 0, p_Size}}};
+    p_CommandBuffer.cmdCopyBuffer(p_Buffer, l_Readback, l_Regions);
+
+    VulkanMemoryBarrierBuilder l_After{m_Device, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0};
+    l_After.addBufferMemoryBarrier(l_Readback, 0, p_Size, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT);
+    p_CommandBuffer.cmdPipelineBarrier(l_After);
+
+    m_Pending.push_back({p_Fence, VulkanContext::getDevice(m_Device).getFence(p_Fence).getSubmitCount(), l_PoolIndex, p_Size, std::move(p_Callback)});
+}
+
+std::future<std::vector<uint8_t>> VulkanReadbackManager::readBuffer(const VulkanCommandBuffer& p_CommandBuffer, const ResourceID p_Fence, const ResourceID p_Buffer, const VkDeviceSize p_Offset, const VkDeviceSize p_Size)
+{
+    const std::shared_ptr<std::promise<std::vector<uint8_t>>> l_Promise = std::make_shared<std::promise<std::vector<uint8_t>>>();
+    std::future<std::vector<uint8_t>> l_Future = l_Promise->get_future();
+    readBuffer(p_CommandBuffer, p_Fence, p_Buffer, p_Offset, p_Size, toPromise(l_Promise));
+    return l_Future;
+}
+
+void VulkanReadbackManager::readImage(const VulkanCommandBuffer& p_CommandBuffer, const ResourceID p_Fence, const ResourceID p_Image, const uint32_t p_BytesPerPixel, Callback p_Callback)
+{
+    VulkanImage& l_Image = VulkanContext::getDevice(m_Device).getImage(p_Image);
+    const VkExtent3D l_Extent = l_Image.getSize();
+    const VkDeviceSize l_Size = static_cast<VkDeviceSize>(l_Extent.width) * l_Extent.height * l_Extent.depth * p_BytesPerPixel;
+
+    const uint32_t l_PoolIndex = acquireBuffer(l_Size);
+    const ResourceID l_Readback = m_Pool[l_PoolIndex].buffer;
+
+    const VkImageLayout l_Layout = l_Image.getLayout();
+    if (l_Layout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+    {
+        VulkanMemoryBarrierBuilder l_BarrierBuilder{m_Device, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0};
+        l_BarrierBuilder.addImageMemoryBarrier(l_Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+        p_CommandBuffer.cmdPipelineBarrier(l_BarrierBuilder);
+        l_Image.setLayout(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    }
+
+    VkBufferImageCopy l_Region{};
+    l_Region.bufferOffset = 0;
+    l_Region.bufferRowLength = 0;
+    l_Region.bufferImageHeight = 0;
+    l_Region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    l_Region.imageSubresource.mipLevel = 0;
+    l_Region.imageSubresource.baseArrayLayer = 0;
+    l_Region.imageSubresource.layerCount = 1;
+    l_Region.imageOffset = {0, 0, 0};
+    l_Region.imageExtent = l_Extent;
+    const std::array<VkBufferImageCopy, 1> l_Regions = {l_Region};
+    p_CommandBuffer.cmdCopyImageToBuffer(p_Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, l_Readback, l_Regions);
+
+    // Images coming from an undefined layout stay in transfer source, anything else gets its layout back
+    if (l_Layout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL && l_Layout != VK_IMAGE_LAYOUT_UNDEFINED && l_Layout != VK_IMAGE_LAYOUT_PREINITIALIZED)
+    {
+        VulkanMemoryBarrierBuilder l_BarrierBuilder{m_Device, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0};
+        l_BarrierBuilder.addImageMemoryBarrier(l_Image, l_Layout);
+        p_CommandBuffer.cmdPipelineBarrier(l_BarrierBuilder);
+        l_Image.setLayout(l_Layout);
+    }
+
+    VulkanMemoryBarrierBuilder l_After{m_Device, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0};
+    l_After.addBufferMemoryBarrier(l_Readback, 0, l_Size, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT);
+    p_CommandBuffer.cmdPipelineBarrier(l_After);
+
+    m_Pending.push_back({p_Fence, VulkanContext::getDevice(m_Device).getFence(p_Fence).getSubmitCount(), l_PoolIndex, l_Size, std::move(p_Callback)});
+}
+
+std::future<std::vector<uint8_t>> VulkanReadbackManager::readImage(const VulkanCommandBuffer& p_CommandBuffer, const ResourceID p_Fence, const ResourceID p_Image, const uint32_t p_BytesPerPixel)
+{
+    const std::shared_ptr<std::promise<std::vector<uint8_t>>> l_Promise = std::make_shared<std::promise<std::vector<uint8_t>>>();
+    std::future<std::vector<uint8_t>> l_Future = l_Promise->get_future();
+    readImage(p_CommandBuffer, p_Fence, p_Image, p_BytesPerPixel, toPromise(l_Promise));
+    return l_Future;
+}
+
+uint32_t VulkanReadbackManager::poll()
+{
+    if (m_Pending.empty())
+        return 0;
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+
+    TRANS_UMAP(l_FenceStates, ResourceID, bool);
+    std::vector<PendingReadback> l_Ready;
+    size_t l_Kept = 0;
+    for (size_t i = 0; i < m_Pending.size(); i++)
+    {
+        const ResourceID l_Fence = m_Pending[i].fence;
+        auto l_State = l_FenceStates.find(l_Fence);
+        if (l_State == l_FenceStates.end())
+            l_State = l_FenceStates.emplace(l_Fence, l_Device.getFence(l_Fence).poll()).first;
+
+        // The fence only covers the copy once a submission after recording signaled it
+        if (l_State->second && l_Device.getFence(l_Fence).getSubmitCount() != m_Pending[i].submitCount)
+        {
+            l_Ready.push_back(std::move(m_Pending[i]));
+            continue;
+        }
+        if (l_Kept != i)
+            m_Pending[l_Kept] = std::move(m_Pending[i]);
+        l_Kept++;
+    }
+    m_Pending.resize(l_Kept);
+
+    // Callbacks run after the pending list is consistent so they can queue new readbacks
+    for (const PendingReadback& l_Readback : l_Ready)
+    {
+        resolve(l_Readback);
+    }
+    return static_cast<uint32_t>(l_Ready.size());
+}
+
+void VulkanReadbackManager::waitAll()
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    for (const PendingReadback& l_Readback : m_Pending)
+    {
+        VulkanFence& l_Fence = l_Device.getFence(l_Readback.fence);
+        if (l_Fence.getSubmitCount() != l_Readback.submitCount && !l_Fence.isSignaled())
+            l_Fence.wait();
+    }
+    poll();
+}
+
+void VulkanReadbackManager::free()
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    if (!m_Pending.empty())
+    {
+        LOG_WARN("Freeing readback manager with ", m_Pending.size(), " pending readback(s), they will not be resolved");
+        for (const PendingReadback& l_Readback : m_Pending)
+        {
+            VulkanFence& l_Fence = l_Device.getFence(l_Readback.fence);
+            if (l_Fence.getSubmitCount() != l_Readback.submitCount)
+                l_Fence.wait();
+        }
+        m_Pending.clear();
+    }
+
+    for (const PooledBuffer& l_Buffer : m_Pool)
+    {
+        l_Device.freeBuffer(l_Buffer.buffer);
+    }
+    m_Pool.clear();
+}
+
+uint32_t VulkanReadbackManager::acquireBuffer(const VkDeviceSize p_Size)
+{
+    uint32_t l_Best = UINT32_MAX;
+    for (uint32_t i = 0; i < m_Pool.size(); i++)
+    {
+        if (!m_Pool[i].inUse && m_Pool[i].size >= p_Size && (l_Best == UINT32_MAX || m_Pool[i].size < m_Pool[l_Best].size))
+            l_Best = i;
+    }
+
+    if (l_Best == UINT32_MAX)
+    {
+        constexpr VulkanMemoryAllocator::MemoryPreferences PREFS{
+            .usage = VMA_MEMORY_USAGE_AUTO,
+            .vmaFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+            .preferredProperties = VK_MEMORY_PROPERTY_HOST_CACHED_BIT
+        };
+
+        // Power of two sizes let buffers be recycled between requests of slightly different sizes
+        const VkDeviceSize l_Size = std::bit_ceil(std::max(p_Size, MIN_READBACK_BUFFER_SIZE));
+        const ResourceID l_Buffer = VulkanContext::getDevice(m_Device).createAndAllocateBuffer(PREFS, {l_Size, VK_BUFFER_USAGE_TRANSFER_DST_BIT});
+        m_Pool.push_back({l_Buffer, l_Size, false});
+        l_Best = static_cast<uint32_t>(m_Pool.size() - 1);
+        LOG_DEBUG("Created readback buffer (ID:", l_Buffer, ") with size ", VulkanMemoryAllocator::compactBytes(l_Size));
+    }
+
+    m_Pool[l_Best].inUse = true;
+    return l_Best;
+}
+
+void VulkanReadbackManager::resolve(const PendingReadback& p_Readback)
+{
+    const VulkanBuffer& l_Buffer = VulkanContext::getDevice(m_Device).getBuffer(m_Pool[p_Readback.poolIndex].buffer);
+
+    // No-op on coherent memory, VMA skips the call
+    l_Buffer.invalidate(0, p_Readback.size);
+
+    if (p_Readback.callback)
+        p_Readback.callback({static_cast<const uint8_t*>(l_Buffer.getMappedData()), static_cast<size_t>(p_Readback.size)});
+
+    m_Pool[p_Readback.poolIndex].inUse = false;
+}
+
+VulkanReadbackManager::Callback VulkanReadbackManager::toPromise(const std::shared_ptr<std::promise<std::vector<uint8_t>>>& p_Promise)
+{
+    return [p_Promise](const std::span<const uint8_t> p_Data)
+    {
+        p_Promise->set_value({p_Data.begin(), p_Data.end()});
+    };
+}
+
+VulkanStagingRing::VulkanStagingRing(const ResourceID p_Device, const VkDeviceSize p_Size, const uint32_t p_QueueFamilyIndex)
+    : m_Device(p_Device)
+{
+    constexpr VulkanMemoryAllocator::MemoryPreferences PREFS{
+        .usage = VMA_MEMORY_USAGE_AUTO,
+        .vmaFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+        .preferredProperties = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    };
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    m_Buffer = l_Device.createAndAllocateBuffer(PREFS, {p_Size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, p_QueueFamilyIndex});
+    m_Data = static_cast<uint8_t*>(l_Device.getBuffer(m_Buffer).map(p_Size, 0));
+    m_Size = p_Size;
+}
+
+bool VulkanStagingRing::allocate(const VkDeviceSize p_Size, const VkDeviceSize p_Alignment, Range& p_Range)
+{
+    if (m_Buffer == UINT32_MAX)
+    {
+        throw std::runtime_error("Tried to allocate from a freed staging ring");
+    }
+    if (p_Size == 0 || p_Size > m_Size)
+        return false;
+
+    VkDeviceSize l_Begin;
+    if (m_Allocations.empty())
+    {
+        l_Begin = 0;
+    }
+    else
+    {
+        const VkDeviceSize l_Tail = m_Allocations.front().begin;
+        l_Begin = alignUp(m_Head, p_Alignment);
+        if (m_Head > l_Tail)
+        {
+            // Live ranges are [tail, head), try the end of the buffer first and wrap around if it doesn't fit
+            if (l_Begin + p_Size > m_Size)
+            {
+                if (p_Size > l_Tail)
+                    return false;
+                l_Begin = 0;
+            }
+        }
+        else if (l_Begin + p_Size > l_Tail)
+        {
+            return false;
+        }
+    }
+
+    m_Allocations.push_back({l_Begin, l_Begin + p_Size, UINT64_MAX, false});
+    m_Head = l_Begin + p_Size;
+
+    p_Range = {l_Begin, p_Size, m_Data + l_Begin};
+    return true;
+}
+
+void VulkanStagingRing::retire(const uint64_t p_Serial)
+{
+    for (auto l_It = m_Allocations.rbegin(); l_It != m_Allocations.rend() && l_It->serial == UINT64_MAX; ++l_It)
+    {
+        l_It->serial = p_Serial;
+    }
+}
+
+void VulkanStagingRing::retire(const VkDeviceSize p_Offset, const uint64_t p_Serial)
+{
+    for (Allocation& l_Allocation : m_Allocations)
+    {
+        if (l_Allocation.begin == p_Offset && l_Allocation.serial == UINT64_MAX)
+        {
+            l_Allocation.serial = p_Serial;
+            return;
+        }
+    }
+    LOG_WARN("Tried to retire staging ring range at offset ", p_Offset, ", but no unretired range starts there");
+}
+
+VkDeviceSize VulkanStagingRing::complete(const uint64_t p_Serial)
+{
+    for (Allocation& l_Allocation : m_Allocations)
+    {
+        if (l_Allocation.serial == p_Serial)
+            l_Allocation.done = true;
+    }
+
+    VkDeviceSize l_Freed = 0;
+    while (!m_Allocations.empty() && m_Allocations.front().done)
+    {
+        l_Freed += m_Allocations.front().end - m_Allocations.front().begin;
+        m_Allocations.pop_front();
+    }
+
+    if (m_Allocations.empty())
+        m_Head = 0;
+    return l_Freed;
+}
+
+void VulkanStagingRing::free()
+{
+    if (m_Buffer != UINT32_MAX)
+    {
+        if (!m_Allocations.empty())
+        {
+            LOG_WARN("Freeing staging ring (buffer ID:", m_Buffer, ") with ", m_Allocations.size(), " range(s) still in use");
+        }
+        VulkanContext::getDevice(m_Device).freeBuffer(m_Buffer);
+        m_Buffer = UINT32_MAX;
+        m_Data = nullptr;
+        m_Size = 0;
+    }
+    m_Allocations.clear();
+    m_Head = 0;
+}
+
+VulkanFileStreamer::VulkanFileStreamer(const ResourceID p_Device, const QueueSelection p_Queue, const ThreadID p_ThreadID, const VkDeviceSize p_RingSize)
+    : m_Device(p_Device), m_Queue(p_Queue), m_ThreadID(p_ThreadID), m_Ring(p_Device, p_RingSize, p_Queue.familyIndex)
+{
+    // Small enough chunks that copying into the ring overlaps with the GPU draining earlier ones
+    setChunkSize(p_RingSize / 4);
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    const QueueFamily l_Family = l_Device.getGPU().getQueueFamilies().getQueueFamily(m_Queue.familyIndex);
+    l_Device.initializeCommandPool(l_Family, m_ThreadID, true);
+    for (Batch& l_Batch : m_Batches)
+    {
+        l_Batch.commandBuffer = l_Device.createCommandBuffer(l_Family, m_ThreadID, false);
+        l_Batch.fence = l_Device.createFence(false);
+    }
+}
+
+void VulkanFileStreamer::uploadFile(const std::string_view p_Path, const VkDeviceSize p_FileOffset, const VkDeviceSize p_Size, const ResourceID p_Buffer, const VkDeviceSize p_BufferOffset)
+{
+    MappedFile l_File{p_Path};
+    if (p_FileOffset >= l_File.getSize())
+    {
+        throw std::runtime_error("Tried to stream file " + std::string(p_Path) + " from offset " + std::to_string(p_FileOffset) + ", but the file is only " + std::to_string(l_File.getSize()) + " bytes");
+    }
+
+    const VkDeviceSize l_Size = p_Size == VK_WHOLE_SIZE ? l_File.getSize() - p_FileOffset : p_Size;
+    if (p_FileOffset + l_Size > l_File.getSize())
+    {
+        throw std::runtime_error("Tried to stream " + std::to_string(l_Size) + " bytes past the end of file " + std::string(p_Path));
+    }
+
+    if (m_ImportEnabled && tryImport(l_File, p_FileOffset, l_Size, p_Buffer, p_BufferOffset))
+    {
+        LOG_DEBUG("Imported ", VulkanMemoryAllocator::compactBytes(l_Size), " of file ", p_Path, " for buffer (ID:", p_Buffer, ") without staging");
+        return;
+    }
+
+    copyThroughRing(l_File, p_FileOffset, l_Size, p_Buffer, p_BufferOffset);
+}
+
+void VulkanFileStreamer::uploadFileAsync(const std::string_view p_Path, const VkDeviceSize p_FileOffset, const VkDeviceSize p_Size, const ResourceID p_Buffer, const VkDeviceSize p_BufferOffset)
+{
+    if (!m_Reader)
+        m_Reader = new AsyncFileReader();
+
+    const AsyncFileReader::FileHandle l_File = m_Reader->openFile(p_Path);
+    const VkDeviceSize l_FileSize = m_Reader->getFileSize(l_File);
+    const VkDeviceSize l_Size = p_Size == VK_WHOLE_SIZE && p_FileOffset < l_FileSize ? l_FileSize - p_FileOffset : p_Size;
+    if (p_FileOffset >= l_FileSize || p_FileOffset + l_Size > l_FileSize)
+    {
+        m_Reader->closeFile(l_File);
+        throw std::runtime_error("Tried to stream " + std::to_string(l_Size) + " bytes from offset " + std::to_string(p_FileOffset) + " of file " + std::string(p_Path) + ", which is only " + std::to_string(l_FileSize) + " bytes");
+    }
+
+    m_AsyncUploads[m_NextUpload++] = {l_File, p_FileOffset, l_Size, 0, p_Buffer, p_BufferOffset, 0};
+    issueReads();
+}
+
+bool VulkanFileStreamer::pump(const bool p_Block)
+{
+    if (m_AsyncUploads.empty())
+        return false;
+
+    const bool l_Stalled = !issueReads();
+
+    std::vector<AsyncFileReader::Completion> l_Completions;
+    if (p_Block)
+        m_Reader->wait(l_Completions);
+    else
+        m_Reader->poll(l_Completions);
+
+    for (const AsyncFileReader::Completion& l_Completion : l_Completions)
+    {
+        completeRead(l_Completion);
+    }
+
+    // Submitting as soon as reads dry up keeps the GPU copy overlapping with the next reads, the size cap keeps batches from hoarding the ring
+    const Batch& l_Batch = m_Batches[m_CurrentBatch];
+    if (l_Batch.recording && (m_ChunkReads.empty() || l_Stalled || l_Batch.recordedBytes >= m_Ring.getSize() / 2))
+        submit();
+
+    // Nothing is being read and the ring is full, the space has to come back from the GPU
+    if (p_Block && l_Stalled && m_ChunkReads.empty())
+        waitOldestBatch();
+
+    issueReads();
+    return !m_AsyncUploads.empty();
+}
+
+void VulkanFileStreamer::submit()
+{
+    Batch& l_Batch = m_Batches[m_CurrentBatch];
+    if (!l_Batch.recording)
+        return;
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    VulkanCommandBuffer& l_CommandBuffer = l_Device.getCommandBuffer(l_Batch.commandBuffer, m_ThreadID);
+    l_CommandBuffer.endRecording();
+    l_CommandBuffer.submit(l_Device.getQueue(m_Queue), {}, {}, l_Batch.fence);
+
+    l_Batch.serial = m_NextSerial++;
+    for (const VkDeviceSize l_RingOffset : l_Batch.ringRanges)
+    {
+        m_Ring.retire(l_RingOffset, l_Batch.serial);
+    }
+    l_Batch.ringRanges.clear();
+    l_Batch.recordedBytes = 0;
+    l_Batch.recording = false;
+    l_Batch.submitted = true;
+    m_CurrentBatch = (m_CurrentBatch + 1) % MAX_BATCHES_IN_FLIGHT;
+}
+
+void VulkanFileStreamer::waitIdle()
+{
+    while (pump(true)) {}
+    submit();
+    while (waitOldestBatch()) {}
+}
+
+void VulkanFileStreamer::setChunkSize(const VkDeviceSize p_Size)
+{
+    const VkDeviceSize l_PageSize = MappedFile::getPageSize();
+    m_ChunkSize = std::min(static_cast<VkDeviceSize>(alignUp(std::max(p_Size, l_PageSize), l_PageSize)), m_Ring.getSize());
+}
+
+void VulkanFileStreamer::free()
+{
+    waitIdle();
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    for (Batch& l_Batch : m_Batches)
+    {
+        if (l_Batch.commandBuffer != UINT32_MAX)
+            l_Device.freeCommandBuffer(l_Batch.commandBuffer, m_ThreadID);
+        if (l_Batch.fence != UINT32_MAX)
+            l_Device.freeFence(l_Batch.fence);
+        l_Batch = {};
+    }
+    m_Ring.free();
+
+    delete m_Reader;
+    m_Reader = nullptr;
+}
+
+VulkanCommandBuffer& VulkanFileStreamer::getRecordingCommandBuffer()
+{
+    Batch& l_Batch = m_Batches[m_CurrentBatch];
+    VulkanCommandBuffer& l_CommandBuffer = VulkanContext::getDevice(m_Device).getCommandBuffer(l_Batch.commandBuffer, m_ThreadID);
+    if (!l_Batch.recording)
+    {
+        recycleBatch(l_Batch);
+        l_CommandBuffer.reset();
+        l_CommandBuffer.beginRecording(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+        l_Batch.recording = true;
+    }
+    return l_CommandBuffer;
+}
+
+void VulkanFileStreamer::recycleBatch(Batch& p_Batch)
+{
+    if (!p_Batch.submitted)
+        return;
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    VulkanFence& l_Fence = l_Device.getFence(p_Batch.fence);
+    if (!l_Fence.isSignaled())
+        l_Fence.wait();
+
+    // The ring only knows the serial, so resetting the fence can't strand ranges still queued behind an older one
+    m_Ring.complete(p_Batch.serial);
+    l_Fence.reset();
+
+    VulkanExternalMemoryHostExtension* l_HostMemory = VulkanExternalMemoryHostExtension::get(l_Device);
+    for (const ResourceID l_Import : p_Batch.importedBuffers)
+    {
+        l_HostMemory->freeImportedBuffer(l_Import);
+    }
+    p_Batch.importedBuffers.clear();
+    p_Batch.files.clear();
+    p_Batch.submitted = false;
+}
+
+void VulkanFileStreamer::recycleFinishedBatches()
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_Device);
+    for (Batch& l_Batch : m_Batches)
+    {
+        if (l_Batch.submitted && l_Device.getFence(l_Batch.fence).poll())
+            recycleBatch(l_Batch);
+    }
+}
+
+bool VulkanFileStreamer::waitOldestBatch()
+{
+    // Batches are submitted round robin, so the first submitted one after the current slot is the oldest
+    for (uint32_t i = 0; i < MAX_BATCHES_IN_FLIGHT; i++)
+    {
+        Batch& l_Batch = m_Batches[(m_CurrentBatch + i) % MAX_BATCHES_IN_FLIGHT];
+        if (l_Batch.submitted)
+        {
+            recycleBatch(l_Batch);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool VulkanFileStreamer::tryImport(MappedFile& p_File, const VkDeviceSize p_FileOffset, const VkDeviceSize p_Size, const ResourceID p_Buffer, const VkDeviceSize p_BufferOffset)
+{
+    VulkanExternalMemoryHostExtension* l_HostMemory = VulkanExternalMemoryHostExtension::get(m_Device);
+    if (!l_HostMemory)
+        return false;
+
+    // The import is widened to the driver's alignment, which must not reach outside of the mapped pages
+    const VkDeviceSize l_Alignment = l_HostMemory->getMinImportedHostPointerAlignment();
+    const uintptr_t l_MappingBegin = reinterpret_cast<uintptr_t>(p_File.getData());
+    const uintptr_t l_MappingEnd = alignUp(l_MappingBegin + p_File.getSize(), MappedFile::getPageSize());
+    const uintptr_t l_ImportBegin = (l_MappingBegin + p_FileOffset) & ~(l_Alignment - 1);
+    const uintptr_t l_ImportEnd = alignUp(l_MappingBegin + p_FileOffset + p_Size, l_Alignment);
+    if (l_ImportBegin < l_MappingBegin || l_ImportEnd > l_MappingEnd)
+        return false;
+
+    const VulkanExternalMemoryHostExtension::HostImport l_Import = l_HostMemory->importHostPointer(p_File.getData() + p_FileOffset, p_Size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    if (l_Import.buffer == UINT32_MAX)
+        return false;
+
+    const VulkanCommandBuffer& l_CommandBuffer = getRecordingCommandBuffer();
+    const std::array<VkBufferCopy, 1> l_Regions = {{{l_Import.offset, p_BufferOffset, p_Size}}};
+    l_CommandBuffer.cmdCopyBuffer(l_Import.buffer, p_Buffer, l_Regions);
+
+    Batch& l_Batch = m_Batches[m_CurrentBatch];
+    l_Batch.importedBuffers.push_back(l_Import.buffer);
+    l_Batch.files.push_back(std::move(p_File));
+    return true;
+}
+
+void VulkanFileStreamer::copyThroughRing(const MappedFile& p_File, const VkDeviceSize p_FileOffset, const VkDeviceSize p_Size, const ResourceID p_Buffer, const VkDeviceSize p_BufferOffset)
+{
+    p_File.adviseSequential();
+    p_File.prefetch(p_FileOffset, m_ChunkSize);
+
+    VkDeviceSize l_Done = 0;
+    while (l_Done < p_Size)
+    {
+        const VkDeviceSize l_ChunkSize = std::min(m_ChunkSize, p_Size - l_Done);
+
+        // Page in the next chunk while this one is copied
+        p_File.prefetch(p_FileOffset + l_Done + l_ChunkSize, m_ChunkSize);
+
+        VulkanStagingRing::Range l_Range;
+        while (!m_Ring.allocate(l_ChunkSize, 16, l_Range))
+        {
+            submit();
+            if (waitOldestBatch())
+                continue;
+
+            // The rest of the ring is held by async reads that haven't been recorded yet
+            if (!m_ChunkReads.empty())
+            {
+                pump(true);
+                continue;
+            }
+            throw std::runtime_error("Staging ring (buffer ID:" + std::to_string(m_Ring.getBuffer()) + ") can't fit a chunk of " + std::to_string(l_ChunkSize) + " bytes");
+        }
+
+        CopyEngine::copy(l_Range.data, p_File.getData() + p_FileOffset + l_Done, l_ChunkSize);
+        recordRingCopy(l_Range.offset, p_Buffer, p_BufferOffset + l_Done, l_ChunkSize);
+
+        l_Done += l_ChunkSize;
+    }
+    LOG_DEBUG("Streamed ", VulkanMemoryAllocator::compactBytes(p_Size), " into buffer (ID:", p_Buffer, ") through staging ring");
+}
+
+void VulkanFileStreamer::recordRingCopy(const VkDeviceSize p_RingOffset, const ResourceID p_Buffer, const VkDeviceSize p_BufferOffset, const VkDeviceSize p_Size)
+{
+    const VulkanCommandBuffer& l_CommandBuffer = getRecordingCommandBuffer();
+    VulkanContext::getDevice(m_Device).getBuffer(m_Ring.getBuffer()).markDirty(p_RingOffset, p_Size);
+
+    const std::array<VkBufferCopy, 1> l_Regions = {{{p_RingOffset, p_BufferOffset, p_Size}}};
+    l_CommandBuffer.cmdCopyBuffer(m_Ring.getBuffer(), p_Buffer, l_Regions);
+
+    Batch& l_Batch = m_Batches[m_CurrentBatch];
+    l_Batch.ringRanges.push_back(p_RingOffset);
+    l_Batch.recordedBytes += p_Size;
+}
+
+bool VulkanFileStreamer::issueReads()
+{
+    recycleFinishedBatches();
+
+    for (auto& [l_ID, l_Upload] : m_AsyncUploads)
+    {
+        while (l_Upload.issued < l_Upload.size)
+        {
+            const VkDeviceSize l_ChunkSize = std::min(m_ChunkSize, l_Upload.size - l_Upload.issued);
+
+            VulkanStagingRing::Range l_Range;
+            if (!m_Ring.allocate(l_ChunkSize, 16, l_Range))
+                return false;
+
+            const AsyncFileReader::RequestID l_Request = m_Reader->read(l_Upload.file, l_Upload.fileOffset + l_Upload.issued, l_ChunkSize, l_Range.data);
+            m_ChunkReads[l_Request] = {l_ID, l_Range.offset, l_Upload.issued, l_ChunkSize};
+            l_Upload.issued += l_ChunkSize;
+            l_Upload.readsInFlight++;
+        }
+    }
+    return true;
+}
+
+void VulkanFileStreamer::completeRead(const AsyncFileReader::Completion& p_Completion)
+{
+    const auto l_Chunk = m_ChunkReads.find(p_Completion.request);
+    if (l_Chunk == m_ChunkReads.end())
+        return;
+
+    const ChunkRead l_Read = l_Chunk->second;
+    m_ChunkReads.erase(l_Chunk);
+
+    AsyncUpload& l_Upload = m_AsyncUploads.at(l_Read.upload);
+    if (!p_Completion.success)
+    {
+        throw std::runtime_error("Async read of " + std::to_string(l_Read.size) + " bytes for buffer (ID:" + std::to_string(l_Upload.buffer) + ") failed after " + std::to_string(p_Completion.bytesRead) + " bytes");
+    }
+
+    recordRingCopy(l_Read.ringOffset, l_Upload.buffer, l_Upload.bufferOffset + l_Read.uploadOffset, l_Read.size);
+
+    l_Upload.readsInFlight--;
+    if (l_Upload.issued == l_Upload.size && l_Upload.readsInFlight == 0)
+    {
+        m_Reader->closeFile(l_Upload.file);
+        LOG_DEBUG("Finished async stream of ", VulkanMemoryAllocator::compactBytes(l_Upload.size), " into buffer (ID:", l_Upload.buffer, ")");
+        m_AsyncUploads.erase(l_Read.upload);
+    }
+}